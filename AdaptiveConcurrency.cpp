@@ -0,0 +1,181 @@
+#include "AdaptiveConcurrency.h"
+#include <algorithm>
+
+std::string ConcurrencySettings::toString() const {
+    return std::to_string(readsInFlight) + " reads in flight, " + std::to_string(extentSectors) +
+           " sectors per extent, " + std::to_string(hasherCount) + " hashers";
+}
+
+AdaptiveConcurrencyController::AdaptiveConcurrencyController(const ConcurrencySettings& initial,
+                                                             const ConcurrencySettings& minimum,
+                                                             const ConcurrencySettings& maximum,
+                                                             std::chrono::milliseconds window)
+    : current_(initial), previous_(initial), minimum_(minimum), maximum_(maximum), window_(window),
+      windowBytes_(0), windowBusyNanos_(0), occupancySum_(0.0), occupancySamples_(0), started_(false),
+      bestThroughput_(0.0), trial_(NO_MOVE), warmingUp_(false), trials_(0), settled_(false) {
+    std::fill(exhausted_, exhausted_ + MOVE_COUNT, false);
+
+    // Keep the starting point inside the limits
+    current_.readsInFlight = std::max(minimum_.readsInFlight, std::min(maximum_.readsInFlight, current_.readsInFlight));
+    current_.extentSectors = std::max(minimum_.extentSectors, std::min(maximum_.extentSectors, current_.extentSectors));
+    current_.hasherCount = std::max(minimum_.hasherCount, std::min(maximum_.hasherCount, current_.hasherCount));
+    previous_ = current_;
+}
+
+bool AdaptiveConcurrencyController::sample(uint64_t bytesDone, uint64_t hasherBusyNanos, double queueOccupancy) {
+    Clock::time_point now = Clock::now();
+    if (!started_) {
+        started_ = true;
+        windowStart_ = now;
+        windowBytes_ = bytesDone;
+        windowBusyNanos_ = hasherBusyNanos;
+        return false;
+    }
+
+    occupancySum_ += queueOccupancy;
+    ++occupancySamples_;
+    if (settled_ || now - windowStart_ < window_) {
+        return false;
+    }
+
+    // Close the window
+    double seconds = std::chrono::duration<double>(now - windowStart_).count();
+    double throughput = static_cast<double>(bytesDone - windowBytes_) / seconds;
+    double utilisation = static_cast<double>(hasherBusyNanos - windowBusyNanos_) /
+                         (seconds * 1e9 * current_.hasherCount);
+    double occupancy = occupancySum_ / occupancySamples_;
+
+    windowStart_ = now;
+    windowBytes_ = bytesDone;
+    windowBusyNanos_ = hasherBusyNanos;
+    occupancySum_ = 0.0;
+    occupancySamples_ = 0;
+
+    // The window right after a change mixes old and new settings
+    if (warmingUp_) {
+        warmingUp_ = false;
+        return false;
+    }
+
+    if (trial_ == NO_MOVE) {
+        // Baseline of the accepted settings
+        bestThroughput_ = throughput;
+    } else {
+        Move tried = trial_;
+        trial_ = NO_MOVE;
+
+        bool keep = addsResources(tried) ? throughput > bestThroughput_ * (1.0 + NOISE_THRESHOLD)
+                                         : throughput >= bestThroughput_ * (1.0 - NOISE_THRESHOLD);
+        if (!keep) {
+            exhausted_[tried] = true;
+            current_ = previous_;
+            warmingUp_ = true;
+            return true;
+        }
+
+        // New operating point: everything may be worth trying again except undoing this change.
+        // Dropping resources at equal speed must not lower the bar for later changes.
+        bestThroughput_ = std::max(bestThroughput_, throughput);
+        std::fill(exhausted_, exhausted_ + MOVE_COUNT, false);
+        exhausted_[opposite(tried)] = true;
+
+        // Keep going in the same direction while it pays off
+        ConcurrencySettings next = current_;
+        if (trials_ < MAX_TRIALS && applyMove(tried, next)) {
+            previous_ = current_;
+            current_ = next;
+            trial_ = tried;
+            warmingUp_ = true;
+            ++trials_;
+            return true;
+        }
+    }
+
+    Move move = trials_ < MAX_TRIALS ? chooseMove(utilisation, occupancy) : NO_MOVE;
+    if (move == NO_MOVE) {
+        settled_ = true;
+        return false;
+    }
+
+    previous_ = current_;
+    applyMove(move, current_);
+    trial_ = move;
+    warmingUp_ = true;
+    ++trials_;
+    return true;
+}
+
+AdaptiveConcurrencyController::Move AdaptiveConcurrencyController::chooseMove(double utilisation,
+                                                                              double occupancy) const {
+    auto usable = [this](Move move) {
+        ConcurrencySettings settings = current_;
+        return !exhausted_[move] && applyMove(move, settings);
+    };
+
+    // Follow the bottleneck first
+    if (utilisation > 0.85 && occupancy > 0.5) {
+        if (usable(MORE_HASHERS)) return MORE_HASHERS;
+    } else if (occupancy < 0.25 && utilisation < 0.85) {
+        if (usable(MORE_READS)) return MORE_READS;
+        if (usable(LARGER_EXTENTS)) return LARGER_EXTENTS;
+    }
+    if (utilisation < 0.5 && usable(FEWER_HASHERS)) {
+        return FEWER_HASHERS;
+    }
+    if (occupancy > 0.75 && usable(FEWER_READS)) {
+        return FEWER_READS; // The queue backs up, so extra reads in flight only hold memory
+    }
+
+    // Then any growth not yet ruled out at this operating point
+    for (Move move : {MORE_READS, LARGER_EXTENTS, MORE_HASHERS}) {
+        if (usable(move)) {
+            return move;
+        }
+    }
+    return NO_MOVE;
+}
+
+bool AdaptiveConcurrencyController::applyMove(Move move, ConcurrencySettings& settings) const {
+    ConcurrencySettings before = settings;
+    int hasherStep = std::max(1, settings.hasherCount / 4);
+
+    switch (move) {
+    case MORE_READS:
+        settings.readsInFlight = std::min(maximum_.readsInFlight, settings.readsInFlight + 1);
+        break;
+    case FEWER_READS:
+        settings.readsInFlight = std::max(minimum_.readsInFlight, settings.readsInFlight - 1);
+        break;
+    case LARGER_EXTENTS:
+        settings.extentSectors = std::min(maximum_.extentSectors, settings.extentSectors * 2);
+        break;
+    case SMALLER_EXTENTS:
+        settings.extentSectors = std::max(minimum_.extentSectors, settings.extentSectors / 2);
+        break;
+    case MORE_HASHERS:
+        settings.hasherCount = std::min(maximum_.hasherCount, settings.hasherCount + hasherStep);
+        break;
+    case FEWER_HASHERS:
+        settings.hasherCount = std::max(minimum_.hasherCount, settings.hasherCount - hasherStep);
+        break;
+    default:
+        break;
+    }
+    return settings != before;
+}
+
+bool AdaptiveConcurrencyController::addsResources(Move move) {
+    return move == MORE_READS || move == LARGER_EXTENTS || move == MORE_HASHERS;
+}
+
+AdaptiveConcurrencyController::Move AdaptiveConcurrencyController::opposite(Move move) {
+    switch (move) {
+    case MORE_READS: return FEWER_READS;
+    case FEWER_READS: return MORE_READS;
+    case LARGER_EXTENTS: return SMALLER_EXTENTS;
+    case SMALLER_EXTENTS: return LARGER_EXTENTS;
+    case MORE_HASHERS: return FEWER_HASHERS;
+    case FEWER_HASHERS: return MORE_HASHERS;
+    default: return NO_MOVE;
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef ADAPTIVE_CONCURRENCY_H
+#define ADAPTIVE_CONCURRENCY_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Knobs of a read -> hash pipeline
+struct ConcurrencySettings {
+    int readsInFlight = 1;          // Reads outstanding at the device
+    uint32_t extentSectors = 256;   // Sectors per unit of hashing work
+    int hasherCount = 1;            // Hashing threads allowed to run
+
+    bool operator==(const ConcurrencySettings& other) const {
+        return readsInFlight == other.readsInFlight && extentSectors == other.extentSectors &&
+               hasherCount == other.hasherCount;
+    }
+    bool operator!=(const ConcurrencySettings& other) const { return !(*this == other); }
+
+    std::string toString() const;
+};
+
+// Hill-climbing tuner for a read -> hash pipeline. The pipeline reports cumulative progress
+// from its coordinating thread; once per sampling window the controller measures throughput,
+// hasher utilisation and queue occupancy, and tries one change at a time:
+//
+//   - hashers saturated while the queue backs up: add hashers
+//   - queue running dry while hashers idle: deepen I/O (more reads in flight, larger extents)
+//   - hashers mostly idle: drop hashers to avoid over-subscription
+//   - queue backed up: drop reads in flight, they only hold buffers
+//   - no clear signal: try any growth not yet ruled out
+//
+// A change that adds resources is kept only if throughput improves by more than the noise
+// threshold; one that removes resources is kept if throughput does not drop by more than it.
+// Rejected changes are reverted and not retried until another change is accepted. When no
+// change is left to try the controller settles and leaves the settings alone.
+class AdaptiveConcurrencyController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    AdaptiveConcurrencyController(const ConcurrencySettings& initial, const ConcurrencySettings& minimum,
+                                  const ConcurrencySettings& maximum,
+                                  std::chrono::milliseconds window = std::chrono::milliseconds(500));
+
+    // Report cumulative bytes completed, cumulative nanoseconds spent hashing (summed over all
+    // hashers) and the current fill level of the hand-off queue (0..1). Cheap between window
+    // boundaries. Returns true when settings() changed and should be applied.
+    bool sample(uint64_t bytesDone, uint64_t hasherBusyNanos, double queueOccupancy);
+
+    const ConcurrencySettings& settings() const { return current_; }
+    bool isSettled() const { return settled_; }
+
+    // Throughput of the accepted settings in bytes per second, 0 before the first measurement
+    double bestThroughput() const { return bestThroughput_; }
+
+private:
+    enum Move {
+        MORE_READS, LARGER_EXTENTS, MORE_HASHERS, FEWER_HASHERS, FEWER_READS, SMALLER_EXTENTS,
+        MOVE_COUNT, NO_MOVE = MOVE_COUNT
+    };
+
+    static constexpr double NOISE_THRESHOLD = 0.05;
+    static constexpr int MAX_TRIALS = 32;   // Hard stop in case noise keeps accepting changes
+
+    ConcurrencySettings current_;
+    ConcurrencySettings previous_;
+    ConcurrencySettings minimum_;
+    ConcurrencySettings maximum_;
+    Clock::duration window_;
+
+    Clock::time_point windowStart_;
+    uint64_t windowBytes_;
+    uint64_t windowBusyNanos_;
+    double occupancySum_;
+    uint32_t occupancySamples_;
+    bool started_;
+
+    double bestThroughput_;
+    Move trial_;
+    bool warmingUp_;
+    bool exhausted_[MOVE_COUNT];
+    int trials_;
+    bool settled_;
+
+    Move chooseMove(double utilisation, double occupancy) const;
+    bool applyMove(Move move, ConcurrencySettings& settings) const;
+    static bool addsResources(Move move);
+    static Move opposite(Move move);
+};
+
+#endif // ADAPTIVE_CONCURRENCY_H
@@ -0,0 +1,139 @@
+#include "AsyncJob.h"
+#include "EnhancedDiskSectorCRC.h"
+#include <atomic>
+#include <exception>
+#include <thread>
+
+struct JobHandle::State {
+    using Clock = std::chrono::steady_clock;
+
+    StopSource stopSource;
+    std::promise<JobResult> promise;
+    std::shared_future<JobResult> future;
+    AsyncJobs::ProgressCallback progressCallback;
+
+    Clock::time_point startTime;
+    std::atomic<int64_t> elapsedNanos{-1};     // Set when the job finishes
+    std::atomic<uint64_t> processed{0};
+    std::atomic<uint64_t> total{0};
+};
+
+void JobHandle::requestStop() {
+    if (state_) {
+        state_->stopSource.requestStop();
+    }
+}
+
+StopToken JobHandle::stopToken() const {
+    return state_ ? state_->stopSource.token() : StopToken();
+}
+
+JobStatistics JobHandle::statistics() const {
+    JobStatistics statistics;
+    if (!state_) {
+        return statistics;
+    }
+
+    int64_t elapsedNanos = state_->elapsedNanos.load();
+    statistics.finished = elapsedNanos >= 0;
+    if (!statistics.finished) {
+        elapsedNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            State::Clock::now() - state_->startTime).count();
+    }
+
+    statistics.processed = state_->processed.load();
+    statistics.total = state_->total.load();
+    statistics.elapsedSeconds = elapsedNanos / 1e9;
+    if (statistics.elapsedSeconds > 0.0) {
+        statistics.itemsPerSecond = statistics.processed / statistics.elapsedSeconds;
+    }
+    statistics.stopRequested = state_->stopSource.stopRequested();
+    return statistics;
+}
+
+bool JobHandle::isFinished() const {
+    return state_ && state_->elapsedNanos.load() >= 0;
+}
+
+std::shared_future<JobResult> JobHandle::result() const {
+    return state_ ? state_->future : std::shared_future<JobResult>();
+}
+
+JobHandle AsyncJobs::start(Body body, ProgressCallback progressCallback) {
+    JobHandle handle;
+    handle.state_ = std::make_shared<JobHandle::State>();
+    std::shared_ptr<JobHandle::State> state = handle.state_;
+    state->future = state->promise.get_future().share();
+    state->progressCallback = std::move(progressCallback);
+    state->startTime = JobHandle::State::Clock::now();
+
+    // The thread owns a reference to the state, so the job outlives every handle
+    std::thread([state, body]() {
+        ProgressCallback progress = [state](int processed, int total) {
+            state->processed.store(static_cast<uint64_t>(processed));
+            state->total.store(static_cast<uint64_t>(total));
+            if (state->progressCallback) {
+                state->progressCallback(processed, total);
+            }
+        };
+
+        JobResult result;
+        try {
+            result = body(state->stopSource.token(), progress);
+        } catch (const std::exception& e) {
+            result.success = false;
+            result.error = std::string("Job failed: ") + e.what();
+        }
+
+        state->elapsedNanos.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            JobHandle::State::Clock::now() - state->startTime).count());
+        state->promise.set_value(result);
+    }).detach();
+
+    return handle;
+}
+
+// Run one operation on a private engine bound to the job's stop token
+template <typename Operation>
+static JobHandle startDiskJob(const std::string& diskPath, Operation operation,
+                              AsyncJobs::ProgressCallback progressCallback) {
+    return AsyncJobs::start([diskPath, operation](const StopToken& stopToken,
+                                                  const AsyncJobs::ProgressCallback& progress) {
+        EnhancedDiskSectorCRC disk(diskPath);
+        disk.setStopToken(stopToken);
+
+        JobResult result;
+        result.success = operation(disk, progress);
+        if (!result.success) {
+            result.error = disk.getLastError();
+            if (result.error.empty() && stopToken.stopRequested()) {
+                result.error = "Operation cancelled by user";
+            }
+        }
+        return result;
+    }, std::move(progressCallback));
+}
+
+JobHandle AsyncJobs::generateChecksums(const std::string& diskPath, uint64_t startSector, uint64_t sectorCount,
+                                       const std::string& outputFile, int processorThreads,
+                                       ProgressCallback progressCallback) {
+    return startDiskJob(diskPath, [=](EnhancedDiskSectorCRC& disk, const ProgressCallback& progress) {
+        return disk.generateChecksumsHighPerformance(startSector, sectorCount, outputFile, 1, processorThreads,
+                                                     progress);
+    }, std::move(progressCallback));
+}
+
+JobHandle AsyncJobs::verifyIntegrity(const std::string& diskPath, const std::string& checksumFile,
+                                     int processorThreads, ProgressCallback progressCallback) {
+    return startDiskJob(diskPath, [=](EnhancedDiskSectorCRC& disk, const ProgressCallback& progress) {
+        return disk.verifyIntegrityHighPerformance(checksumFile, 1, processorThreads, progress);
+    }, std::move(progressCallback));
+}
+
+JobHandle AsyncJobs::repairData(const std::string& diskPath, const std::string& checksumFile,
+                                const std::string& backupDiskPath, int threadCount,
+                                ProgressCallback progressCallback) {
+    return startDiskJob(diskPath, [=](EnhancedDiskSectorCRC& disk, const ProgressCallback& progress) {
+        return disk.repairDataParallel(checksumFile, backupDiskPath, threadCount, progress);
+    }, std::move(progressCallback));
+}
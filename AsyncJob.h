@@ -0,0 +1,79 @@
+#ifndef ASYNC_JOB_H
+#define ASYNC_JOB_H
+
+#include "StopToken.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+
+struct JobResult {
+    bool success = false;
+    std::string error;      // getLastError() of the engine when success is false
+};
+
+// Snapshot of a job's progress; cheap to take from any thread while the job runs
+struct JobStatistics {
+    uint64_t processed = 0;     // Last value reported by the engine's progress callback
+    uint64_t total = 0;
+    double elapsedSeconds = 0.0;
+    double itemsPerSecond = 0.0;
+    bool stopRequested = false;
+    bool finished = false;
+};
+
+// Handle to a job started by AsyncJobs. Copies refer to the same job; dropping every handle
+// does not stop it.
+class JobHandle {
+public:
+    JobHandle() = default;
+
+    bool valid() const { return state_ != nullptr; }
+
+    // Ask the job to stop; it finishes its current unit of work and reports failure
+    void requestStop();
+    StopToken stopToken() const;
+
+    JobStatistics statistics() const;
+    bool isFinished() const;
+
+    // Result, ready once the job has finished
+    std::shared_future<JobResult> result() const;
+    JobResult wait() const { return result().get(); }
+
+private:
+    friend class AsyncJobs;
+    struct State;
+    std::shared_ptr<State> state_;
+};
+
+// Non-blocking front end for the disk engines. Every job runs on its own thread with its own
+// EnhancedDiskSectorCRC instance and stop source, so jobs on one process - even on the same
+// disk - neither block the caller nor cancel or reset each other. CPU work still goes to the
+// shared work-stealing pool. Progress callbacks may be called from several threads at once.
+//
+// Jobs still running when the process exits are abandoned; wait for them or stop them first.
+class AsyncJobs {
+public:
+    using ProgressCallback = std::function<void(int, int)>;
+
+    // Run an arbitrary body. It must poll the token and report progress through the callback it
+    // is given, which updates the statistics and forwards to progressCallback.
+    using Body = std::function<JobResult(const StopToken& stopToken, const ProgressCallback& progress)>;
+    static JobHandle start(Body body, ProgressCallback progressCallback = nullptr);
+
+    static JobHandle generateChecksums(const std::string& diskPath, uint64_t startSector, uint64_t sectorCount,
+                                       const std::string& outputFile, int processorThreads = 0,
+                                       ProgressCallback progressCallback = nullptr);
+
+    static JobHandle verifyIntegrity(const std::string& diskPath, const std::string& checksumFile,
+                                     int processorThreads = 0, ProgressCallback progressCallback = nullptr);
+
+    static JobHandle repairData(const std::string& diskPath, const std::string& checksumFile,
+                                const std::string& backupDiskPath, int threadCount = 4,
+                                ProgressCallback progressCallback = nullptr);
+};
+
+#endif // ASYNC_JOB_H
@@ -0,0 +1,300 @@
+#include "BadBlockMap.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+void BadBlockMap::add(uint64_t startSector, uint64_t sectorCount) {
+    if (sectorCount == 0) {
+        return;
+    }
+    uint64_t endSector = startSector + sectorCount;
+
+    // Absorb every range touching [startSector, endSector)
+    auto it = ranges_.upper_bound(startSector);
+    if (it != ranges_.begin()) {
+        auto previous = std::prev(it);
+        if (previous->first + previous->second >= startSector) {
+            it = previous;
+        }
+    }
+    while (it != ranges_.end() && it->first <= endSector) {
+        startSector = std::min(startSector, it->first);
+        endSector = std::max(endSector, it->first + it->second);
+        it = ranges_.erase(it);
+    }
+    ranges_[startSector] = endSector - startSector;
+}
+
+void BadBlockMap::remove(uint64_t startSector, uint64_t sectorCount) {
+    if (sectorCount == 0) {
+        return;
+    }
+    uint64_t endSector = startSector + sectorCount;
+
+    auto it = ranges_.upper_bound(startSector);
+    if (it != ranges_.begin()) {
+        --it;
+    }
+    while (it != ranges_.end() && it->first < endSector) {
+        uint64_t rangeStart = it->first;
+        uint64_t rangeEnd = it->first + it->second;
+        if (rangeEnd <= startSector) {
+            ++it;
+            continue;
+        }
+        it = ranges_.erase(it);
+        if (rangeStart < startSector) {
+            ranges_[rangeStart] = startSector - rangeStart;
+        }
+        if (rangeEnd > endSector) {
+            ranges_[endSector] = rangeEnd - endSector;
+        }
+    }
+}
+
+void BadBlockMap::merge(const BadBlockMap& other) {
+    for (const auto& range : other.ranges_) {
+        add(range.first, range.second);
+    }
+}
+
+bool BadBlockMap::contains(uint64_t sector) const {
+    uint64_t startSector, sectorCount;
+    return findNext(sector, startSector, sectorCount) && startSector <= sector;
+}
+
+bool BadBlockMap::findNext(uint64_t sector, uint64_t& startSector, uint64_t& sectorCount) const {
+    auto it = ranges_.upper_bound(sector);
+    if (it != ranges_.begin()) {
+        auto previous = std::prev(it);
+        if (previous->first + previous->second > sector) {
+            it = previous;
+        }
+    }
+    if (it == ranges_.end()) {
+        return false;
+    }
+    startSector = it->first;
+    sectorCount = it->second;
+    return true;
+}
+
+uint64_t BadBlockMap::sectorCount() const {
+    uint64_t total = 0;
+    for (const auto& range : ranges_) {
+        total += range.second;
+    }
+    return total;
+}
+
+bool BadBlockMap::load(const std::string& path) {
+    ranges_.clear();
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return true;
+    }
+
+    std::string line;
+    uint64_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#' || line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        std::istringstream fields(line);
+        uint64_t startSector, sectorCount;
+        if (!(fields >> startSector >> sectorCount)) {
+            lastError_ = "Invalid bad-block map entry at line " + std::to_string(lineNumber) + ": " + path;
+            ranges_.clear();
+            return false;
+        }
+        add(startSector, sectorCount);
+    }
+    return true;
+}
+
+bool BadBlockMap::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        lastError_ = "Cannot write bad-block map: " + path;
+        return false;
+    }
+    file << "# Unreadable sectors: <start sector> <sector count>\n";
+    for (const auto& range : ranges_) {
+        file << range.first << ' ' << range.second << '\n';
+    }
+    file.flush();
+    if (!file) {
+        lastError_ = "Cannot write bad-block map: " + path;
+        return false;
+    }
+    return true;
+}
+
+RescueScheduler::RescueScheduler(uint64_t startSector, uint64_t endSector, const RescuePolicy& policy,
+                                 const BadBlockMap* knownBad)
+    : policy_(policy), endSector_(endSector), pass_(COPY), cursor_(startSector), skip_(0),
+      readStart_(0), readCount_(0), readAreaFailed_(false), outstanding_(false), failedReads_(0) {
+    policy_.maxReadSectors = std::max<uint32_t>(1, policy_.maxReadSectors);
+    policy_.minSkipSectors = std::max<uint64_t>(1, policy_.minSkipSectors);
+    policy_.maxSkipSectors = std::max(policy_.minSkipSectors, policy_.maxSkipSectors);
+
+    // Known bad sectors of the range are never read and count as bad right away
+    if (knownBad != nullptr && policy_.avoidKnownBad) {
+        uint64_t sector = startSector;
+        uint64_t badStart, badCount;
+        while (sector < endSector && knownBad->findNext(sector, badStart, badCount) && badStart < endSector) {
+            uint64_t first = std::max(badStart, sector);
+            uint64_t last = std::min(badStart + badCount, endSector);
+            known_.add(first, last - first);
+            sector = last;
+        }
+        bad_.merge(known_);
+    }
+}
+
+void RescueScheduler::addPending(uint64_t startSector, uint64_t sectorCount, bool failed) {
+    // Leave out what is known to be bad
+    uint64_t endSector = startSector + sectorCount;
+    uint64_t badStart, badCount;
+    while (startSector < endSector) {
+        uint64_t pieceEnd = endSector;
+        if (known_.findNext(startSector, badStart, badCount) && badStart < endSector) {
+            if (badStart <= startSector) {
+                startSector = badStart + badCount;
+                continue;
+            }
+            pieceEnd = badStart;
+        }
+        pending_[startSector] = Area{pieceEnd - startSector, failed};
+        startSector = pieceEnd;
+    }
+}
+
+bool RescueScheduler::next(uint64_t& firstSector, uint32_t& sectorCount) {
+    if (outstanding_) {
+        return false; // complete() the last read first
+    }
+
+    while (pass_ != DONE) {
+        if (pass_ == COPY) {
+            uint64_t badStart, badCount;
+            while (cursor_ < endSector_ && known_.findNext(cursor_, badStart, badCount) && badStart <= cursor_) {
+                cursor_ = badStart + badCount;
+            }
+            if (cursor_ >= endSector_) {
+                pass_ = TRIM;
+                continue;
+            }
+            uint64_t limit = std::min(endSector_, cursor_ + policy_.maxReadSectors);
+            if (known_.findNext(cursor_, badStart, badCount) && badStart < limit) {
+                limit = badStart;
+            }
+            readStart_ = cursor_;
+            readCount_ = static_cast<uint32_t>(limit - cursor_);
+            break;
+        }
+
+        if (pass_ == TRIM) {
+            if (pending_.empty()) {
+                pass_ = RETRY;
+                continue;
+            }
+            uint64_t areaStart = pending_.begin()->first;
+            Area area = pending_.begin()->second;
+            pending_.erase(pending_.begin());
+
+            if (area.failed) {
+                // Bisect; single sectors move on to the retry pass
+                if (area.sectorCount == 1) {
+                    if (policy_.retries > 0) {
+                        retry_[areaStart] = policy_.retries;
+                    } else {
+                        bad_.add(areaStart, 1);
+                    }
+                    continue;
+                }
+                uint64_t half = area.sectorCount / 2;
+                pending_[areaStart] = Area{half, false};
+                pending_[areaStart + half] = Area{area.sectorCount - half, false};
+                continue;
+            }
+
+            readStart_ = areaStart;
+            readCount_ = static_cast<uint32_t>(std::min<uint64_t>(area.sectorCount, policy_.maxReadSectors));
+            if (area.sectorCount > readCount_) {
+                pending_[areaStart + readCount_] = Area{area.sectorCount - readCount_, false};
+            }
+            break;
+        }
+
+        if (pass_ == RETRY) {
+            if (retry_.empty()) {
+                pass_ = DONE;
+                continue;
+            }
+            readStart_ = retry_.begin()->first;
+            readCount_ = 1;
+            break;
+        }
+    }
+    if (pass_ == DONE) {
+        return false;
+    }
+
+    outstanding_ = true;
+    firstSector = readStart_;
+    sectorCount = readCount_;
+    return true;
+}
+
+void RescueScheduler::complete(bool success, bool timedOut) {
+    if (!outstanding_) {
+        return;
+    }
+    outstanding_ = false;
+    if (!success) {
+        failedReads_++;
+        if (timedOut) {
+            slow_.add(readStart_, readCount_);
+        }
+    }
+
+    switch (pass_) {
+    case COPY:
+        if (success) {
+            skip_ = 0;
+            cursor_ = readStart_ + readCount_;
+        } else {
+            // Come back to the failed read later and jump past what is likely more of the same
+            addPending(readStart_, readCount_, true);
+            skip_ = skip_ == 0 ? policy_.minSkipSectors : std::min(policy_.maxSkipSectors, skip_ * 2);
+            uint64_t skipStart = readStart_ + readCount_;
+            uint64_t skipEnd = std::min(endSector_, skipStart + skip_);
+            if (skipEnd > skipStart) {
+                addPending(skipStart, skipEnd - skipStart, false);
+            }
+            cursor_ = std::max(skipStart, skipEnd);
+        }
+        break;
+    case TRIM:
+        if (!success && timedOut && readCount_ == 1) {
+            bad_.add(readStart_, 1);
+        } else if (!success) {
+            pending_[readStart_] = Area{readCount_, true};
+        }
+        break;
+    case RETRY: {
+        auto it = retry_.find(readStart_);
+        if (success) {
+            retry_.erase(it);
+        } else if (timedOut || --it->second <= 0) {
+            retry_.erase(it);
+            bad_.add(readStart_, 1);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef BAD_BLOCK_MAP_H
+#define BAD_BLOCK_MAP_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Sector ranges known to be unreadable, kept merged. Persisted as a small text file ("start count"
+// per line, like a ddrescue map restricted to bad areas) so later runs can avoid them.
+class BadBlockMap {
+public:
+    void add(uint64_t startSector, uint64_t sectorCount);
+    void remove(uint64_t startSector, uint64_t sectorCount);
+    void merge(const BadBlockMap& other);
+    void clear() { ranges_.clear(); }
+
+    bool contains(uint64_t sector) const;
+
+    // First bad range ending after `sector`; false if there is none
+    bool findNext(uint64_t sector, uint64_t& startSector, uint64_t& sectorCount) const;
+
+    const std::map<uint64_t, uint64_t>& ranges() const { return ranges_; }   // start -> count
+    uint64_t sectorCount() const;
+    bool empty() const { return ranges_.empty(); }
+
+    // A missing file loads as an empty map
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    std::string getLastError() const { return lastError_; }
+
+private:
+    std::map<uint64_t, uint64_t> ranges_;
+    mutable std::string lastError_;
+};
+
+// How hard a rescue read tries before giving a sector up
+struct RescuePolicy {
+    uint32_t maxReadSectors = 1024;     // Size of the large reads of the first pass
+    uint64_t minSkipSectors = 128;      // Skip after the first error of a streak
+    uint64_t maxSkipSectors = 1 << 20;  // Skips double per consecutive error up to this
+    int retries = 2;                    // Extra attempts for single sectors in the last pass
+    uint32_t readTimeoutMs = 30000;     // Deadline of every read, 0 for none
+    bool avoidKnownBad = true;          // Do not touch ranges of the loaded map at all
+};
+
+// ddrescue-style read schedule over [startSector, endSector), driven by the caller:
+//
+//   1. copy:  large reads front to back; after a failed read skip ahead, doubling the skip on
+//             every consecutive failure, so a failing zone costs a few timeouts, not thousands
+//   2. trim:  revisit failed and skipped areas in LBA order, bisecting failed reads down to
+//             single sectors
+//   3. retry: read each remaining bad sector up to `retries` more times
+//
+// next() hands out one read at a time and complete() reports its outcome, so the caller reads into
+// its own (pooled) buffers. A read that ran into its deadline counts as failed and is rescheduled
+// the same way, except that a single sector which timed out is given up on instead of retried:
+// every retry would cost another full timeout. Sectors that stay unreadable, and known bad ones
+// that were avoided, end up in badBlocks(); everything covered by a timed-out read in slowBlocks().
+class RescueScheduler {
+public:
+    enum Pass { COPY = 1, TRIM = 2, RETRY = 3, DONE = 4 };
+
+    RescueScheduler(uint64_t startSector, uint64_t endSector, const RescuePolicy& policy = RescuePolicy(),
+                    const BadBlockMap* knownBad = nullptr);
+
+    // Next read to issue; false once every sector was read or given up on
+    bool next(uint64_t& firstSector, uint32_t& sectorCount);
+
+    // Outcome of the read handed out by the last next()
+    void complete(bool success, bool timedOut = false);
+
+    Pass pass() const { return pass_; }
+    const BadBlockMap& badBlocks() const { return bad_; }
+    const BadBlockMap& slowBlocks() const { return slow_; }
+    uint64_t failedReads() const { return failedReads_; }
+
+private:
+    struct Area {
+        uint64_t sectorCount;
+        bool failed;        // Already failed as a whole, so split it instead of reading it again
+    };
+
+    RescuePolicy policy_;
+    uint64_t endSector_;
+    BadBlockMap known_;
+    BadBlockMap bad_;
+    BadBlockMap slow_;
+
+    Pass pass_;
+    uint64_t cursor_;               // Copy pass position
+    uint64_t skip_;                 // Current skip, 0 while reads succeed
+    std::map<uint64_t, Area> pending_;  // Trim pass work, by start sector
+    std::map<uint64_t, int> retry_;     // Retry pass: sector -> attempts left
+
+    uint64_t readStart_;
+    uint32_t readCount_;
+    bool readAreaFailed_;
+    bool outstanding_;
+    uint64_t failedReads_;
+
+    void addPending(uint64_t startSector, uint64_t sectorCount, bool failed);
+};
+
+#endif // BAD_BLOCK_MAP_H
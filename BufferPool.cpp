@@ -0,0 +1,120 @@
+#include "BufferPool.h"
+#include "CpuTopology.h"
+#include <new>
+
+BufferLease::BufferLease(const BufferLease& other) : pool_(other.pool_), slot_(other.slot_) {
+    if (pool_) {
+        pool_->addRef(slot_);
+    }
+}
+
+BufferLease::BufferLease(BufferLease&& other) noexcept : pool_(other.pool_), slot_(other.slot_) {
+    other.pool_ = nullptr;
+}
+
+BufferLease& BufferLease::operator=(const BufferLease& other) {
+    if (this != &other) {
+        if (other.pool_) {
+            other.pool_->addRef(other.slot_);
+        }
+        reset();
+        pool_ = other.pool_;
+        slot_ = other.slot_;
+    }
+    return *this;
+}
+
+BufferLease& BufferLease::operator=(BufferLease&& other) noexcept {
+    if (this != &other) {
+        reset();
+        pool_ = other.pool_;
+        slot_ = other.slot_;
+        other.pool_ = nullptr;
+    }
+    return *this;
+}
+
+void BufferLease::reset() {
+    if (pool_) {
+        pool_->release(slot_);
+        pool_ = nullptr;
+    }
+}
+
+uint8_t* BufferLease::data() const {
+    return pool_ ? pool_->slotData(slot_) : nullptr;
+}
+
+size_t BufferLease::size() const {
+    return pool_ ? pool_->bufferSize_ : 0;
+}
+
+BufferPool::BufferPool(size_t bufferCount, size_t bufferSize, size_t alignment, int numaNode)
+    : bufferCount_(bufferCount ? bufferCount : 1), bufferSize_(bufferSize),
+      alignment_(alignment ? alignment : BUFFER_POOL_ALIGNMENT), numaNode_(numaNode), memory_(nullptr),
+      refCounts_(new std::atomic<uint32_t>[bufferCount ? bufferCount : 1]),
+      freeSlots_(bufferCount ? bufferCount : 1) {
+    // Every buffer starts on an aligned boundary
+    stride_ = (bufferSize_ + alignment_ - 1) / alignment_ * alignment_;
+    if (stride_ == 0) {
+        stride_ = alignment_;
+    }
+    // Node-local memory comes page aligned, which covers the default alignment
+    if (numaNode_ >= 0 && alignment_ > BUFFER_POOL_ALIGNMENT) {
+        numaNode_ = -1;
+    }
+    if (numaNode_ >= 0) {
+        memory_ = static_cast<uint8_t*>(allocateOnNode(stride_ * bufferCount_, numaNode_));
+    } else {
+        memory_ = static_cast<uint8_t*>(::operator new(stride_ * bufferCount_, std::align_val_t(alignment_)));
+    }
+
+    for (size_t slot = 0; slot < bufferCount_; ++slot) {
+        refCounts_[slot].store(0, std::memory_order_relaxed);
+        freeSlots_.tryPush(static_cast<uint32_t>(slot));
+    }
+}
+
+BufferPool::~BufferPool() {
+    if (numaNode_ >= 0) {
+        freeOnNode(memory_, stride_ * bufferCount_);
+        return;
+    }
+    ::operator delete(memory_, std::align_val_t(alignment_));
+}
+
+BufferLease BufferPool::acquire() {
+    uint32_t slot;
+    if (!freeSlots_.pop(slot)) {
+        return BufferLease();
+    }
+    return lease(slot);
+}
+
+BufferLease BufferPool::tryAcquire() {
+    uint32_t slot;
+    if (!freeSlots_.tryPop(slot)) {
+        return BufferLease();
+    }
+    return lease(slot);
+}
+
+void BufferPool::close() {
+    freeSlots_.close();
+}
+
+BufferLease BufferPool::lease(uint32_t slot) {
+    refCounts_[slot].store(1, std::memory_order_relaxed);
+    return BufferLease(this, slot);
+}
+
+void BufferPool::addRef(uint32_t slot) {
+    refCounts_[slot].fetch_add(1, std::memory_order_relaxed);
+}
+
+void BufferPool::release(uint32_t slot) {
+    if (refCounts_[slot].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // The free list has room for every slot, so this only fails once the pool is closed
+        freeSlots_.tryPush(slot);
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include "ConcurrentRing.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Default buffer alignment: a multiple of every sector size in use and of the page size,
+// as required for unbuffered device I/O
+static constexpr size_t BUFFER_POOL_ALIGNMENT = 4096;
+
+class BufferPool;
+
+// Reference-counted handle to one pool buffer. Copies share the buffer and may live on
+// different threads; when the last copy is dropped the buffer goes back to the pool.
+// Copying and returning never allocate.
+class BufferLease {
+public:
+    BufferLease() : pool_(nullptr), slot_(0) {}
+    BufferLease(const BufferLease& other);
+    BufferLease(BufferLease&& other) noexcept;
+    BufferLease& operator=(const BufferLease& other);
+    BufferLease& operator=(BufferLease&& other) noexcept;
+    ~BufferLease() { reset(); }
+
+    // Drop this reference
+    void reset();
+
+    bool valid() const { return pool_ != nullptr; }
+    explicit operator bool() const { return valid(); }
+
+    uint8_t* data() const;
+    size_t size() const;
+
+private:
+    friend class BufferPool;
+    BufferLease(BufferPool* pool, uint32_t slot) : pool_(pool), slot_(slot) {}
+
+    BufferPool* pool_;
+    uint32_t slot_;
+};
+
+// Fixed set of equally sized, aligned buffers carved out of one allocation made up front.
+// acquire() blocks while every buffer is leased out, which doubles as back-pressure for readers
+// that run ahead of the hashers. The pool must outlive all of its leases.
+//
+// numaNode >= 0 places the memory on that NUMA node (OS node id), so a reader pinned to the node
+// fills, and its paired hashers read, node-local buffers.
+class BufferPool {
+public:
+    BufferPool(size_t bufferCount, size_t bufferSize, size_t alignment = BUFFER_POOL_ALIGNMENT,
+               int numaNode = -1);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Blocks until a buffer is free; returns an empty lease once the pool is closed and exhausted
+    BufferLease acquire();
+
+    // Returns an empty lease instead of blocking
+    BufferLease tryAcquire();
+
+    // Wake threads blocked in acquire(), e.g. on cancellation. Closing is final.
+    void close();
+
+    size_t bufferCount() const { return bufferCount_; }
+    size_t bufferSize() const { return bufferSize_; }
+    size_t available() const { return freeSlots_.sizeApprox(); }
+
+private:
+    friend class BufferLease;
+
+    size_t bufferCount_;
+    size_t bufferSize_;
+    size_t stride_;
+    size_t alignment_;
+    int numaNode_;
+    uint8_t* memory_;
+    std::unique_ptr<std::atomic<uint32_t>[]> refCounts_;
+    BlockingRing<uint32_t> freeSlots_;
+
+    uint8_t* slotData(uint32_t slot) const { return memory_ + static_cast<size_t>(slot) * stride_; }
+    BufferLease lease(uint32_t slot);
+    void addRef(uint32_t slot);
+    void release(uint32_t slot);
+};
+
+#endif // BUFFER_POOL_H
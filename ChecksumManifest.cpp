@@ -0,0 +1,983 @@
+#include "ChecksumManifest.h"
+#include "FastCRC32.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <queue>
+#include <thread>
+
+namespace {
+
+uint32_t headerChecksum(const ManifestV2Header& header) {
+    return FastCRC32::compute(&header, offsetof(ManifestV2Header, headerCrc));
+}
+
+uint64_t v2BlockOffset(const ManifestInfo& info, uint64_t block) {
+    return info.dataOffset + block * info.blockSize;
+}
+
+uint64_t v2BlockRecordCount(const ManifestInfo& info, uint64_t block) {
+    uint64_t first = block * info.blockRecords;
+    return std::min<uint64_t>(info.blockRecords, info.recordCount - first);
+}
+
+std::string describeBlock(uint64_t block, uint64_t firstRecord, uint64_t recordCount,
+                          const ManifestBlockIndexEntry* entry) {
+    std::string text = "block " + std::to_string(block) + " (records " + std::to_string(firstRecord) +
+                       "-" + std::to_string(firstRecord + recordCount - 1);
+    if (entry) {
+        text += ", sectors " + std::to_string(entry->minSector) + "-" + std::to_string(entry->maxSector);
+    }
+    return text + ")";
+}
+
+// Add [first, first + count) to coalesced start -> count ranges. Manifest records never repeat a
+// sector, so only the neighbours need to be merged.
+void addCoveredRange(std::map<uint64_t, uint64_t>& ranges, uint64_t first, uint64_t count) {
+    auto next = ranges.lower_bound(first);
+    if (next != ranges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == first) {
+            previous->second += count;
+            if (next != ranges.end() && next->first == previous->first + previous->second) {
+                previous->second += next->second;
+                ranges.erase(next);
+            }
+            return;
+        }
+    }
+    if (next != ranges.end() && next->first == first + count) {
+        count += next->second;
+        ranges.erase(next);
+    }
+    ranges[first] = count;
+}
+
+} // namespace
+
+ChecksumManifestReader::ChecksumManifestReader() {
+}
+
+ChecksumManifestReader::~ChecksumManifestReader() {
+    close();
+}
+
+bool ChecksumManifestReader::open(const std::string& manifestPath) {
+    close();
+    path_ = manifestPath;
+
+    file_.open(manifestPath, std::ios::binary);
+    if (!file_.is_open()) {
+        lastError_ = "Cannot open checksum file: " + manifestPath;
+        return false;
+    }
+
+    file_.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(file_.tellg());
+    file_.seekg(0, std::ios::beg);
+
+    if (!detectFormat(fileSize)) {
+        file_.close();
+        return false;
+    }
+
+    return true;
+}
+
+void ChecksumManifestReader::close() {
+    if (file_.is_open()) {
+        file_.close();
+    }
+    file_.clear();
+    info_ = ManifestInfo();
+    cachedBlock_ = UINT64_MAX;
+}
+
+bool ChecksumManifestReader::detectFormat(uint64_t fileSize) {
+    uint32_t magic = 0;
+    if (fileSize >= sizeof(magic)) {
+        file_.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    }
+
+    if (magic == MANIFEST_MAGIC_V2) {
+        return readV2Header(fileSize);
+    }
+
+    if (magic == MANIFEST_MAGIC_V1 && fileSize >= MANIFEST_V1_HEADER_SIZE) {
+        info_.format = ManifestFormat::CrcdV1;
+        info_.legacyCrc = true;
+        file_.read(reinterpret_cast<char*>(&info_.startSector), sizeof(info_.startSector));
+        file_.read(reinterpret_cast<char*>(&info_.sectorCount), sizeof(info_.sectorCount));
+        file_.read(reinterpret_cast<char*>(&info_.timestamp), sizeof(info_.timestamp));
+        info_.dataOffset = MANIFEST_V1_HEADER_SIZE;
+        info_.recordSize = MANIFEST_V1_RECORD_SIZE;
+        // Parallel generators skip unreadable sectors, so trust the file size over the header
+        info_.recordCount = (fileSize - info_.dataOffset) / info_.recordSize;
+        return true;
+    }
+
+    if (magic == MANIFEST_MAGIC_DELTA && fileSize >= MANIFEST_DELTA_FIXED_HEADER_SIZE) {
+        uint32_t version = 0;
+        uint32_t baseNameLength = 0;
+        file_.read(reinterpret_cast<char*>(&version), sizeof(version));
+        if (version == MANIFEST_DELTA_UNFINISHED_VERSION) {
+            lastError_ = "Delta manifest was never finalized (interrupted write?): " + path_;
+            return false;
+        }
+        if (version != MANIFEST_DELTA_VERSION && version != MANIFEST_DELTA_LEGACY_CRC_VERSION) {
+            lastError_ = "Unsupported delta manifest version " + std::to_string(version) + ": " + path_;
+            return false;
+        }
+
+        info_.format = ManifestFormat::Delta;
+        info_.legacyCrc = (version == MANIFEST_DELTA_LEGACY_CRC_VERSION);
+        file_.read(reinterpret_cast<char*>(&info_.startSector), sizeof(info_.startSector));
+        file_.read(reinterpret_cast<char*>(&info_.sectorCount), sizeof(info_.sectorCount));
+        file_.read(reinterpret_cast<char*>(&info_.timestamp), sizeof(info_.timestamp));
+        file_.read(reinterpret_cast<char*>(&info_.recordCount), sizeof(info_.recordCount));
+        file_.read(reinterpret_cast<char*>(&info_.baseTimestamp), sizeof(info_.baseTimestamp));
+        file_.read(reinterpret_cast<char*>(&info_.baseRecordCount), sizeof(info_.baseRecordCount));
+        file_.read(reinterpret_cast<char*>(&info_.chainDepth), sizeof(info_.chainDepth));
+        file_.read(reinterpret_cast<char*>(&baseNameLength), sizeof(baseNameLength));
+
+        info_.dataOffset = MANIFEST_DELTA_FIXED_HEADER_SIZE + baseNameLength;
+        info_.recordSize = MANIFEST_COMPACT_RECORD_SIZE;
+        if (info_.dataOffset + info_.recordCount * info_.recordSize > fileSize) {
+            lastError_ = "Delta manifest is truncated: " + path_;
+            return false;
+        }
+
+        info_.baseManifest.resize(baseNameLength);
+        if (baseNameLength > 0) {
+            file_.read(&info_.baseManifest[0], baseNameLength);
+        }
+        return true;
+    }
+
+    if (fileSize % MANIFEST_COMPACT_RECORD_SIZE == 0) {
+        info_.format = ManifestFormat::Compact;
+        info_.dataOffset = 0;
+        info_.recordSize = MANIFEST_COMPACT_RECORD_SIZE;
+        info_.recordCount = fileSize / MANIFEST_COMPACT_RECORD_SIZE;
+        info_.sectorCount = info_.recordCount;
+        info_.timestamp = 0;
+        info_.startSector = 0;
+        if (info_.recordCount > 0) {
+            file_.seekg(0, std::ios::beg);
+            file_.read(reinterpret_cast<char*>(&info_.startSector), sizeof(info_.startSector));
+        }
+        file_.clear();
+        return true;
+    }
+
+    lastError_ = "Invalid checksum file format: " + path_;
+    return false;
+}
+
+bool ChecksumManifestReader::readV2Header(uint64_t fileSize) {
+    ManifestV2Header header;
+    if (fileSize < sizeof(header)) {
+        lastError_ = "Manifest header is truncated: " + path_;
+        return false;
+    }
+
+    file_.seekg(0, std::ios::beg);
+    file_.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (header.headerCrc != headerChecksum(header)) {
+        lastError_ = "Manifest header is damaged (CRC mismatch): " + path_;
+        return false;
+    }
+    if (header.version != MANIFEST_V2_VERSION) {
+        lastError_ = "Unsupported manifest version " + std::to_string(header.version) + ": " + path_;
+        return false;
+    }
+    if (header.indexOffset == 0) {
+        lastError_ = "Manifest was never finalized (interrupted write?): " + path_;
+        return false;
+    }
+
+    // The geometry must be self-consistent before any record offset is derived from it
+    uint64_t expectedBlocks = header.blockRecords ? (header.recordCount + header.blockRecords - 1) / header.blockRecords : 0;
+    uint64_t payloadBytes = header.recordCount * MANIFEST_COMPACT_RECORD_SIZE + header.blockCount * sizeof(uint32_t);
+    uint64_t indexBytes = header.blockCount * sizeof(ManifestBlockIndexEntry) + sizeof(uint32_t);
+    if (header.blockRecords == 0 ||
+        header.blockSize != header.blockRecords * MANIFEST_COMPACT_RECORD_SIZE + sizeof(uint32_t) ||
+        header.blockCount != expectedBlocks ||
+        header.indexOffset != sizeof(header) + payloadBytes ||
+        header.indexOffset + indexBytes != fileSize) {
+        lastError_ = "Manifest size does not match its header (truncated?): " + path_;
+        return false;
+    }
+
+    info_.format = ManifestFormat::CrcdV2;
+    info_.startSector = header.startSector;
+    info_.sectorCount = header.sectorCount;
+    info_.timestamp = header.timestamp;
+    info_.recordCount = header.recordCount;
+    info_.dataOffset = sizeof(header);
+    info_.recordSize = MANIFEST_COMPACT_RECORD_SIZE;
+    info_.blockCount = header.blockCount;
+    info_.indexOffset = header.indexOffset;
+    info_.blockSize = header.blockSize;
+    info_.blockRecords = header.blockRecords;
+    return true;
+}
+
+bool ChecksumManifestReader::loadBlock(uint64_t block) {
+    if (block == cachedBlock_) {
+        return true;
+    }
+    cachedBlock_ = UINT64_MAX;
+
+    uint64_t firstRecord = block * info_.blockRecords;
+    uint64_t recordCount = v2BlockRecordCount(info_, block);
+    size_t payloadBytes = static_cast<size_t>(recordCount * MANIFEST_COMPACT_RECORD_SIZE);
+
+    rawBuffer_.resize(payloadBytes + sizeof(uint32_t));
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(v2BlockOffset(info_, block)), std::ios::beg);
+    file_.read(reinterpret_cast<char*>(rawBuffer_.data()), static_cast<std::streamsize>(rawBuffer_.size()));
+    if (static_cast<uint64_t>(file_.gcount()) != rawBuffer_.size()) {
+        lastError_ = "Failed to read checksum data";
+        return false;
+    }
+
+    uint32_t trailer;
+    std::memcpy(&trailer, rawBuffer_.data() + payloadBytes, sizeof(trailer));
+    if (FastCRC32::compute(rawBuffer_.data(), payloadBytes) != trailer) {
+        // Name the sectors the block was supposed to cover so the damage can be judged
+        ManifestBlockIndexEntry entry;
+        file_.clear();
+        file_.seekg(static_cast<std::streamoff>(info_.indexOffset + block * sizeof(entry)), std::ios::beg);
+        file_.read(reinterpret_cast<char*>(&entry), sizeof(entry));
+        bool haveEntry = file_.gcount() == sizeof(entry);
+        lastError_ = "Manifest " + describeBlock(block, firstRecord, recordCount, haveEntry ? &entry : nullptr) +
+                     " is damaged: " + path_;
+        return false;
+    }
+
+    cachedBlock_ = block;
+    return true;
+}
+
+bool ChecksumManifestReader::readColumns(uint64_t firstRecord, uint64_t count,
+                                         std::vector<uint64_t>& sectors, std::vector<uint32_t>& crcs) {
+    if (!file_.is_open()) {
+        lastError_ = "Checksum file is not open";
+        return false;
+    }
+
+    if (firstRecord >= info_.recordCount) {
+        sectors.clear();
+        crcs.clear();
+        return true;
+    }
+    count = std::min(count, info_.recordCount - firstRecord);
+
+    if (info_.format == ManifestFormat::CrcdV2) {
+        sectors.resize(count);
+        crcs.resize(count);
+        uint64_t done = 0;
+        while (done < count) {
+            uint64_t record = firstRecord + done;
+            uint64_t block = record / info_.blockRecords;
+            uint64_t inBlock = record % info_.blockRecords;
+            if (!loadBlock(block)) {
+                return false;
+            }
+            uint64_t take = std::min(count - done, v2BlockRecordCount(info_, block) - inBlock);
+            const uint8_t* source = rawBuffer_.data() + inBlock * MANIFEST_COMPACT_RECORD_SIZE;
+            for (uint64_t i = 0; i < take; ++i, source += MANIFEST_COMPACT_RECORD_SIZE) {
+                std::memcpy(&sectors[done + i], source, sizeof(uint64_t));
+                std::memcpy(&crcs[done + i], source + sizeof(uint64_t), sizeof(uint32_t));
+            }
+            done += take;
+        }
+        return true;
+    }
+
+    cachedBlock_ = UINT64_MAX;
+    rawBuffer_.resize(count * info_.recordSize);
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(info_.dataOffset + firstRecord * info_.recordSize), std::ios::beg);
+    file_.read(reinterpret_cast<char*>(rawBuffer_.data()), static_cast<std::streamsize>(rawBuffer_.size()));
+    if (static_cast<uint64_t>(file_.gcount()) != rawBuffer_.size()) {
+        lastError_ = "Failed to read checksum data";
+        return false;
+    }
+
+    // All layouts store the sector number at offset 0 and the CRC at offset 8
+    sectors.resize(count);
+    crcs.resize(count);
+    const uint8_t* record = rawBuffer_.data();
+    for (uint64_t i = 0; i < count; ++i, record += info_.recordSize) {
+        std::memcpy(&sectors[i], record, sizeof(uint64_t));
+        std::memcpy(&crcs[i], record + sizeof(uint64_t), sizeof(uint32_t));
+    }
+
+    return true;
+}
+
+bool ChecksumManifestReader::readAll(std::vector<SectorChecksum>& checksums) {
+    const uint64_t CHUNK_RECORDS = 1 << 20;
+    std::vector<uint64_t> sectors;
+    std::vector<uint32_t> crcs;
+
+    checksums.clear();
+    checksums.reserve(info_.recordCount);
+
+    for (uint64_t first = 0; first < info_.recordCount; first += CHUNK_RECORDS) {
+        if (!readColumns(first, CHUNK_RECORDS, sectors, crcs)) {
+            return false;
+        }
+        for (size_t i = 0; i < sectors.size(); ++i) {
+            checksums.push_back(SectorChecksum{sectors[i], crcs[i], info_.timestamp});
+        }
+    }
+
+    return true;
+}
+
+const char* ChecksumManifestReader::formatName(ManifestFormat format) {
+    switch (format) {
+        case ManifestFormat::CrcdV1:
+            return "CRCD v1";
+        case ManifestFormat::CrcdV2:
+            return "CRCD v2";
+        case ManifestFormat::Compact:
+            return "compact";
+        case ManifestFormat::Delta:
+            return "delta";
+        default:
+            return "unknown";
+    }
+}
+
+// ChecksumManifestWriter
+
+ChecksumManifestWriter::ChecksumManifestWriter()
+    : header_(), blockRecords_(0), blockMinSector_(0), blockMaxSector_(0), failed_(false), trackRanges_(false) {
+}
+
+ChecksumManifestWriter::~ChecksumManifestWriter() {
+    // Only close() finalizes; a writer dropped on an error path leaves an unfinished manifest
+    // that readers reject and resume() can continue
+    suspend();
+}
+
+bool ChecksumManifestWriter::open(const std::string& outputFile, uint64_t startSector,
+                                  uint64_t sectorCount, uint64_t timestamp) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    outputFile_ = outputFile;
+    file_.open(outputFile, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        lastError_ = "Cannot create output file: " + outputFile;
+        return false;
+    }
+
+    header_ = ManifestV2Header();
+    header_.magic = MANIFEST_MAGIC_V2;
+    header_.version = MANIFEST_V2_VERSION;
+    header_.startSector = startSector;
+    header_.sectorCount = sectorCount;
+    header_.timestamp = timestamp;
+    header_.blockSize = MANIFEST_V2_BLOCK_SIZE;
+    header_.blockRecords = MANIFEST_V2_BLOCK_RECORDS;
+    header_.headerCrc = headerChecksum(header_);
+
+    block_.clear();
+    block_.reserve(MANIFEST_V2_BLOCK_SIZE);
+    blockRecords_ = 0;
+    index_.clear();
+    blockRuns_.clear();
+    coveredRanges_.clear();
+    failed_ = false;
+
+    // Provisional header: indexOffset stays 0 until close() so partial files are rejected
+    file_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+    file_.flush();
+    if (!file_) {
+        lastError_ = "Failed to write manifest header: " + outputFile;
+        failed_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool ChecksumManifestWriter::resume(const std::string& outputFile, uint64_t startSector,
+                                    uint64_t sectorCount, uint64_t timestamp) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    outputFile_ = outputFile;
+    block_.clear();
+    block_.reserve(MANIFEST_V2_BLOCK_SIZE);
+    blockRecords_ = 0;
+    index_.clear();
+    blockRuns_.clear();
+    coveredRanges_.clear();
+    failed_ = false;
+
+    std::ifstream existing(outputFile, std::ios::binary);
+    if (!existing.is_open()) {
+        lastError_ = "Cannot open manifest to resume: " + outputFile;
+        return false;
+    }
+    existing.read(reinterpret_cast<char*>(&header_), sizeof(header_));
+    if (existing.gcount() != sizeof(header_) || header_.magic != MANIFEST_MAGIC_V2 ||
+        header_.version != MANIFEST_V2_VERSION || header_.headerCrc != headerChecksum(header_)) {
+        lastError_ = "Cannot resume, not an unfinished v2 manifest: " + outputFile;
+        return false;
+    }
+    if (header_.indexOffset != 0) {
+        lastError_ = "Cannot resume, manifest is already complete: " + outputFile;
+        return false;
+    }
+    if (header_.startSector != startSector || header_.sectorCount != sectorCount || header_.timestamp != timestamp ||
+        header_.blockSize != MANIFEST_V2_BLOCK_SIZE || header_.blockRecords != MANIFEST_V2_BLOCK_RECORDS) {
+        lastError_ = "Cannot resume, manifest belongs to a different run: " + outputFile;
+        return false;
+    }
+
+    // Keep the leading run of intact full blocks; a torn or lost write ends it
+    header_.recordCount = 0;
+    std::vector<uint8_t> block(MANIFEST_V2_BLOCK_SIZE);
+    const size_t payloadBytes = MANIFEST_V2_BLOCK_SIZE - sizeof(uint32_t);
+    while (existing.read(reinterpret_cast<char*>(block.data()), MANIFEST_V2_BLOCK_SIZE)) {
+        uint32_t trailer;
+        std::memcpy(&trailer, block.data() + payloadBytes, sizeof(trailer));
+        if (FastCRC32::compute(block.data(), payloadBytes) != trailer) {
+            break;
+        }
+        for (uint32_t i = 0; i < MANIFEST_V2_BLOCK_RECORDS; ++i) {
+            uint64_t sectorNumber;
+            std::memcpy(&sectorNumber, block.data() + i * MANIFEST_COMPACT_RECORD_SIZE, sizeof(sectorNumber));
+            blockMinSector_ = i == 0 ? sectorNumber : std::min(blockMinSector_, sectorNumber);
+            blockMaxSector_ = i == 0 ? sectorNumber : std::max(blockMaxSector_, sectorNumber);
+            noteRecord(sectorNumber);
+        }
+        index_.push_back(ManifestBlockIndexEntry{blockMinSector_, blockMaxSector_, MANIFEST_V2_BLOCK_RECORDS, trailer});
+        header_.recordCount += MANIFEST_V2_BLOCK_RECORDS;
+        for (const auto& run : blockRuns_) {
+            addCoveredRange(coveredRanges_, run.first, run.second);
+        }
+        blockRuns_.clear();
+    }
+    existing.close();
+
+    std::error_code error;
+    std::filesystem::resize_file(outputFile, sizeof(header_) + index_.size() * MANIFEST_V2_BLOCK_SIZE, error);
+    if (error) {
+        lastError_ = "Cannot truncate manifest to resume: " + outputFile;
+        return false;
+    }
+    file_.open(outputFile, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file_.is_open()) {
+        lastError_ = "Cannot open manifest to resume: " + outputFile;
+        return false;
+    }
+    file_.seekp(0, std::ios::end);
+    return true;
+}
+
+bool ChecksumManifestWriter::append(uint64_t sectorNumber, uint32_t crc32) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return appendLocked(sectorNumber, crc32);
+}
+
+bool ChecksumManifestWriter::appendBatch(const SectorChecksum* checksums, size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < count; ++i) {
+        if (!appendLocked(checksums[i].sectorNumber, checksums[i].crc32)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ChecksumManifestWriter::appendRun(uint64_t firstSector, const uint32_t* crcs, size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < count; ++i) {
+        if (!appendLocked(firstSector + i, crcs[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ChecksumManifestWriter::appendLocked(uint64_t sectorNumber, uint32_t crc32) {
+    if (!file_.is_open() || failed_) {
+        return false;
+    }
+
+    uint8_t record[MANIFEST_COMPACT_RECORD_SIZE];
+    std::memcpy(record, &sectorNumber, sizeof(sectorNumber));
+    std::memcpy(record + sizeof(sectorNumber), &crc32, sizeof(crc32));
+    block_.insert(block_.end(), record, record + sizeof(record));
+
+    if (blockRecords_ == 0) {
+        blockMinSector_ = blockMaxSector_ = sectorNumber;
+    } else {
+        blockMinSector_ = std::min(blockMinSector_, sectorNumber);
+        blockMaxSector_ = std::max(blockMaxSector_, sectorNumber);
+    }
+    noteRecord(sectorNumber);
+
+    if (++blockRecords_ == MANIFEST_V2_BLOCK_RECORDS) {
+        return flushBlock();
+    }
+    return true;
+}
+
+bool ChecksumManifestWriter::flushBlock() {
+    if (blockRecords_ == 0) {
+        return true;
+    }
+
+    uint32_t crc = FastCRC32::compute(block_.data(), block_.size());
+    const uint8_t* trailer = reinterpret_cast<const uint8_t*>(&crc);
+    block_.insert(block_.end(), trailer, trailer + sizeof(crc));
+
+    file_.write(reinterpret_cast<const char*>(block_.data()), static_cast<std::streamsize>(block_.size()));
+    if (!file_) {
+        lastError_ = "Failed to write manifest block: " + outputFile_;
+        failed_ = true;
+        return false;
+    }
+
+    index_.push_back(ManifestBlockIndexEntry{blockMinSector_, blockMaxSector_, blockRecords_, crc});
+    header_.recordCount += blockRecords_;
+    block_.clear();
+    blockRecords_ = 0;
+    for (const auto& run : blockRuns_) {
+        addCoveredRange(coveredRanges_, run.first, run.second);
+    }
+    blockRuns_.clear();
+    return true;
+}
+
+void ChecksumManifestWriter::noteRecord(uint64_t sectorNumber) {
+    if (!trackRanges_) {
+        return;
+    }
+    if (!blockRuns_.empty() && blockRuns_.back().first + blockRuns_.back().second == sectorNumber) {
+        blockRuns_.back().second++;
+    } else {
+        blockRuns_.push_back(std::make_pair(sectorNumber, uint64_t(1)));
+    }
+}
+
+bool ChecksumManifestWriter::checkpoint(uint64_t& blockCount, std::map<uint64_t, uint64_t>& coveredRanges) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_.is_open() || failed_) {
+        return false;
+    }
+    file_.flush();
+    if (!file_) {
+        lastError_ = "Failed to write manifest block: " + outputFile_;
+        failed_ = true;
+        return false;
+    }
+    blockCount = index_.size();
+    coveredRanges = coveredRanges_;
+    return true;
+}
+
+bool ChecksumManifestWriter::suspend() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_.is_open()) {
+        return !failed_;
+    }
+    block_.clear();
+    blockRecords_ = 0;
+    blockRuns_.clear();
+    file_.flush();
+    if (!file_) {
+        lastError_ = "Failed to write manifest block: " + outputFile_;
+        failed_ = true;
+    }
+    file_.close();
+    return !failed_;
+}
+
+bool ChecksumManifestWriter::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_.is_open()) {
+        return !failed_;
+    }
+
+    if (!failed_ && flushBlock()) {
+        header_.blockCount = index_.size();
+        header_.indexOffset = static_cast<uint64_t>(file_.tellp());
+
+        uint32_t indexCrc = FastCRC32::compute(index_.data(), index_.size() * sizeof(ManifestBlockIndexEntry));
+        file_.write(reinterpret_cast<const char*>(index_.data()),
+                    static_cast<std::streamsize>(index_.size() * sizeof(ManifestBlockIndexEntry)));
+        file_.write(reinterpret_cast<const char*>(&indexCrc), sizeof(indexCrc));
+
+        header_.headerCrc = headerChecksum(header_);
+        file_.seekp(0, std::ios::beg);
+        file_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+        file_.flush();
+        if (!file_) {
+            lastError_ = "Failed to finalize manifest: " + outputFile_;
+            failed_ = true;
+        }
+    }
+
+    file_.close();
+    std::vector<ManifestBlockIndexEntry>().swap(index_);
+    return !failed_;
+}
+
+uint64_t ChecksumManifestWriter::recordCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return header_.recordCount + blockRecords_;
+}
+
+std::string ChecksumManifestWriter::getLastError() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lastError_;
+}
+
+// ManifestSorter
+
+ManifestSorter::ManifestSorter() : runRecords_(1 << 22) {
+}
+
+bool ManifestSorter::sort(ChecksumManifestReader& input, const std::string& outputFile) {
+    const ManifestInfo info = input.info();
+    const bool singleRun = info.recordCount <= runRecords_;
+
+    ChecksumManifestWriter writer;
+    if (!writer.open(outputFile, info.startSector, info.sectorCount, info.timestamp)) {
+        lastError_ = writer.getLastError();
+        return false;
+    }
+
+    std::vector<std::string> runFiles;
+    auto fail = [&](const std::string& error) {
+        lastError_ = error;
+        writer.suspend();
+        std::remove(outputFile.c_str());
+        for (const std::string& runFile : runFiles) {
+            std::remove(runFile.c_str());
+        }
+        return false;
+    };
+
+    std::vector<uint64_t> sectors;
+    std::vector<uint32_t> crcs;
+    std::vector<size_t> order;
+    std::vector<uint8_t> record(MANIFEST_COMPACT_RECORD_SIZE);
+    for (uint64_t first = 0; first < info.recordCount; first += runRecords_) {
+        if (!input.readColumns(first, runRecords_, sectors, crcs)) {
+            return fail(input.getLastError());
+        }
+        if (sectors.empty()) {
+            break;
+        }
+
+        order.resize(sectors.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return sectors[a] < sectors[b];
+        });
+
+        // A single run goes straight into the manifest, otherwise it is spilled for the merge
+        std::ofstream runFile;
+        if (!singleRun) {
+            runFiles.push_back(outputFile + ".run" + std::to_string(runFiles.size()));
+            runFile.open(runFiles.back(), std::ios::binary | std::ios::trunc);
+            if (!runFile.is_open()) {
+                return fail("Cannot create sort run file: " + runFiles.back());
+            }
+        }
+
+        for (size_t k = 0; k < order.size(); ++k) {
+            size_t index = order[k];
+            if (k + 1 < order.size() && sectors[order[k + 1]] == sectors[index]) {
+                continue;
+            }
+            if (singleRun) {
+                if (!writer.append(sectors[index], crcs[index])) {
+                    return fail(writer.getLastError());
+                }
+            } else {
+                std::memcpy(record.data(), &sectors[index], sizeof(uint64_t));
+                std::memcpy(record.data() + sizeof(uint64_t), &crcs[index], sizeof(uint32_t));
+                runFile.write(reinterpret_cast<const char*>(record.data()), record.size());
+            }
+        }
+
+        if (!singleRun) {
+            runFile.close();
+            if (!runFile) {
+                return fail("Failed to write sort run file: " + runFiles.back());
+            }
+        }
+    }
+
+    if (!singleRun && !mergeRuns(runFiles, writer)) {
+        return fail(lastError_);
+    }
+    if (!writer.close()) {
+        return fail(writer.getLastError());
+    }
+    for (const std::string& runFile : runFiles) {
+        std::remove(runFile.c_str());
+    }
+    return true;
+}
+
+bool ManifestSorter::mergeRuns(const std::vector<std::string>& runFiles, ChecksumManifestWriter& writer) {
+    struct Run {
+        std::ifstream file;
+        uint64_t sector;
+        uint32_t crc;
+    };
+    std::vector<Run> runs(runFiles.size());
+
+    auto advance = [](Run& run) {
+        run.file.read(reinterpret_cast<char*>(&run.sector), sizeof(run.sector));
+        run.file.read(reinterpret_cast<char*>(&run.crc), sizeof(run.crc));
+        return static_cast<bool>(run.file);
+    };
+
+    // Smallest sector first; among runs holding the same sector, the later run is the later record
+    using HeadEntry = std::pair<uint64_t, size_t>;
+    std::priority_queue<HeadEntry, std::vector<HeadEntry>, std::greater<HeadEntry>> heads;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        runs[i].file.open(runFiles[i], std::ios::binary);
+        if (!runs[i].file.is_open()) {
+            lastError_ = "Cannot open sort run file: " + runFiles[i];
+            return false;
+        }
+        if (advance(runs[i])) {
+            heads.push(HeadEntry(runs[i].sector, i));
+        }
+    }
+
+    while (!heads.empty()) {
+        uint64_t sector = heads.top().first;
+        uint32_t crc = 0;
+        while (!heads.empty() && heads.top().first == sector) {
+            Run& run = runs[heads.top().second];
+            crc = run.crc;
+            size_t index = heads.top().second;
+            heads.pop();
+            if (advance(run)) {
+                heads.push(HeadEntry(run.sector, index));
+            }
+        }
+        if (!writer.append(sector, crc)) {
+            lastError_ = writer.getLastError();
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < runs.size(); ++i) {
+        if (!runs[i].file.eof()) {
+            lastError_ = "Failed to read sort run file: " + runFiles[i];
+            return false;
+        }
+    }
+    return true;
+}
+
+// ManifestValidator
+
+ManifestValidator::ManifestValidator() : blocksChecked_(0) {
+}
+
+bool ManifestValidator::validate(const std::string& manifestPath, bool quickCheck, int threadCount,
+                                 std::function<void(int, int)> progressCallback) {
+    info_ = ManifestInfo();
+    index_.clear();
+    damagedBlocks_.clear();
+    blocksChecked_ = 0;
+    lastError_.clear();
+
+    // Opening parses and cross-checks the header (and its CRC for v2)
+    {
+        ChecksumManifestReader reader;
+        if (!reader.open(manifestPath)) {
+            lastError_ = reader.getLastError();
+            return false;
+        }
+        info_ = reader.info();
+    }
+
+    if (info_.format != ManifestFormat::CrcdV2) {
+        return true;
+    }
+
+    bool indexValid = readIndex(manifestPath);
+    if (!indexValid && quickCheck) {
+        return false;
+    }
+    if (quickCheck) {
+        return true;
+    }
+
+    std::string indexError = lastError_;
+    if (!scanBlocks(manifestPath, threadCount, progressCallback)) {
+        return false;
+    }
+
+    if (!damagedBlocks_.empty()) {
+        const ManifestBlockDamage& first = damagedBlocks_.front();
+        ManifestBlockIndexEntry entry{first.minSector, first.maxSector, 0, 0};
+        lastError_ = std::to_string(damagedBlocks_.size()) + " of " + std::to_string(info_.blockCount) +
+                     " manifest blocks are damaged, first is " +
+                     describeBlock(first.blockIndex, first.firstRecord, first.recordCount,
+                                   indexValid ? &entry : nullptr) + ": " + manifestPath;
+        if (!indexValid) {
+            lastError_ += "; " + indexError;
+        }
+        return false;
+    }
+
+    if (!indexValid) {
+        lastError_ = indexError;
+        return false;
+    }
+    return true;
+}
+
+bool ManifestValidator::readIndex(const std::string& manifestPath) {
+    std::ifstream file(manifestPath, std::ios::binary);
+    if (!file.is_open()) {
+        lastError_ = "Cannot open checksum file: " + manifestPath;
+        return false;
+    }
+
+    index_.resize(info_.blockCount);
+    uint32_t storedCrc = 0;
+    file.seekg(static_cast<std::streamoff>(info_.indexOffset), std::ios::beg);
+    file.read(reinterpret_cast<char*>(index_.data()),
+              static_cast<std::streamsize>(index_.size() * sizeof(ManifestBlockIndexEntry)));
+    file.read(reinterpret_cast<char*>(&storedCrc), sizeof(storedCrc));
+    if (!file) {
+        lastError_ = "Failed to read manifest block index: " + manifestPath;
+        index_.clear();
+        return false;
+    }
+
+    if (FastCRC32::compute(index_.data(), index_.size() * sizeof(ManifestBlockIndexEntry)) != storedCrc) {
+        lastError_ = "Manifest block index is damaged (CRC mismatch): " + manifestPath;
+        index_.clear();
+        return false;
+    }
+
+    for (uint64_t block = 0; block < index_.size(); ++block) {
+        const ManifestBlockIndexEntry& entry = index_[block];
+        if (entry.recordCount != v2BlockRecordCount(info_, block) || entry.minSector > entry.maxSector) {
+            lastError_ = "Manifest block index is inconsistent at block " + std::to_string(block) + ": " + manifestPath;
+            index_.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ManifestValidator::scanBlocks(const std::string& manifestPath, int threadCount,
+                                   std::function<void(int, int)> progressCallback) {
+    // Blocks are claimed in contiguous runs so each worker issues large sequential reads
+    const uint64_t BLOCKS_PER_CLAIM = 64;
+
+    if (threadCount <= 0) {
+        unsigned int availableThreads = std::thread::hardware_concurrency();
+        threadCount = availableThreads > 0 ? static_cast<int>(availableThreads) : 1;
+    }
+    uint64_t claims = (info_.blockCount + BLOCKS_PER_CLAIM - 1) / BLOCKS_PER_CLAIM;
+    threadCount = static_cast<int>(std::max<uint64_t>(1, std::min<uint64_t>(threadCount, claims)));
+
+    std::atomic<uint64_t> nextBlock(0);
+    std::atomic<uint64_t> checkedBlocks(0);
+    std::atomic<bool> ioFailed(false);
+    std::mutex resultMutex;
+
+    auto worker = [&]() {
+        std::ifstream file(manifestPath, std::ios::binary);
+        if (!file.is_open()) {
+            ioFailed = true;
+            return;
+        }
+
+        std::vector<uint8_t> buffer;
+        std::vector<ManifestBlockDamage> localDamage;
+
+        while (!ioFailed) {
+            uint64_t firstBlock = nextBlock.fetch_add(BLOCKS_PER_CLAIM);
+            if (firstBlock >= info_.blockCount) {
+                break;
+            }
+            uint64_t lastBlock = std::min(firstBlock + BLOCKS_PER_CLAIM, info_.blockCount);
+            uint64_t begin = v2BlockOffset(info_, firstBlock);
+            uint64_t end = (lastBlock == info_.blockCount) ? info_.indexOffset : v2BlockOffset(info_, lastBlock);
+
+            buffer.resize(static_cast<size_t>(end - begin));
+            file.clear();
+            file.seekg(static_cast<std::streamoff>(begin), std::ios::beg);
+            file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+            if (static_cast<uint64_t>(file.gcount()) != buffer.size()) {
+                ioFailed = true;
+                break;
+            }
+
+            for (uint64_t block = firstBlock; block < lastBlock; ++block) {
+                uint64_t recordCount = v2BlockRecordCount(info_, block);
+                size_t payloadBytes = static_cast<size_t>(recordCount * MANIFEST_COMPACT_RECORD_SIZE);
+                const uint8_t* payload = buffer.data() + (block - firstBlock) * info_.blockSize;
+
+                uint32_t trailer;
+                std::memcpy(&trailer, payload + payloadBytes, sizeof(trailer));
+                uint32_t actual = FastCRC32::compute(payload, payloadBytes);
+                bool indexMatches = index_.empty() || index_[block].blockCrc == trailer;
+
+                if (actual != trailer || !indexMatches) {
+                    ManifestBlockDamage damage{block, block * info_.blockRecords, recordCount, 0, 0};
+                    if (!index_.empty()) {
+                        damage.minSector = index_[block].minSector;
+                        damage.maxSector = index_[block].maxSector;
+                    }
+                    localDamage.push_back(damage);
+                }
+            }
+
+            uint64_t checked = checkedBlocks.fetch_add(lastBlock - firstBlock) + (lastBlock - firstBlock);
+            if (progressCallback) {
+                progressCallback(static_cast<int>(checked), static_cast<int>(info_.blockCount));
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(resultMutex);
+        damagedBlocks_.insert(damagedBlocks_.end(), localDamage.begin(), localDamage.end());
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (ioFailed) {
+        lastError_ = "Failed to read checksum data: " + manifestPath;
+        return false;
+    }
+
+    blocksChecked_ = checkedBlocks;
+    std::sort(damagedBlocks_.begin(), damagedBlocks_.end(),
+              [](const ManifestBlockDamage& a, const ManifestBlockDamage& b) { return a.blockIndex < b.blockIndex; });
+    return true;
+}
@@ -0,0 +1,254 @@
+#ifndef CHECKSUM_MANIFEST_H
+#define CHECKSUM_MANIFEST_H
+
+#include "DiskSectorCRC.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <functional>
+#include <utility>
+
+// On-disk manifest layouts understood by the readers
+enum class ManifestFormat {
+    Unknown,
+    CrcdV1,     // "CRCD" header followed by SectorChecksum records
+    CrcdV2,     // "CRC2" checksummed header, CRC-framed blocks of compact records, block index footer
+    Compact,    // Headerless {uint64 sector, uint32 crc} records (FinalUltimateOptimizedGUI)
+    Delta       // "CRDL" header naming a base manifest, followed by sorted compact records
+};
+
+// Manifest constants
+static constexpr uint32_t MANIFEST_MAGIC_V1 = 0x43524344;   // "CRCD"
+static constexpr uint64_t MANIFEST_V1_HEADER_SIZE = sizeof(uint32_t) + 3 * sizeof(uint64_t);
+static constexpr uint32_t MANIFEST_V1_RECORD_SIZE = sizeof(SectorChecksum);
+static constexpr uint32_t MANIFEST_COMPACT_RECORD_SIZE = sizeof(uint64_t) + sizeof(uint32_t);
+static constexpr uint32_t MANIFEST_MAGIC_DELTA = 0x4352444C;  // "CRDL"
+static constexpr uint32_t MANIFEST_DELTA_VERSION = 2;
+static constexpr uint32_t MANIFEST_DELTA_LEGACY_CRC_VERSION = 1;  // Records use the old CRC-32 table
+static constexpr uint32_t MANIFEST_DELTA_UNFINISHED_VERSION = 0;  // Header of a delta still being written
+static constexpr uint64_t MANIFEST_DELTA_FIXED_HEADER_SIZE = 2 * sizeof(uint32_t) + 6 * sizeof(uint64_t) + 2 * sizeof(uint32_t);
+static constexpr uint64_t MANIFEST_DELTA_RECORD_COUNT_OFFSET = 2 * sizeof(uint32_t) + 3 * sizeof(uint64_t);
+static constexpr uint32_t MANIFEST_MAGIC_V2 = 0x43524332;   // "CRC2"
+static constexpr uint32_t MANIFEST_V2_VERSION = 2;
+static constexpr uint32_t MANIFEST_V2_BLOCK_SIZE = 64 * 1024;  // Records plus the 4-byte CRC trailer
+static constexpr uint32_t MANIFEST_V2_BLOCK_RECORDS = (MANIFEST_V2_BLOCK_SIZE - sizeof(uint32_t)) / MANIFEST_COMPACT_RECORD_SIZE;
+
+// v2 file header. headerCrc covers every preceding byte; the counts and index offset are
+// zero until the writer finalizes the file, so an interrupted write is never mistaken for a
+// complete manifest.
+struct ManifestV2Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t startSector;
+    uint64_t sectorCount;
+    uint64_t timestamp;
+    uint64_t recordCount;
+    uint64_t blockCount;
+    uint64_t indexOffset;       // Byte offset of the block index footer
+    uint32_t blockSize;         // Stride between blocks (the last block may be shorter)
+    uint32_t blockRecords;      // Records in every block but the last
+    uint32_t flags;
+    uint32_t headerCrc;
+};
+
+// One entry of the v2 block index; the footer is blockCount entries followed by a CRC32 of them
+struct ManifestBlockIndexEntry {
+    uint64_t minSector;
+    uint64_t maxSector;
+    uint32_t recordCount;
+    uint32_t blockCrc;          // Copy of the block trailer
+};
+
+// Parsed manifest header
+struct ManifestInfo {
+    ManifestFormat format = ManifestFormat::Unknown;
+    uint64_t startSector = 0;       // Header value (v1, delta) or first record's sector (compact)
+    uint64_t sectorCount = 0;       // Header value (v1, delta) or record count (compact)
+    uint64_t timestamp = 0;         // Header value (v1, delta) or 0 (compact)
+    uint64_t recordCount = 0;       // Records actually present in the file
+    uint64_t dataOffset = 0;        // Byte offset of the first record
+    uint32_t recordSize = 0;        // Bytes per record
+
+    // Sector CRCs were computed with the old DiskSectorCRC table (entry 10 wrong) and must be
+    // checked with FastCRC32::legacyCrc32. Set for CRCD v1 and delta version 1.
+    bool legacyCrc = false;
+
+    // Delta manifests only
+    std::string baseManifest;       // Base manifest path as recorded by the writer
+    uint64_t baseTimestamp = 0;     // Identity of the base file when the delta was written
+    uint64_t baseRecordCount = 0;
+    uint32_t chainDepth = 0;        // 1 for a delta written directly against a full manifest
+
+    // v2 manifests only
+    uint64_t blockCount = 0;
+    uint64_t indexOffset = 0;
+    uint32_t blockSize = 0;
+    uint32_t blockRecords = 0;
+};
+
+// Streaming, column-oriented reader for checksum manifests.
+// Each instance owns its own file handle, so parallel workers open one reader each.
+// v2 blocks are checked against their CRC trailer as they are loaded; a damaged block fails the
+// read with the block and sector range named, instead of handing back garbage records.
+class ChecksumManifestReader {
+public:
+    ChecksumManifestReader();
+    ~ChecksumManifestReader();
+
+    bool open(const std::string& manifestPath);
+    void close();
+    bool isOpen() const { return file_.is_open(); }
+
+    const ManifestInfo& info() const { return info_; }
+
+    // Read records [firstRecord, firstRecord + count) into separate sector and CRC columns
+    bool readColumns(uint64_t firstRecord, uint64_t count,
+                     std::vector<uint64_t>& sectors, std::vector<uint32_t>& crcs);
+
+    // Read every record into SectorChecksum form (timestamps are taken from the header)
+    bool readAll(std::vector<SectorChecksum>& checksums);
+
+    static const char* formatName(ManifestFormat format);
+
+    std::string getLastError() const { return lastError_; }
+
+private:
+    std::string path_;
+    std::ifstream file_;
+    ManifestInfo info_;
+    std::string lastError_;
+    std::vector<uint8_t> rawBuffer_;
+    uint64_t cachedBlock_ = UINT64_MAX;
+
+    bool detectFormat(uint64_t fileSize);
+    bool readV2Header(uint64_t fileSize);
+    bool loadBlock(uint64_t block);
+};
+
+// Writer for v2 manifests. append() is thread-safe so parallel generators can share one writer;
+// records are framed into CRC-trailed blocks and the index and header are written by close().
+// Until then the header stays provisional, which is what makes an interrupted write resumable:
+// every full block already in the file is self-checking and can be kept as it is.
+class ChecksumManifestWriter {
+public:
+    ChecksumManifestWriter();
+    ~ChecksumManifestWriter();
+
+    bool open(const std::string& outputFile, uint64_t startSector, uint64_t sectorCount, uint64_t timestamp);
+
+    // Continue a manifest that was suspended or interrupted. Its provisional header must match the
+    // arguments; the leading full blocks whose CRC checks out are kept and everything after them
+    // is cut off, then appends carry on behind them.
+    bool resume(const std::string& outputFile, uint64_t startSector, uint64_t sectorCount, uint64_t timestamp);
+
+    // Keep the sector ranges covered by written blocks (start -> count); set before open/resume
+    void setRangeTracking(bool enabled) { trackRanges_ = enabled; }
+
+    // Push written blocks to the OS and report how many there are and which sectors they cover.
+    // Records of the unfinished block are not included.
+    bool checkpoint(uint64_t& blockCount, std::map<uint64_t, uint64_t>& coveredRanges);
+
+    // Close without finalizing: full blocks stay, the unfinished block is dropped and the header
+    // stays provisional, so readers reject the file but resume() can continue it. Error and
+    // cancel paths call this (the destructor does too) instead of close().
+    bool suspend();
+
+    bool append(uint64_t sectorNumber, uint32_t crc32);
+    bool appendBatch(const SectorChecksum* checksums, size_t count);
+
+    // Records for consecutive sectors firstSector .. firstSector + count - 1, taken under one lock
+    bool appendRun(uint64_t firstSector, const uint32_t* crcs, size_t count);
+
+    // Flush the last block, write the index footer and finalize the header. Only for a run that
+    // covered its whole range.
+    bool close();
+
+    uint64_t recordCount() const;
+    std::string getLastError() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::ofstream file_;
+    std::string outputFile_;
+    std::string lastError_;
+    ManifestV2Header header_;
+    std::vector<uint8_t> block_;
+    uint32_t blockRecords_;
+    uint64_t blockMinSector_;
+    uint64_t blockMaxSector_;
+    std::vector<ManifestBlockIndexEntry> index_;
+    bool failed_;
+    bool trackRanges_;
+    std::vector<std::pair<uint64_t, uint64_t>> blockRuns_;     // Runs of the unfinished block
+    std::map<uint64_t, uint64_t> coveredRanges_;               // Sectors of written blocks
+
+    bool appendLocked(uint64_t sectorNumber, uint32_t crc32);
+    bool flushBlock();
+    void noteRecord(uint64_t sectorNumber);
+};
+
+// External sort of a manifest into a v2 manifest in ascending sector order, one record per
+// sector. Runs of up to runRecords records are sorted in memory and spilled next to the output,
+// then merged, so memory stays bounded by the run size whatever the input. A sector recorded
+// twice keeps the CRC of its last record, as a scan in file order would.
+class ManifestSorter {
+public:
+    ManifestSorter();
+
+    bool sort(ChecksumManifestReader& input, const std::string& outputFile);
+
+    // Records per in-memory run
+    void setRunRecords(uint64_t runRecords) { runRecords_ = runRecords ? runRecords : 1; }
+
+    std::string getLastError() const { return lastError_; }
+
+private:
+    uint64_t runRecords_;
+    std::string lastError_;
+
+    bool mergeRuns(const std::vector<std::string>& runFiles, ChecksumManifestWriter& writer);
+};
+
+// Damaged v2 block as reported by the validator
+struct ManifestBlockDamage {
+    uint64_t blockIndex;
+    uint64_t firstRecord;
+    uint64_t recordCount;
+    uint64_t minSector;         // Sector range the block claims to cover, taken from the index
+    uint64_t maxSector;
+};
+
+// Integrity check for a single manifest file.
+// Quick mode checks the header and (v2) the block index only; full mode additionally verifies
+// every block trailer in a parallel scan. v1, compact and delta files carry no checksums, so
+// only their structure can be checked. Legacy-CRC manifests are flagged in info().
+class ManifestValidator {
+public:
+    ManifestValidator();
+
+    bool validate(const std::string& manifestPath, bool quickCheck = false, int threadCount = 0,
+                  std::function<void(int, int)> progressCallback = nullptr);
+
+    const ManifestInfo& info() const { return info_; }
+    const std::vector<ManifestBlockDamage>& damagedBlocks() const { return damagedBlocks_; }
+    uint64_t blocksChecked() const { return blocksChecked_; }
+    bool hasChecksums() const { return info_.format == ManifestFormat::CrcdV2; }
+
+    std::string getLastError() const { return lastError_; }
+
+private:
+    ManifestInfo info_;
+    std::vector<ManifestBlockIndexEntry> index_;
+    std::vector<ManifestBlockDamage> damagedBlocks_;
+    uint64_t blocksChecked_;
+    std::string lastError_;
+
+    bool readIndex(const std::string& manifestPath);
+    bool scanBlocks(const std::string& manifestPath, int threadCount,
+                    std::function<void(int, int)> progressCallback);
+};
+
+#endif // CHECKSUM_MANIFEST_H
@@ -0,0 +1,343 @@
+#ifndef CONCURRENT_RING_H
+#define CONCURRENT_RING_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RING_CPU_RELAX() _mm_pause()
+#else
+#define RING_CPU_RELAX() std::this_thread::yield()
+#endif
+
+// Indices owned by different threads live on separate cache lines
+static constexpr size_t RING_CACHE_LINE = 64;
+
+// Failed attempts spent spinning before a thread parks on an empty or full ring
+static constexpr int RING_SPIN_LIMIT = 256;
+
+// Ring sizes are rounded up to a power of two so slots are addressed with a mask
+inline size_t ringCapacityFor(size_t requested) {
+    size_t capacity = 2;
+    while (capacity < requested) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+// Bounded single-producer/single-consumer ring.
+// Each side keeps a private copy of the other side's index and only reloads it when the
+// ring looks full (producer) or empty (consumer), so steady-state transfers touch no shared
+// cache line other than the slot itself.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : capacity_(ringCapacityFor(capacity)), mask_(capacity_ - 1), slots_(new T[capacity_]),
+          head_(0), cachedTail_(0), tail_(0), cachedHead_(0) {
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side; the value is only moved from when the push succeeds
+    template <typename U>
+    bool tryPush(U&& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ == capacity_) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ == capacity_) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = std::forward<U>(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool tryPop(T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head == cachedTail_) {
+                return false;
+            }
+        }
+        value = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    size_t sizeApprox() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+private:
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    alignas(RING_CACHE_LINE) std::atomic<size_t> head_;     // Written by the consumer
+    size_t cachedTail_;                                      // Consumer-private
+    alignas(RING_CACHE_LINE) std::atomic<size_t> tail_;     // Written by the producer
+    size_t cachedHead_;                                      // Producer-private
+};
+
+// Bounded multi-producer/multi-consumer ring (per-slot sequence numbers, D. Vyukov's design).
+// Producers and consumers claim slots with one CAS on their own padded index; the slot's
+// sequence number tells them whether it is free, filled, or still being written.
+template <typename T>
+class MpmcRing {
+public:
+    explicit MpmcRing(size_t capacity)
+        : capacity_(ringCapacityFor(capacity)), mask_(capacity_ - 1), cells_(new Cell[capacity_]),
+          enqueuePos_(0), dequeuePos_(0) {
+        for (size_t i = 0; i < capacity_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    // The value is only moved from when the push succeeds
+    template <typename U>
+    bool tryPush(U&& value) {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (difference == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;   // Full
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::forward<U>(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (difference == 0) {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;   // Empty
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    size_t sizeApprox() const {
+        size_t enqueued = enqueuePos_.load(std::memory_order_acquire);
+        size_t dequeued = dequeuePos_.load(std::memory_order_acquire);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+
+    alignas(RING_CACHE_LINE) std::atomic<size_t> enqueuePos_;
+    alignas(RING_CACHE_LINE) std::atomic<size_t> dequeuePos_;
+};
+
+// Event count: lets a thread sleep until "something changed" without the notifier taking a
+// lock on the fast path. Notifiers only enter the kernel when a waiter has registered, so a
+// ring that is neither empty nor full never touches the mutex or condition variable.
+//
+// Waiter protocol: key = prepareWait(); re-check the condition; then either cancelWait()
+// or wait(key).
+class RingEventCount {
+public:
+    RingEventCount() : waiters_(0), epoch_(0) {}
+
+    uint64_t prepareWait() {
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        return epoch_.load(std::memory_order_seq_cst);
+    }
+
+    void cancelWait() {
+        waiters_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    void wait(uint64_t key) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this, key]() { return epoch_.load(std::memory_order_relaxed) != key; });
+        }
+        waiters_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    void notifyOne() { notify(false); }
+    void notifyAll() { notify(true); }
+
+private:
+    alignas(RING_CACHE_LINE) std::atomic<uint32_t> waiters_;
+    std::atomic<uint64_t> epoch_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+
+    void notify(bool all) {
+        // Pairs with the seq_cst increment in prepareWait: either we see the waiter, or the
+        // waiter's re-check sees the state change that preceded this call
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            epoch_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (all) {
+            condition_.notify_all();
+        } else {
+            condition_.notify_one();
+        }
+    }
+};
+
+// Blocking front end for SpscRing/MpmcRing. push/pop spin briefly and then park on an event
+// count only while the ring is full/empty. close() marks the end of the stream: producers are
+// refused from then on, while consumers drain the remaining items before pop returns false.
+template <typename T, typename Ring = MpmcRing<T>>
+class BlockingRing {
+public:
+    explicit BlockingRing(size_t capacity) : ring_(capacity), closed_(false) {}
+
+    BlockingRing(const BlockingRing&) = delete;
+    BlockingRing& operator=(const BlockingRing&) = delete;
+
+    // Returns false if the ring was closed; the value is left untouched in that case
+    template <typename U>
+    bool push(U&& value) {
+        int spins = 0;
+        for (;;) {
+            if (closed_.load(std::memory_order_seq_cst)) {
+                return false;
+            }
+            if (ring_.tryPush(std::forward<U>(value))) {
+                notEmpty_.notifyOne();
+                return true;
+            }
+            if (++spins < RING_SPIN_LIMIT) {
+                RING_CPU_RELAX();
+                continue;
+            }
+
+            uint64_t key = notFull_.prepareWait();
+            if (closed_.load(std::memory_order_seq_cst)) {
+                notFull_.cancelWait();
+                return false;
+            }
+            if (ring_.tryPush(std::forward<U>(value))) {
+                notFull_.cancelWait();
+                notEmpty_.notifyOne();
+                return true;
+            }
+            notFull_.wait(key);
+            spins = 0;
+        }
+    }
+
+    // Returns false once the ring is closed and drained
+    bool pop(T& value) {
+        int spins = 0;
+        for (;;) {
+            if (tryPop(value)) {
+                return true;
+            }
+            if (closed_.load(std::memory_order_seq_cst)) {
+                // Items pushed before close() are still delivered
+                return tryPop(value);
+            }
+            if (++spins < RING_SPIN_LIMIT) {
+                RING_CPU_RELAX();
+                continue;
+            }
+
+            uint64_t key = notEmpty_.prepareWait();
+            if (tryPop(value)) {
+                notEmpty_.cancelWait();
+                return true;
+            }
+            if (closed_.load(std::memory_order_seq_cst)) {
+                notEmpty_.cancelWait();
+                continue;
+            }
+            notEmpty_.wait(key);
+            spins = 0;
+        }
+    }
+
+    template <typename U>
+    bool tryPush(U&& value) {
+        if (closed_.load(std::memory_order_seq_cst) || !ring_.tryPush(std::forward<U>(value))) {
+            return false;
+        }
+        notEmpty_.notifyOne();
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        if (!ring_.tryPop(value)) {
+            return false;
+        }
+        notFull_.notifyOne();
+        return true;
+    }
+
+    void close() {
+        closed_.store(true, std::memory_order_seq_cst);
+        notEmpty_.notifyAll();
+        notFull_.notifyAll();
+    }
+
+    bool isClosed() const { return closed_.load(std::memory_order_seq_cst); }
+    size_t capacity() const { return ring_.capacity(); }
+    size_t sizeApprox() const { return ring_.sizeApprox(); }
+
+private:
+    Ring ring_;
+    std::atomic<bool> closed_;
+    RingEventCount notEmpty_;
+    RingEventCount notFull_;
+};
+
+#endif // CONCURRENT_RING_H
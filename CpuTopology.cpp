@@ -0,0 +1,382 @@
+#include "CpuTopology.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static size_t popCount(uint64_t value) {
+    size_t count = 0;
+    while (value) {
+        value &= value - 1;
+        ++count;
+    }
+    return count;
+}
+
+bool CpuSet::empty() const {
+    for (uint64_t mask : masks) {
+        if (mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t CpuSet::count() const {
+    size_t total = 0;
+    for (uint64_t mask : masks) {
+        total += popCount(mask);
+    }
+    return total;
+}
+
+bool CpuSet::contains(unsigned int cpu) const {
+    size_t group = cpu / 64;
+    return group < masks.size() && (masks[group] >> (cpu % 64)) & 1;
+}
+
+void CpuSet::add(unsigned int cpu) {
+    size_t group = cpu / 64;
+    if (group >= masks.size()) {
+        masks.resize(group + 1, 0);
+    }
+    masks[group] |= uint64_t(1) << (cpu % 64);
+}
+
+CpuSet CpuSet::intersect(const CpuSet& other) const {
+    CpuSet result;
+    result.masks.resize(std::min(masks.size(), other.masks.size()));
+    for (size_t group = 0; group < result.masks.size(); ++group) {
+        result.masks[group] = masks[group] & other.masks[group];
+    }
+    return result;
+}
+
+bool CpuSet::parse(const std::string& spec, CpuSet& set, std::string& error) {
+    CpuSet parsed;
+    size_t position = 0;
+    while (position <= spec.size()) {
+        size_t comma = spec.find(',', position);
+        std::string item = spec.substr(position, comma == std::string::npos ? std::string::npos : comma - position);
+        position = comma == std::string::npos ? spec.size() + 1 : comma + 1;
+        if (item.empty()) {
+            continue;
+        }
+
+        unsigned long first, last;
+        try {
+            size_t dash = item.find('-');
+            size_t used = 0;
+            first = std::stoul(item.substr(0, dash), &used);
+            if (used != (dash == std::string::npos ? item.size() : dash)) {
+                throw std::invalid_argument(item);
+            }
+            last = first;
+            if (dash != std::string::npos) {
+                last = std::stoul(item.substr(dash + 1), &used);
+                if (used != item.size() - dash - 1) {
+                    throw std::invalid_argument(item);
+                }
+            }
+        } catch (const std::exception&) {
+            error = "Invalid CPU list entry: " + item;
+            return false;
+        }
+        if (last < first || last >= 4096) {
+            error = "Invalid CPU range: " + item;
+            return false;
+        }
+        for (unsigned long cpu = first; cpu <= last; ++cpu) {
+            parsed.add(static_cast<unsigned int>(cpu));
+        }
+    }
+
+    if (parsed.empty()) {
+        error = "Empty CPU list: " + spec;
+        return false;
+    }
+    set = parsed;
+    return true;
+}
+
+std::string CpuSet::toString() const {
+    std::string result;
+    unsigned int limit = static_cast<unsigned int>(masks.size() * 64);
+    for (unsigned int cpu = 0; cpu < limit; ++cpu) {
+        if (!contains(cpu)) {
+            continue;
+        }
+        unsigned int last = cpu;
+        while (last + 1 < limit && contains(last + 1)) {
+            ++last;
+        }
+        if (!result.empty()) {
+            result += ",";
+        }
+        result += std::to_string(cpu);
+        if (last != cpu) {
+            result += "-" + std::to_string(last);
+        }
+        cpu = last;
+    }
+    return result;
+}
+
+const CpuTopology& CpuTopology::instance() {
+    static CpuTopology topology;
+    return topology;
+}
+
+CpuTopology::CpuTopology() {
+    CpuSet allowed;
+
+#ifdef _WIN32
+    // Processors of the process's primary group the process may use; other groups are only
+    // reachable through explicit group affinity, which pinning provides
+    GROUP_AFFINITY threadAffinity = {};
+    DWORD_PTR processMask = 0, systemMask = 0;
+    bool haveProcessMask = GetThreadGroupAffinity(GetCurrentThread(), &threadAffinity) &&
+                           GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask);
+
+    ULONG highestNode = 0;
+    if (GetNumaHighestNodeNumber(&highestNode)) {
+        for (ULONG id = 0; id <= highestNode; ++id) {
+            GROUP_AFFINITY nodeAffinity = {};
+            if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(id), &nodeAffinity)) {
+                continue;
+            }
+            uint64_t mask = nodeAffinity.Mask;
+            if (haveProcessMask && nodeAffinity.Group == threadAffinity.Group) {
+                mask &= processMask;
+            }
+
+            NumaNode node;
+            node.id = id;
+            node.cpus.masks.resize(nodeAffinity.Group + 1, 0);
+            node.cpus.masks[nodeAffinity.Group] = mask;
+            if (!node.cpus.empty()) {
+                nodes_.push_back(node);
+            }
+        }
+    }
+#else
+    cpu_set_t affinity;
+    CPU_ZERO(&affinity);
+    if (sched_getaffinity(0, sizeof(affinity), &affinity) == 0) {
+        for (unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &affinity)) {
+                allowed.add(cpu);
+            }
+        }
+    }
+
+    if (DIR* directory = opendir("/sys/devices/system/node")) {
+        while (dirent* entry = readdir(directory)) {
+            std::string name = entry->d_name;
+            if (name.compare(0, 4, "node") != 0 || name.size() == 4 ||
+                name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue;
+            }
+
+            std::ifstream cpuList("/sys/devices/system/node/" + name + "/cpulist");
+            std::string spec, error;
+            NumaNode node;
+            node.id = static_cast<uint32_t>(std::stoul(name.substr(4)));
+            if (!std::getline(cpuList, spec) || !CpuSet::parse(spec, node.cpus, error)) {
+                continue;
+            }
+            if (!allowed.empty()) {
+                node.cpus = node.cpus.intersect(allowed);
+            }
+            if (!node.cpus.empty()) {
+                nodes_.push_back(node);
+            }
+        }
+        closedir(directory);
+    }
+    std::sort(nodes_.begin(), nodes_.end(),
+              [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+#endif
+
+    // No NUMA information: one node holding every usable processor
+    if (nodes_.empty()) {
+        NumaNode node;
+        node.cpus = allowed;
+        if (node.cpus.empty()) {
+            unsigned int cpuCount = std::max(1u, std::thread::hardware_concurrency());
+            for (unsigned int cpu = 0; cpu < cpuCount; ++cpu) {
+                node.cpus.add(cpu);
+            }
+        }
+        nodes_.push_back(node);
+    }
+}
+
+size_t CpuTopology::currentNodeIndex() const {
+    unsigned int cpu = 0;
+#ifdef _WIN32
+    PROCESSOR_NUMBER processor = {};
+    GetCurrentProcessorNumberEx(&processor);
+    cpu = processor.Group * 64u + processor.Number;
+#else
+    int current = sched_getcpu();
+    if (current < 0) {
+        return 0;
+    }
+    cpu = static_cast<unsigned int>(current);
+#endif
+    for (size_t index = 0; index < nodes_.size(); ++index) {
+        if (nodes_[index].cpus.contains(cpu)) {
+            return index;
+        }
+    }
+    return 0;
+}
+
+bool CpuTopology::pinCurrentThread(const CpuSet& cpus) {
+    if (cpus.empty()) {
+        return false;
+    }
+
+#ifdef _WIN32
+    // A thread lives in one processor group; take the group holding most of the set
+    size_t bestGroup = 0;
+    for (size_t group = 1; group < cpus.masks.size(); ++group) {
+        if (popCount(cpus.masks[group]) > popCount(cpus.masks[bestGroup])) {
+            bestGroup = group;
+        }
+    }
+    GROUP_AFFINITY affinity = {};
+    affinity.Group = static_cast<WORD>(bestGroup);
+    affinity.Mask = static_cast<KAFFINITY>(cpus.masks[bestGroup]);
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL) != FALSE;
+#else
+    cpu_set_t affinity;
+    CPU_ZERO(&affinity);
+    for (unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (cpus.contains(cpu)) {
+            CPU_SET(cpu, &affinity);
+        }
+    }
+    return sched_setaffinity(0, sizeof(affinity), &affinity) == 0;
+#endif
+}
+
+bool ThreadPlacement::parse(const std::string& spec, ThreadPlacement& placement, std::string& error) {
+    ThreadPlacement parsed;
+    size_t position = 0;
+    while (position <= spec.size()) {
+        size_t separator = spec.find(';', position);
+        std::string item = spec.substr(position, separator == std::string::npos ? std::string::npos : separator - position);
+        position = separator == std::string::npos ? spec.size() + 1 : separator + 1;
+        if (item.empty()) {
+            continue;
+        }
+
+        size_t equals = item.find('=');
+        if (equals == std::string::npos) {
+            error = "Expected stage=cpus: " + item;
+            return false;
+        }
+        std::string key = item.substr(0, equals);
+        std::string value = item.substr(equals + 1);
+
+        if (key == "numa") {
+            if (value != "on" && value != "off") {
+                error = "numa must be on or off: " + value;
+                return false;
+            }
+            parsed.numaAware = value == "on";
+            continue;
+        }
+
+        CpuSet* stage = key == "readers" ? &parsed.readers
+                      : key == "hashers" ? &parsed.hashers
+                      : key == "writer" ? &parsed.writer : nullptr;
+        if (stage == nullptr) {
+            error = "Unknown pipeline stage: " + key;
+            return false;
+        }
+        if (!CpuSet::parse(value, *stage, error)) {
+            return false;
+        }
+    }
+
+    placement = parsed;
+    return true;
+}
+
+const ThreadPlacement& ThreadPlacement::fromEnvironment() {
+    static const ThreadPlacement placement = []() {
+        ThreadPlacement result;
+        const char* spec = std::getenv("CRCRECOVER_PLACEMENT");
+        std::string error;
+        if (spec != nullptr && !parse(spec, result, error)) {
+            std::cerr << "Ignoring CRCRECOVER_PLACEMENT: " << error << std::endl;
+            result = ThreadPlacement();
+        }
+        return result;
+    }();
+    return placement;
+}
+
+CpuSet ThreadPlacement::stageCpus(const CpuSet& stage, const NumaNode& node) const {
+    if (!numaAware) {
+        return stage;
+    }
+    if (stage.empty()) {
+        return node.cpus;
+    }
+    CpuSet local = stage.intersect(node.cpus);
+    return local.empty() ? stage : local;
+}
+
+void* allocateOnNode(size_t size, int node) {
+#ifdef _WIN32
+    void* memory = node >= 0
+        ? VirtualAllocExNuma(GetCurrentProcess(), NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE,
+                             static_cast<DWORD>(node))
+        : VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (memory == NULL) {
+        throw std::bad_alloc();
+    }
+    return memory;
+#else
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    if (node >= 0 && node < 64) {
+        // Preferred-node policy; pages are placed when first touched
+        const int MPOL_PREFERRED_POLICY = 1;
+        unsigned long nodeMask = 1UL << node;
+        syscall(SYS_mbind, memory, size, MPOL_PREFERRED_POLICY, &nodeMask, sizeof(nodeMask) * 8, 0);
+    }
+    return memory;
+#endif
+}
+
+void freeOnNode(void* memory, size_t size) {
+    if (memory == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    (void)size; // MEM_RELEASE frees the whole reservation
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    munmap(memory, size);
+#endif
+}
@@ -0,0 +1,80 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Set of logical processors, numbered the way the OS numbers them: on Windows processor
+// group * 64 + index within the group, elsewhere the kernel CPU id. Windows runs a thread inside
+// a single group, so pinning to a set spanning groups uses its largest group.
+struct CpuSet {
+    std::vector<uint64_t> masks;    // Bit i of masks[g] is processor g * 64 + i
+
+    bool empty() const;
+    size_t count() const;
+    bool contains(unsigned int cpu) const;
+    void add(unsigned int cpu);
+
+    CpuSet intersect(const CpuSet& other) const;
+
+    // Parse a list such as "0-7,16,18-19"
+    static bool parse(const std::string& spec, CpuSet& set, std::string& error);
+    std::string toString() const;
+};
+
+struct NumaNode {
+    uint32_t id = 0;
+    CpuSet cpus;    // Processors of the node this process may run on
+};
+
+// NUMA layout of the machine restricted to the processors the process may use, discovered once
+// (Windows NUMA APIs, elsewhere sysfs and sched_getaffinity). Machines without NUMA report a
+// single node.
+class CpuTopology {
+public:
+    static const CpuTopology& instance();
+
+    const std::vector<NumaNode>& nodes() const { return nodes_; }
+    size_t nodeCount() const { return nodes_.size(); }
+
+    // Index into nodes() of the node the calling thread runs on
+    size_t currentNodeIndex() const;
+
+    // Restrict the calling thread to `cpus`; false if the set is empty or the call failed
+    static bool pinCurrentThread(const CpuSet& cpus);
+
+private:
+    CpuTopology();
+
+    std::vector<NumaNode> nodes_;
+};
+
+// Where the stages of a read -> hash -> write pipeline may run. Empty sets leave placement to
+// the scheduler (or to NUMA pairing when enabled). With numaAware set, pipelines split their
+// readers across nodes, allocate each reader's buffers on its node and hash them on the same
+// node, so sector data never crosses the interconnect.
+struct ThreadPlacement {
+    bool numaAware = true;
+    CpuSet readers;
+    CpuSet hashers;
+    CpuSet writer;
+
+    // "readers=0-3;hashers=4-15;writer=2;numa=off"; unspecified stages stay unrestricted
+    static bool parse(const std::string& spec, ThreadPlacement& placement, std::string& error);
+
+    // Placement from the CRCRECOVER_PLACEMENT environment variable, defaults if unset or invalid
+    static const ThreadPlacement& fromEnvironment();
+
+    // CPUs for a stage thread working on `node`: the stage set narrowed to the node when NUMA
+    // pairing is on, falling back to whichever of the two is not empty
+    CpuSet stageCpus(const CpuSet& stage, const NumaNode& node) const;
+};
+
+// Page-aligned memory placed on NUMA node `node` (the OS node id, NumaNode::id); node < 0 leaves
+// placement to the OS
+void* allocateOnNode(size_t size, int node);
+void freeOnNode(void* memory, size_t size);
+
+#endif // CPU_TOPOLOGY_H
@@ -0,0 +1,94 @@
+// Every generator, verifier and repair path must agree on the sector CRC, otherwise intact sectors
+// show up as corrupted and "repairs" overwrite good data. Checks DiskSectorCRC::calculateCRC32 and
+// FastCRC32 against a bitwise CRC-32 on random buffers of every length a sector pipeline uses, and
+// FastCRC32::legacyCrc32 against the old byte-wise table that legacy manifests were written with.
+#include "DiskSectorCRC.h"
+#include "FastCRC32.h"
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Exposes the protected per-sector CRC the legacy generators use
+class CrcProbe : public DiskSectorCRC {
+public:
+    CrcProbe() : DiskSectorCRC("PhysicalDrive0") {}
+    uint32_t crc(const std::vector<uint8_t>& data) { return calculateCRC32(data); }
+};
+
+static uint32_t referenceCrc32(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0u - (crc & 1)));
+        }
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+// The old DiskSectorCRC table: standard CRC-32 except entry 10
+static uint32_t referenceLegacyCrc32(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; ++i) {
+        uint32_t entry = (crc ^ data[i]) & 0xFF;
+        uint32_t value = entry;
+        for (int bit = 0; bit < 8; ++bit) {
+            value = (value >> 1) ^ (0xEDB88320 & (0u - (value & 1)));
+        }
+        crc = (crc >> 8) ^ (entry == 10 ? 0xE0D5E4E8 : value);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+int main() {
+    int failures = 0;
+    auto expect = [&failures](bool condition, const std::string& what) {
+        if (!condition) {
+            std::cout << "FAIL: " << what << std::endl;
+            ++failures;
+        }
+    };
+
+    // Standard check value of CRC-32/ISO-HDLC
+    const std::string check = "123456789";
+    std::vector<uint8_t> checkData(check.begin(), check.end());
+    CrcProbe probe;
+    expect(probe.crc(checkData) == 0xCBF43926, "DiskSectorCRC check value");
+    expect(FastCRC32::compute(checkData.data(), checkData.size()) == 0xCBF43926, "FastCRC32 check value");
+
+    std::mt19937_64 random(0x5EC7012);
+    const size_t lengths[] = {0, 1, 7, 8, 9, 63, 511, 512, 513, 4096, 65536};
+    for (size_t length : lengths) {
+        for (int round = 0; round < 64; ++round) {
+            std::vector<uint8_t> data(length);
+            for (auto& byte : data) {
+                byte = static_cast<uint8_t>(random());
+            }
+            // Bytes that index entry 10 of a byte-wise table, where the old table was wrong
+            if (length > 0 && round % 2 == 0) {
+                data[random() % length] = 0x0A;
+            }
+
+            uint32_t reference = referenceCrc32(data.data(), data.size());
+            uint32_t fast = FastCRC32::compute(data.data(), data.size());
+            uint32_t sector = probe.crc(data);
+            std::string label = "length " + std::to_string(length) + " round " + std::to_string(round);
+            expect(fast == reference, "FastCRC32 vs reference, " + label);
+            expect(sector == fast, "DiskSectorCRC vs FastCRC32, " + label);
+            expect(FastCRC32::legacyCrc32(data.data(), data.size()) == referenceLegacyCrc32(data.data(), data.size()),
+                   "FastCRC32::legacyCrc32 vs old table, " + label);
+
+            // Split updates must match a single pass
+            size_t split = length ? random() % length : 0;
+            uint32_t chained = FastCRC32::update(FastCRC32::update(0, data.data(), split),
+                                                 data.data() + split, length - split);
+            expect(chained == fast, "FastCRC32::update split, " + label);
+        }
+    }
+
+    if (failures == 0) {
+        std::cout << "CRC consistency: OK" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+#include "CrcSyndrome.h"
+#include "FastCRC32.h"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+
+CrcSyndromeTable::CrcSyndromeTable(size_t length) : length_(length) {
+    // Byte-wise table of the bare (zero init, no final xor) reflected CRC
+    uint32_t table[256];
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+        table[i] = crc;
+    }
+
+    // The syndrome of bit b in byte k is the CRC of that bit followed by length - 1 - k zero
+    // bytes; walking from the last byte backwards adds one zero byte per step
+    bitSyndromes_.resize(length_ * 8);
+    uint32_t syndromes[8];
+    for (int bit = 0; bit < 8; ++bit) {
+        syndromes[bit] = table[1u << bit];
+    }
+    for (size_t byte = length_; byte-- > 0;) {
+        for (int bit = 0; bit < 8; ++bit) {
+            bitSyndromes_[byte * 8 + bit] = syndromes[bit];
+            syndromes[bit] = (syndromes[bit] >> 8) ^ table[syndromes[bit] & 0xFF];
+        }
+    }
+
+    entries_.resize(bitSyndromes_.size());
+    for (uint32_t bit = 0; bit < bitSyndromes_.size(); ++bit) {
+        entries_[bit] = Entry{bitSyndromes_[bit], bit};
+    }
+    std::sort(entries_.begin(), entries_.end(),
+              [](const Entry& a, const Entry& b) { return a.syndrome < b.syndrome; });
+
+    // Only reachable for very long buffers, where two bits can share a syndrome
+    for (size_t i = 1; i < entries_.size(); ++i) {
+        if (entries_[i].syndrome == entries_[i - 1].syndrome) {
+            entries_[i].bit = entries_[i - 1].bit = AMBIGUOUS;
+        }
+    }
+}
+
+const CrcSyndromeTable& CrcSyndromeTable::forLength(size_t length) {
+    static std::mutex tablesMutex;
+    static std::map<size_t, std::unique_ptr<CrcSyndromeTable>> tables;
+
+    std::lock_guard<std::mutex> lock(tablesMutex);
+    std::unique_ptr<CrcSyndromeTable>& table = tables[length];
+    if (!table) {
+        table.reset(new CrcSyndromeTable(length));
+    }
+    return *table;
+}
+
+uint32_t CrcSyndromeTable::findBit(uint32_t syndrome) const {
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), syndrome,
+                               [](const Entry& entry, uint32_t value) { return entry.syndrome < value; });
+    return it != entries_.end() && it->syndrome == syndrome ? it->bit : AMBIGUOUS;
+}
+
+int CrcSyndromeTable::correct(uint8_t* data, uint32_t storedCrc, int maxFlips) const {
+    uint32_t syndrome = FastCRC32::compute(data, length_) ^ storedCrc;
+    if (syndrome == 0) {
+        return 0;
+    }
+
+    int flipped = 0;
+    uint32_t bit = findBit(syndrome);
+    uint32_t secondBit = AMBIGUOUS;
+    if (bit != AMBIGUOUS) {
+        flipped = 1;
+    } else if (maxFlips >= 2 && length_ <= MAX_DOUBLE_FLIP_LENGTH) {
+        // Pair (i, j) has syndrome S(i) ^ S(j); accept it only if no other pair fits
+        for (uint32_t first = 0; first < bitSyndromes_.size(); ++first) {
+            uint32_t second = findBit(syndrome ^ bitSyndromes_[first]);
+            if (second == AMBIGUOUS || second <= first) {
+                continue;
+            }
+            if (flipped == 2) {
+                return 0;
+            }
+            bit = first;
+            secondBit = second;
+            flipped = 2;
+        }
+    }
+    if (flipped == 0) {
+        return 0;
+    }
+
+    // Re-check the corrected buffer before reporting success
+    flipBit(data, bit);
+    if (flipped == 2) {
+        flipBit(data, secondBit);
+    }
+    if (FastCRC32::compute(data, length_) != storedCrc) {
+        flipBit(data, bit);
+        if (flipped == 2) {
+            flipBit(data, secondBit);
+        }
+        return 0;
+    }
+    return flipped;
+}
@@ -0,0 +1,52 @@
+#ifndef CRC_SYNDROME_H
+#define CRC_SYNDROME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Corrects bit flips in a buffer of fixed length from its CRC-32 alone. For two buffers of equal
+// length, crc(a) ^ crc(b) depends only on a ^ b (the syndrome), so a single flipped bit maps to
+// one of length * 8 syndromes, looked up in a sorted table. CRC-32 keeps these distinct for
+// buffers up to 11 KiB; a random multi-bit corruption still hits a single-bit syndrome with a
+// probability of about length * 8 / 2^32. Double flips are only searched on request: with
+// (length * 8)^2 / 2 candidate pairs, a random corruption of a 512-byte buffer matches one about
+// 0.2% of the time, too often to write the result back without another source agreeing.
+class CrcSyndromeTable {
+public:
+    // Double flips are only searched in buffers of at most this many bytes: beyond it so many bit
+    // pairs exist that an unrelated corruption would too often match one
+    static constexpr size_t MAX_DOUBLE_FLIP_LENGTH = 512;
+
+    explicit CrcSyndromeTable(size_t length);
+
+    // Shared table for a length, built on first use
+    static const CrcSyndromeTable& forLength(size_t length);
+
+    size_t length() const { return length_; }
+
+    // Flip the bits of `data` explaining the mismatch with storedCrc and re-check the result.
+    // Returns the number of bits corrected (1, or 2 when maxFlips is 2); 0 leaves data untouched,
+    // either because it already matches or because no unique flip of up to maxFlips bits explains
+    // the syndrome.
+    int correct(uint8_t* data, uint32_t storedCrc, int maxFlips = 1) const;
+
+private:
+    struct Entry {
+        uint32_t syndrome;
+        uint32_t bit;
+    };
+
+    static constexpr uint32_t AMBIGUOUS = 0xFFFFFFFF;
+
+    size_t length_;
+    std::vector<uint32_t> bitSyndromes_;    // By bit position
+    std::vector<Entry> entries_;            // Sorted by syndrome
+
+    // Bit with this single-flip syndrome, AMBIGUOUS if none or several
+    uint32_t findBit(uint32_t syndrome) const;
+
+    static void flipBit(uint8_t* data, uint32_t bit) { data[bit / 8] ^= static_cast<uint8_t>(1u << (bit % 8)); }
+};
+
+#endif // CRC_SYNDROME_H
@@ -14,16 +14,6 @@ public:
     // 析构函数
     ~DiskSectorCRC();
     
-    // 生成扇区校验数据
-    bool generateSectorChecksums(uint64_t startSector, uint64_t sectorCount, 
-                                const std::string& outputFile);
-    
-    // 验证扇区数据完整性
-    bool verifySectorIntegrity(const std::string& checksumFile);
-    
-    // 修复损坏的扇区数据
-    bool repairSectorData(const std::string& checksumFile, const std::string& backupDiskPath = "");
-    
     // 获取扇区大小（字节）
     static constexpr uint32_t SECTOR_SIZE = 512;
     
@@ -37,20 +27,17 @@ protected:
     std::string diskPath_;
     std::string lastError_;
     
+    // 当前校验文件使用旧 CRC 表（ManifestInfo::legacyCrc），打开校验文件时设置
+    bool legacyCrc_;
+    
     // 计算数据的CRC32校验和
     uint32_t calculateCRC32(const std::vector<uint8_t>& data);
     
-    // 读取指定扇区数据
-    bool readSector(uint64_t sectorNumber, std::vector<uint8_t>& buffer);
-    
-    // 写入指定扇区数据
-    bool writeSector(uint64_t sectorNumber, const std::vector<uint8_t>& data);
-    
-    // 备份扇区数据
-    bool backupSector(uint64_t sectorNumber, const std::string& backupPath);
+    // 按当前校验文件的 CRC 表计算，用于与校验文件中的 CRC 比较
+    uint32_t manifestCRC32(const uint8_t* data, size_t length) const;
     
-    // 从备份恢复扇区数据
-    bool restoreSector(uint64_t sectorNumber, const std::string& backupPath);
+    // 扇区读写只经过 OptimizedDiskReader（限时、可撤销），修复写入只经过 EnhancedDiskSectorCRC::repairCorrupted
+    // （RepairJournal 记录）；生成、验证和修复由 EnhancedDiskSectorCRC 提供
 };
 
 // 校验和数据结构
@@ -0,0 +1,263 @@
+#include "DiskSync.h"
+#include "EnhancedDiskSectorCRC.h"
+#include "OptimizedDiskReader.h"
+#include "BufferPool.h"
+#include "ConcurrentRing.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+// One source transfer on its way from the reader thread to the writer
+struct SyncTransfer {
+    BufferLease buffer;
+    SectorRange range;
+};
+
+// Sorted, coalesced `ranges` minus sorted, coalesced `removed`
+std::vector<SectorRange> subtractRanges(const std::vector<SectorRange>& ranges,
+                                        const std::vector<SectorRange>& removed) {
+    std::vector<SectorRange> result;
+    size_t next = 0;
+    for (const SectorRange& range : ranges) {
+        uint64_t first = range.firstSector;
+        uint64_t end = range.firstSector + range.sectorCount;
+        while (next < removed.size() && removed[next].firstSector + removed[next].sectorCount <= first) {
+            ++next;
+        }
+        for (size_t i = next; i < removed.size() && removed[i].firstSector < end && first < end; ++i) {
+            if (removed[i].firstSector > first) {
+                result.push_back(SectorRange{first, removed[i].firstSector - first});
+            }
+            first = std::max(first, removed[i].firstSector + removed[i].sectorCount);
+        }
+        if (first < end) {
+            result.push_back(SectorRange{first, end - first});
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+DiskSync::DiskSync(const std::string& sourceDiskPath, const std::string& targetDiskPath)
+    : sourceDiskPath_(sourceDiskPath), targetDiskPath_(targetDiskPath), maxTransferSectors_(SYNC_TRANSFER_SECTORS),
+      gapSectors_(64), verifyWrites_(true), operationCancelled_(false) {
+}
+
+bool DiskSync::sync(const std::string& sourceManifest, const std::string& targetManifest, DiskSyncResult& result,
+                    std::function<void(int, int)> progressCallback) {
+    operationCancelled_ = false;
+    return syncManifests(sourceManifest, targetManifest, result, progressCallback);
+}
+
+bool DiskSync::scanAndSync(uint64_t startSector, uint64_t sectorCount, const std::string& sourceManifest,
+                           const std::string& targetManifest, DiskSyncResult& result,
+                           std::function<void(int, int)> progressCallback) {
+    operationCancelled_ = false;
+    result = DiskSyncResult();
+
+    // Both devices are read at full speed at the same time; each generator gets half the hashers
+    unsigned int availableThreads = std::thread::hardware_concurrency();
+    int processorThreads = std::max(1, static_cast<int>(availableThreads / 2));
+
+    EnhancedDiskSectorCRC sourceScan(sourceDiskPath_);
+    EnhancedDiskSectorCRC targetScan(targetDiskPath_);
+    sourceScan.setStopToken(stopToken_);
+    targetScan.setStopToken(stopToken_);
+
+    // Progress covers both scans together
+    std::atomic<uint64_t> scanned[2] = {{0}, {0}};
+    auto scanProgress = [&scanned, sectorCount, progressCallback](int side) {
+        return [&scanned, sectorCount, progressCallback, side](int current, int) {
+            scanned[side] = static_cast<uint64_t>(current);
+            if (progressCallback) {
+                progressCallback(static_cast<int>(scanned[0] + scanned[1]), static_cast<int>(sectorCount * 2));
+            }
+        };
+    };
+
+    // Both scans run on their own threads while this one forwards a cancellation to them
+    std::atomic<int> finishedScans(0);
+    bool sourceOk = false;
+    bool targetOk = false;
+    std::thread sourceThread([&]() {
+        sourceOk = sourceScan.generateChecksumsHighPerformance(startSector, sectorCount, sourceManifest, 1,
+                                                               processorThreads, scanProgress(0));
+        finishedScans++;
+    });
+    std::thread targetThread([&]() {
+        targetOk = targetScan.generateChecksumsHighPerformance(startSector, sectorCount, targetManifest, 1,
+                                                               processorThreads, scanProgress(1));
+        finishedScans++;
+    });
+    while (finishedScans < 2) {
+        if (operationCancelled_) {
+            sourceScan.cancelOperation();
+            targetScan.cancelOperation();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    sourceThread.join();
+    targetThread.join();
+
+    if (isOperationCancelled()) {
+        lastError_ = "Operation cancelled by user";
+        return false;
+    }
+    if (!sourceOk || !targetOk) {
+        lastError_ = !sourceOk ? "Source scan failed: " + sourceScan.getLastError()
+                               : "Target scan failed: " + targetScan.getLastError();
+        return false;
+    }
+
+    return syncManifests(sourceManifest, targetManifest, result, progressCallback);
+}
+
+bool DiskSync::syncManifests(const std::string& sourceManifest, const std::string& targetManifest,
+                             DiskSyncResult& result, std::function<void(int, int)> progressCallback) {
+    result = DiskSyncResult();
+
+    // The target manifest plays the old snapshot: sectors only it lists are not copied
+    ManifestDiff diff;
+    ManifestDiffResult diffResult;
+    if (!diff.compare(targetManifest, sourceManifest, diffResult)) {
+        lastError_ = diff.getLastError();
+        return false;
+    }
+    std::vector<SectorRange> changed = subtractRanges(diffResult.changedRanges, diffResult.removedRanges);
+    for (const SectorRange& range : changed) {
+        result.changedSectors += range.sectorCount;
+    }
+    result.changedRanges = changed.size();
+    if (changed.empty()) {
+        return true;
+    }
+
+    return copyTransfers(planTransfers(changed), result, progressCallback);
+}
+
+std::vector<SectorRange> DiskSync::planTransfers(const std::vector<SectorRange>& ranges) const {
+    std::vector<SectorRange> merged;
+    for (const SectorRange& range : ranges) {
+        if (!merged.empty() && range.firstSector - (merged.back().firstSector + merged.back().sectorCount) <= gapSectors_) {
+            merged.back().sectorCount = range.firstSector + range.sectorCount - merged.back().firstSector;
+        } else {
+            merged.push_back(range);
+        }
+    }
+
+    std::vector<SectorRange> transfers;
+    for (const SectorRange& range : merged) {
+        for (uint64_t offset = 0; offset < range.sectorCount; offset += maxTransferSectors_) {
+            uint64_t count = std::min<uint64_t>(maxTransferSectors_, range.sectorCount - offset);
+            transfers.push_back(SectorRange{range.firstSector + offset, count});
+        }
+    }
+    return transfers;
+}
+
+bool DiskSync::copyTransfers(const std::vector<SectorRange>& transfers, DiskSyncResult& result,
+                             std::function<void(int, int)> progressCallback) {
+    OptimizedDiskReader source(sourceDiskPath_);
+    if (!source.openDisk()) {
+        lastError_ = "Cannot open source disk: " + source.getLastError();
+        return false;
+    }
+    OptimizedDiskReader target(targetDiskPath_);
+    target.setUnbuffered(verifyWrites_);
+    if (!target.openDisk(true)) {
+        lastError_ = "Cannot open target disk: " + target.getLastError();
+        return false;
+    }
+    source.setCancelCheck([this]() { return isOperationCancelled(); });
+    target.setCancelCheck([this]() { return isOperationCancelled(); });
+
+    const uint32_t sectorSize = OptimizedDiskReader::sectorSize();
+    uint64_t totalSectors = 0;
+    for (const SectorRange& transfer : transfers) {
+        totalSectors += transfer.sectorCount;
+    }
+    const size_t bufferSize = static_cast<size_t>(maxTransferSectors_) * sectorSize;
+
+    // The reader stays up to a ring's worth of transfers ahead of the writer
+    BlockingRing<SyncTransfer> ring(4);
+    BufferPool bufferPool(ring.capacity() + 2, bufferSize);
+    BufferPool verifyPool(1, bufferSize);
+    BufferLease verifyBuffer = verifyWrites_ ? verifyPool.acquire() : BufferLease();
+
+    std::string readError;
+    std::thread reader([&]() {
+        for (const SectorRange& transfer : transfers) {
+            if (isOperationCancelled()) {
+                break;
+            }
+            BufferLease buffer = bufferPool.acquire();
+            if (!buffer) {
+                break;
+            }
+            if (!source.readSectorsInto(transfer.firstSector, transfer.sectorCount, buffer.data())) {
+                readError = "Cannot read source disk: " + source.getLastError();
+                break;
+            }
+            if (!ring.push(SyncTransfer{buffer, transfer})) {
+                break;
+            }
+        }
+        ring.close();
+    });
+
+    // Write and check each transfer in turn; after a failure only drain the ring
+    bool failed = false;
+    SyncTransfer item;
+    while (ring.pop(item)) {
+        const SectorRange& range = item.range;
+        if (!failed && !isOperationCancelled()) {
+            if (!target.writeSectorsFrom(range.firstSector, range.sectorCount, item.buffer.data())) {
+                lastError_ = "Cannot write target disk: " + target.getLastError();
+                failed = true;
+            } else if (verifyWrites_ &&
+                       (!target.readSectorsInto(range.firstSector, range.sectorCount, verifyBuffer.data()) ||
+                        std::memcmp(verifyBuffer.data(), item.buffer.data(), range.sectorCount * sectorSize) != 0)) {
+                lastError_ = "Verification failed for sectors " + std::to_string(range.firstSector) + "-" +
+                             std::to_string(range.firstSector + range.sectorCount - 1) + " of the target disk";
+                failed = true;
+            } else {
+                result.copiedSectors += range.sectorCount;
+                result.transferCount++;
+                if (progressCallback) {
+                    progressCallback(static_cast<int>(result.copiedSectors), static_cast<int>(totalSectors));
+                }
+            }
+            if (failed) {
+                ring.close();
+                bufferPool.close();
+            }
+        }
+        item.buffer.reset();
+    }
+    reader.join();
+
+    bool flushed = target.flush();
+    source.closeDisk();
+    target.closeDisk();
+
+    if (failed) {
+        return false;
+    }
+    if (!readError.empty()) {
+        lastError_ = readError;
+        return false;
+    }
+    if (isOperationCancelled()) {
+        lastError_ = "Operation cancelled by user";
+        return false;
+    }
+    if (!flushed) {
+        lastError_ = target.getLastError();
+        return false;
+    }
+    return true;
+}
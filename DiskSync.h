@@ -0,0 +1,79 @@
+#ifndef DISK_SYNC_H
+#define DISK_SYNC_H
+
+#include "ManifestDiff.h"
+#include "StopToken.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Sectors per sync transfer (1 MiB of 512-byte sectors)
+static constexpr uint32_t SYNC_TRANSFER_SECTORS = 2048;
+
+struct DiskSyncResult {
+    uint64_t changedSectors = 0;    // Sectors whose CRCs differ between the manifests
+    uint64_t changedRanges = 0;     // Coalesced runs of those sectors
+    uint64_t copiedSectors = 0;     // Sectors written, including small gaps merged into transfers
+    uint64_t transferCount = 0;     // Sequential read/write(/verify) round trips
+};
+
+// Block-level resync of a target device from a source device. A manifest of each device over the
+// same range is compared with ManifestDiff and only the differing ranges are copied, as large
+// sequential transfers: a reader thread streams source ranges into pooled buffers while the
+// calling thread writes each one to the target and, by default, reads it back and compares it.
+// Source read errors abort the sync; a mirror with holes is not a mirror.
+class DiskSync {
+public:
+    DiskSync(const std::string& sourceDiskPath, const std::string& targetDiskPath);
+
+    // Copy what differs between sourceManifest (of the source device) and targetManifest (of the
+    // target). Sectors outside the source manifest's range are left alone.
+    bool sync(const std::string& sourceManifest, const std::string& targetManifest, DiskSyncResult& result,
+              std::function<void(int, int)> progressCallback = nullptr);
+
+    // Generate both manifests first, one high-performance generate per device running concurrently,
+    // then sync. Afterwards sourceManifest describes the target range as well.
+    bool scanAndSync(uint64_t startSector, uint64_t sectorCount, const std::string& sourceManifest,
+                     const std::string& targetManifest, DiskSyncResult& result,
+                     std::function<void(int, int)> progressCallback = nullptr);
+
+    void setMaxTransferSectors(uint32_t sectors) { maxTransferSectors_ = sectors ? sectors : 1; }
+
+    // Changed ranges at most this many sectors apart are copied as one transfer; rewriting a few
+    // unchanged sectors is cheaper than another seek on both devices
+    void setGapThreshold(uint32_t sectors) { gapSectors_ = sectors; }
+
+    // Read every written transfer back from the target and compare it with the source data. The
+    // target is then opened unbuffered and write-through, so the read-back comes from the device
+    // rather than from the page cache the write just filled.
+    void setVerifyWrites(bool verify) { verifyWrites_ = verify; }
+
+    void cancelOperation() { operationCancelled_ = true; }
+    bool isOperationCancelled() const { return operationCancelled_ || stopToken_.stopRequested(); }
+    void setStopToken(const StopToken& stopToken) { stopToken_ = stopToken; }
+
+    std::string getLastError() const { return lastError_; }
+
+private:
+    std::string sourceDiskPath_;
+    std::string targetDiskPath_;
+    uint32_t maxTransferSectors_;
+    uint32_t gapSectors_;
+    bool verifyWrites_;
+    std::atomic<bool> operationCancelled_;
+    StopToken stopToken_;
+    std::string lastError_;
+
+    bool syncManifests(const std::string& sourceManifest, const std::string& targetManifest, DiskSyncResult& result,
+                       std::function<void(int, int)> progressCallback);
+
+    // Merge ranges closer than the gap threshold, then cut them into transfers
+    std::vector<SectorRange> planTransfers(const std::vector<SectorRange>& ranges) const;
+
+    bool copyTransfers(const std::vector<SectorRange>& transfers, DiskSyncResult& result,
+                       std::function<void(int, int)> progressCallback);
+};
+
+#endif // DISK_SYNC_H
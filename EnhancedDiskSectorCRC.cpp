@@ -1,114 +1,45 @@
 #include "EnhancedDiskSectorCRC.h"
+#include "ManifestDelta.h"
+#include "FastCRC32.h"
+#include "OptimizedDiskReader.h"
+#include "RepairJournal.h"
+#include "ParitySidecar.h"
+#include "CrcSyndrome.h"
+#include "BadBlockMap.h"
+#include "WorkStealingPool.h"
+#include "IoThrottle.h"
 #include <iostream>
 #include <fstream>
 #include <thread>
 #include <vector>
 #include <algorithm>
 #include <chrono>
+#include <memory>
+#include <cmath>
+#include <random>
+#include <unordered_set>
 
 EnhancedDiskSectorCRC::EnhancedDiskSectorCRC(const std::string& diskPath) 
-    : DiskSectorCRC(diskPath), operationCancelled_(false) {
+    : DiskSectorCRC(diskPath), operationCancelled_(false), ioGapSectors_(IoPlanner::DEFAULT_MAX_GAP_SECTORS),
+      paritySidecarGroupSize_(0), bitFlipCorrection_(true), maxBitFlips_(1), checkpointIntervalSeconds_(CHECKPOINT_INTERVAL_SECONDS),
+      resumeFromCheckpoint_(false), readThrottle_(nullptr), lowIoPriority_(false) {
 }
 
 EnhancedDiskSectorCRC::~EnhancedDiskSectorCRC() {
     cancelOperation();
 }
 
-// Enhanced methods with cancellation support
+// Enhanced methods with cancellation support. The per-sector entry points run on the pipelined
+// generator and verifier: one handle, large reads with a deadline, and the rescue schedule.
 bool EnhancedDiskSectorCRC::generateSectorChecksums(uint64_t startSector, uint64_t sectorCount, 
                                                    const std::string& outputFile, 
                                                    std::function<void(int, int)> progressCallback) {
-    resetCancellation();
-    
-    std::ofstream outFile(outputFile, std::ios::binary);
-    if (!outFile.is_open()) {
-        lastError_ = "Cannot create output file: " + outputFile;
-        return false;
-    }
-    
-    // Write file header
-    uint32_t magic = 0x43524344; // "CRCD"
-    uint64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
-    
-    outFile.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
-    outFile.write(reinterpret_cast<const char*>(&startSector), sizeof(startSector));
-    outFile.write(reinterpret_cast<const char*>(&sectorCount), sizeof(sectorCount));
-    outFile.write(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
-    
-    // Generate checksum for each sector with cancellation support
-    for (uint64_t i = 0; i < sectorCount; ++i) {
-        if (isOperationCancelled()) {
-            outFile.close();
-            lastError_ = "Operation cancelled by user";
-            return false;
-        }
-        
-        uint64_t currentSector = startSector + i;
-        std::vector<uint8_t> sectorData;
-        
-        if (!readSector(currentSector, sectorData)) {
-            lastError_ = "Failed to read sector " + std::to_string(currentSector) + ": " + lastError_;
-            outFile.close();
-            return false;
-        }
-        
-        uint32_t crc = calculateCRC32(sectorData);
-        SectorChecksum checksum{currentSector, crc, timestamp};
-        
-        outFile.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
-        
-        if (progressCallback && (i + 1) % 100 == 0) {
-            progressCallback(i + 1, sectorCount);
-        }
-    }
-    
-    outFile.close();
-    return true;
+    return generateChecksumsHighPerformance(startSector, sectorCount, outputFile, 1, 0, progressCallback);
 }
 
 bool EnhancedDiskSectorCRC::verifySectorIntegrity(const std::string& checksumFile,
                                                  std::function<void(int, int)> progressCallback) {
-    resetCancellation();
-    
-    std::vector<SectorChecksum> checksums;
-    uint64_t startSector, sectorCount;
-    
-    if (!readChecksumFile(checksumFile, checksums, startSector, sectorCount)) {
-        return false;
-    }
-    
-    bool allValid = true;
-    uint64_t corruptedSectors = 0;
-    
-    // Verify each sector with cancellation support
-    for (uint64_t i = 0; i < checksums.size(); ++i) {
-        if (isOperationCancelled()) {
-            lastError_ = "Operation cancelled by user";
-            return false;
-        }
-        
-        const auto& storedChecksum = checksums[i];
-        std::vector<uint8_t> currentSectorData;
-        
-        if (!readSector(storedChecksum.sectorNumber, currentSectorData)) {
-            lastError_ = "Failed to read sector " + std::to_string(storedChecksum.sectorNumber) + ": " + lastError_;
-            return false;
-        }
-        
-        uint32_t currentCRC = calculateCRC32(currentSectorData);
-        
-        if (currentCRC != storedChecksum.crc32) {
-            allValid = false;
-            corruptedSectors++;
-        }
-        
-        if (progressCallback && (i + 1) % 100 == 0) {
-            progressCallback(i + 1, checksums.size());
-        }
-    }
-    
-    return allValid;
+    return verifyIntegrityHighPerformance(checksumFile, 1, 0, progressCallback);
 }
 
 bool EnhancedDiskSectorCRC::repairSectorData(const std::string& checksumFile, 
@@ -116,64 +47,18 @@ bool EnhancedDiskSectorCRC::repairSectorData(const std::string& checksumFile,
                                             std::function<void(int, int)> progressCallback) {
     resetCancellation();
     
-    std::vector<SectorChecksum> checksums;
-    uint64_t startSector, sectorCount;
-    
-    if (!readChecksumFile(checksumFile, checksums, startSector, sectorCount)) {
+    // Find the corrupted sectors with the streamed verify instead of loading the manifest
+    std::vector<SectorChecksum> corrupted;
+    if (!findCorruptedSectors(checksumFile, corrupted, 0, progressCallback)) {
         return false;
     }
     
-    bool backupAvailable = !backupDiskPath.empty();
-    std::string backupDisk = backupDiskPath;
-    
-    if (backupAvailable && backupDisk.find("\\\\.\\") == std::string::npos) {
-        backupDisk = "\\\\.\\" + backupDiskPath;
-    }
-    
+    uint64_t totalCorrupted = corrupted.size();
     uint64_t repairedSectors = 0;
-    uint64_t totalCorrupted = 0;
     
-    // Check each sector and attempt repair with cancellation support
-    for (uint64_t i = 0; i < checksums.size(); ++i) {
-        if (isOperationCancelled()) {
-            lastError_ = "Operation cancelled by user";
-            return false;
-        }
-        
-        const auto& storedChecksum = checksums[i];
-        std::vector<uint8_t> currentSectorData;
-        
-        if (!readSector(storedChecksum.sectorNumber, currentSectorData)) {
-            lastError_ = "Failed to read sector " + std::to_string(storedChecksum.sectorNumber) + ": " + lastError_;
-            return false;
-        }
-        
-        uint32_t currentCRC = calculateCRC32(currentSectorData);
-        
-        if (currentCRC != storedChecksum.crc32) {
-            totalCorrupted++;
-            
-            // Attempt recovery from backup disk
-            if (backupAvailable) {
-                EnhancedDiskSectorCRC backupDiskObj(backupDisk);
-                std::vector<uint8_t> backupData;
-                
-                if (backupDiskObj.readSector(storedChecksum.sectorNumber, backupData)) {
-                    uint32_t backupCRC = backupDiskObj.calculateCRC32(backupData);
-                    
-                    if (backupCRC == storedChecksum.crc32) {
-                        // Write data from backup
-                        if (writeSector(storedChecksum.sectorNumber, backupData)) {
-                            repairedSectors++;
-                        }
-                    }
-                }
-            }
-        }
-        
-        if (progressCallback && (i + 1) % 100 == 0) {
-            progressCallback(i + 1, checksums.size());
-        }
+    // Repair them from the backup disk or the parity sidecar through the journal
+    if (totalCorrupted > 0 && !repairCorrupted(corrupted, backupDiskPath, checksumFile, repairedSectors)) {
+        return false;
     }
     
     return repairedSectors > 0 || totalCorrupted == 0;
@@ -183,117 +68,240 @@ bool EnhancedDiskSectorCRC::repairSectorData(const std::string& checksumFile,
 bool EnhancedDiskSectorCRC::generateChecksumsParallel(uint64_t startSector, uint64_t sectorCount,
                                                      const std::string& outputFile, int threadCount,
                                                      std::function<void(int, int)> progressCallback) {
+    // One sequential reader feeds threadCount hashing threads
+    return generateChecksumsHighPerformance(startSector, sectorCount, outputFile, 1, threadCount, progressCallback);
+}
+
+bool EnhancedDiskSectorCRC::verifyIntegrityParallel(const std::string& checksumFile, int threadCount,
+                                                   std::function<void(int, int)> progressCallback) {
+    return verifyIntegrityHighPerformance(checksumFile, 1, threadCount, progressCallback);
+}
+
+// Wilson score interval of failures / trials at the given two-sided z
+static void wilsonInterval(uint64_t failures, uint64_t trials, double z, double& low, double& high) {
+    if (trials == 0) {
+        low = 0.0;
+        high = 1.0;
+        return;
+    }
+    double n = static_cast<double>(trials);
+    double p = static_cast<double>(failures) / n;
+    double z2 = z * z;
+    double center = (p + z2 / (2 * n)) / (1 + z2 / n);
+    double half = z * std::sqrt(p * (1 - p) / n + z2 / (4 * n * n)) / (1 + z2 / n);
+    low = std::max(0.0, center - half);
+    high = std::min(1.0, center + half);
+}
+
+// Two-sided standard normal quantile for a confidence level, by bisection on erfc
+static double normalQuantile(double confidence) {
+    double tail = (1 - std::min(std::max(confidence, 0.5), 0.999999)) / 2;
+    double low = 0.0, high = 10.0;
+    for (int i = 0; i < 100; ++i) {
+        double mid = (low + high) / 2;
+        if (0.5 * std::erfc(mid / std::sqrt(2.0)) > tail) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return (low + high) / 2;
+}
+
+bool EnhancedDiskSectorCRC::verifySampled(const std::string& checksumFile, const SamplingPolicy& policy,
+                                         SamplingResult& result, std::function<void(int, int)> progressCallback) {
     resetCancellation();
+    result = SamplingResult();
+    auto startTime = std::chrono::steady_clock::now();
     
-    // Auto-detect optimal thread count: use half of available threads
-    if (threadCount <= 0) {
-        unsigned int availableThreads = std::thread::hardware_concurrency();
-        threadCount = (availableThreads > 1) ? (availableThreads / 2) : 1;
+    // Full manifests are sampled in place through random record access; delta chains are merged first
+    ChecksumManifestReader reader;
+    if (!reader.open(checksumFile)) {
+        lastError_ = reader.getLastError();
+        return false;
     }
-    
-    std::cout << "Using " << threadCount << " threads for parallel processing" << std::endl;
-    
-    std::ofstream outFile(outputFile, std::ios::binary);
-    if (!outFile.is_open()) {
-        lastError_ = "Cannot create output file: " + outputFile;
+    legacyCrc_ = reader.info().legacyCrc;
+    if (!knownBadBlocks_.load(badBlockMapPathFor(checksumFile))) {
+        lastError_ = knownBadBlocks_.getLastError();
         return false;
     }
-    
-    // Write file header
-    uint32_t magic = 0x43524344;
-    uint64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
-    
-    outFile.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
-    outFile.write(reinterpret_cast<const char*>(&startSector), sizeof(startSector));
-    outFile.write(reinterpret_cast<const char*>(&sectorCount), sizeof(sectorCount));
-    outFile.write(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
-    outFile.close();
-    
-    std::vector<std::thread> threads;
-    std::mutex fileMutex;
-    std::atomic<uint64_t> processedCount(0);
-    
-    // Calculate sectors per thread
-    uint64_t sectorsPerThread = sectorCount / threadCount;
-    uint64_t remainingSectors = sectorCount % threadCount;
-    
-    uint64_t currentStart = startSector;
-    
-    // Always use optimized batch reading for maximum performance
-    const int BATCH_SIZE = 256; // Larger batch size for better I/O performance
-    
-    for (int i = 0; i < threadCount; ++i) {
-        uint64_t threadSectorCount = sectorsPerThread;
-        if (i < remainingSectors) {
-            threadSectorCount++;
+    foundBadBlocks_.clear();
+    foundSlowBlocks_.clear();
+    std::vector<SectorChecksum> merged;
+    uint64_t recordCount = reader.info().recordCount;
+    if (reader.info().format == ManifestFormat::Delta) {
+        reader.close();
+        uint64_t startSector, sectorCount;
+        if (!readChecksumFile(checksumFile, merged, startSector, sectorCount)) {
+            return false;
         }
-        
-        uint64_t threadEnd = currentStart + threadSectorCount;
-        
-        threads.emplace_back(&EnhancedDiskSectorCRC::checksumWorkerStreaming, this,
-                           currentStart, threadEnd, outputFile, std::ref(fileMutex),
-                           std::ref(processedCount), sectorCount, progressCallback, BATCH_SIZE);
-        
-        currentStart = threadEnd;
+        recordCount = merged.size();
     }
-    
-    // Wait for all threads to complete
-    for (auto& thread : threads) {
-        thread.join();
+    result.manifestSectors = recordCount;
+    if (recordCount == 0) {
+        return true;
     }
     
-    return !isOperationCancelled();
-}
-
-bool EnhancedDiskSectorCRC::verifyIntegrityParallel(const std::string& checksumFile, int threadCount,
-                                                   std::function<void(int, int)> progressCallback) {
-    resetCancellation();
+    // The manifest is cut into extents of consecutive records and those into equal strata, which
+    // are LBA regions for manifests written in sector order
+    const uint32_t sectorSize = OptimizedDiskReader::sectorSize();
+    const uint64_t extentRecords = std::max<uint32_t>(1, policy.extentSectors);
+    const uint64_t extentCount = (recordCount + extentRecords - 1) / extentRecords;
+    const uint64_t strata = std::min<uint64_t>(std::max<uint32_t>(1, policy.strata), extentCount);
+    result.manifestExtents = extentCount;
+    
+    // The byte budget becomes a number of extents, in whole rounds of one extent per stratum when
+    // it allows more than one round, so every region gets the same share
+    uint64_t budget = extentCount;
+    if (policy.maxBytes > 0) {
+        budget = std::min(extentCount, std::max<uint64_t>(1, policy.maxBytes / (extentRecords * sectorSize)));
+    }
+    if (budget >= strata) {
+        budget -= budget % strata;
+    }
     
-    std::vector<SectorChecksum> checksums;
-    uint64_t startSector, sectorCount;
+    // Pick each stratum's extents at random (Floyd's algorithm, no full shuffle) and deal them out
+    // in rounds; within a round the extents are visited in ascending order, one sweep per round
+    std::mt19937_64 random(policy.seed != 0 ? policy.seed : std::random_device()());
+    const uint64_t rotation = random() % strata;
+    std::vector<std::vector<uint64_t>> picks(strata);
+    for (uint64_t h = 0; h < strata; ++h) {
+        uint64_t stratum = (h + rotation) % strata;
+        uint64_t first = stratum * extentCount / strata;
+        uint64_t size = (stratum + 1) * extentCount / strata - first;
+        uint64_t quota = std::min(size, budget / strata + (h < budget % strata ? 1 : 0));
+        std::unordered_set<uint64_t> chosen;
+        for (uint64_t j = size - quota; j < size; ++j) {
+            uint64_t candidate = std::uniform_int_distribution<uint64_t>(0, j)(random);
+            if (!chosen.insert(candidate).second) {
+                chosen.insert(j);
+            }
+        }
+        for (uint64_t offset : chosen) {
+            picks[stratum].push_back(first + offset);
+        }
+        std::shuffle(picks[stratum].begin(), picks[stratum].end(), random);
+    }
+    std::vector<uint64_t> order;
+    for (size_t round = 0; order.size() < budget; ++round) {
+        size_t roundStart = order.size();
+        for (const auto& stratumPicks : picks) {
+            if (round < stratumPicks.size()) {
+                order.push_back(stratumPicks[round]);
+            }
+        }
+        if (order.size() == roundStart) {
+            break;
+        }
+        std::sort(order.begin() + roundStart, order.end());
+    }
+    picks.clear();
     
-    if (!readChecksumFile(checksumFile, checksums, startSector, sectorCount)) {
+    OptimizedDiskReader diskReader(diskPath_);
+    if (!diskReader.openDisk()) {
+        lastError_ = diskReader.getLastError();
         return false;
     }
-    
-    if (threadCount <= 0) threadCount = std::thread::hardware_concurrency();
-    if (threadCount <= 0) threadCount = 4;
-    
-    std::vector<std::thread> threads;
-    std::atomic<uint64_t> corruptedCount(0);
-    std::atomic<uint64_t> processedCount(0);
-    
-    // Split checksums among threads
-    size_t checksumsPerThread = checksums.size() / threadCount;
-    size_t remainingChecksums = checksums.size() % threadCount;
-    
-    size_t currentIndex = 0;
-    
-    for (int i = 0; i < threadCount; ++i) {
-        size_t threadChecksumCount = checksumsPerThread;
-        if (i < remainingChecksums) {
-            threadChecksumCount++;
+    diskReader.setReadTimeout(rescuePolicy_.readTimeoutMs);
+    diskReader.setCancelCheck([this]() { return isOperationCancelled(); });
+    
+    // Each sampled extent is planned into as few large reads as its sectors allow
+    IoPlanner plan(ioGapSectors_, static_cast<uint32_t>(std::min<uint64_t>(extentRecords, UINT32_MAX)));
+    std::vector<uint64_t> sectors;
+    std::vector<uint32_t> crcs;
+    std::vector<uint8_t> readBuffer;
+    BadBlockMap unreadable;
+    const auto deadline = startTime + std::chrono::seconds(policy.maxSeconds);
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (isOperationCancelled()) {
+            break;
+        }
+        if (policy.maxSeconds > 0 && std::chrono::steady_clock::now() >= deadline) {
+            result.timeLimitReached = true;
+            break;
         }
         
-        std::vector<SectorChecksum> threadChecksums(
-            checksums.begin() + currentIndex,
-            checksums.begin() + currentIndex + threadChecksumCount
-        );
+        uint64_t firstRecord = order[i] * extentRecords;
+        if (merged.empty()) {
+            if (!reader.readColumns(firstRecord, extentRecords, sectors, crcs)) {
+                lastError_ = reader.getLastError();
+                return false;
+            }
+        } else {
+            uint64_t lastRecord = std::min(recordCount, firstRecord + extentRecords);
+            sectors.clear();
+            crcs.clear();
+            for (uint64_t record = firstRecord; record < lastRecord; ++record) {
+                sectors.push_back(merged[record].sectorNumber);
+                crcs.push_back(merged[record].crc32);
+            }
+        }
         
-        threads.emplace_back(&EnhancedDiskSectorCRC::verificationWorker, this,
-                           threadChecksums, std::ref(corruptedCount),
-                           std::ref(processedCount), progressCallback);
+        plan.plan(sectors, 0, sectors.size(), [](uint64_t sector) { return sector; });
+        readBuffer.resize(static_cast<size_t>(plan.maxReadSectors()) * sectorSize);
+        uint64_t extentBytes = 0, extentCorrupted = 0, extentUnreadable = 0;
+        for (const PlannedRead& read : plan.reads()) {
+            // Unreadable sectors (and known bad ones, which are not read) count as failed and go
+            // to the bad-block map
+            if (!rescueRead(diskReader, read.startSector, read.sectorCount, readBuffer.data(), &knownBadBlocks_,
+                            unreadable, &foundSlowBlocks_)) {
+                break;
+            }
+            foundBadBlocks_.merge(unreadable);
+            extentBytes += static_cast<uint64_t>(read.sectorCount) * sectorSize;
+            
+            for (size_t entry = read.firstEntry; entry < read.firstEntry + read.entryCount; ++entry) {
+                size_t index = plan.itemIndex(entry);
+                if (unreadable.contains(sectors[index])) {
+                    extentUnreadable++;
+                    extentCorrupted++;
+                    continue;
+                }
+                const uint8_t* data = readBuffer.data() + (sectors[index] - read.startSector) * sectorSize;
+                if (manifestCRC32(data, sectorSize) != crcs[index]) {
+                    extentCorrupted++;
+                }
+            }
+        }
+        if (isOperationCancelled()) {
+            break; // Reads of this extent may have been abandoned, do not count it
+        }
+        result.bytesRead += extentBytes;
+        result.sampledSectors += sectors.size();
+        result.corruptedSectors += extentCorrupted;
+        result.unreadableSectors += extentUnreadable;
+        result.sampledExtents++;
+        if (extentCorrupted > 0) {
+            result.corruptedExtents++;
+        }
         
-        currentIndex += threadChecksumCount;
+        if (progressCallback) {
+            progressCallback(static_cast<int>(i + 1), static_cast<int>(order.size()));
+        }
+    }
+    diskReader.closeDisk();
+    if (!saveBadBlockMap(checksumFile, 0, 0)) {
+        return false;
     }
     
-    // Wait for all threads to complete
-    for (auto& thread : threads) {
-        thread.join();
+    // Corruption clusters, so sectors of one extent are not independent trials: the sector interval
+    // is optimistic and the extent interval is the one to act on
+    double z = normalQuantile(policy.confidence);
+    if (result.sampledSectors > 0) {
+        result.sectorRate = static_cast<double>(result.corruptedSectors) / result.sampledSectors;
     }
+    if (result.sampledExtents > 0) {
+        result.extentRate = static_cast<double>(result.corruptedExtents) / result.sampledExtents;
+    }
+    wilsonInterval(result.corruptedSectors, result.sampledSectors, z, result.sectorRateLow, result.sectorRateHigh);
+    wilsonInterval(result.corruptedExtents, result.sampledExtents, z, result.extentRateLow, result.extentRateHigh);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
     
-    return corruptedCount == 0 && !isOperationCancelled();
+    if (isOperationCancelled()) {
+        lastError_ = "Operation cancelled by user";
+        return false;
+    }
+    return true;
 }
 
 bool EnhancedDiskSectorCRC::repairDataParallel(const std::string& checksumFile, 
@@ -301,50 +309,17 @@ bool EnhancedDiskSectorCRC::repairDataParallel(const std::string& checksumFile,
                                               std::function<void(int, int)> progressCallback) {
     resetCancellation();
     
-    std::vector<SectorChecksum> checksums;
-    uint64_t startSector, sectorCount;
-    
-    if (!readChecksumFile(checksumFile, checksums, startSector, sectorCount)) {
+    // Find every corrupted sector first with the streamed verify, comparing threadCount extents at once
+    std::vector<SectorChecksum> corrupted;
+    if (!findCorruptedSectors(checksumFile, corrupted, threadCount, progressCallback) || corrupted.empty()) {
         return false;
     }
     
-    if (threadCount <= 0) threadCount = std::thread::hardware_concurrency();
-    if (threadCount <= 0) threadCount = 4;
+    // Then repair them from the backup (or parity sidecar) in large sequential runs
+    uint64_t repairedCount = 0;
+    bool repairOk = repairCorrupted(corrupted, backupDiskPath, checksumFile, repairedCount);
     
-    std::vector<std::thread> threads;
-    std::atomic<uint64_t> repairedCount(0);
-    std::atomic<uint64_t> processedCount(0);
-    
-    // Split checksums among threads
-    size_t checksumsPerThread = checksums.size() / threadCount;
-    size_t remainingChecksums = checksums.size() % threadCount;
-    
-    size_t currentIndex = 0;
-    
-    for (int i = 0; i < threadCount; ++i) {
-        size_t threadChecksumCount = checksumsPerThread;
-        if (i < remainingChecksums) {
-            threadChecksumCount++;
-        }
-        
-        std::vector<SectorChecksum> threadChecksums(
-            checksums.begin() + currentIndex,
-            checksums.begin() + currentIndex + threadChecksumCount
-        );
-        
-        threads.emplace_back(&EnhancedDiskSectorCRC::repairWorker, this,
-                           threadChecksums, backupDiskPath, std::ref(repairedCount),
-                           std::ref(processedCount), progressCallback);
-        
-        currentIndex += threadChecksumCount;
-    }
-    
-    // Wait for all threads to complete
-    for (auto& thread : threads) {
-        thread.join();
-    }
-    
-    return repairedCount > 0 && !isOperationCancelled();
+    return repairOk && repairedCount > 0 && !isOperationCancelled();
 }
 
 // Control methods
@@ -354,7 +329,7 @@ void EnhancedDiskSectorCRC::cancelOperation() {
 }
 
 bool EnhancedDiskSectorCRC::isOperationCancelled() const {
-    return operationCancelled_;
+    return operationCancelled_ || stopToken_.stopRequested();
 }
 
 void EnhancedDiskSectorCRC::resetCancellation() {
@@ -367,13 +342,6 @@ bool EnhancedDiskSectorCRC::repairFromChecksumFile(const std::string& checksumFi
                                                   std::function<void(int, int)> progressCallback) {
     resetCancellation();
     
-    std::vector<SectorChecksum> checksums;
-    uint64_t startSector, sectorCount;
-    
-    if (!readChecksumFile(checksumFile, checksums, startSector, sectorCount)) {
-        return false;
-    }
-    
     std::string repairSource = repairSourcePath;
     if (repairSource.empty()) {
         if (!findRepairSource(checksumFile, repairSource)) {
@@ -382,97 +350,153 @@ bool EnhancedDiskSectorCRC::repairFromChecksumFile(const std::string& checksumFi
         }
     }
     
-    EnhancedDiskSectorCRC repairSourceObj(repairSource);
-    uint64_t repairedSectors = 0;
-    uint64_t totalCorrupted = 0;
+    // Find the corrupted sectors using checksum file as reference
+    std::vector<SectorChecksum> corrupted;
+    if (!findCorruptedSectors(checksumFile, corrupted, 0, progressCallback)) {
+        return false;
+    }
     
-    // Repair corrupted sectors using checksum file as reference
-    for (uint64_t i = 0; i < checksums.size(); ++i) {
-        if (isOperationCancelled()) {
-            lastError_ = "Operation cancelled by user";
-            return false;
-        }
-        
-        const auto& storedChecksum = checksums[i];
-        std::vector<uint8_t> currentSectorData;
-        
-        if (!readSector(storedChecksum.sectorNumber, currentSectorData)) {
-            lastError_ = "Failed to read sector " + std::to_string(storedChecksum.sectorNumber) + ": " + lastError_;
-            return false;
-        }
-        
-        uint32_t currentCRC = calculateCRC32(currentSectorData);
-        
-        if (currentCRC != storedChecksum.crc32) {
-            totalCorrupted++;
-            
-            // Read correct data from repair source
-            std::vector<uint8_t> repairData;
-            if (repairSourceObj.readSector(storedChecksum.sectorNumber, repairData)) {
-                uint32_t repairCRC = calculateCRC32(repairData);
-                
-                if (repairCRC == storedChecksum.crc32) {
-                    // Write correct data to target disk
-                    if (writeSector(storedChecksum.sectorNumber, repairData)) {
-                        repairedSectors++;
-                    }
-                }
-            }
-        }
-        
-        if (progressCallback && (i + 1) % 100 == 0) {
-            progressCallback(i + 1, checksums.size());
-        }
+    // The repair source is used like a backup disk: only data matching the stored CRC is written,
+    // and every write goes through the repair journal
+    uint64_t repairedSectors = 0;
+    if (!corrupted.empty() && !repairCorrupted(corrupted, repairSource, checksumFile, repairedSectors)) {
+        return false;
     }
     
     return repairedSectors > 0;
 }
 
-bool EnhancedDiskSectorCRC::validateChecksumFile(const std::string& checksumFile) {
-    std::vector<SectorChecksum> checksums;
-    uint64_t startSector, sectorCount;
+bool EnhancedDiskSectorCRC::validateChecksumFile(const std::string& checksumFile, bool quickCheck) {
+    // Opening the chain checks every header and that each delta still matches its base
+    ManifestChainView view;
+    if (!view.open(checksumFile)) {
+        lastError_ = view.getLastError();
+        return false;
+    }
+    std::vector<std::string> chainPaths = view.chainPaths();
+    view.close();
+    
+    for (const auto& path : chainPaths) {
+        ManifestValidator validator;
+        if (!validator.validate(path, quickCheck)) {
+            lastError_ = validator.getLastError();
+            return false;
+        }
+    }
     
-    return readChecksumFile(checksumFile, checksums, startSector, sectorCount);
+    return true;
 }
 
-// Worker thread functions
-void EnhancedDiskSectorCRC::checksumWorker(uint64_t startSector, uint64_t endSector, 
-                                          const std::string& outputFile, std::mutex& fileMutex,
-                                          std::atomic<uint64_t>& processedCount, uint64_t totalCount,
-                                          std::function<void(int, int)> progressCallback) {
-    std::ofstream outFile(outputFile, std::ios::binary | std::ios::app);
-    if (!outFile.is_open()) {
-        return;
+bool EnhancedDiskSectorCRC::generateDeltaChecksums(uint64_t startSector, uint64_t sectorCount,
+                                                  const std::string& baseManifest, const std::string& outputFile,
+                                                  std::function<void(int, int)> progressCallback) {
+    resetCancellation();
+    
+    // The base chain is looked up one window at a time while the disk is read in order
+    ManifestChainView baseView;
+    if (!baseView.open(baseManifest)) {
+        lastError_ = baseView.getLastError();
+        return false;
     }
     
-    for (uint64_t sector = startSector; sector < endSector; ++sector) {
-        if (isOperationCancelled()) {
+    uint64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    
+    ChecksumDeltaWriter writer;
+    if (!writer.open(outputFile, baseManifest, startSector, sectorCount, timestamp)) {
+        lastError_ = writer.getLastError();
+        return false;
+    }
+    
+    // Sectors come through the same extent reader as generateChecksumsHighPerformance. With a
+    // single reader they arrive in LBA order until a read fails; a delta has to cover every
+    // sector (a missing record means "unchanged"), so the first gap ends the run.
+    knownBadBlocks_.clear();
+    foundBadBlocks_.clear();
+    foundSlowBlocks_.clear();
+    const int readerBatchSize = 128;
+    BlockingRing<SectorExtent> dataRing(8);
+    BufferPool bufferPool(dataRing.capacity() + 2, static_cast<size_t>(readerBatchSize) * SECTOR_SIZE);
+    const std::vector<SectorRange> ranges{SectorRange{startSector, sectorCount}};
+    std::string readError;
+    std::thread reader([this, &ranges, &bufferPool, &dataRing, &readError, readerBatchSize]() {
+        readerWorker(ranges, bufferPool, dataRing, nullptr, readerBatchSize, readError);
+        dataRing.close();
+    });
+    
+    std::vector<uint32_t> baseCrcs;
+    std::vector<uint8_t> basePresent;
+    uint64_t windowStart = startSector;
+    uint64_t windowCount = 0;
+    uint64_t nextSector = startSector;
+    bool ok = true;
+    SectorExtent extent;
+    while (ok && !isOperationCancelled() && dataRing.pop(extent)) {
+        if (extent.startSector != nextSector) {
+            lastError_ = "Failed to read sector " + std::to_string(nextSector) + ": a delta needs every sector of the range";
+            ok = false;
             break;
         }
         
-        std::vector<uint8_t> sectorData;
-        if (!readSector(sector, sectorData)) {
-            continue;
-        }
-        
-        uint32_t crc = calculateCRC32(sectorData);
-        uint64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count();
-        
-        SectorChecksum checksum{sector, crc, timestamp};
-        
-        {
-            std::lock_guard<std::mutex> lock(fileMutex);
-            outFile.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        for (uint32_t i = 0; i < extent.sectorCount; ++i) {
+            uint64_t sector = extent.startSector + i;
+            if (sector - windowStart >= windowCount) {
+                windowStart = sector;
+                windowCount = std::min(ManifestChainView::WINDOW_SECTORS, startSector + sectorCount - sector);
+                if (!baseView.readWindow(windowStart, windowCount, baseCrcs, basePresent)) {
+                    lastError_ = baseView.getLastError();
+                    ok = false;
+                    break;
+                }
+            }
+            
+            uint32_t crc = FastCRC32::compute(extent.sector(i), extent.sectorSize);
+            uint64_t slot = sector - windowStart;
+            if ((!basePresent[slot] || baseCrcs[slot] != crc) && !writer.append(sector, crc)) {
+                lastError_ = writer.getLastError();
+                ok = false;
+                break;
+            }
         }
+        nextSector += extent.sectorCount;
+        extent.buffer.reset();
         
-        uint64_t processed = ++processedCount;
-        if (progressCallback && processed % 100 == 0) {
-            progressCallback(processed, totalCount);
+        uint64_t done = nextSector - startSector;
+        if (progressCallback && done / 100 != (done - extent.sectorCount) / 100) {
+            progressCallback(done, sectorCount);
         }
     }
     
-    outFile.close();
+    // Stop the reader and hand back the buffers still queued
+    dataRing.close();
+    bufferPool.close();
+    while (dataRing.pop(extent)) {
+    }
+    reader.join();
+    
+    if (!readError.empty()) {
+        lastError_ = readError;
+        ok = false;
+    }
+    if (ok && isOperationCancelled()) {
+        lastError_ = "Operation cancelled by user";
+        ok = false;
+    }
+    if (ok && nextSector != startSector + sectorCount) {
+        lastError_ = "Failed to read sector " + std::to_string(nextSector) + ": a delta needs every sector of the range";
+        ok = false;
+    }
+    
+    // An incomplete delta is removed rather than finalized
+    if (!ok) {
+        writer.abandon();
+        return false;
+    }
+    if (!writer.close()) {
+        lastError_ = writer.getLastError();
+        return false;
+    }
+    return true;
 }
 
 // High-performance parallel processing with dedicated reader thread
@@ -490,431 +514,1554 @@ bool EnhancedDiskSectorCRC::generateChecksumsHighPerformance(uint64_t startSecto
     std::cout << "High-performance mode: " << readerThreads << " reader thread(s), " 
               << processorThreads << " processor thread(s)" << std::endl;
     
-    // Create output file and write header
-    std::ofstream outFile(outputFile, std::ios::binary);
-    if (!outFile.is_open()) {
-        lastError_ = "Cannot create output file: " + outputFile;
-        return false;
-    }
-    
-    uint32_t magic = 0x43524344;
+    // Create output manifest shared by all processor threads
     uint64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
         std::chrono::system_clock::now().time_since_epoch()).count();
     
-    outFile.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
-    outFile.write(reinterpret_cast<const char*>(&startSector), sizeof(startSector));
-    outFile.write(reinterpret_cast<const char*>(&sectorCount), sizeof(sectorCount));
-    outFile.write(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
-    outFile.close();
-    
-    // Producer-consumer setup
-    std::queue<SectorData> dataQueue;
-    std::mutex queueMutex;
-    std::condition_variable queueCV;
-    std::atomic<bool> readingComplete(false);
-    std::atomic<uint64_t> processedCount(0);
+    // An interrupted run of the same job continues with the manifest it was writing
+    const std::string checkpointPath = checkpointPathFor(outputFile);
+    const bool checkpointing = checkpointIntervalSeconds_ > 0 && paritySidecarGroupSize_ == 0;
+    const bool resuming = resumeFromCheckpoint_ && JobCheckpoint::exists(checkpointPath);
+    JobCheckpoint checkpoint;
+    if (resuming) {
+        if (!checkpoint.load(checkpointPath)) {
+            lastError_ = checkpoint.getLastError();
+            return false;
+        }
+        if (checkpoint.kind != JobCheckpoint::Kind::Generate || checkpoint.diskPath != diskPath_ ||
+            checkpoint.startSector != startSector || checkpoint.sectorCount != sectorCount) {
+            lastError_ = "Checkpoint belongs to a different job: " + checkpointPath;
+            return false;
+        }
+        if (paritySidecarGroupSize_ > 0) {
+            lastError_ = "A run writing a parity sidecar cannot be resumed";
+            return false;
+        }
+        timestamp = checkpoint.timestamp;
+    } else {
+        JobCheckpoint::remove(checkpointPath);
+        checkpoint.kind = JobCheckpoint::Kind::Generate;
+        checkpoint.diskPath = diskPath_;
+        checkpoint.startSector = startSector;
+        checkpoint.sectorCount = sectorCount;
+        checkpoint.timestamp = timestamp;
+    }
+    
+    // Ranges found unreadable by earlier runs are not read again
+    if (!knownBadBlocks_.load(badBlockMapPathFor(outputFile))) {
+        lastError_ = knownBadBlocks_.getLastError();
+        return false;
+    }
+    foundBadBlocks_.clear();
+    foundSlowBlocks_.clear();
+    
+    ChecksumManifestWriter writer;
+    writer.setRangeTracking(checkpointing || resuming);
+    bool opened = resuming ? writer.resume(outputFile, startSector, sectorCount, timestamp)
+                           : writer.open(outputFile, startSector, sectorCount, timestamp);
+    if (!opened) {
+        lastError_ = writer.getLastError();
+        return false;
+    }
+    
+    // Sectors already in the manifest are not read again; the rest is what is left to do
+    std::map<uint64_t, uint64_t> doneRanges;
+    if (resuming) {
+        writer.checkpoint(checkpoint.manifestBlocks, doneRanges);
+    }
+    std::vector<SectorRange> remaining;
+    uint64_t doneSectors = 0;
+    uint64_t cursor = startSector;
+    for (const auto& range : doneRanges) {
+        if (range.first > cursor) {
+            remaining.push_back(SectorRange{cursor, range.first - cursor});
+        }
+        cursor = std::max(cursor, range.first + range.second);
+        doneSectors += range.second;
+    }
+    if (cursor < startSector + sectorCount) {
+        remaining.push_back(SectorRange{cursor, startSector + sectorCount - cursor});
+    }
+    if (resuming) {
+        std::cout << "Resuming from checkpoint: " << doneSectors << " of " << sectorCount
+                  << " sectors already in the manifest" << std::endl;
+    }
+    
+    // Parity is accumulated from the same buffers the processors hash
+    std::unique_ptr<ParitySidecarWriter> parity;
+    if (paritySidecarGroupSize_ > 0) {
+        ParityLayout layout;
+        layout.startSector = startSector;
+        layout.sectorCount = sectorCount;
+        layout.sectorSize = SECTOR_SIZE;
+        layout.groupSize = paritySidecarGroupSize_;
+        parity.reset(new ParitySidecarWriter());
+        if (!parity->open(outputFile + ".parity", layout)) {
+            lastError_ = parity->getLastError();
+            writer.suspend();
+            return false;
+        }
+    }
+    
+    // Producer-consumer setup: bounded lock-free ring of extents, threads only park when it is empty or full
+    const int readerBatchSize = 128;
+    BlockingRing<SectorExtent> dataRing(8);
+    
+    // One read buffer per batch; enough for a full ring plus one in hand per thread, so readers
+    // only wait on the pool when the processors are genuinely behind
+    BufferPool bufferPool(dataRing.capacity() + readerThreads + processorThreads,
+                          static_cast<size_t>(readerBatchSize) * SECTOR_SIZE);
+    std::atomic<uint64_t> processedCount(doneSectors);
     
     std::vector<std::thread> readerThreadsList;
     std::vector<std::thread> processorThreadsList;
-    std::mutex fileMutex;
     
     // Calculate sectors per reader thread
-    uint64_t sectorsPerReader = sectorCount / readerThreads;
-    uint64_t remainingSectors = sectorCount % readerThreads;
-    
-    uint64_t currentStart = startSector;
+    uint64_t sectorsToRead = sectorCount - doneSectors;
+    uint64_t sectorsPerReader = sectorsToRead / readerThreads;
+    uint64_t remainingSectors = sectorsToRead % readerThreads;
+    
+    std::vector<std::vector<SectorRange>> readerRanges(readerThreads);
+    size_t reader = 0;
+    uint64_t quota = sectorsPerReader + (remainingSectors > 0 ? 1 : 0);
+    for (SectorRange range : remaining) {
+        while (range.sectorCount > 0) {
+            bool last = reader + 1 == readerRanges.size();
+            uint64_t take = last ? range.sectorCount : std::min(range.sectorCount, quota);
+            if (take > 0) {
+                readerRanges[reader].push_back(SectorRange{range.firstSector, take});
+            }
+            range.firstSector += take;
+            range.sectorCount -= take;
+            quota -= std::min(quota, take);
+            if (quota == 0 && !last) {
+                reader++;
+                quota = sectorsPerReader + (reader < remainingSectors ? 1 : 0);
+            }
+        }
+    }
     
     // Start reader threads (producers)
+    std::atomic<int> finishedReaders(0);
+    std::vector<std::string> readerErrors(readerThreads);
     for (int i = 0; i < readerThreads; ++i) {
-        uint64_t threadSectorCount = sectorsPerReader;
-        if (i < remainingSectors) {
-            threadSectorCount++;
-        }
-        
-        uint64_t threadEnd = currentStart + threadSectorCount;
-        
-        readerThreadsList.emplace_back(&EnhancedDiskSectorCRC::readerWorker, this,
-                                     currentStart, threadEnd, std::ref(dataQueue),
-                                     std::ref(queueMutex), std::ref(queueCV),
-                                     std::ref(readingComplete), 128); // Large batch size
-        
-        currentStart = threadEnd;
+        readerThreadsList.emplace_back([this, &readerRanges, &bufferPool, &dataRing, &parity, &finishedReaders,
+                                        &readerErrors, i, readerBatchSize]() {
+            readerWorker(readerRanges[i], bufferPool, dataRing, parity.get(), readerBatchSize, readerErrors[i]);
+            finishedReaders++;
+        });
     }
     
     // Start processor threads (consumers)
+    std::atomic<bool> processingFailed(false);
     for (int i = 0; i < processorThreads; ++i) {
         processorThreadsList.emplace_back(&EnhancedDiskSectorCRC::processorWorker, this,
-                                        std::ref(dataQueue), std::ref(queueMutex),
-                                        std::ref(queueCV), std::ref(readingComplete),
-                                        outputFile, std::ref(fileMutex),
-                                        std::ref(processedCount), sectorCount, progressCallback);
+                                        std::ref(dataRing), std::ref(writer), parity.get(),
+                                        std::ref(processedCount), sectorCount, std::ref(processingFailed),
+                                        progressCallback);
     }
     
-    // Wait for all reader threads to complete
+    // Wait for all reader threads to complete, saving a checkpoint now and then
+    auto nextCheckpoint = std::chrono::steady_clock::now() + std::chrono::seconds(checkpointIntervalSeconds_);
+    while (finishedReaders < readerThreads) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (checkpointing && !isOperationCancelled() && std::chrono::steady_clock::now() >= nextCheckpoint) {
+            if (!writer.checkpoint(checkpoint.manifestBlocks, checkpoint.doneRanges)) {
+                std::cerr << "Cannot save checkpoint: " << writer.getLastError() << std::endl;
+            } else if (!saveCheckpoint(checkpoint, outputFile)) {
+                std::cerr << "Cannot save checkpoint: " << lastError_ << std::endl;
+            }
+            nextCheckpoint = std::chrono::steady_clock::now() + std::chrono::seconds(checkpointIntervalSeconds_);
+        }
+    }
     for (auto& thread : readerThreadsList) {
         thread.join();
     }
     
-    // Signal that reading is complete
-    readingComplete = true;
-    queueCV.notify_all();
+    // Signal that reading is complete; processors drain what is left and exit
+    dataRing.close();
     
     // Wait for all processor threads to complete
     for (auto& thread : processorThreadsList) {
         thread.join();
     }
     
-    return !isOperationCancelled();
+    // A run that did not cover the range never finalizes: its manifest stays unfinished (with a
+    // checkpoint to resume from when possible) and a partial parity sidecar is deleted. That
+    // includes a reader that could not open the disk and left its ranges out.
+    std::string readError;
+    for (const std::string& error : readerErrors) {
+        if (!error.empty()) {
+            readError = error;
+            break;
+        }
+    }
+    if (processingFailed || !readError.empty()) {
+        if (!readError.empty()) {
+            lastError_ = readError;
+        } else {
+            lastError_ = (parity && !parity->getLastError().empty()) ? parity->getLastError() : writer.getLastError();
+        }
+        writer.suspend();
+        if (parity) {
+            parity->abandon();
+        }
+        return false;
+    }
+    bool cancelled = isOperationCancelled();
+    bool suspended = cancelled && checkpointing && writer.checkpoint(checkpoint.manifestBlocks, checkpoint.doneRanges);
+    if (cancelled) {
+        if (parity) {
+            parity->abandon();
+        }
+        if (!writer.suspend()) {
+            lastError_ = writer.getLastError();
+            return false;
+        }
+    } else if (!writer.close()) {
+        lastError_ = writer.getLastError();
+        return false;
+    } else if (parity && !parity->close()) {
+        lastError_ = parity->getLastError();
+        return false;
+    }
+    
+    if (!foundBadBlocks_.empty()) {
+        std::cout << foundBadBlocks_.sectorCount() << " unreadable sector(s) left out of the manifest" << std::endl;
+    }
+    if (!saveBadBlockMap(outputFile, startSector, cancelled ? 0 : sectorCount)) {
+        return false;
+    }
+    
+    if (suspended) {
+        if (!saveCheckpoint(checkpoint, outputFile)) {
+            return false;
+        }
+        std::cout << "Progress saved to " << checkpointPath << "; resume to continue" << std::endl;
+    } else if (!cancelled) {
+        JobCheckpoint::remove(checkpointPath);
+    }
+    
+    return !cancelled;
+}
+
+bool EnhancedDiskSectorCRC::saveCheckpoint(JobCheckpoint& checkpoint, const std::string& manifest) {
+    BadBlockMap badBlocks = knownBadBlocks_;
+    {
+        std::lock_guard<std::mutex> lock(badBlocksMutex_);
+        badBlocks.merge(foundBadBlocks_);
+    }
+    if (!badBlocks.empty() && !badBlocks.save(badBlockMapPathFor(manifest))) {
+        lastError_ = badBlocks.getLastError();
+        return false;
+    }
+    
+    if (checkpoint.kind == JobCheckpoint::Kind::Generate) {
+        checkpoint.processedCount = checkpoint.doneSectors();
+        checkpoint.unreadableCount = badBlocks.sectorCount();
+    }
+    if (!checkpoint.save(checkpointPathFor(manifest))) {
+        lastError_ = checkpoint.getLastError();
+        return false;
+    }
+    return true;
+}
+
+bool EnhancedDiskSectorCRC::saveBadBlockMap(const std::string& manifest, uint64_t scannedStart, uint64_t scannedCount) {
+    if (!foundSlowBlocks_.empty()) {
+        std::cout << foundSlowBlocks_.sectorCount() << " sector(s) were covered by reads that timed out after "
+                  << rescuePolicy_.readTimeoutMs << " ms" << std::endl;
+    }
+    
+    BadBlockMap badBlocks = knownBadBlocks_;
+    badBlocks.remove(scannedStart, scannedCount);
+    badBlocks.merge(foundBadBlocks_);
+    if (badBlocks.empty() && knownBadBlocks_.empty()) {
+        return true; // Nothing to record, do not leave an empty file behind
+    }
+    if (!badBlocks.save(badBlockMapPathFor(manifest))) {
+        lastError_ = badBlocks.getLastError();
+        return false;
+    }
+    return true;
+}
+
+bool EnhancedDiskSectorCRC::rescueRead(OptimizedDiskReader& reader, uint64_t firstSector, uint32_t sectorCount,
+                                      uint8_t* buffer, const BadBlockMap* knownBad, BadBlockMap& unreadable,
+                                      BadBlockMap* slow) {
+    RescuePolicy policy = rescuePolicy_;
+    policy.maxReadSectors = sectorCount;
+    RescueScheduler rescue(firstSector, firstSector + sectorCount, policy, knownBad);
+    
+    const uint32_t sectorSize = OptimizedDiskReader::sectorSize();
+    uint64_t start;
+    uint32_t count;
+    while (!isOperationCancelled() && rescue.next(start, count)) {
+        bool readOk = reader.readSectorsInto(start, count, buffer + (start - firstSector) * sectorSize);
+        if (!readOk && isOperationCancelled()) {
+            break; // Abandoned read, not an unreadable sector
+        }
+        rescue.complete(readOk, reader.lastReadTimedOut());
+    }
+    if (isOperationCancelled()) {
+        return false;
+    }
+    
+    unreadable = rescue.badBlocks();
+    if (slow) {
+        slow->merge(rescue.slowBlocks());
+    }
+    return true;
 }
 
 bool EnhancedDiskSectorCRC::verifyIntegrityHighPerformance(const std::string& checksumFile, int readerThreads,
                                                           int processorThreads,
                                                           std::function<void(int, int)> progressCallback) {
-    // Implementation similar to generateChecksumsHighPerformance but for verification
-    // This would use a similar producer-consumer pattern for verification
-    // For now, fall back to parallel verification
-    return verifyIntegrityParallel(checksumFile, readerThreads + processorThreads, progressCallback);
-}
-
-// Reader worker: dedicated to reading sectors from disk
-void EnhancedDiskSectorCRC::readerWorker(uint64_t startSector, uint64_t endSector,
-                                        std::queue<SectorData>& dataQueue, std::mutex& queueMutex,
-                                        std::condition_variable& queueCV, std::atomic<bool>& readingComplete,
-                                        int batchSize) {
-    const int MAX_QUEUE_SIZE = batchSize * 4; // Prevent queue from growing too large
-    
-    uint64_t currentSector = startSector;
-    
-    while (currentSector < endSector && !isOperationCancelled()) {
-        // Read a batch of sectors
-        int actualBatchSize = std::min(static_cast<uint64_t>(batchSize), endSector - currentSector);
-        std::vector<std::vector<uint8_t>> batchData(actualBatchSize);
-        std::vector<uint64_t> batchSectors(actualBatchSize);
-        
-        // Read sectors in batch for maximum throughput
-        for (int i = 0; i < actualBatchSize; ++i) {
-            batchSectors[i] = currentSector;
-            if (!readSector(currentSector, batchData[i])) {
-                // Skip failed sectors
-                batchData[i].clear();
-            }
-            currentSector++;
+    resetCancellation();
+    verifyStats_ = VerifyStats();
+    
+    // Stream the merged view instead of materialising every record
+    ManifestChainView view;
+    if (!view.open(checksumFile)) {
+        lastError_ = view.getLastError();
+        return false;
+    }
+    legacyCrc_ = view.info().legacyCrc;
+    
+    if (!knownBadBlocks_.load(badBlockMapPathFor(checksumFile))) {
+        lastError_ = knownBadBlocks_.getLastError();
+        return false;
+    }
+    foundBadBlocks_.clear();
+    foundSlowBlocks_.clear();
+    
+    unsigned int availableThreads = std::thread::hardware_concurrency();
+    if (processorThreads <= 0) processorThreads = (availableThreads > 2) ? (availableThreads - 1) : 1;
+    if (readerThreads > 1) {
+        std::cout << "Verification streams the manifest in order; using 1 reader thread" << std::endl;
+    }
+    
+    std::cout << "High-performance verify: 1 reader thread, "
+              << processorThreads << " extent(s) hashing in parallel" << std::endl;
+    
+    VerifyJob job;
+    job.totalCount = view.chainLength() == 1 ? view.info().recordCount : view.info().sectorCount;
+    job.progressCallback = progressCallback;
+    
+    // An interrupted verification of this manifest continues after the records it had checked
+    const std::string checkpointPath = checkpointPathFor(checksumFile);
+    JobCheckpoint checkpoint;
+    checkpoint.kind = JobCheckpoint::Kind::Verify;
+    checkpoint.diskPath = diskPath_;
+    checkpoint.startSector = view.info().startSector;
+    checkpoint.sectorCount = view.info().sectorCount;
+    checkpoint.timestamp = view.info().timestamp;
+    if (resumeFromCheckpoint_ && JobCheckpoint::exists(checkpointPath)) {
+        JobCheckpoint saved;
+        if (!saved.load(checkpointPath)) {
+            lastError_ = saved.getLastError();
+            return false;
         }
-        
-        // Prepare sector data for the queue
-        uint64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count();
-        
-        std::vector<SectorData> sectorBatch;
-        for (int i = 0; i < actualBatchSize; ++i) {
-            if (!batchData[i].empty()) {
-                SectorData data;
-                data.sectorNumber = batchSectors[i];
-                data.data = std::move(batchData[i]);
-                data.timestamp = timestamp;
-                sectorBatch.push_back(std::move(data));
-            }
+        if (saved.kind != checkpoint.kind || saved.diskPath != checkpoint.diskPath ||
+            saved.startSector != checkpoint.startSector || saved.sectorCount != checkpoint.sectorCount ||
+            saved.timestamp != checkpoint.timestamp) {
+            lastError_ = "Checkpoint belongs to a different job: " + checkpointPath;
+            return false;
         }
-        
-        // Add to queue with proper synchronization
-        if (!sectorBatch.empty()) {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            
-            // Wait if queue is too large to prevent memory exhaustion
-            while (dataQueue.size() >= MAX_QUEUE_SIZE && !isOperationCancelled()) {
-                queueCV.wait_for(lock, std::chrono::milliseconds(10));
-            }
-            
-            if (isOperationCancelled()) {
-                break;
-            }
-            
-            // Add all sectors from the batch to the queue
-            for (auto& data : sectorBatch) {
-                dataQueue.push(std::move(data));
-            }
-            
-            lock.unlock();
-            queueCV.notify_all(); // Notify processor threads
+        job.checkedRecords = saved.manifestRecords;
+        job.processedCount = saved.processedCount;
+        job.corruptedCount = saved.corruptedCount;
+        job.unreadableCount = saved.unreadableCount;
+        verifyStats_.resumed = true;
+        std::cout << "Resuming from checkpoint: " << saved.processedCount << " sector(s) already verified, "
+                  << saved.corruptedCount << " failed" << std::endl;
+    } else {
+        JobCheckpoint::remove(checkpointPath);
+    }
+    if (checkpointIntervalSeconds_ > 0) {
+        job.checkpoint = &checkpoint;
+        job.manifest = checksumFile;
+    }
+    
+    runVerifyPipeline(view, job, processorThreads);
+    verifyStats_.verifiedSectors = job.processedCount;
+    verifyStats_.corruptedSectors = job.corruptedCount;
+    verifyStats_.unreadableSectors = job.unreadableCount;
+    
+    // Verification only adds ranges, the sectors it avoided were not re-checked
+    if (!saveBadBlockMap(checksumFile, 0, 0)) {
+        return false;
+    }
+    
+    // A cancelled run saves where it stopped when that is a clean boundary; otherwise the last
+    // periodic checkpoint stands. A finished run, failed sectors or not, needs no checkpoint.
+    if (job.checkpoint && job.error.empty()) {
+        if (!isOperationCancelled()) {
+            JobCheckpoint::remove(checkpointPath);
+        } else if (job.cleanStop && saveVerifyCheckpoint(job)) {
+            std::cout << "Progress saved to " << checkpointPath << "; resume to continue" << std::endl;
         }
     }
+    
+    if (!job.error.empty()) {
+        lastError_ = job.error;
+        return false;
+    }
+    if (isOperationCancelled()) {
+        lastError_ = "Operation cancelled by user";
+        return false;
+    }
+    if (job.corruptedCount > 0) {
+        lastError_ = std::to_string(job.corruptedCount.load()) + " of " + std::to_string(job.processedCount.load()) +
+                     " sectors failed verification (" + std::to_string(job.unreadableCount.load()) + " unreadable)";
+        return false;
+    }
+    
+    return true;
 }
 
-// Processor worker: dedicated to calculating CRC and writing results
-void EnhancedDiskSectorCRC::processorWorker(std::queue<SectorData>& dataQueue, std::mutex& queueMutex,
-                                           std::condition_variable& queueCV, std::atomic<bool>& readingComplete,
-                                           const std::string& outputFile, std::mutex& fileMutex,
-                                           std::atomic<uint64_t>& processedCount, uint64_t totalCount,
-                                           std::function<void(int, int)> progressCallback) {
-    std::ofstream outFile(outputFile, std::ios::binary | std::ios::app);
-    if (!outFile.is_open()) {
+void EnhancedDiskSectorCRC::runVerifyPipeline(ManifestChainView& view, VerifyJob& job, int processorThreads) {
+    // Reads cover up to one batch of consecutive manifest sectors and are cut into extents of at
+    // most EXTENT_MAX_SECTORS for hashing. processorThreads only decides how many buffers are in
+    // flight; hashing width is the pool's.
+    const int readerBatchSize = 1024;
+    const size_t bufferCount = static_cast<size_t>(processorThreads) + 2;
+    BufferPool bufferPool(bufferCount, static_cast<size_t>(readerBatchSize) * OptimizedDiskReader::sectorSize());
+    BlockingRing<VerifyExtent> dataRing(bufferCount * (readerBatchSize / EXTENT_MAX_SECTORS));
+    TaskGroup tasks;
+    job.tasks = &tasks;
+    job.dataRing = &dataRing;
+    
+    // The calling thread reads; every pushed extent has its own pool task, so a full ring only
+    // waits for tasks already queued
+    verifyReaderWorker(view, bufferPool, job, readerBatchSize);
+    
+    // Finish the remaining comparisons (this thread helps)
+    tasks.wait();
+    job.tasks = nullptr;
+    job.dataRing = nullptr;
+}
+
+bool EnhancedDiskSectorCRC::findCorruptedSectors(const std::string& checksumFile, std::vector<SectorChecksum>& corrupted,
+                                                int processorThreads, std::function<void(int, int)> progressCallback) {
+    ManifestChainView view;
+    if (!view.open(checksumFile)) {
+        lastError_ = view.getLastError();
+        return false;
+    }
+    legacyCrc_ = view.info().legacyCrc;
+    
+    if (!knownBadBlocks_.load(badBlockMapPathFor(checksumFile))) {
+        lastError_ = knownBadBlocks_.getLastError();
+        return false;
+    }
+    foundBadBlocks_.clear();
+    foundSlowBlocks_.clear();
+    
+    unsigned int availableThreads = std::thread::hardware_concurrency();
+    if (processorThreads <= 0) processorThreads = (availableThreads > 2) ? (availableThreads - 1) : 1;
+    
+    // Known bad and unreadable sectors are collected too: rewriting them from a good copy is
+    // the only way to get their contents back
+    VerifyJob job;
+    job.totalCount = view.chainLength() == 1 ? view.info().recordCount : view.info().sectorCount;
+    job.progressCallback = progressCallback;
+    job.failed = &corrupted;
+    job.timestamp = view.info().timestamp;
+    runVerifyPipeline(view, job, processorThreads);
+    
+    if (!saveBadBlockMap(checksumFile, 0, 0)) {
+        return false;
+    }
+    if (!job.error.empty()) {
+        lastError_ = job.error;
+        return false;
+    }
+    if (isOperationCancelled()) {
+        lastError_ = "Operation cancelled by user";
+        return false;
+    }
+    
+    std::cout << "Repair scan: " << corrupted.size() << " of " << job.processedCount.load()
+              << " sectors need repair (" << job.unreadableCount.load() << " unreadable)" << std::endl;
+    return true;
+}
+
+void EnhancedDiskSectorCRC::recordFailedSector(VerifyJob& job, uint64_t sectorNumber, uint32_t crc) {
+    if (job.failed) {
+        std::lock_guard<std::mutex> lock(job.failedMutex);
+        job.failed->push_back(SectorChecksum{sectorNumber, crc, job.timestamp});
+    }
+}
+
+// Verify reader: walks the manifest in order and reads each run of consecutive sectors at once
+void EnhancedDiskSectorCRC::verifyReaderWorker(ManifestChainView& view, BufferPool& bufferPool, VerifyJob& job,
+                                              int batchSize) {
+    // One handle for the whole pass instead of one open per sector
+    OptimizedDiskReader diskReader(diskPath_);
+    if (!diskReader.openDisk()) {
+        job.error = diskReader.getLastError();
         return;
     }
+    diskReader.setReadTimeout(rescuePolicy_.readTimeoutMs);
+    diskReader.setCancelCheck([this]() { return isOperationCancelled(); });
+    if (lowIoPriority_) {
+        IoThrottle::lowerCurrentThreadIoPriority();
+    }
+    
+    const uint64_t manifestChunkRecords = 1 << 16;
+    const uint32_t sectorSize = OptimizedDiskReader::sectorSize();
+    std::vector<uint64_t> sectors;
+    std::vector<uint32_t> crcs;
+    std::vector<uint8_t> sectorData;
+    size_t next = 0;
+    
+    // Records a resumed run has checked before are only read from the manifest, not the disk
+    uint64_t skipRecords = job.checkedRecords;
+    auto nextCheckpoint = std::chrono::steady_clock::now() + std::chrono::seconds(checkpointIntervalSeconds_);
     
     while (!isOperationCancelled()) {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        
-        // Wait for data or completion signal
-        while (dataQueue.empty() && !(readingComplete && isOperationCancelled())) {
-            queueCV.wait_for(lock, std::chrono::milliseconds(100));
+        if (next == sectors.size()) {
+            if (!view.readNext(manifestChunkRecords, sectors, crcs)) {
+                job.error = view.getLastError();
+                break;
+            }
+            next = 0;
+            if (sectors.empty()) {
+                break; // End of the manifest
+            }
+            if (skipRecords > 0) {
+                next = static_cast<size_t>(std::min<uint64_t>(skipRecords, sectors.size()));
+                skipRecords -= next;
+                continue;
+            }
         }
         
-        if (dataQueue.empty() && readingComplete) {
-            break; // No more data and reading is complete
+        // Between runs every counted record lies before checkedRecords: settle and save
+        if (job.checkpoint && std::chrono::steady_clock::now() >= nextCheckpoint) {
+            job.tasks->wait();
+            if (!saveVerifyCheckpoint(job)) {
+                std::cerr << "Cannot save checkpoint: " << lastError_ << std::endl;
+            }
+            nextCheckpoint = std::chrono::steady_clock::now() + std::chrono::seconds(checkpointIntervalSeconds_);
         }
         
-        if (dataQueue.empty()) {
-            continue; // No data available yet
+        // Sectors of the bad-block map are not read again and count as unreadable
+        if (knownBadBlocks_.contains(sectors[next])) {
+            recordFailedSector(job, sectors[next], crcs[next]);
+            job.unreadableCount++;
+            job.corruptedCount++;
+            job.processedCount++;
+            job.checkedRecords++;
+            next++;
+            continue;
         }
         
-        // Process one sector at a time for better load balancing
-        SectorData data = std::move(dataQueue.front());
-        dataQueue.pop();
-        lock.unlock();
+        // Longest run of consecutive sectors within this chunk, capped at one batch and at the
+        // next known bad range. Gaps in sparse or delta manifests simply start a new run.
+        uint64_t badStart = 0, badCount = 0;
+        bool badAhead = knownBadBlocks_.findNext(sectors[next], badStart, badCount);
+        size_t runLength = 1;
+        while (runLength < static_cast<size_t>(batchSize) && next + runLength < sectors.size() &&
+               sectors[next + runLength] == sectors[next] + runLength &&
+               (!badAhead || sectors[next + runLength] < badStart)) {
+            runLength++;
+        }
+        const uint64_t* runSectors = sectors.data() + next;
+        const uint32_t* runCrcs = crcs.data() + next;
         
-        // Calculate CRC
-        data.crc = calculateCRC32(data.data);
+        // Background runs wait for their bandwidth before taking a buffer
+        if (readThrottle_ && !readThrottle_->acquire(runLength * sectorSize, [this]() { return isOperationCancelled(); })) {
+            break;
+        }
+        next += runLength;
         
-        // Write result to file
-        SectorChecksum checksum{data.sectorNumber, data.crc, data.timestamp};
-        {
-            std::lock_guard<std::mutex> fileLock(fileMutex);
-            outFile.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        BufferLease buffer = bufferPool.acquire();
+        if (!buffer) {
+            break;
+        }
+        bool runRead = diskReader.readSectorsInto(runSectors[0], runLength, buffer.data());
+        bool stalled = false;
+        
+        // Cut the run into extents. If the large read failed, sectors are re-read one by one and
+        // unreadable ones are counted as failed, ending the current extent. Once a single sector
+        // runs into the deadline the rest of the run is given up without paying it again.
+        VerifyExtent item;
+        item.extent.buffer = buffer;
+        item.extent.sectorSize = sectorSize;
+        bool runCounted = false;
+        bool interrupted = false;
+        for (size_t i = 0; i <= runLength; ++i) {
+            if (i < runLength) {
+                bool readable = runRead;
+                if (!readable && !stalled) {
+                    if (diskReader.readSector(runSectors[i], sectorData)) {
+                        std::copy(sectorData.begin(), sectorData.end(), buffer.data() + i * sectorSize);
+                        readable = true;
+                    } else if (isOperationCancelled()) {
+                        interrupted = true;
+                        break; // Abandoned read, not an unreadable sector
+                    } else {
+                        stalled = diskReader.lastReadTimedOut();
+                    }
+                }
+                
+                if (readable) {
+                    if (item.extent.sectorCount == 0) {
+                        item.extent.offset = i * sectorSize;
+                        item.extent.startSector = runSectors[i];
+                        item.expected.startSector = runSectors[i];
+                    }
+                    item.expected.crcs[item.extent.sectorCount++] = runCrcs[i];
+                    if (item.extent.sectorCount < EXTENT_MAX_SECTORS) {
+                        continue;
+                    }
+                } else {
+                    recordFailedSector(job, runSectors[i], runCrcs[i]);
+                    job.unreadableCount++;
+                    job.corruptedCount++;
+                    job.processedCount++;
+                    runCounted = true;
+                    std::lock_guard<std::mutex> lock(badBlocksMutex_);
+                    foundBadBlocks_.add(runSectors[i], 1);
+                    if (stalled) {
+                        foundSlowBlocks_.add(runSectors[i], 1);
+                    }
+                }
+            }
+            
+            if (item.extent.sectorCount > 0) {
+                item.expected.count = item.extent.sectorCount;
+                if (isOperationCancelled() || !job.dataRing->push(item)) {
+                    interrupted = true;
+                    break;
+                }
+                job.tasks->run([this, &job]() { verifyNextExtent(job); });
+                runCounted = true;
+                item.extent.sectorCount = 0;
+            }
         }
         
-        // Update progress
-        uint64_t processed = ++processedCount;
-        if (progressCallback && processed % 100 == 0) {
-            progressCallback(processed, totalCount);
+        // A run cut short after part of it was counted leaves no exact position to resume from
+        if (interrupted) {
+            job.cleanStop = !runCounted;
+            break;
         }
+        job.checkedRecords += runLength;
     }
     
-    outFile.close();
+    diskReader.closeDisk();
 }
 
-// Optimized batch reading for maximum throughput
-bool EnhancedDiskSectorCRC::readSectorsBatch(uint64_t startSector, uint64_t count, std::vector<std::vector<uint8_t>>& batchData) {
-    // This method would implement optimized batch reading
-    // For now, use individual sector reads
-    batchData.resize(count);
-    bool allSuccess = true;
+bool EnhancedDiskSectorCRC::saveVerifyCheckpoint(VerifyJob& job) {
+    job.checkpoint->manifestRecords = job.checkedRecords;
+    job.checkpoint->processedCount = job.processedCount;
+    job.checkpoint->corruptedCount = job.corruptedCount;
+    job.checkpoint->unreadableCount = job.unreadableCount;
+    return saveCheckpoint(*job.checkpoint, job.manifest);
+}
+
+void EnhancedDiskSectorCRC::verifyNextExtent(VerifyJob& job) {
+    // One task per extent pushed by the reader, so pop does not wait. Extents already read are
+    // still compared after a cancel, which keeps the counts exact for the checkpoint.
+    VerifyExtent item;
+    if (!job.dataRing->pop(item)) {
+        return;
+    }
     
-    for (uint64_t i = 0; i < count; ++i) {
-        if (!readSector(startSector + i, batchData[i])) {
-            allSuccess = false;
-            batchData[i].clear();
+    uint64_t mismatches = 0;
+    for (uint32_t i = 0; i < item.extent.sectorCount; ++i) {
+        if (manifestCRC32(item.extent.sector(i), item.extent.sectorSize) != item.expected.crcs[i]) {
+            recordFailedSector(job, item.extent.startSector + i, item.expected.crcs[i]);
+            mismatches++;
         }
     }
+    item.extent.buffer.reset();
     
-    return allSuccess;
+    if (mismatches > 0) {
+        job.corruptedCount += mismatches;
+    }
+    
+    // Update progress about every 100 sectors
+    uint64_t processed = job.processedCount += item.extent.sectorCount;
+    if (job.progressCallback && processed / 100 != (processed - item.extent.sectorCount) / 100) {
+        job.progressCallback(processed, job.totalCount);
+    }
 }
 
-// Streaming worker with automatic memory release: process sectors as they are read
-void EnhancedDiskSectorCRC::checksumWorkerStreaming(uint64_t startSector, uint64_t endSector, 
-                                                   const std::string& outputFile, std::mutex& fileMutex,
-                                                   std::atomic<uint64_t>& processedCount, uint64_t totalCount,
-                                                   std::function<void(int, int)> progressCallback,
-                                                   int bufferSize) {
-    std::ofstream outFile(outputFile, std::ios::binary | std::ios::app);
-    if (!outFile.is_open()) {
-        return;
+// Reader worker: dedicated to reading sectors from disk
+bool EnhancedDiskSectorCRC::readerWorker(const std::vector<SectorRange>& ranges, BufferPool& bufferPool,
+                                        BlockingRing<SectorExtent>& dataRing, ParitySidecarWriter* parity,
+                                        int batchSize, std::string& error) {
+    OptimizedDiskReader diskReader(diskPath_);
+    if (!diskReader.openDisk()) {
+        error = "Cannot open disk: " + diskReader.getLastError();
+        return false;
     }
+    diskReader.setReadTimeout(rescuePolicy_.readTimeoutMs);
+    diskReader.setCancelCheck([this]() { return isOperationCancelled(); });
     
-    // Use a small buffer for streaming processing to minimize memory usage
-    const int STREAM_BUFFER_SIZE = std::min(bufferSize, 32); // Smaller buffer for streaming
-    
-    // Pre-allocate minimal buffers for streaming
-    std::vector<uint8_t> sectorData(DiskSectorCRC::SECTOR_SIZE);
-    std::vector<SectorChecksum> checksumBuffer(STREAM_BUFFER_SIZE);
-    std::vector<uint64_t> sectorBuffer(STREAM_BUFFER_SIZE);
+    // Large reads first, failing areas are revisited with smaller reads once the rest is done
+    RescuePolicy policy = rescuePolicy_;
+    policy.maxReadSectors = static_cast<uint32_t>(batchSize);
     
-    uint64_t currentSector = startSector;
-    int bufferIndex = 0;
-    
-    while (currentSector < endSector) {
+    for (const SectorRange& range : ranges) {
         if (isOperationCancelled()) {
             break;
         }
+        RescueScheduler rescue(range.firstSector, range.firstSector + range.sectorCount, policy, &knownBadBlocks_);
         
-        // Read one sector at a time for streaming processing
-        if (readSector(currentSector, sectorData)) {
-            // Calculate checksum immediately after reading
-            uint32_t crc = calculateCRC32(sectorData);
-            uint64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-                std::chrono::system_clock::now().time_since_epoch()).count();
-            
-            // Store in buffer
-            checksumBuffer[bufferIndex] = SectorChecksum{currentSector, crc, timestamp};
-            sectorBuffer[bufferIndex] = currentSector;
-            bufferIndex++;
-            
-            // When buffer is full or at end, write to file and clear buffer
-            if (bufferIndex >= STREAM_BUFFER_SIZE || currentSector + 1 >= endSector) {
-                {
-                    std::lock_guard<std::mutex> lock(fileMutex);
-                    for (int i = 0; i < bufferIndex; ++i) {
-                        outFile.write(reinterpret_cast<const char*>(&checksumBuffer[i]), sizeof(SectorChecksum));
-                    }
+        uint64_t firstSector;
+        uint32_t sectorCount;
+        while (!isOperationCancelled() && rescue.next(firstSector, sectorCount)) {
+            BufferLease buffer = bufferPool.acquire();
+            if (!buffer) {
+                break;
+            }
+            bool readOk = diskReader.readSectorsInto(firstSector, sectorCount, buffer.data());
+            rescue.complete(readOk, diskReader.lastReadTimedOut());
+            if (!readOk) {
+                // Sectors given up on are recorded as they are found, so a checkpoint keeps them
+                if (rescue.pass() != RescueScheduler::COPY) {
+                    std::lock_guard<std::mutex> lock(badBlocksMutex_);
+                    foundBadBlocks_.merge(rescue.badBlocks());
                 }
-                
-                // Update progress
-                uint64_t processed = processedCount.fetch_add(bufferIndex) + bufferIndex;
-                if (progressCallback && processed % 100 == 0) {
-                    progressCallback(processed, totalCount);
+                continue;
+            }
+            
+            // push blocks only while the ring is full, which bounds memory use
+            SectorExtent extent;
+            extent.buffer = buffer;
+            extent.sectorSize = SECTOR_SIZE;
+            extent.startSector = firstSector;
+            extent.sectorCount = sectorCount;
+            if (isOperationCancelled() || !dataRing.push(std::move(extent))) {
+                break;
+            }
+        }
+        
+        const BadBlockMap& badBlocks = rescue.badBlocks();
+        if (parity) {
+            for (const auto& badRange : badBlocks.ranges()) {
+                for (uint64_t sector = badRange.first; sector < badRange.first + badRange.second; ++sector) {
+                    parity->skip(sector);
                 }
-                
-                // Clear buffer for next batch
-                bufferIndex = 0;
             }
         }
+        std::lock_guard<std::mutex> lock(badBlocksMutex_);
+        foundBadBlocks_.merge(badBlocks);
+        foundSlowBlocks_.merge(rescue.slowBlocks());
+    }
+    diskReader.closeDisk();
+    return true;
+}
+
+// Processor worker: dedicated to calculating CRC and writing results
+void EnhancedDiskSectorCRC::processorWorker(BlockingRing<SectorExtent>& dataRing,
+                                           ChecksumManifestWriter& writer, ParitySidecarWriter* parity,
+                                           std::atomic<uint64_t>& processedCount, uint64_t totalCount,
+                                           std::atomic<bool>& failed, std::function<void(int, int)> progressCallback) {
+    // pop returns false once the readers are done and the ring is drained
+    SectorExtent extent;
+    std::vector<uint32_t> crcs;
+    while (dataRing.pop(extent)) {
+        if (isOperationCancelled()) {
+            dataRing.close(); // Release readers blocked on a full ring
+            break;
+        }
         
-        currentSector++;
+        // Calculate one contiguous CRC array per extent
+        crcs.resize(extent.sectorCount);
+        for (uint32_t i = 0; i < extent.sectorCount; ++i) {
+            crcs[i] = FastCRC32::compute(extent.sector(i), extent.sectorSize);
+        }
+        if (parity && !parity->accumulate(extent.startSector, extent.sector(0), extent.sectorCount)) {
+            failed = true;
+            dataRing.close();
+            break;
+        }
+        extent.buffer.reset();
+        
+        // Hand the whole run to the shared manifest writer
+        if (!writer.appendRun(extent.startSector, crcs.data(), crcs.size())) {
+            failed = true;
+            dataRing.close();
+            break;
+        }
         
-        // Explicitly clear sector data to release memory immediately
-        if (currentSector % 16 == 0) {
-            std::vector<uint8_t>().swap(sectorData); // Force memory release
-            sectorData.resize(DiskSectorCRC::SECTOR_SIZE); // Reallocate for next sector
+        // Update progress about every 100 sectors
+        uint64_t processed = processedCount += extent.sectorCount;
+        if (progressCallback && processed / 100 != (processed - extent.sectorCount) / 100) {
+            progressCallback(processed, totalCount);
         }
     }
+}
+
+// Collects repaired sectors, handed over in ascending order, into runs of consecutive sectors
+// inside one group buffer. A full group is journaled (original and new contents), synced once,
+// then written run by run through one persistent handle.
+class JournaledRepairWriter {
+public:
+    JournaledRepairWriter(OptimizedDiskReader& target, RepairJournal& journal, uint32_t maxRunSectors)
+        : target_(target), journal_(journal), sectorSize_(OptimizedDiskReader::sectorSize()),
+          maxRunSectors_(maxRunSectors), groupUsed_(0), writeStart_(0), writeCount_(0), repairedCount_(0),
+          failed_(false) {
+        originalData_.resize(static_cast<size_t>(maxRunSectors_) * sectorSize_);
+        groupData_.resize(static_cast<size_t>(REPAIR_GROUP_SECTORS) * sectorSize_);
+    }
     
-    // Write any remaining data in buffer
-    if (bufferIndex > 0) {
-        {
-            std::lock_guard<std::mutex> lock(fileMutex);
-            for (int i = 0; i < bufferIndex; ++i) {
-                outFile.write(reinterpret_cast<const char*>(&checksumBuffer[i]), sizeof(SectorChecksum));
+    bool add(uint64_t sector, const uint8_t* data) {
+        if (failed_) {
+            return false;
+        }
+        if (writeCount_ > 0 && sector < writeStart_ + writeCount_) {
+            return true; // Duplicate manifest entry, already repaired
+        }
+        
+        if (writeCount_ > 0 && (sector != writeStart_ + writeCount_ || writeCount_ == maxRunSectors_)) {
+            closeRun();
+        }
+        if (groupUsed_ + writeCount_ == REPAIR_GROUP_SECTORS && !commitGroup()) {
+            return false;
+        }
+        if (writeCount_ == 0) {
+            writeStart_ = sector;
+        }
+        std::copy(data, data + sectorSize_, groupData_.data() + static_cast<size_t>(groupUsed_ + writeCount_) * sectorSize_);
+        writeCount_++;
+        return true;
+    }
+    
+    // Journal and write everything added so far; later adds may start below the last sector
+    bool commit() {
+        return commitGroup();
+    }
+    
+    // Write what is left and flush the device; the journal may only go after this succeeded
+    bool finish() {
+        if (!commitGroup()) {
+            return false;
+        }
+        if (!target_.flush()) {
+            error_ = target_.getLastError() + " (repair journal kept: " + journal_.journalPath() + ")";
+            failed_ = true;
+        }
+        return !failed_;
+    }
+    
+    uint64_t repairedCount() const { return repairedCount_; }
+    std::string getLastError() const { return error_; }
+    
+private:
+    struct GroupRun {
+        uint64_t startSector;
+        uint32_t sectorCount;
+        size_t offset;
+    };
+    
+    OptimizedDiskReader& target_;
+    RepairJournal& journal_;
+    uint32_t sectorSize_;
+    uint32_t maxRunSectors_;
+    std::vector<uint8_t> originalData_;
+    std::vector<uint8_t> groupData_;
+    std::vector<GroupRun> groupRuns_;
+    uint32_t groupUsed_;
+    uint64_t writeStart_;
+    uint32_t writeCount_;
+    uint64_t repairedCount_;
+    bool failed_;
+    std::string error_;
+    
+    void closeRun() {
+        if (writeCount_ > 0) {
+            groupRuns_.push_back(GroupRun{writeStart_, writeCount_, static_cast<size_t>(groupUsed_) * sectorSize_});
+            groupUsed_ += writeCount_;
+            writeCount_ = 0;
+        }
+    }
+    
+    bool commitGroup() {
+        closeRun();
+        if (failed_) {
+            return false;
+        }
+        
+        // Journal first: original contents come from the target itself
+        for (const GroupRun& run : groupRuns_) {
+            if (!target_.readSectorsInto(run.startSector, run.sectorCount, originalData_.data())) {
+                error_ = "Cannot save original contents: " + target_.getLastError();
+                failed_ = true;
+                return false;
+            }
+            if (!journal_.appendRange(run.startSector, run.sectorCount, originalData_.data(),
+                                      groupData_.data() + run.offset)) {
+                error_ = journal_.getLastError();
+                failed_ = true;
+                return false;
             }
         }
+        if (!groupRuns_.empty() && !journal_.sync()) {
+            error_ = journal_.getLastError();
+            failed_ = true;
+            return false;
+        }
         
-        uint64_t processed = processedCount.fetch_add(bufferIndex) + bufferIndex;
-        if (progressCallback && processed % 100 == 0) {
-            progressCallback(processed, totalCount);
+        for (const GroupRun& run : groupRuns_) {
+            if (!target_.writeSectorsFrom(run.startSector, run.sectorCount, groupData_.data() + run.offset)) {
+                error_ = target_.getLastError() + " (repair journal kept: " + journal_.journalPath() + ")";
+                failed_ = true;
+                return false;
+            }
+            repairedCount_ += run.sectorCount;
         }
+        groupRuns_.clear();
+        groupUsed_ = 0;
+        return true;
+    }
+};
+
+bool EnhancedDiskSectorCRC::repairCorrupted(const std::vector<SectorChecksum>& corrupted,
+                                           const std::string& backupDiskPath, const std::string& checksumFile,
+                                           uint64_t& repairedCount) {
+    // Without a backup disk the parity sidecar written next to the manifest is the only source
+    // besides bit-flip correction
+    std::string parityPath = checksumFile + ".parity";
+    bool useParity = backupDiskPath.empty() && std::ifstream(parityPath, std::ios::binary).is_open();
+    if (!bitFlipCorrection_ && backupDiskPath.empty() && !useParity) {
+        return true; // Nothing to repair from
     }
     
-    outFile.close();
+    OptimizedDiskReader targetWriter(diskPath_);
+    if (!targetWriter.openDisk(true)) {
+        lastError_ = targetWriter.getLastError();
+        return false;
+    }
+    targetWriter.setReadTimeout(rescuePolicy_.readTimeoutMs);
+    targetWriter.setCancelCheck([this]() { return isOperationCancelled(); });
+    
+    RepairJournal journal;
+    std::string journalPath = repairJournalPath_.empty() ? checksumFile + ".journal" : repairJournalPath_;
+    if (!journal.create(journalPath, diskPath_, OptimizedDiskReader::sectorSize())) {
+        lastError_ = journal.getLastError();
+        return false;
+    }
+    
+    // Bit flips are fixed in place first and committed, so parity rebuilds already see them. The
+    // syndromes assume standard CRC-32, so old-table manifests go straight to the backup or parity.
+    JournaledRepairWriter writer(targetWriter, journal, IoPlanner::DEFAULT_MAX_READ_SECTORS);
+    std::vector<SectorChecksum> remaining;
+    bool sourceOk = true;
+    if (bitFlipCorrection_ && !legacyCrc_) {
+        sourceOk = repairBitFlips(corrupted, targetWriter, writer, remaining) && writer.commit();
+    } else {
+        remaining = corrupted;
+    }
+    
+    if (sourceOk && !remaining.empty() && !isOperationCancelled()) {
+        if (!backupDiskPath.empty()) {
+            sourceOk = repairFromBackup(remaining, backupDiskPath, writer);
+        } else if (useParity) {
+            sourceOk = repairFromParity(remaining, parityPath, writer);
+        }
+    }
     
-    // Final memory cleanup
-    std::vector<uint8_t>().swap(sectorData);
-    std::vector<SectorChecksum>().swap(checksumBuffer);
-    std::vector<uint64_t>().swap(sectorBuffer);
+    // Whatever was rebuilt before a source error is still written and flushed
+    bool writeOk = writer.finish();
+    repairedCount = writer.repairedCount();
+    targetWriter.closeDisk();
+    if (!writeOk) {
+        lastError_ = writer.getLastError();
+        return false;
+    }
+    if (!journal.complete()) {
+        lastError_ = journal.getLastError();
+        return false;
+    }
+    return sourceOk;
 }
 
+bool EnhancedDiskSectorCRC::repairBitFlips(const std::vector<SectorChecksum>& corrupted, OptimizedDiskReader& target,
+                                          JournaledRepairWriter& writer, std::vector<SectorChecksum>& remaining) {
+    const uint32_t sectorSize = OptimizedDiskReader::sectorSize();
+    const CrcSyndromeTable& syndromes = CrcSyndromeTable::forLength(sectorSize);
+    
+    IoPlanner plan(ioGapSectors_);
+    plan.plan(corrupted, 0, corrupted.size(), [](const SectorChecksum& checksum) { return checksum.sectorNumber; });
+    
+    std::vector<uint8_t> readBuffer(static_cast<size_t>(plan.maxReadSectors()) * sectorSize);
+    BadBlockMap unreadable;
+    uint64_t corrected = 0;
+    for (const PlannedRead& read : plan.reads()) {
+        // Known bad and unreadable sectors have nothing to correct; they need another source
+        if (!rescueRead(target, read.startSector, read.sectorCount, readBuffer.data(), &knownBadBlocks_, unreadable)) {
+            break;
+        }
+        
+        for (size_t entry = read.firstEntry; entry < read.firstEntry + read.entryCount; ++entry) {
+            const auto& checksum = corrupted[plan.itemIndex(entry)];
+            uint8_t* data = readBuffer.data() + (checksum.sectorNumber - read.startSector) * sectorSize;
+            if (unreadable.contains(checksum.sectorNumber)) {
+                remaining.push_back(checksum);
+                continue;
+            }
+            
+            if (syndromes.correct(data, checksum.crc32, maxBitFlips_) == 0) {
+                remaining.push_back(checksum);
+                continue;
+            }
+            if (!writer.add(checksum.sectorNumber, data)) {
+                return false;
+            }
+            corrected++;
+        }
+    }
+    
+    if (corrected > 0) {
+        std::cout << "Bit-flip correction: " << corrected << " sector(s) fixed from their CRC" << std::endl;
+    }
+    return true;
+}
 
-void EnhancedDiskSectorCRC::verificationWorker(const std::vector<SectorChecksum>& checksums,
-                                              std::atomic<uint64_t>& corruptedCount,
-                                              std::atomic<uint64_t>& processedCount,
-                                              std::function<void(int, int)> progressCallback) {
-    for (const auto& checksum : checksums) {
-        if (isOperationCancelled()) {
+bool EnhancedDiskSectorCRC::repairFromBackup(const std::vector<SectorChecksum>& corrupted,
+                                            const std::string& backupDiskPath, JournaledRepairWriter& writer) {
+    OptimizedDiskReader backupReader(backupDiskPath);
+    if (!backupReader.openDisk()) {
+        lastError_ = "Cannot open backup disk: " + backupReader.getLastError();
+        return false;
+    }
+    backupReader.setReadTimeout(rescuePolicy_.readTimeoutMs);
+    backupReader.setCancelCheck([this]() { return isOperationCancelled(); });
+    
+    // Chunks finish in any order; the plan puts the corrupted sectors back in LBA order
+    IoPlanner plan(ioGapSectors_);
+    plan.plan(corrupted, 0, corrupted.size(), [](const SectorChecksum& checksum) { return checksum.sectorNumber; });
+    
+    const uint32_t sectorSize = OptimizedDiskReader::sectorSize();
+    std::vector<uint8_t> readBuffer(static_cast<size_t>(plan.maxReadSectors()) * sectorSize);
+    BadBlockMap backupBad;
+    uint64_t unreadable = 0;
+    uint64_t mismatched = 0;
+    for (const PlannedRead& read : plan.reads()) {
+        // The bad-block map belongs to this disk, the backup is read in full
+        if (!rescueRead(backupReader, read.startSector, read.sectorCount, readBuffer.data(), nullptr, backupBad)) {
             break;
         }
         
-        std::vector<uint8_t> sectorData;
-        if (!readSector(checksum.sectorNumber, sectorData)) {
-            continue;
+        for (size_t entry = read.firstEntry; entry < read.firstEntry + read.entryCount; ++entry) {
+            const auto& checksum = corrupted[plan.itemIndex(entry)];
+            const uint8_t* data = readBuffer.data() + (checksum.sectorNumber - read.startSector) * sectorSize;
+            if (backupBad.contains(checksum.sectorNumber)) {
+                unreadable++;
+                continue;
+            }
+            
+            // Only backup data matching the stored CRC (the same CRC the generators write) is used
+            if (manifestCRC32(data, sectorSize) != checksum.crc32) {
+                mismatched++;
+                continue;
+            }
+            if (!writer.add(checksum.sectorNumber, data)) {
+                backupReader.closeDisk();
+                return false;
+            }
+        }
+    }
+    
+    backupReader.closeDisk();
+    if (unreadable > 0 || mismatched > 0) {
+        std::cout << "Backup disk: " << mismatched << " sector(s) do not match the manifest CRC and "
+                  << unreadable << " could not be read; left unrepaired" << std::endl;
+    }
+    return true;
+}
+
+bool EnhancedDiskSectorCRC::repairFromParity(const std::vector<SectorChecksum>& corrupted,
+                                            const std::string& parityPath, JournaledRepairWriter& writer) {
+    ParitySidecarReader parity;
+    if (!parity.open(parityPath)) {
+        lastError_ = parity.getLastError();
+        return false;
+    }
+    const ParityLayout& layout = parity.layout();
+    const uint32_t sectorSize = OptimizedDiskReader::sectorSize();
+    if (layout.sectorSize != sectorSize) {
+        lastError_ = "Parity file sector size does not match the disk: " + parityPath;
+        return false;
+    }
+    
+    OptimizedDiskReader diskReader(diskPath_);
+    if (!diskReader.openDisk()) {
+        lastError_ = diskReader.getLastError();
+        return false;
+    }
+    diskReader.setReadTimeout(rescuePolicy_.readTimeoutMs);
+    diskReader.setCancelCheck([this]() { return isOperationCancelled(); });
+    
+    // Work stripe by stripe in LBA order; a stripe is read in one request
+    std::vector<SectorChecksum> targets;
+    for (const auto& checksum : corrupted) {
+        if (checksum.sectorNumber >= layout.startSector &&
+            checksum.sectorNumber - layout.startSector < layout.sectorCount) {
+            targets.push_back(checksum);
+        }
+    }
+    std::sort(targets.begin(), targets.end(),
+              [](const SectorChecksum& a, const SectorChecksum& b) { return a.sectorNumber < b.sectorNumber; });
+    targets.erase(std::unique(targets.begin(), targets.end(),
+                              [](const SectorChecksum& a, const SectorChecksum& b) { return a.sectorNumber == b.sectorNumber; }),
+                  targets.end());
+    uint64_t unrecoverable = corrupted.size() - targets.size();
+    
+    std::vector<uint8_t> stripeData(static_cast<size_t>(layout.stripeSectors()) * sectorSize);
+    std::vector<uint8_t> parityData;
+    std::vector<uint8_t> rebuilt(sectorSize);
+    BadBlockMap unreadable;
+    std::vector<uint32_t> badMembers(layout.interleave);
+    bool ok = true;
+    
+    for (size_t first = 0; first < targets.size() && ok && !isOperationCancelled();) {
+        uint64_t stripe = (targets[first].sectorNumber - layout.startSector) / layout.stripeSectors();
+        uint64_t stripeStart = layout.startSector + stripe * layout.stripeSectors();
+        uint64_t stripeLength = layout.sectorsInStripe(stripe);
+        size_t last = first;
+        while (last < targets.size() && targets[last].sectorNumber < stripeStart + stripeLength) {
+            last++;
         }
         
-        uint32_t currentCRC = calculateCRC32(sectorData);
+        // Groups with an invalid parity sector or an unreadable member cannot rebuild anything
+        uint64_t unusable = 0;
+        if (!parity.readStripe(stripe, unusable, parityData)) {
+            unusable = ~uint64_t(0);
+        }
+        if (!rescueRead(diskReader, stripeStart, static_cast<uint32_t>(stripeLength), stripeData.data(),
+                        &knownBadBlocks_, unreadable)) {
+            break;
+        }
+        for (const auto& range : unreadable.ranges()) {
+            for (uint64_t sector = range.first; sector < range.first + range.second; ++sector) {
+                // The sectors being rebuilt may be unreadable themselves; any other member may not
+                auto target = std::lower_bound(targets.begin() + first, targets.begin() + last, sector,
+                    [](const SectorChecksum& checksum, uint64_t value) { return checksum.sectorNumber < value; });
+                if (target == targets.begin() + last || target->sectorNumber != sector) {
+                    unusable |= uint64_t(1) << ((sector - stripeStart) % layout.interleave);
+                }
+            }
+        }
         
-        if (currentCRC != checksum.crc32) {
-            corruptedCount++;
+        // XOR parity rebuilds exactly one bad member per group
+        std::fill(badMembers.begin(), badMembers.end(), 0);
+        for (size_t t = first; t < last; ++t) {
+            badMembers[(targets[t].sectorNumber - stripeStart) % layout.interleave]++;
         }
         
-        uint64_t processed = ++processedCount;
-        if (progressCallback && processed % 100 == 0) {
-            progressCallback(processed, checksums.size());
+        for (size_t t = first; t < last; ++t) {
+            uint64_t member = targets[t].sectorNumber - stripeStart;
+            uint32_t group = static_cast<uint32_t>(member % layout.interleave);
+            if ((unusable >> group) & 1 || badMembers[group] != 1) {
+                unrecoverable++;
+                continue;
+            }
+            
+            std::copy(parityData.begin() + static_cast<size_t>(group) * sectorSize,
+                      parityData.begin() + static_cast<size_t>(group + 1) * sectorSize, rebuilt.begin());
+            for (uint64_t other = group; other < stripeLength; other += layout.interleave) {
+                if (other != member) {
+                    xorInto(rebuilt.data(), stripeData.data() + other * sectorSize, sectorSize);
+                }
+            }
+            
+            // Stale parity (data changed since generation) fails this check
+            if (manifestCRC32(rebuilt.data(), sectorSize) != targets[t].crc32) {
+                unrecoverable++;
+                continue;
+            }
+            if (!writer.add(targets[t].sectorNumber, rebuilt.data())) {
+                ok = false;
+                break;
+            }
         }
+        first = last;
+    }
+    
+    if (unrecoverable > 0) {
+        std::cout << "Parity repair: " << unrecoverable << " sector(s) could not be rebuilt" << std::endl;
     }
+    diskReader.closeDisk();
+    return ok;
 }
 
-void EnhancedDiskSectorCRC::repairWorker(const std::vector<SectorChecksum>& checksums,
-                                        const std::string& backupDiskPath,
-                                        std::atomic<uint64_t>& repairedCount,
-                                        std::atomic<uint64_t>& processedCount,
-                                        std::function<void(int, int)> progressCallback) {
-    bool backupAvailable = !backupDiskPath.empty();
-    std::string backupDisk = backupDiskPath;
+bool EnhancedDiskSectorCRC::repairWithReplicas(const std::string& checksumFile,
+                                              const std::vector<std::string>& replicaPaths,
+                                              ReplicaRepairStats& stats,
+                                              std::function<void(int, int)> progressCallback) {
+    resetCancellation();
+    stats = ReplicaRepairStats();
     
-    if (backupAvailable && backupDisk.find("\\\\.\\") == std::string::npos) {
-        backupDisk = "\\\\.\\" + backupDiskPath;
+    std::vector<SectorChecksum> checksums;
+    uint64_t startSector, sectorCount;
+    if (!readChecksumFile(checksumFile, checksums, startSector, sectorCount)) {
+        return false;
     }
     
-    for (const auto& checksum : checksums) {
-        if (isOperationCancelled()) {
-            break;
+    if (!knownBadBlocks_.load(badBlockMapPathFor(checksumFile))) {
+        lastError_ = knownBadBlocks_.getLastError();
+        return false;
+    }
+    foundBadBlocks_.clear();
+    foundSlowBlocks_.clear();
+    
+    std::vector<std::string> copies(1, diskPath_);
+    copies.insert(copies.end(), replicaPaths.begin(), replicaPaths.end());
+    const size_t copyCount = copies.size();
+    stats.repairedSectors.assign(copyCount, 0);
+    
+    std::string journalBase = repairJournalPath_.empty() ? checksumFile + ".journal" : repairJournalPath_;
+    std::vector<std::string> journalPaths(1, journalBase);
+    for (size_t copy = 1; copy < copyCount; ++copy) {
+        journalPaths.push_back(journalBase + "." + std::to_string(copy));
+    }
+    for (const std::string& journalPath : journalPaths) {
+        if (RepairJournal::exists(journalPath)) {
+            lastError_ = "Interrupted repair journal found, run recover-repair first: " + journalPath;
+            return false;
         }
-        
-        std::vector<uint8_t> currentSectorData;
-        if (!readSector(checksum.sectorNumber, currentSectorData)) {
-            continue;
+    }
+    
+    // Verify every copy at once, each device with its own reader
+    IoPlanner plan(ioGapSectors_);
+    plan.plan(checksums, 0, checksums.size(), [](const SectorChecksum& checksum) { return checksum.sectorNumber; });
+    std::vector<std::vector<uint8_t>> bad(copyCount, std::vector<uint8_t>(checksums.size(), 0));
+    std::vector<std::string> scanErrors(copyCount);
+    std::atomic<uint64_t> processedCount(0);
+    std::vector<std::thread> scanners;
+    for (size_t copy = 0; copy < copyCount; ++copy) {
+        scanners.emplace_back(&EnhancedDiskSectorCRC::scanReplica, this, std::cref(copies[copy]), copy == 0, std::cref(checksums),
+                              std::cref(plan), std::ref(bad[copy]), std::ref(scanErrors[copy]),
+                              std::ref(processedCount), checksums.size() * copyCount, progressCallback);
+    }
+    for (auto& scanner : scanners) {
+        scanner.join();
+    }
+    if (!saveBadBlockMap(checksumFile, 0, 0)) {
+        return false;
+    }
+    for (const std::string& error : scanErrors) {
+        if (!error.empty()) {
+            lastError_ = error;
+            return false;
+        }
+    }
+    if (isOperationCancelled()) {
+        lastError_ = "Operation cancelled by user";
+        return false;
+    }
+    
+    // Sectors bad on any copy; every other manifest sector is good everywhere
+    std::vector<SectorChecksum> suspects;
+    std::vector<uint64_t> manifestSectors;
+    manifestSectors.reserve(checksums.size());
+    for (size_t i = 0; i < checksums.size(); ++i) {
+        manifestSectors.push_back(checksums[i].sectorNumber);
+        for (size_t copy = 0; copy < copyCount; ++copy) {
+            if (bad[copy][i]) {
+                suspects.push_back(checksums[i]);
+                break;
+            }
+        }
+    }
+    bad.clear();
+    std::sort(manifestSectors.begin(), manifestSectors.end());
+    stats.suspectSectors = suspects.size();
+    if (suspects.empty()) {
+        return true;
+    }
+    
+    // Every copy is written through its own journal
+    std::vector<std::unique_ptr<OptimizedDiskReader>> devices;
+    for (size_t copy = 0; copy < copyCount; ++copy) {
+        devices.emplace_back(new OptimizedDiskReader(copies[copy]));
+        if (!devices.back()->openDisk(true)) {
+            lastError_ = "Cannot open " + copies[copy] + " for writing: " + devices.back()->getLastError();
+            return false;
+        }
+        devices.back()->setReadTimeout(rescuePolicy_.readTimeoutMs);
+        devices.back()->setCancelCheck([this]() { return isOperationCancelled(); });
+    }
+    std::vector<std::unique_ptr<RepairJournal>> journals;
+    for (size_t copy = 0; copy < copyCount; ++copy) {
+        journals.emplace_back(new RepairJournal());
+        if (!journals.back()->create(journalPaths[copy], copies[copy], OptimizedDiskReader::sectorSize())) {
+            lastError_ = journals.back()->getLastError();
+            journals.pop_back();
+            for (auto& journal : journals) {
+                journal->complete(); // Nothing written yet
+            }
+            return false;
+        }
+    }
+    std::vector<std::unique_ptr<JournaledRepairWriter>> writers;
+    for (size_t copy = 0; copy < copyCount; ++copy) {
+        writers.emplace_back(new JournaledRepairWriter(*devices[copy], *journals[copy], IoPlanner::DEFAULT_MAX_READ_SECTORS));
+    }
+    
+    // Re-read the suspect ranges (gaps included) from all copies batch by batch and settle each
+    // sector: the copy matching the stored CRC, else a bit-flip correction of one, or for sectors
+    // without a manifest entry the content a strict majority of the copies agrees on
+    const uint32_t sectorSize = OptimizedDiskReader::sectorSize();
+    const CrcSyndromeTable& syndromes = CrcSyndromeTable::forLength(sectorSize);
+    IoPlanner suspectPlan(ioGapSectors_);
+    suspectPlan.plan(suspects, 0, suspects.size(), [](const SectorChecksum& checksum) { return checksum.sectorNumber; });
+    const std::vector<PlannedRead>& reads = suspectPlan.reads();
+    
+    std::vector<std::vector<uint8_t>> copyData(copyCount);
+    std::vector<std::vector<uint8_t>> readable(copyCount);
+    std::vector<uint32_t> crcs(copyCount);
+    std::vector<uint8_t> corrected(sectorSize);
+    bool ok = true;
+    size_t firstRead = 0;
+    while (ok && firstRead < reads.size() && !isOperationCancelled()) {
+        size_t lastRead = firstRead;
+        uint64_t batchSectors = 0;
+        while (lastRead < reads.size() &&
+               (lastRead == firstRead || batchSectors + reads[lastRead].sectorCount <= REPLICA_BATCH_SECTORS)) {
+            batchSectors += reads[lastRead].sectorCount;
+            lastRead++;
         }
         
-        uint32_t currentCRC = calculateCRC32(currentSectorData);
+        std::vector<std::thread> readers;
+        for (size_t copy = 0; copy < copyCount; ++copy) {
+            readers.emplace_back([&, copy]() {
+                OptimizedDiskReader& device = *devices[copy];
+                copyData[copy].resize(static_cast<size_t>(batchSectors) * sectorSize);
+                readable[copy].assign(batchSectors, 1);
+                BadBlockMap unreadable;
+                uint64_t offset = 0;
+                for (size_t r = firstRead; r < lastRead; ++r) {
+                    const PlannedRead& read = reads[r];
+                    uint8_t* buffer = copyData[copy].data() + offset * sectorSize;
+                    if (!rescueRead(device, read.startSector, read.sectorCount, buffer,
+                                    copy == 0 ? &knownBadBlocks_ : nullptr, unreadable)) {
+                        break;
+                    }
+                    // Unreadable sectors take no part in the decision and are rewritten
+                    for (const auto& range : unreadable.ranges()) {
+                        for (uint64_t sector = range.first; sector < range.first + range.second; ++sector) {
+                            readable[copy][offset + (sector - read.startSector)] = 0;
+                        }
+                    }
+                    offset += read.sectorCount;
+                }
+            });
+        }
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        if (isOperationCancelled()) {
+            break;
+        }
         
-        if (currentCRC != checksum.crc32) {
-            // Attempt recovery from backup disk
-            if (backupAvailable) {
-                EnhancedDiskSectorCRC backupDiskObj(backupDisk);
-                std::vector<uint8_t> backupData;
+        uint64_t offset = 0;
+        for (size_t r = firstRead; r < lastRead && ok; ++r) {
+            const PlannedRead& read = reads[r];
+            size_t entry = read.firstEntry;
+            const size_t entryEnd = read.firstEntry + read.entryCount;
+            for (uint32_t i = 0; i < read.sectorCount && ok; ++i) {
+                const uint64_t sector = read.startSector + i;
+                const uint64_t slot = offset + i;
+                
+                bool suspect = false;
+                uint32_t expected = 0;
+                while (entry < entryEnd && suspects[suspectPlan.itemIndex(entry)].sectorNumber == sector) {
+                    expected = suspects[suspectPlan.itemIndex(entry)].crc32;
+                    suspect = true;
+                    entry++;
+                }
+                if (!suspect && std::binary_search(manifestSectors.begin(), manifestSectors.end(), sector)) {
+                    continue; // Verified good on every copy
+                }
                 
-                if (backupDiskObj.readSector(checksum.sectorNumber, backupData)) {
-                    uint32_t backupCRC = backupDiskObj.calculateCRC32(backupData);
-                    
-                    if (backupCRC == checksum.crc32) {
-                        // Write data from backup
-                        if (writeSector(checksum.sectorNumber, backupData)) {
-                            repairedCount++;
+                for (size_t copy = 0; copy < copyCount; ++copy) {
+                    if (readable[copy][slot]) {
+                        crcs[copy] = manifestCRC32(copyData[copy].data() + slot * sectorSize, sectorSize);
+                    }
+                }
+                
+                const uint8_t* chosen = nullptr;
+                if (suspect) {
+                    for (size_t copy = 0; copy < copyCount && !chosen; ++copy) {
+                        if (readable[copy][slot] && crcs[copy] == expected) {
+                            chosen = copyData[copy].data() + slot * sectorSize;
+                        }
+                    }
+                    for (size_t copy = 0; copy < copyCount && !chosen && bitFlipCorrection_ && !legacyCrc_; ++copy) {
+                        if (readable[copy][slot]) {
+                            const uint8_t* data = copyData[copy].data() + slot * sectorSize;
+                            std::copy(data, data + sectorSize, corrected.begin());
+                            if (syndromes.correct(corrected.data(), expected, maxBitFlips_) > 0) {
+                                chosen = corrected.data();
+                            }
                         }
                     }
+                    if (!chosen) {
+                        stats.unrecoverableSectors++;
+                        continue;
+                    }
+                } else {
+                    for (size_t copy = 0; copy < copyCount && !chosen; ++copy) {
+                        if (!readable[copy][slot]) {
+                            continue;
+                        }
+                        const uint8_t* data = copyData[copy].data() + slot * sectorSize;
+                        size_t votes = 0;
+                        for (size_t other = 0; other < copyCount; ++other) {
+                            if (readable[other][slot] && crcs[other] == crcs[copy] &&
+                                std::equal(data, data + sectorSize, copyData[other].data() + slot * sectorSize)) {
+                                votes++;
+                            }
+                        }
+                        if (votes * 2 > copyCount) {
+                            chosen = data;
+                        }
+                    }
+                    if (!chosen) {
+                        continue; // No majority, leave every copy as it is
+                    }
+                }
+                
+                // Rewrite every copy holding something else
+                const uint32_t chosenCrc = suspect ? expected : manifestCRC32(chosen, sectorSize);
+                bool rewritten = false;
+                for (size_t copy = 0; copy < copyCount; ++copy) {
+                    const uint8_t* data = copyData[copy].data() + slot * sectorSize;
+                    if (readable[copy][slot] && crcs[copy] == chosenCrc && std::equal(data, data + sectorSize, chosen)) {
+                        continue;
+                    }
+                    if (!writers[copy]->add(sector, chosen)) {
+                        lastError_ = writers[copy]->getLastError();
+                        ok = false;
+                        break;
+                    }
+                    rewritten = true;
+                }
+                if (!suspect && rewritten) {
+                    stats.votedSectors++;
                 }
             }
+            offset += read.sectorCount;
+        }
+        firstRead = lastRead;
+    }
+    
+    // Whatever was settled before an error is still written and flushed on every copy
+    bool writeOk = true;
+    for (size_t copy = 0; copy < copyCount; ++copy) {
+        if (!writers[copy]->finish()) {
+            if (ok && writeOk) {
+                lastError_ = writers[copy]->getLastError();
+            }
+            writeOk = false;
+            continue;
+        }
+        stats.repairedSectors[copy] = writers[copy]->repairedCount();
+        if (!journals[copy]->complete()) {
+            if (ok && writeOk) {
+                lastError_ = journals[copy]->getLastError();
+            }
+            writeOk = false;
+        }
+        devices[copy]->closeDisk();
+    }
+    if (!ok || !writeOk) {
+        return false;
+    }
+    if (isOperationCancelled()) {
+        lastError_ = "Operation cancelled by user";
+        return false;
+    }
+    if (stats.unrecoverableSectors > 0) {
+        lastError_ = std::to_string(stats.unrecoverableSectors) + " sector(s) are bad on every copy";
+        return false;
+    }
+    return true;
+}
+
+void EnhancedDiskSectorCRC::scanReplica(const std::string& copyPath, bool thisDisk, const std::vector<SectorChecksum>& checksums,
+                                       const IoPlanner& plan, std::vector<uint8_t>& bad, std::string& error,
+                                       std::atomic<uint64_t>& processedCount, uint64_t totalCount,
+                                       std::function<void(int, int)> progressCallback) {
+    OptimizedDiskReader diskReader(copyPath);
+    if (!diskReader.openDisk()) {
+        error = "Cannot open " + copyPath + ": " + diskReader.getLastError();
+        return;
+    }
+    diskReader.setReadTimeout(rescuePolicy_.readTimeoutMs);
+    diskReader.setCancelCheck([this]() { return isOperationCancelled(); });
+    
+    const uint32_t sectorSize = OptimizedDiskReader::sectorSize();
+    std::vector<uint8_t> readBuffer(static_cast<size_t>(plan.maxReadSectors()) * sectorSize);
+    BadBlockMap unreadable;
+    BadBlockMap slow;
+    for (const PlannedRead& read : plan.reads()) {
+        if (!rescueRead(diskReader, read.startSector, read.sectorCount, readBuffer.data(),
+                        thisDisk ? &knownBadBlocks_ : nullptr, unreadable, &slow)) {
+            break;
+        }
+        if (thisDisk) {
+            std::lock_guard<std::mutex> lock(badBlocksMutex_);
+            foundBadBlocks_.merge(unreadable);
+            foundSlowBlocks_.merge(slow);
         }
         
-        uint64_t processed = ++processedCount;
-        if (progressCallback && processed % 100 == 0) {
-            progressCallback(processed, checksums.size());
+        for (size_t entry = read.firstEntry; entry < read.firstEntry + read.entryCount; ++entry) {
+            size_t index = plan.itemIndex(entry);
+            const auto& checksum = checksums[index];
+            const uint8_t* data = readBuffer.data() + (checksum.sectorNumber - read.startSector) * sectorSize;
+            
+            // Unreadable counts as bad
+            if (unreadable.contains(checksum.sectorNumber) || manifestCRC32(data, sectorSize) != checksum.crc32) {
+                bad[index] = 1;
+            }
+            
+            uint64_t processed = ++processedCount;
+            if (progressCallback && processed % 100 == 0) {
+                progressCallback(processed, totalCount);
+            }
         }
     }
+    
+    diskReader.closeDisk();
+}
+
+void EnhancedDiskSectorCRC::planReads(const std::vector<SectorChecksum>& checksums, IoPlanner& plan,
+                                      uint64_t& readsPerChunk) const {
+    plan.plan(checksums, 0, checksums.size(), [](const SectorChecksum& checksum) { return checksum.sectorNumber; });
+    
+    // About PARALLEL_CHUNK_SECTORS targets per chunk, whether the reads are dense or sparse
+    readsPerChunk = std::max<uint64_t>(1, PARALLEL_CHUNK_SECTORS * plan.reads().size() /
+                                          std::max<size_t>(1, checksums.size()));
 }
 
 // Helper methods
 bool EnhancedDiskSectorCRC::readChecksumFile(const std::string& checksumFile, 
                                             std::vector<SectorChecksum>& checksums,
                                             uint64_t& startSector, uint64_t& sectorCount) {
-    std::ifstream inFile(checksumFile, std::ios::binary);
-    if (!inFile.is_open()) {
-        lastError_ = "Cannot open checksum file: " + checksumFile;
+    // Accepts full (v1 / compact) manifests as well as delta chains
+    ManifestChainView view;
+    if (!view.open(checksumFile)) {
+        lastError_ = view.getLastError();
         return false;
     }
+    legacyCrc_ = view.info().legacyCrc;
     
-    // Read file header
-    uint32_t magic;
-    uint64_t timestamp;
-    
-    inFile.read(reinterpret_cast<char*>(&magic), sizeof(magic));
-    inFile.read(reinterpret_cast<char*>(&startSector), sizeof(startSector));
-    inFile.read(reinterpret_cast<char*>(&sectorCount), sizeof(sectorCount));
-    inFile.read(reinterpret_cast<char*>(&timestamp), sizeof(timestamp));
+    startSector = view.info().startSector;
+    sectorCount = view.info().sectorCount;
     
-    if (magic != 0x43524344) {
-        lastError_ = "Invalid checksum file format";
-        inFile.close();
+    if (!view.readAll(checksums)) {
+        lastError_ = view.getLastError();
         return false;
     }
     
-    // Read all checksums
-    checksums.resize(sectorCount);
-    for (uint64_t i = 0; i < sectorCount; ++i) {
-        inFile.read(reinterpret_cast<char*>(&checksums[i]), sizeof(SectorChecksum));
-        if (inFile.gcount() != sizeof(SectorChecksum)) {
-            lastError_ = "Failed to read checksum data";
-            inFile.close();
-            return false;
-        }
-    }
-    
-    inFile.close();
     return true;
 }
 
@@ -924,63 +2071,3 @@ bool EnhancedDiskSectorCRC::findRepairSource(const std::string& checksumFile, st
     // For now, return false to indicate no automatic source found
     return false;
 }
-
-// Optimized worker with batch reading for better performance
-void EnhancedDiskSectorCRC::checksumWorkerBatch(uint64_t startSector, uint64_t endSector, 
-                                               const std::string& outputFile, std::mutex& fileMutex,
-                                               std::atomic<uint64_t>& processedCount, uint64_t totalCount,
-                                               std::function<void(int, int)> progressCallback,
-                                               int batchSize) {
-    std::ofstream outFile(outputFile, std::ios::binary | std::ios::app);
-    if (!outFile.is_open()) {
-        return;
-    }
-    
-    // Pre-allocate buffers for batch processing
-    std::vector<std::vector<uint8_t>> batchData(batchSize);
-    std::vector<uint64_t> batchSectors(batchSize);
-    std::vector<SectorChecksum> batchChecksums(batchSize);
-    
-    uint64_t currentSector = startSector;
-    
-    while (currentSector < endSector) {
-        if (isOperationCancelled()) {
-            break;
-        }
-        
-        // Process sectors in batches for better I/O performance
-        int actualBatchSize = 0;
-        for (int i = 0; i < batchSize && currentSector < endSector; ++i) {
-            batchSectors[i] = currentSector;
-            if (readSector(currentSector, batchData[i])) {
-                actualBatchSize++;
-            }
-            currentSector++;
-        }
-        
-        // Calculate checksums for the batch
-        uint64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count();
-        
-        for (int i = 0; i < actualBatchSize; ++i) {
-            uint32_t crc = calculateCRC32(batchData[i]);
-            batchChecksums[i] = SectorChecksum{batchSectors[i], crc, timestamp};
-        }
-        
-        // Write batch results to file
-        {
-            std::lock_guard<std::mutex> lock(fileMutex);
-            for (int i = 0; i < actualBatchSize; ++i) {
-                outFile.write(reinterpret_cast<const char*>(&batchChecksums[i]), sizeof(SectorChecksum));
-            }
-        }
-        
-        // Update progress
-        uint64_t processed = processedCount.fetch_add(actualBatchSize) + actualBatchSize;
-        if (progressCallback && processed % 100 == 0) {
-            progressCallback(processed, totalCount);
-        }
-    }
-    
-    outFile.close();
-}
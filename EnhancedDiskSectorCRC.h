@@ -2,20 +2,91 @@
 #define ENHANCED_DISK_SECTOR_CRC_H
 
 #include "DiskSectorCRC.h"
+#include "ConcurrentRing.h"
+#include "SectorExtent.h"
+#include "IoPlanner.h"
+#include "BadBlockMap.h"
+#include "JobCheckpoint.h"
+#include "StopToken.h"
 #include <atomic>
 #include <thread>
 #include <vector>
-#include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
 
+class ChecksumManifestWriter;
+class IoThrottle;
+class ManifestChainView;
+class TaskGroup;
+class JournaledRepairWriter;
+class ParitySidecarWriter;
+class OptimizedDiskReader;
+
+// Sectors per work item when parallel operations are scheduled on the shared pool
+static constexpr uint64_t PARALLEL_CHUNK_SECTORS = 4096;
+
+// Repaired sectors journaled per sync; device writes of a group start once it is durable
+static constexpr uint32_t REPAIR_GROUP_SECTORS = 8192;
+
+// Sectors re-read from every copy at once during a replica repair (per copy buffer: 32 MB)
+static constexpr uint64_t REPLICA_BATCH_SECTORS = 65536;
+
+// Default interval between checkpoints of long generate/verify runs
+static constexpr uint32_t CHECKPOINT_INTERVAL_SECONDS = 60;
+
+// Budget and layout of a sampling verify
+struct SamplingPolicy {
+    uint64_t maxBytes = 1ull << 30;     // Read budget, 0 for none
+    uint32_t maxSeconds = 0;            // Time limit, 0 for none
+    uint32_t extentSectors = 1024;      // Manifest records per sampled extent, read in one request
+    uint32_t strata = 64;               // Regions of the manifest sampled evenly
+    double confidence = 0.95;           // Level of the reported intervals
+    uint64_t seed = 0;                  // 0 picks a random seed
+};
+
+// Outcome of verifySampled; corrupted counts include unreadable sectors
+struct SamplingResult {
+    uint64_t manifestSectors = 0;
+    uint64_t manifestExtents = 0;
+    uint64_t sampledSectors = 0;
+    uint64_t sampledExtents = 0;
+    uint64_t corruptedSectors = 0;
+    uint64_t corruptedExtents = 0;
+    uint64_t unreadableSectors = 0;
+    uint64_t bytesRead = 0;
+    double seconds = 0;
+    bool timeLimitReached = false;
+    
+    // Estimated corrupted fraction of all sectors / extents with its Wilson score interval
+    double sectorRate = 0, sectorRateLow = 0, sectorRateHigh = 0;
+    double extentRate = 0, extentRateLow = 0, extentRateHigh = 0;
+};
+
+// Counts of the last high-performance verify, including what a resumed run carried over;
+// corrupted counts include unreadable sectors
+struct VerifyStats {
+    uint64_t verifiedSectors = 0;
+    uint64_t corruptedSectors = 0;
+    uint64_t unreadableSectors = 0;
+    bool resumed = false;
+};
+
+// Outcome of repairWithReplicas
+struct ReplicaRepairStats {
+    uint64_t suspectSectors = 0;            // Manifest sectors bad on at least one copy
+    uint64_t unrecoverableSectors = 0;      // Manifest sectors with no good copy left
+    uint64_t votedSectors = 0;              // Sectors without a manifest entry settled by majority
+    std::vector<uint64_t> repairedSectors;  // Sectors rewritten per copy, the disk itself first
+};
+
 class EnhancedDiskSectorCRC : public DiskSectorCRC {
 public:
     EnhancedDiskSectorCRC(const std::string& diskPath);
     ~EnhancedDiskSectorCRC();
     
-    // Enhanced methods with cancellation support
+    // Enhanced methods with cancellation support; generate and verify run the high-performance
+    // pipelines below with one reader
     bool generateSectorChecksums(uint64_t startSector, uint64_t sectorCount, 
                                 const std::string& outputFile, 
                                 std::function<void(int, int)> progressCallback = nullptr);
@@ -38,17 +109,89 @@ public:
                            int threadCount = 4,
                            std::function<void(int, int)> progressCallback = nullptr);
     
+    // Health check within a budget: verify a random subset of manifest extents, stratified over
+    // the manifest so every region is covered evenly, until the byte budget or time limit is used
+    // up, and estimate the corruption rate of the whole disk with confidence intervals. Each round
+    // visits one extent per region in ascending order and each extent is one large read.
+    bool verifySampled(const std::string& checksumFile, const SamplingPolicy& policy, SamplingResult& result,
+                       std::function<void(int, int)> progressCallback = nullptr);
+    
+    // Repair this disk and every replica in one pass. All copies are verified against the
+    // manifest in parallel (one reader per device); the sectors bad on any copy are then re-read
+    // from all copies together, the copy matching the stored CRC is written to every copy that
+    // does not, and sectors between them without a manifest entry go to the majority when the
+    // copies disagree. Each copy is journaled to its own file: <journal> for this disk and
+    // <journal>.<n> for replica n.
+    bool repairWithReplicas(const std::string& checksumFile, const std::vector<std::string>& replicaPaths,
+                            ReplicaRepairStats& stats,
+                            std::function<void(int, int)> progressCallback = nullptr);
+    
+    // Repairs are journaled (see RepairJournal) to this file; empty means <checksum file>.journal.
+    // A journal left behind by an interrupted repair blocks new repairs until it is recovered.
+    void setRepairJournalPath(const std::string& journalPath) { repairJournalPath_ = journalPath; }
+    
+    // Parallel verify/repair read manifest sectors in LBA order, merging targets at most this
+    // many sectors apart into one read (see IoPlanner); 0 only merges adjacent sectors
+    void setIoGapThreshold(uint32_t sectors) { ioGapSectors_ = sectors; }
+    
+    // generateChecksumsHighPerformance also writes <manifest>.parity (see ParitySidecar) with one
+    // XOR parity sector per groupSize data sectors; 0 turns it off. Repairs without a backup disk
+    // rebuild single bad sectors per group from it.
+    void setParitySidecar(uint32_t groupSize) { paritySidecarGroupSize_ = groupSize; }
+    
+    // Repairs first try to explain each CRC mismatch by a single flipped bit (see CrcSyndromeTable)
+    // and fix those in place; only the rest go to the backup or parity. maxFlips = 2 also accepts
+    // double flips, which falsely match about 0.2% of random 512-byte corruptions.
+    void setBitFlipCorrection(bool enabled, int maxFlips = 1) {
+        bitFlipCorrection_ = enabled;
+        maxBitFlips_ = maxFlips;
+    }
+    
+    // High-performance generate and verify load unreadable ranges from this map and do not touch
+    // them, and record newly found ones in it; empty means <manifest>.badblocks. Generation reads
+    // with the RescueScheduler policy given here.
+    void setBadBlockMapPath(const std::string& path) { badBlockMapPath_ = path; }
+    void setRescuePolicy(const RescuePolicy& policy) { rescuePolicy_ = policy; }
+    
+    // High-performance generate and verify save their progress to <manifest>.checkpoint about every
+    // `seconds` (0 turns it off) and when cancelled; the file is removed once the run completes.
+    // Generation with a parity sidecar is not checkpointed, the parity is only complete at the end.
+    void setCheckpointInterval(uint32_t seconds) { checkpointIntervalSeconds_ = seconds; }
+    
+    // Continue an interrupted run of the same job from its checkpoint: generation reads only the
+    // sectors not yet in the manifest, verification skips the manifest records already checked and
+    // carries its counts over. Without a checkpoint the run starts from the beginning.
+    void setResumeFromCheckpoint(bool resume) { resumeFromCheckpoint_ = resume; }
+    
+    // Background operation: the high-performance verify reader asks this throttle before every
+    // read (see IoThrottle; null for none) and, with lowIoPriority, reads in the idle I/O class
+    void setReadThrottle(IoThrottle* throttle) { readThrottle_ = throttle; }
+    void setLowIoPriority(bool enabled) { lowIoPriority_ = enabled; }
+    
+    const VerifyStats& verifyStats() const { return verifyStats_; }
+    
     // Control methods
     void cancelOperation();
     bool isOperationCancelled() const;
     void resetCancellation();
     
+    // Also treat a stop requested through this token as cancellation. Unlike cancelOperation it
+    // is not cleared when the next operation starts.
+    void setStopToken(const StopToken& stopToken) { stopToken_ = stopToken; }
+    
     // Advanced repair methods
     bool repairFromChecksumFile(const std::string& checksumFile, 
                                const std::string& repairSourcePath = "",
                                std::function<void(int, int)> progressCallback = nullptr);
     
-    bool validateChecksumFile(const std::string& checksumFile);
+    // Check a manifest (and every file of a delta chain). v2 manifests are verified block by block
+    // in parallel; quickCheck limits this to the headers and block indexes.
+    bool validateChecksumFile(const std::string& checksumFile, bool quickCheck = false);
+    
+    // Incremental snapshot: store only sectors whose CRC differs from the base manifest (or chain)
+    bool generateDeltaChecksums(uint64_t startSector, uint64_t sectorCount,
+                               const std::string& baseManifest, const std::string& outputFile,
+                               std::function<void(int, int)> progressCallback = nullptr);
     
     // High-performance parallel processing with dedicated reader thread
     bool generateChecksumsHighPerformance(uint64_t startSector, uint64_t sectorCount,
@@ -56,6 +199,10 @@ public:
                                          int processorThreads = 0,
                                          std::function<void(int, int)> progressCallback = nullptr);
     
+    // Streams the manifest (or delta chain) and reads each run of consecutive sectors in large
+    // sequential requests from one dedicated reader; hashing and comparison run on the shared pool.
+    // Unreadable sectors count as failed. The manifest is read in order by a single reader, so
+    // readerThreads above 1 gains nothing and is ignored.
     bool verifyIntegrityHighPerformance(const std::string& checksumFile, int readerThreads = 1,
                                        int processorThreads = 0,
                                        std::function<void(int, int)> progressCallback = nullptr);
@@ -67,66 +214,140 @@ private:
     std::atomic<bool> operationCancelled_;
     std::mutex cancellationMutex_;
     std::condition_variable cancellationCV_;
+    uint32_t ioGapSectors_;
+    StopToken stopToken_;
+    std::string repairJournalPath_;
+    uint32_t paritySidecarGroupSize_;
+    bool bitFlipCorrection_;
+    int maxBitFlips_;
+    std::string badBlockMapPath_;
+    RescuePolicy rescuePolicy_;
+    uint32_t checkpointIntervalSeconds_;
+    bool resumeFromCheckpoint_;
+    IoThrottle* readThrottle_;
+    bool lowIoPriority_;
+    VerifyStats verifyStats_;
+    BadBlockMap knownBadBlocks_;    // Loaded when an operation starts, read-only while it runs
+    BadBlockMap foundBadBlocks_;    // Found by the running operation, guarded by badBlocksMutex_
+    BadBlockMap foundSlowBlocks_;   // Covered by reads that ran into their deadline, same mutex
+    std::mutex badBlocksMutex_;
     
-    // Data structures for producer-consumer pattern
-    struct SectorData {
-        uint64_t sectorNumber;
-        std::vector<uint8_t> data;
-        uint32_t crc;
-        uint64_t timestamp;
-    };
+    std::string badBlockMapPathFor(const std::string& manifest) const {
+        return badBlockMapPath_.empty() ? manifest + ".badblocks" : badBlockMapPath_;
+    }
+    
+    std::string checkpointPathFor(const std::string& manifest) const { return manifest + ".checkpoint"; }
+    
+    // Persist known + found ranges; the known ranges inside a fully scanned range are replaced
+    bool saveBadBlockMap(const std::string& manifest, uint64_t scannedStart, uint64_t scannedCount);
     
-    // High-performance worker functions
-    void readerWorker(uint64_t startSector, uint64_t endSector,
-                     std::queue<SectorData>& dataQueue, std::mutex& queueMutex,
-                     std::condition_variable& queueCV, std::atomic<bool>& readingComplete,
-                     int batchSize = 64);
+    // Save a checkpoint together with the bad ranges found so far, which a resumed run avoids
+    bool saveCheckpoint(JobCheckpoint& checkpoint, const std::string& manifest);
     
-    void processorWorker(std::queue<SectorData>& dataQueue, std::mutex& queueMutex,
-                        std::condition_variable& queueCV, std::atomic<bool>& readingComplete,
-                        const std::string& outputFile, std::mutex& fileMutex,
+    // Read [firstSector, firstSector + sectorCount) into buffer on the rescue schedule: one read of
+    // the whole range, and if that fails the RescueScheduler narrows it down to the sectors that
+    // stay unreadable. Those (and the known bad ones, which are not read) are returned in
+    // unreadable. False once the operation is cancelled.
+    bool rescueRead(OptimizedDiskReader& reader, uint64_t firstSector, uint32_t sectorCount, uint8_t* buffer,
+                    const BadBlockMap* knownBad, BadBlockMap& unreadable, BadBlockMap* slow = nullptr);
+    
+    // High-performance worker functions; readers hand extents of consecutive sectors to processors
+    // Reads each range with a RescueScheduler; extents also feed the parity sidecar when one is
+    // being written. False (with error set) if the disk could not be opened and nothing was read.
+    bool readerWorker(const std::vector<SectorRange>& ranges, BufferPool& bufferPool,
+                     BlockingRing<SectorExtent>& dataRing, ParitySidecarWriter* parity, int batchSize,
+                     std::string& error);
+    
+    // Sets `failed` and closes the ring when the manifest or parity writer fails
+    void processorWorker(BlockingRing<SectorExtent>& dataRing,
+                        ChecksumManifestWriter& writer, ParitySidecarWriter* parity,
                         std::atomic<uint64_t>& processedCount, uint64_t totalCount,
-                        std::function<void(int, int)> progressCallback);
-    
-    // Optimized batch reading for maximum throughput
-    bool readSectorsBatch(uint64_t startSector, uint64_t count, std::vector<std::vector<uint8_t>>& batchData);
-    
-    // Worker thread functions
-    void checksumWorker(uint64_t startSector, uint64_t endSector, 
-                       const std::string& outputFile, std::mutex& fileMutex,
-                       std::atomic<uint64_t>& processedCount, uint64_t totalCount,
-                       std::function<void(int, int)> progressCallback);
-    
-    // Optimized worker with batch reading
-    void checksumWorkerBatch(uint64_t startSector, uint64_t endSector, 
-                            const std::string& outputFile, std::mutex& fileMutex,
-                            std::atomic<uint64_t>& processedCount, uint64_t totalCount,
-                            std::function<void(int, int)> progressCallback,
-                            int batchSize = 64);
-    
-    // Streaming worker with automatic memory release
-    void checksumWorkerStreaming(uint64_t startSector, uint64_t endSector, 
-                                const std::string& outputFile, std::mutex& fileMutex,
-                                std::atomic<uint64_t>& processedCount, uint64_t totalCount,
-                                std::function<void(int, int)> progressCallback,
-                                int bufferSize = 32);
-    
-    void verificationWorker(const std::vector<SectorChecksum>& checksums,
-                           std::atomic<uint64_t>& corruptedCount,
-                           std::atomic<uint64_t>& processedCount,
-                           std::function<void(int, int)> progressCallback);
-    
-    void repairWorker(const std::vector<SectorChecksum>& checksums,
-                     const std::string& backupDiskPath,
-                     std::atomic<uint64_t>& repairedCount,
-                     std::atomic<uint64_t>& processedCount,
+                        std::atomic<bool>& failed, std::function<void(int, int)> progressCallback);
+    
+    // Pipelined verification: each extent carries the stored CRCs of its sectors
+    struct VerifyExtent {
+        SectorExtent extent;
+        ExtentChecksums expected;
+    };
+    
+    struct VerifyJob {
+        TaskGroup* tasks = nullptr;
+        BlockingRing<VerifyExtent>* dataRing = nullptr;
+        std::atomic<uint64_t> corruptedCount{0};
+        std::atomic<uint64_t> unreadableCount{0};
+        std::atomic<uint64_t> processedCount{0};
+        uint64_t totalCount = 0;
+        std::function<void(int, int)> progressCallback;
+        std::string error;      // Set by the reader, read once it has been joined
+        
+        // Checkpointing: the reader settles the comparisons in flight before each save, so the
+        // counts cover exactly the first checkedRecords merged manifest records
+        JobCheckpoint* checkpoint = nullptr;
+        std::string manifest;
+        uint64_t checkedRecords = 0;    // Skipped on start when resuming, reported back on exit
+        bool cleanStop = true;          // False if a cancel cut a run that was partly counted
+        
+        // Repair scans: every mismatched or unreadable sector is also collected here
+        std::vector<SectorChecksum>* failed = nullptr;
+        uint64_t timestamp = 0;
+        std::mutex failedMutex;
+    };
+    
+    // Runs the verify pipeline for a prepared job: the manifest is streamed in order by one reader
+    // and the extents are compared on the pool. Returns once every comparison has finished.
+    void runVerifyPipeline(ManifestChainView& view, VerifyJob& job, int processorThreads);
+    
+    // Repair scan: streams the manifest like verifyIntegrityHighPerformance and collects the
+    // checksums of the corrupted and unreadable sectors in any order
+    bool findCorruptedSectors(const std::string& checksumFile, std::vector<SectorChecksum>& corrupted,
+                              int processorThreads, std::function<void(int, int)> progressCallback);
+    
+    void recordFailedSector(VerifyJob& job, uint64_t sectorNumber, uint32_t crc);
+    
+    bool saveVerifyCheckpoint(VerifyJob& job);
+    
+    void verifyReaderWorker(ManifestChainView& view, BufferPool& bufferPool, VerifyJob& job, int batchSize);
+    
+    // Pool task: pop one extent, hash it and compare against the stored CRCs
+    void verifyNextExtent(VerifyJob& job);
+    
+    // Repair the corrupted sectors by bit-flip correction, then the rest from the backup disk, or
+    // without one from <checksum file>.parity when it exists. Repaired sectors are written back in coalesced runs through one handle,
+    // flushed once at the end; each group of runs is journaled with its original contents and
+    // synced before it is written.
+    bool repairCorrupted(const std::vector<SectorChecksum>& corrupted, const std::string& backupDiskPath,
+                         const std::string& checksumFile, uint64_t& repairedCount);
+    
+    // Read the corrupted sectors back from the target in planned range reads and fix those whose
+    // CRC syndrome points at a flipped bit (or two, if enabled); the others are appended to remaining
+    bool repairBitFlips(const std::vector<SectorChecksum>& corrupted, OptimizedDiskReader& target,
+                        JournaledRepairWriter& writer, std::vector<SectorChecksum>& remaining);
+    
+    // Read the corrupted sectors from the backup in planned range reads and keep those matching
+    // their stored CRC
+    bool repairFromBackup(const std::vector<SectorChecksum>& corrupted, const std::string& backupDiskPath,
+                          JournaledRepairWriter& writer);
+    
+    // Verify one copy against the manifest along the plan; marks bad (or unreadable) entries.
+    // For this disk (thisDisk) known bad sectors are not read and unreadable ones are recorded.
+    void scanReplica(const std::string& copyPath, bool thisDisk, const std::vector<SectorChecksum>& checksums,
+                     const IoPlanner& plan, std::vector<uint8_t>& bad, std::string& error,
+                     std::atomic<uint64_t>& processedCount, uint64_t totalCount,
                      std::function<void(int, int)> progressCallback);
     
+    // Rebuild corrupted sectors from the parity sidecar, one stripe read at a time. A group can
+    // rebuild one bad member; the result is kept only if it matches the stored CRC.
+    bool repairFromParity(const std::vector<SectorChecksum>& corrupted, const std::string& parityPath,
+                          JournaledRepairWriter& writer);
+    
     // Helper methods
     bool readChecksumFile(const std::string& checksumFile, 
                          std::vector<SectorChecksum>& checksums,
                          uint64_t& startSector, uint64_t& sectorCount);
     
+    // Sort and coalesce the sectors of a checksum list into reads
+    void planReads(const std::vector<SectorChecksum>& checksums, IoPlanner& plan, uint64_t& readsPerChunk) const;
+    
     bool findRepairSource(const std::string& checksumFile, std::string& repairSource);
 };
 
@@ -0,0 +1,83 @@
+#include "FastCRC32.h"
+#include <cstring>
+
+namespace {
+
+struct SlicingTables {
+    uint32_t table[8][256];
+
+    SlicingTables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int slice = 1; slice < 8; ++slice) {
+                uint32_t previous = table[slice - 1][i];
+                table[slice][i] = (previous >> 8) ^ table[0][previous & 0xFF];
+            }
+        }
+    }
+};
+
+const SlicingTables& tables() {
+    static const SlicingTables instance;
+    return instance;
+}
+
+// The old table differs from the standard one in a single entry
+struct LegacyTable {
+    uint32_t table[256];
+
+    LegacyTable() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            table[i] = tables().table[0][i];
+        }
+        table[10] = 0xE0D5E4E8;
+    }
+};
+
+const LegacyTable& legacyTable() {
+    static const LegacyTable instance;
+    return instance;
+}
+
+} // namespace
+
+uint32_t FastCRC32::update(uint32_t crc, const void* data, size_t length) {
+    const uint32_t (*t)[256] = tables().table;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+
+    // Eight bytes per step; the words are assembled byte-wise so the result is endian-independent
+    while (length >= 8) {
+        uint32_t low = crc ^ (static_cast<uint32_t>(bytes[0]) |
+                              static_cast<uint32_t>(bytes[1]) << 8 |
+                              static_cast<uint32_t>(bytes[2]) << 16 |
+                              static_cast<uint32_t>(bytes[3]) << 24);
+        crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^
+              t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+              t[3][bytes[4]] ^ t[2][bytes[5]] ^ t[1][bytes[6]] ^ t[0][bytes[7]];
+        bytes += 8;
+        length -= 8;
+    }
+
+    while (length-- > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *bytes++) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+uint32_t FastCRC32::legacyCrc32(const void* data, size_t length) {
+    const uint32_t* t = legacyTable().table;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint32_t crc = 0xFFFFFFFF;
+    while (length-- > 0) {
+        crc = (crc >> 8) ^ t[(crc ^ *bytes++) & 0xFF];
+    }
+    return crc ^ 0xFFFFFFFF;
+}
@@ -0,0 +1,384 @@
+#include "FileManifest.h"
+#include "FastCRC32.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+
+namespace {
+
+const size_t PATH_TABLE_FLUSH_SIZE = 1 << 20;
+const size_t RECORD_FLUSH_COUNT = 4096;
+
+uint32_t headerChecksum(const FileManifestV2Header& header) {
+    return FastCRC32::compute(&header, offsetof(FileManifestV2Header, headerCrc));
+}
+
+void appendVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool readVarint(const uint8_t* data, uint64_t end, uint64_t& offset, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (offset >= end) {
+            return false;
+        }
+        uint8_t byte = data[offset++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 补齐到8字节边界
+void padToAlignment(std::ofstream& out, uint64_t& position) {
+    static const char zeros[8] = {0};
+    uint64_t padding = (8 - position % 8) % 8;
+    out.write(zeros, static_cast<std::streamsize>(padding));
+    position += padding;
+}
+
+} // namespace
+
+// FileManifestWriter
+
+bool FileManifestWriter::write(const std::string& manifestPath, const DirectoryChecksum& checksum) {
+    const std::vector<FileChecksum>& files = checksum.fileChecksums;
+
+    // 按路径排序，同一路径出现多次时保留最后一条
+    std::vector<size_t> order(files.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&files](size_t a, size_t b) {
+        return files[a].filePath < files[b].filePath;
+    });
+
+    std::vector<size_t> unique;
+    unique.reserve(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (i + 1 < order.size() && files[order[i + 1]].filePath == files[order[i]].filePath) {
+            continue;
+        }
+        unique.push_back(order[i]);
+    }
+    std::vector<size_t>().swap(order);
+
+    std::ofstream out(manifestPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        lastError_ = "Cannot create output file: " + manifestPath;
+        return false;
+    }
+
+    FileManifestV2Header header = FileManifestV2Header();
+    header.magic = FILE_MANIFEST_MAGIC_V2;
+    header.version = FILE_MANIFEST_V2_VERSION;
+    header.fileCount = unique.size();
+    header.totalSize = checksum.totalSize;
+    header.timestamp = checksum.timestamp;
+    header.directoryCRC = checksum.directoryCRC;
+    header.restartInterval = FILE_MANIFEST_RESTART_INTERVAL;
+
+    // 先写占位文件头，各段偏移确定后再回填
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t position = sizeof(header);
+
+    header.directoryPathOffset = position;
+    header.directoryPathLength = checksum.directoryPath.size();
+    out.write(checksum.directoryPath.data(), static_cast<std::streamsize>(checksum.directoryPath.size()));
+    position += checksum.directoryPath.size();
+    padToAlignment(out, position);
+
+    // 定长记录数组
+    header.recordOffset = position;
+    std::vector<FileManifestRecord> records;
+    records.reserve(RECORD_FLUSH_COUNT);
+    for (size_t i = 0; i < unique.size(); ++i) {
+        const FileChecksum& file = files[unique[i]];
+        records.push_back(FileManifestRecord{file.fileSize, file.timestamp, file.lastModified, file.crc32, 0});
+        if (records.size() == RECORD_FLUSH_COUNT || i + 1 == unique.size()) {
+            out.write(reinterpret_cast<const char*>(records.data()),
+                      static_cast<std::streamsize>(records.size() * sizeof(FileManifestRecord)));
+            records.clear();
+        }
+    }
+    position += unique.size() * sizeof(FileManifestRecord);
+
+    // 前缀压缩的路径表，同时记录重启点偏移
+    header.pathTableOffset = position;
+    std::vector<uint64_t> restarts;
+    restarts.reserve((unique.size() + FILE_MANIFEST_RESTART_INTERVAL - 1) / FILE_MANIFEST_RESTART_INTERVAL);
+    std::vector<uint8_t> chunk;
+    chunk.reserve(PATH_TABLE_FLUSH_SIZE + 4096);
+    const std::string* previous = nullptr;
+
+    for (size_t i = 0; i < unique.size(); ++i) {
+        const std::string& path = files[unique[i]].filePath;
+        uint64_t shared = 0;
+
+        if (i % FILE_MANIFEST_RESTART_INTERVAL == 0) {
+            restarts.push_back(position - header.pathTableOffset + chunk.size());
+        } else {
+            size_t limit = std::min(previous->size(), path.size());
+            while (shared < limit && (*previous)[shared] == path[shared]) {
+                ++shared;
+            }
+        }
+
+        appendVarint(chunk, shared);
+        appendVarint(chunk, path.size() - shared);
+        chunk.insert(chunk.end(), path.begin() + shared, path.end());
+        previous = &path;
+
+        if (chunk.size() >= PATH_TABLE_FLUSH_SIZE) {
+            out.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+            position += chunk.size();
+            chunk.clear();
+        }
+    }
+    out.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+    position += chunk.size();
+    header.pathTableSize = position - header.pathTableOffset;
+    padToAlignment(out, position);
+
+    // 重启点索引
+    header.indexOffset = position;
+    header.indexCount = restarts.size();
+    out.write(reinterpret_cast<const char*>(restarts.data()),
+              static_cast<std::streamsize>(restarts.size() * sizeof(uint64_t)));
+    position += restarts.size() * sizeof(uint64_t);
+
+    header.fileSize = position;
+    header.headerCrc = headerChecksum(header);
+    out.seekp(0, std::ios::beg);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.flush();
+
+    if (!out) {
+        lastError_ = "Error writing checksum file: " + manifestPath;
+        return false;
+    }
+    return true;
+}
+
+// FileManifestView
+
+FileManifestView::FileManifestView() : header_() {
+}
+
+bool FileManifestView::open(const std::string& manifestPath) {
+    close();
+
+    if (!mapped_.open(manifestPath)) {
+        lastError_ = mapped_.getLastError();
+        return false;
+    }
+
+    uint64_t size = mapped_.size();
+    if (size < sizeof(header_)) {
+        lastError_ = "Invalid checksum file format";
+        close();
+        return false;
+    }
+    std::memcpy(&header_, mapped_.data(), sizeof(header_));
+
+    if (header_.magic != FILE_MANIFEST_MAGIC_V2 || header_.version != FILE_MANIFEST_V2_VERSION) {
+        lastError_ = "Invalid checksum file format";
+        close();
+        return false;
+    }
+    if (header_.headerCrc != headerChecksum(header_)) {
+        lastError_ = "Checksum file header is damaged: " + manifestPath;
+        close();
+        return false;
+    }
+
+    // 所有段都必须落在映射范围内，之后的访问不再逐次检查文件头
+    uint64_t expectedRestarts = header_.restartInterval
+        ? (header_.fileCount + header_.restartInterval - 1) / header_.restartInterval : 0;
+    bool valid = header_.fileSize == size &&
+                 header_.restartInterval > 0 &&
+                 header_.directoryPathOffset <= size &&
+                 header_.directoryPathLength <= size - header_.directoryPathOffset &&
+                 header_.recordOffset <= size &&
+                 header_.fileCount <= (size - header_.recordOffset) / sizeof(FileManifestRecord) &&
+                 header_.pathTableOffset <= size &&
+                 header_.pathTableSize <= size - header_.pathTableOffset &&
+                 header_.indexCount == expectedRestarts &&
+                 header_.indexOffset <= size &&
+                 header_.indexCount <= (size - header_.indexOffset) / sizeof(uint64_t);
+    if (!valid) {
+        lastError_ = "Checksum file is truncated or inconsistent: " + manifestPath;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void FileManifestView::close() {
+    mapped_.close();
+    header_ = FileManifestV2Header();
+}
+
+std::string FileManifestView::directoryPath() const {
+    if (!isOpen()) {
+        return std::string();
+    }
+    return std::string(reinterpret_cast<const char*>(mapped_.data() + header_.directoryPathOffset),
+                       static_cast<size_t>(header_.directoryPathLength));
+}
+
+FileManifestRecord FileManifestView::recordAt(uint64_t index) const {
+    FileManifestRecord record;
+    std::memcpy(&record, mapped_.data() + header_.recordOffset + index * sizeof(FileManifestRecord), sizeof(record));
+    return record;
+}
+
+uint64_t FileManifestView::restartOffset(uint64_t restart) const {
+    uint64_t offset;
+    std::memcpy(&offset, mapped_.data() + header_.indexOffset + restart * sizeof(uint64_t), sizeof(offset));
+    return offset;
+}
+
+bool FileManifestView::decodeEntry(uint64_t& offset, uint64_t& sharedLength,
+                                   const char*& suffix, uint64_t& suffixLength) const {
+    const uint8_t* table = mapped_.data() + header_.pathTableOffset;
+    uint64_t end = header_.pathTableSize;
+
+    if (!readVarint(table, end, offset, sharedLength) ||
+        !readVarint(table, end, offset, suffixLength) ||
+        suffixLength > end - offset) {
+        lastError_ = "Checksum file path table is damaged";
+        return false;
+    }
+
+    suffix = reinterpret_cast<const char*>(table + offset);
+    offset += suffixLength;
+    return true;
+}
+
+bool FileManifestView::find(const std::string& filePath, FileChecksum& checksum) const {
+    if (!isOpen()) {
+        lastError_ = "Checksum file is not open";
+        return false;
+    }
+
+    // 找到最后一个完整路径 <= filePath 的重启点
+    uint64_t low = 0;
+    uint64_t high = header_.indexCount;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        uint64_t offset = restartOffset(middle);
+        uint64_t shared, length;
+        const char* suffix;
+        if (!decodeEntry(offset, shared, suffix, length)) {
+            return false;
+        }
+        if (shared != 0) {
+            lastError_ = "Checksum file path index is damaged";
+            return false;
+        }
+
+        if (filePath.compare(0, std::string::npos, suffix, static_cast<size_t>(length)) >= 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low > 0) {
+        uint64_t restart = low - 1;
+        uint64_t offset = restartOffset(restart);
+        uint64_t first = restart * header_.restartInterval;
+        uint64_t last = std::min(header_.fileCount, first + header_.restartInterval);
+        std::string current;
+
+        for (uint64_t index = first; index < last; ++index) {
+            uint64_t shared, length;
+            const char* suffix;
+            if (!decodeEntry(offset, shared, suffix, length)) {
+                return false;
+            }
+            if (shared > current.size()) {
+                lastError_ = "Checksum file path table is damaged";
+                return false;
+            }
+            current.resize(static_cast<size_t>(shared));
+            current.append(suffix, static_cast<size_t>(length));
+
+            int order = current.compare(filePath);
+            if (order == 0) {
+                FileManifestRecord record = recordAt(index);
+                checksum.filePath = current;
+                checksum.fileSize = record.fileSize;
+                checksum.crc32 = record.crc32;
+                checksum.timestamp = record.timestamp;
+                checksum.lastModified = record.lastModified;
+                return true;
+            }
+            if (order > 0) {
+                break;
+            }
+        }
+    }
+
+    lastError_ = "File not found in checksum file: " + filePath;
+    return false;
+}
+
+bool FileManifestView::forEach(const std::function<bool(const std::string&, const FileManifestRecord&)>& visitor) const {
+    if (!isOpen()) {
+        lastError_ = "Checksum file is not open";
+        return false;
+    }
+
+    uint64_t offset = 0;
+    std::string current;
+    for (uint64_t index = 0; index < header_.fileCount; ++index) {
+        uint64_t shared, length;
+        const char* suffix;
+        if (!decodeEntry(offset, shared, suffix, length)) {
+            return false;
+        }
+        if (shared > current.size()) {
+            lastError_ = "Checksum file path table is damaged";
+            return false;
+        }
+        current.resize(static_cast<size_t>(shared));
+        current.append(suffix, static_cast<size_t>(length));
+
+        if (!visitor(current, recordAt(index))) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool FileManifestView::loadAll(DirectoryChecksum& checksum) const {
+    checksum.directoryPath = directoryPath();
+    checksum.totalSize = header_.totalSize;
+    checksum.directoryCRC = header_.directoryCRC;
+    checksum.timestamp = header_.timestamp;
+    checksum.fileChecksums.clear();
+    checksum.fileChecksums.reserve(static_cast<size_t>(header_.fileCount));
+
+    return forEach([&checksum](const std::string& path, const FileManifestRecord& record) {
+        checksum.fileChecksums.push_back(FileChecksum{path, record.fileSize, record.crc32,
+                                                      record.timestamp, record.lastModified});
+        return true;
+    });
+}
+
+bool FileManifestView::isV2Manifest(const std::string& manifestPath) {
+    std::ifstream file(manifestPath, std::ios::binary);
+    uint32_t magic = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    return file && magic == FILE_MANIFEST_MAGIC_V2;
+}
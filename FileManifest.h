@@ -0,0 +1,104 @@
+#ifndef FILE_MANIFEST_H
+#define FILE_MANIFEST_H
+
+#include "FileSystemCRC.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+// 文件校验清单格式
+static constexpr uint32_t FILE_MANIFEST_MAGIC_V1 = 0x46534352;    // "FSCR"，路径按长度前缀内联存储
+static constexpr uint32_t FILE_MANIFEST_MAGIC_V2 = 0x46534332;    // "FSC2"，索引化、可内存映射
+static constexpr uint32_t FILE_MANIFEST_V2_VERSION = 2;
+static constexpr uint32_t FILE_MANIFEST_RESTART_INTERVAL = 16;    // 每16条路径存一次完整路径
+
+// FSCR v2 布局（小端，各段8字节对齐）:
+//   文件头 | 目录路径 | 定长记录数组 | 路径表 | 重启点索引
+// 路径按字节序排序并去重，记录 i 与路径表第 i 条一一对应。
+// 路径表采用前缀压缩: 每条为 varint(共享前缀长度) + varint(后缀长度) + 后缀；
+// 每 FILE_MANIFEST_RESTART_INTERVAL 条为一个重启点，存完整路径，
+// 重启点索引保存其在路径表中的偏移，用于二分查找。
+struct FileManifestV2Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t fileCount;
+    uint64_t totalSize;
+    uint64_t timestamp;
+    uint64_t directoryPathOffset;
+    uint64_t directoryPathLength;
+    uint64_t recordOffset;
+    uint64_t pathTableOffset;
+    uint64_t pathTableSize;
+    uint64_t indexOffset;
+    uint64_t indexCount;
+    uint64_t fileSize;          // 整个清单文件的长度，用于检测截断
+    uint32_t directoryCRC;
+    uint32_t restartInterval;
+    uint32_t flags;
+    uint32_t headerCrc;         // 覆盖之前的所有字段
+};
+
+// 定长文件记录
+struct FileManifestRecord {
+    uint64_t fileSize;
+    uint64_t timestamp;
+    uint64_t lastModified;
+    uint32_t crc32;
+    uint32_t reserved;
+};
+
+// FSCR v2 写入器
+class FileManifestWriter {
+public:
+    bool write(const std::string& manifestPath, const DirectoryChecksum& checksum);
+
+    std::string getLastError() const { return lastError_; }
+
+private:
+    std::string lastError_;
+};
+
+// FSCR v2 只读视图：映射整个清单，不为每个文件分配字符串
+class FileManifestView {
+public:
+    FileManifestView();
+
+    bool open(const std::string& manifestPath);
+    void close();
+    bool isOpen() const { return mapped_.isOpen(); }
+
+    uint64_t fileCount() const { return header_.fileCount; }
+    uint64_t totalSize() const { return header_.totalSize; }
+    uint32_t directoryCRC() const { return header_.directoryCRC; }
+    uint64_t timestamp() const { return header_.timestamp; }
+    std::string directoryPath() const;
+
+    // 二分查找单个文件，只解码一个重启点区间
+    bool find(const std::string& filePath, FileChecksum& checksum) const;
+
+    // 按路径顺序遍历所有记录，回调返回 false 时停止
+    bool forEach(const std::function<bool(const std::string&, const FileManifestRecord&)>& visitor) const;
+
+    // 展开为 DirectoryChecksum（兼容旧接口）
+    bool loadAll(DirectoryChecksum& checksum) const;
+
+    std::string getLastError() const { return lastError_; }
+
+    // 读取前4字节判断是否为 v2 清单
+    static bool isV2Manifest(const std::string& manifestPath);
+
+private:
+    MappedFile mapped_;
+    FileManifestV2Header header_;
+    mutable std::string lastError_;
+
+    FileManifestRecord recordAt(uint64_t index) const;
+    uint64_t restartOffset(uint64_t restart) const;
+
+    // 解码 offset 处的一条路径，返回共享前缀长度和后缀；越界时返回 false
+    bool decodeEntry(uint64_t& offset, uint64_t& sharedLength, const char*& suffix, uint64_t& suffixLength) const;
+};
+
+#endif // FILE_MANIFEST_H
@@ -1,4 +1,6 @@
 #include "FileSystemCRC.h"
+#include "FileManifest.h"
+#include "WorkStealingPool.h"
 #include <iostream>
 #include <fstream>
 #include <thread>
@@ -391,43 +393,21 @@ bool FileSystemCRC::generateDirectoryChecksumsParallel(const std::string& direct
             return true;
         }
         
-        // 分割文件列表给各个线程
-        std::vector<std::thread> threads;
-        std::vector<std::vector<FileChecksum>> threadResults(threadCount);
+        // 文件大小差异很大，每个文件单独作为一个任务交给共享线程池，空闲线程动态领取
+        std::vector<FileChecksum> results(files.size());
+        std::vector<uint8_t> generated(files.size(), 0);
         std::atomic<uint64_t> processedCount(0);
         
-        size_t filesPerThread = files.size() / threadCount;
-        size_t remainingFiles = files.size() % threadCount;
+        WorkStealingPool::instance().parallelFor(0, files.size(), 1, threadCount,
+            [&](uint64_t first, uint64_t last) {
+                fileChecksumWorker(files, first, last, results, generated, processedCount, progressCallback);
+            });
         
-        size_t currentIndex = 0;
-        for (int i = 0; i < threadCount; ++i) {
-            size_t threadFileCount = filesPerThread;
-            if (i < remainingFiles) {
-                threadFileCount++;
-            }
-            
-            std::vector<fs::path> threadFiles(
-                files.begin() + currentIndex,
-                files.begin() + currentIndex + threadFileCount
-            );
-            
-            threads.emplace_back(&FileSystemCRC::fileChecksumWorker, this,
-                               threadFiles, std::ref(threadResults[i]),
-                               std::ref(processedCount), progressCallback);
-            
-            currentIndex += threadFileCount;
-        }
-        
-        // 等待所有线程完成
-        for (auto& thread : threads) {
-            thread.join();
-        }
-        
-        // 合并结果
-        for (const auto& result : threadResults) {
-            for (const auto& fileChecksum : result) {
-                checksum.fileChecksums.push_back(fileChecksum);
-                checksum.totalSize += fileChecksum.fileSize;
+        // 按扫描顺序合并结果
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (generated[i]) {
+                checksum.fileChecksums.push_back(results[i]);
+                checksum.totalSize += results[i].fileSize;
             }
         }
         
@@ -459,80 +439,27 @@ bool FileSystemCRC::verifyDirectoryIntegrityParallel(const DirectoryChecksum& ch
         return true;
     }
     
-    std::vector<std::thread> threads;
     std::atomic<uint64_t> corruptedCount(0);
     std::atomic<uint64_t> processedCount(0);
     
-    // 分割校验和列表给各个线程
-    size_t checksumsPerThread = checksum.fileChecksums.size() / threadCount;
-    size_t remainingChecksums = checksum.fileChecksums.size() % threadCount;
-    
-    size_t currentIndex = 0;
-    for (int i = 0; i < threadCount; ++i) {
-        size_t threadChecksumCount = checksumsPerThread;
-        if (i < remainingChecksums) {
-            threadChecksumCount++;
-        }
-        
-        std::vector<FileChecksum> threadChecksums(
-            checksum.fileChecksums.begin() + currentIndex,
-            checksum.fileChecksums.begin() + currentIndex + threadChecksumCount
-        );
-        
-        threads.emplace_back(&FileSystemCRC::fileVerificationWorker, this,
-                           threadChecksums, std::ref(corruptedCount),
-                           std::ref(processedCount), progressCallback);
-        
-        currentIndex += threadChecksumCount;
-    }
-    
-    // 等待所有线程完成
-    for (auto& thread : threads) {
-        thread.join();
-    }
+    // 每个文件一个任务，交给共享线程池
+    WorkStealingPool::instance().parallelFor(0, checksum.fileChecksums.size(), 1, threadCount,
+        [&](uint64_t first, uint64_t last) {
+            fileVerificationWorker(checksum.fileChecksums, first, last, corruptedCount, processedCount, progressCallback);
+        });
     
     return corruptedCount == 0 && !isOperationCancelled();
 }
 
 // 文件操作
 bool FileSystemCRC::saveChecksumsToFile(const std::string& filePath, const DirectoryChecksum& checksum) {
-    std::ofstream outFile(filePath, std::ios::binary);
-    if (!outFile.is_open()) {
-        setLastError("Cannot create output file: " + filePath);
-        return false;
-    }
-    
+    // 写入 FSCR v2：路径表去重并前缀压缩，定长记录，可按路径二分查找
     try {
-        // 写入文件头
-        uint32_t magic = 0x46534352; // "FSCR"
-        outFile.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
-        
-        // 写入目录信息
-        uint32_t pathLength = checksum.directoryPath.length();
-        outFile.write(reinterpret_cast<const char*>(&pathLength), sizeof(pathLength));
-        outFile.write(checksum.directoryPath.c_str(), pathLength);
-        
-        outFile.write(reinterpret_cast<const char*>(&checksum.totalSize), sizeof(checksum.totalSize));
-        outFile.write(reinterpret_cast<const char*>(&checksum.directoryCRC), sizeof(checksum.directoryCRC));
-        outFile.write(reinterpret_cast<const char*>(&checksum.timestamp), sizeof(checksum.timestamp));
-        
-        // 写入文件数量
-        uint32_t fileCount = checksum.fileChecksums.size();
-        outFile.write(reinterpret_cast<const char*>(&fileCount), sizeof(fileCount));
-        
-        // 写入每个文件的校验和
-        for (const auto& fileChecksum : checksum.fileChecksums) {
-            uint32_t filePathLength = fileChecksum.filePath.length();
-            outFile.write(reinterpret_cast<const char*>(&filePathLength), sizeof(filePathLength));
-            outFile.write(fileChecksum.filePath.c_str(), filePathLength);
-            
-            outFile.write(reinterpret_cast<const char*>(&fileChecksum.fileSize), sizeof(fileChecksum.fileSize));
-            outFile.write(reinterpret_cast<const char*>(&fileChecksum.crc32), sizeof(fileChecksum.crc32));
-            outFile.write(reinterpret_cast<const char*>(&fileChecksum.timestamp), sizeof(fileChecksum.timestamp));
-            outFile.write(reinterpret_cast<const char*>(&fileChecksum.lastModified), sizeof(fileChecksum.lastModified));
+        FileManifestWriter writer;
+        if (!writer.write(filePath, checksum)) {
+            setLastError(writer.getLastError());
+            return false;
         }
-        
-        outFile.close();
         return true;
     } catch (const std::exception& e) {
         setLastError("Error writing checksum file: " + std::string(e.what()));
@@ -541,6 +468,21 @@ bool FileSystemCRC::saveChecksumsToFile(const std::string& filePath, const Direc
 }
 
 bool FileSystemCRC::loadChecksumsFromFile(const std::string& filePath, DirectoryChecksum& checksum) {
+    if (FileManifestView::isV2Manifest(filePath)) {
+        try {
+            FileManifestView view;
+            if (!view.open(filePath) || !view.loadAll(checksum)) {
+                setLastError(view.getLastError());
+                return false;
+            }
+            return true;
+        } catch (const std::exception& e) {
+            setLastError("Error reading checksum file: " + std::string(e.what()));
+            return false;
+        }
+    }
+    
+    // 旧版 FSCR v1：长度前缀路径内联存储
     std::ifstream inFile(filePath, std::ios::binary);
     if (!inFile.is_open()) {
         setLastError("Cannot open checksum file: " + filePath);
@@ -551,7 +493,7 @@ bool FileSystemCRC::loadChecksumsFromFile(const std::string& filePath, Directory
         // 读取文件头
         uint32_t magic;
         inFile.read(reinterpret_cast<char*>(&magic), sizeof(magic));
-        if (magic != 0x46534352) {
+        if (magic != FILE_MANIFEST_MAGIC_V1) {
             setLastError("Invalid checksum file format");
             inFile.close();
             return false;
@@ -593,6 +535,32 @@ bool FileSystemCRC::loadChecksumsFromFile(const std::string& filePath, Directory
     }
 }
 
+bool FileSystemCRC::findChecksumInFile(const std::string& manifestPath, const std::string& filePath,
+                                       FileChecksum& checksum) {
+    if (FileManifestView::isV2Manifest(manifestPath)) {
+        FileManifestView view;
+        if (!view.open(manifestPath) || !view.find(filePath, checksum)) {
+            setLastError(view.getLastError());
+            return false;
+        }
+        return true;
+    }
+    
+    // v1 没有索引，只能加载后线性查找
+    DirectoryChecksum dirChecksum;
+    if (!loadChecksumsFromFile(manifestPath, dirChecksum)) {
+        return false;
+    }
+    for (const auto& fileChecksum : dirChecksum.fileChecksums) {
+        if (fileChecksum.filePath == filePath) {
+            checksum = fileChecksum;
+            return true;
+        }
+    }
+    setLastError("File not found in checksum file: " + filePath);
+    return false;
+}
+
 bool FileSystemCRC::savePartitionChecksumsToFile(const std::string& filePath, const PartitionChecksum& checksum) {
     // 简化的实现：保存为多个目录校验文件
     // 实际实现可以更复杂，保存整个分区的结构
@@ -770,18 +738,18 @@ bool FileSystemCRC::readFileData(const fs::path& filePath, std::vector<uint8_t>&
 }
 
 // 工作线程函数
-void FileSystemCRC::fileChecksumWorker(const std::vector<fs::path>& files, 
-                                      std::vector<FileChecksum>& results,
+void FileSystemCRC::fileChecksumWorker(const std::vector<fs::path>& files, size_t first, size_t last,
+                                      std::vector<FileChecksum>& results, std::vector<uint8_t>& generated,
                                       std::atomic<uint64_t>& processedCount,
                                       std::function<void(int, int, const std::string&)> progressCallback) {
-    for (const auto& file : files) {
+    for (size_t i = first; i < last; ++i) {
         if (isOperationCancelled()) {
             break;
         }
         
-        FileChecksum checksum;
-        if (generateFileChecksum(file.string(), checksum)) {
-            results.push_back(checksum);
+        const auto& file = files[i];
+        if (generateFileChecksum(file.string(), results[i])) {
+            generated[i] = 1;
         }
         
         uint64_t processed = ++processedCount;
@@ -791,15 +759,17 @@ void FileSystemCRC::fileChecksumWorker(const std::vector<fs::path>& files,
     }
 }
 
-void FileSystemCRC::fileVerificationWorker(const std::vector<FileChecksum>& checksums,
+void FileSystemCRC::fileVerificationWorker(const std::vector<FileChecksum>& checksums, size_t first, size_t last,
                                           std::atomic<uint64_t>& corruptedCount,
                                           std::atomic<uint64_t>& processedCount,
                                           std::function<void(int, int, const std::string&)> progressCallback) {
-    for (const auto& checksum : checksums) {
+    for (size_t i = first; i < last; ++i) {
         if (isOperationCancelled()) {
             break;
         }
         
+        const auto& checksum = checksums[i];
+        
         if (!verifyFileIntegrity(checksum)) {
             corruptedCount++;
         }
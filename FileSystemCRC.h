@@ -79,6 +79,8 @@ public:
     // 文件操作
     bool saveChecksumsToFile(const std::string& filePath, const DirectoryChecksum& checksum);
     bool loadChecksumsFromFile(const std::string& filePath, DirectoryChecksum& checksum);
+    // 在校验文件中查找单个文件（v2 格式走内存映射二分查找，无需加载整个清单）
+    bool findChecksumInFile(const std::string& manifestPath, const std::string& filePath, FileChecksum& checksum);
     bool savePartitionChecksumsToFile(const std::string& filePath, const PartitionChecksum& checksum);
     bool loadPartitionChecksumsFromFile(const std::string& filePath, PartitionChecksum& checksum);
     
@@ -106,13 +108,13 @@ private:
     uint32_t calculateCRC32ForFile(const fs::path& filePath);
     bool readFileData(const fs::path& filePath, std::vector<uint8_t>& data);
     
-    // 工作线程函数
-    void fileChecksumWorker(const std::vector<fs::path>& files, 
-                           std::vector<FileChecksum>& results,
+    // 工作线程函数，处理files/checksums中[first, last)范围内的条目
+    void fileChecksumWorker(const std::vector<fs::path>& files, size_t first, size_t last,
+                           std::vector<FileChecksum>& results, std::vector<uint8_t>& generated,
                            std::atomic<uint64_t>& processedCount,
                            std::function<void(int, int, const std::string&)> progressCallback);
     
-    void fileVerificationWorker(const std::vector<FileChecksum>& checksums,
+    void fileVerificationWorker(const std::vector<FileChecksum>& checksums, size_t first, size_t last,
                                std::atomic<uint64_t>& corruptedCount,
                                std::atomic<uint64_t>& processedCount,
                                std::function<void(int, int, const std::string&)> progressCallback);
@@ -8,11 +8,13 @@
 #include <algorithm>
 #include <thread>
 #include <atomic>
-#include <queue>
-#include <mutex>
-#include <condition_variable>
 #include <iomanip>
 #include <conio.h>
+#include "ConcurrentRing.h"
+#include "SectorExtent.h"
+#include "AdaptiveConcurrency.h"
+#include "CpuTopology.h"
+#include "BadBlockMap.h"
 
 class FinalUltimateOptimizedCRC {
 private:
@@ -20,26 +22,52 @@ private:
     HANDLE hDisk_;
     uint32_t SECTOR_SIZE;
     const uint64_t MEMORY_CACHE_SIZE = 2ULL * 1024 * 1024 * 1024; // 2GB内存缓存
+    static constexpr uint64_t READ_BUFFER_SECTORS = 8192; // 32MB读取缓冲区
+    static constexpr uint32_t EXTENT_SECTORS = EXTENT_MAX_SECTORS; // 每个CRC任务最多覆盖的扇区数
+    static constexpr uint32_t MIN_EXTENT_SECTORS = 32;    // 自适应调整时extent的下限
+    static constexpr size_t MAX_READS_IN_FLIGHT = 4;      // 同时在途的重叠读取数上限
+    static constexpr size_t READ_BUFFER_POOL_SIZE = MAX_READS_IN_FLIGHT + 2; // 读取缓冲区数量：在途读取加正在计算的缓冲区
+    static constexpr DWORD READ_TIMEOUT_MS = 30000;       // 单次读取从开始等待起的截止时间
+    static constexpr DWORD CANCEL_POLL_MS = 100;          // 等待期间检查用户取消的间隔
     
     // 并行处理相关
     std::atomic<bool> stopProcessing_;
     std::atomic<bool> userCancelled_;
-    std::queue<std::pair<uint64_t, std::vector<uint8_t>>> dataQueue_;
-    std::queue<std::pair<uint64_t, uint32_t>> resultQueue_;
-    std::mutex dataMutex_;
-    std::mutex resultMutex_;
-    std::condition_variable dataCV_;
-    std::condition_variable resultCV_;
+    // 有界无锁环形队列：结果队列容量必须不小于所有读取缓冲区按最小extent切分后的extent总数，
+    // 这样主线程在阻塞前先取走结果后，CRC线程就不会因结果队列满而占住缓冲区互相等待
+    BlockingRing<SectorExtent> dataRing_;
+    BlockingRing<ExtentChecksums> resultRing_;
+    
+    // 自适应并发：编号不小于activeHashers_的CRC线程挂起在hasherGate_上
+    std::atomic<int> activeHashers_;
+    std::atomic<uint64_t> hasherBusyNanos_;   // 所有CRC线程累计的计算时间
+    RingEventCount hasherGate_;
+    ConcurrencySettings tunedSettings_;
+    
+    // 一个重叠读取槽位：读取完成前缓冲区一直由槽位持有，内核正在写入它
+    struct PendingRead {
+        BufferLease buffer;
+        OVERLAPPED overlapped;
+        HANDLE event = NULL;
+        uint64_t firstSector = 0;   // 相对于起始扇区
+        uint64_t sectorCount = 0;
+        bool active = false;
+        bool rescue = false;        // 与已知坏块重叠：不发起重叠读取，轮到它时同步抢救
+    };
     
 public:
     FinalUltimateOptimizedCRC(const std::string& diskPath, uint32_t sectorSize = 4096) 
         : diskPath_(diskPath), hDisk_(INVALID_HANDLE_VALUE), SECTOR_SIZE(sectorSize), 
-          stopProcessing_(false), userCancelled_(false) {}
+          stopProcessing_(false), userCancelled_(false),
+          dataRing_(2 * READ_BUFFER_SECTORS / EXTENT_SECTORS),
+          resultRing_(READ_BUFFER_POOL_SIZE * READ_BUFFER_SECTORS / MIN_EXTENT_SECTORS),
+          activeHashers_(0), hasherBusyNanos_(0) {}
     
     ~FinalUltimateOptimizedCRC() {
         stopProcessing_ = true;
-        dataCV_.notify_all();
-        resultCV_.notify_all();
+        dataRing_.close();
+        resultRing_.close();
+        hasherGate_.notifyAll();
         
         if (hDisk_ != INVALID_HANDLE_VALUE) {
             CloseHandle(hDisk_);
@@ -49,15 +77,29 @@ public:
     void setUserCancelled() {
         userCancelled_ = true;
         stopProcessing_ = true;
+        dataRing_.close();
+        resultRing_.close();
+        hasherGate_.notifyAll();
+    }
+    
+    // 最近一次生成操作由自适应控制器选定的并发设置
+    ConcurrencySettings getTunedSettings() const {
+        return tunedSettings_;
     }
     
     bool isUserCancelled() {
         return userCancelled_;
     }
     
-    bool openDisk() {
+    bool openDisk(DWORD flagsAndAttributes = FILE_ATTRIBUTE_NORMAL) {
         std::cout << "Attempting to open disk: " << diskPath_ << std::endl;
         
+        // 不同操作需要不同的打开方式（同步或重叠I/O），先关闭已打开的句柄
+        if (hDisk_ != INVALID_HANDLE_VALUE) {
+            CloseHandle(hDisk_);
+            hDisk_ = INVALID_HANDLE_VALUE;
+        }
+        
         // 尝试不同的磁盘路径格式
         std::vector<std::string> pathVariations = {
             diskPath_,
@@ -75,7 +117,7 @@ public:
                                 FILE_SHARE_READ | FILE_SHARE_WRITE,
                                 NULL,
                                 OPEN_EXISTING,
-                                FILE_ATTRIBUTE_NORMAL,
+                                flagsAndAttributes,
                                 NULL);
             
             if (hDisk_ != INVALID_HANDLE_VALUE) {
@@ -94,6 +136,10 @@ public:
     
     // 优化的CRC32计算
     uint32_t calculateCRC32(const std::vector<uint8_t>& data) {
+        return calculateCRC32(data.data(), data.size());
+    }
+    
+    uint32_t calculateCRC32(const uint8_t* data, size_t length) {
         uint32_t crc = 0xFFFFFFFF;
         static const uint32_t crc_table[256] = {
             0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F,
@@ -141,43 +187,188 @@ public:
             0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
         };
         
-        for (uint8_t byte : data) {
-            crc = (crc >> 8) ^ crc_table[(crc ^ byte) & 0xFF];
+        for (size_t i = 0; i < length; ++i) {
+            crc = (crc >> 8) ^ crc_table[(crc ^ data[i]) & 0xFF];
         }
         
         return crc ^ 0xFFFFFFFF;
     }
     
-    // CRC计算线程
-    void crcWorkerThread() {
-        while (!stopProcessing_) {
-            std::pair<uint64_t, std::vector<uint8_t>> dataPair;
-            bool hasData = false;
-            
-            {
-                std::unique_lock<std::mutex> lock(dataMutex_);
-                dataCV_.wait(lock, [this]() { return !dataQueue_.empty() || stopProcessing_; });
-                
-                if (stopProcessing_ && dataQueue_.empty()) {
-                    return;
-                }
-                
-                if (!dataQueue_.empty()) {
-                    dataPair = std::move(dataQueue_.front());
-                    dataQueue_.pop();
-                    hasData = true;
+    // CRC计算线程：每个extent算出一段连续的CRC数组；数据队列关闭并取空后pop返回false
+    void crcWorkerThread(int index, CpuSet cpus) {
+        CpuTopology::pinCurrentThread(cpus);
+        
+        SectorExtent extent;
+        for (;;) {
+            // 超出当前活动数量的线程挂起，直到控制器增加计算线程或数据队列关闭
+            while (index >= activeHashers_.load() && !dataRing_.isClosed()) {
+                uint64_t key = hasherGate_.prepareWait();
+                if (index >= activeHashers_.load() && !dataRing_.isClosed()) {
+                    hasherGate_.wait(key);
+                } else {
+                    hasherGate_.cancelWait();
                 }
             }
             
-            if (hasData) {
-                uint32_t crc = calculateCRC32(dataPair.second);
-                
-                {
-                    std::lock_guard<std::mutex> lock(resultMutex_);
-                    resultQueue_.push({dataPair.first, crc});
-                }
-                resultCV_.notify_one();
+            if (!dataRing_.pop(extent)) {
+                break;
+            }
+            if (userCancelled_) {
+                continue; // 丢弃剩余的extent，把缓冲区归还给缓冲池
+            }
+            
+            auto busyStart = std::chrono::steady_clock::now();
+            ExtentChecksums checksums;
+            checksums.startSector = extent.startSector;
+            checksums.count = extent.sectorCount;
+            for (uint32_t i = 0; i < extent.sectorCount; ++i) {
+                checksums.crcs[i] = calculateCRC32(extent.sector(i), extent.sectorSize);
+            }
+            extent.buffer.reset(); // 最后一个extent处理完后读取缓冲区即被释放
+            hasherBusyNanos_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - busyStart).count();
+            
+            if (!resultRing_.push(std::move(checksums))) {
+                continue; // 用户取消，继续取空数据队列以归还缓冲区
+            }
+        }
+    }
+    
+    // 写出结果队列中所有已完成的extent，不阻塞
+    void drainResults(std::ofstream& outFile, uint64_t& sectorsWritten) {
+        ExtentChecksums done;
+        while (resultRing_.tryPop(done)) {
+            writeExtentChecksums(outFile, done);
+            sectorsWritten += done.count;
+        }
+    }
+    
+    // 在槽位上发起一次重叠读取；立即完成和ERROR_IO_PENDING都算成功。
+    // 发起失败时缓冲区留在槽位上，调用方改走同步抢救
+    bool issueRead(PendingRead& read, BufferLease buffer, uint64_t startSector,
+                   uint64_t firstSector, uint64_t sectorCount) {
+        uint64_t byteOffset = (startSector + firstSector) * SECTOR_SIZE;
+        
+        read.buffer = std::move(buffer);
+        read.firstSector = firstSector;
+        read.sectorCount = sectorCount;
+        read.overlapped = OVERLAPPED();
+        read.overlapped.Offset = static_cast<DWORD>(byteOffset);
+        read.overlapped.OffsetHigh = static_cast<DWORD>(byteOffset >> 32);
+        read.overlapped.hEvent = read.event;
+        
+        if (!ReadFile(hDisk_, read.buffer.data(), static_cast<DWORD>(sectorCount * SECTOR_SIZE),
+                      NULL, &read.overlapped) && GetLastError() != ERROR_IO_PENDING) {
+            return false;
+        }
+        read.active = true;
+        return true;
+    }
+    
+    // 在重叠句柄上同步读取连续扇区，同样受截止时间限制
+    bool readSync(uint64_t sector, uint64_t count, uint8_t* buffer, bool& timedOut) {
+        timedOut = false;
+        uint64_t byteOffset = sector * SECTOR_SIZE;
+        OVERLAPPED overlapped = OVERLAPPED();
+        overlapped.Offset = static_cast<DWORD>(byteOffset);
+        overlapped.OffsetHigh = static_cast<DWORD>(byteOffset >> 32);
+        overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+        if (overlapped.hEvent == NULL) {
+            return false;
+        }
+        
+        DWORD bytesRead = 0;
+        bool ok = (ReadFile(hDisk_, buffer, static_cast<DWORD>(count * SECTOR_SIZE), NULL, &overlapped) ||
+                   GetLastError() == ERROR_IO_PENDING) &&
+                  waitForRead(overlapped, bytesRead, timedOut) && bytesRead == count * SECTOR_SIZE;
+        CloseHandle(overlapped.hEvent);
+        return ok;
+    }
+    
+    // 分段等待一个重叠读取，期间检查用户取消；超过截止时间或取消时用CancelIoEx撤销这一个读取，
+    // 并等它真正结束（缓冲区此后才能复用）
+    bool waitForRead(OVERLAPPED& overlapped, DWORD& bytesRead, bool& timedOut) {
+        timedOut = false;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(READ_TIMEOUT_MS);
+        while (WaitForSingleObject(overlapped.hEvent, CANCEL_POLL_MS) != WAIT_OBJECT_0) {
+            if (isUserCancelled() || std::chrono::steady_clock::now() >= deadline) {
+                timedOut = !isUserCancelled();
+                CancelIoEx(hDisk_, &overlapped);
+                break;
+            }
+        }
+        return GetOverlappedResult(hDisk_, &overlapped, &bytesRead, TRUE) != FALSE && !timedOut;
+    }
+    
+    // 整段读取失败或与已知坏块重叠时，按RescueScheduler的策略（大块读取、出错后指数跳过、
+    // 二分重读、逐扇区重试）把可读扇区重读到缓冲区的对应位置。返回可读的连续扇区段
+    // （相对于缓冲区起点的偏移和扇区数），不可读扇区记入badBlocks；用户取消时返回空
+    std::vector<std::pair<uint64_t, uint64_t>> rescueRange(uint64_t firstSector, uint64_t sectorCount, uint8_t* buffer,
+                                                           const BadBlockMap& knownBad, BadBlockMap& badBlocks) {
+        RescuePolicy policy;
+        policy.maxReadSectors = EXTENT_SECTORS;
+        RescueScheduler rescue(firstSector, firstSector + sectorCount, policy, &knownBad);
+        
+        uint64_t readStart;
+        uint32_t readCount;
+        while (!isUserCancelled() && rescue.next(readStart, readCount)) {
+            bool timedOut;
+            bool readOk = readSync(readStart, readCount, buffer + (readStart - firstSector) * SECTOR_SIZE, timedOut);
+            rescue.complete(readOk, timedOut);
+        }
+        
+        std::vector<std::pair<uint64_t, uint64_t>> runs;
+        if (isUserCancelled()) {
+            return runs;
+        }
+        
+        // 可读扇区段即坏块区域之间的部分
+        uint64_t runStart = firstSector;
+        for (const auto& range : rescue.badBlocks().ranges()) {
+            if (range.first > runStart) {
+                runs.emplace_back(runStart - firstSector, range.first - runStart);
+            }
+            runStart = range.first + range.second;
+        }
+        if (runStart < firstSector + sectorCount) {
+            runs.emplace_back(runStart - firstSector, firstSector + sectorCount - runStart);
+        }
+        badBlocks.merge(rescue.badBlocks());
+        return runs;
+    }
+    
+    // 等待槽位上的读取完成；超时的读取被撤销并按失败处理，随后走抢救路径
+    bool completeRead(PendingRead& read, DWORD& bytesRead) {
+        read.active = false;
+        bool timedOut;
+        bool ok = waitForRead(read.overlapped, bytesRead, timedOut);
+        if (timedOut) {
+            uint64_t sector = ((static_cast<uint64_t>(read.overlapped.OffsetHigh) << 32) | read.overlapped.Offset) /
+                              SECTOR_SIZE;
+            std::cout << "[WARNING] Read at sector " << sector << " timed out after "
+                      << READ_TIMEOUT_MS << " ms" << std::endl;
+        }
+        return ok;
+    }
+    
+    // 撤销仍在途的读取；必须等它们真正结束后缓冲区才能归还缓冲池
+    void cancelPendingReads(PendingRead* reads, size_t count) {
+        CancelIoEx(hDisk_, NULL);
+        for (size_t i = 0; i < count; ++i) {
+            if (reads[i].active) {
+                DWORD bytesRead;
+                completeRead(reads[i], bytesRead);
             }
+            reads[i].buffer.reset();
+        }
+    }
+    
+    // 把一个extent的结果写成紧凑格式记录
+    void writeExtentChecksums(std::ofstream& outFile, const ExtentChecksums& checksums) {
+        for (uint32_t i = 0; i < checksums.count; ++i) {
+            uint64_t sectorNumber = checksums.startSector + i;
+            outFile.write(reinterpret_cast<const char*>(&sectorNumber), sizeof(uint64_t));
+            outFile.write(reinterpret_cast<const char*>(&checksums.crcs[i]), sizeof(uint32_t));
         }
     }
     
@@ -207,7 +398,8 @@ public:
         std::cout << "Press ESC to cancel operation at any time" << std::endl;
         std::cout << std::endl;
         
-        if (!openDisk()) {
+        // 以重叠I/O方式打开，读取由本线程发起、完成顺序由槽位轮转保证
+        if (!openDisk(FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED)) {
             std::cout << "[ERROR] Cannot open disk" << std::endl;
             return false;
         }
@@ -218,66 +410,217 @@ public:
             return false;
         }
         
-        // 启动CRC计算线程
-        unsigned int numThreads = std::thread::hardware_concurrency();
+        // CPU/NUMA放置（CRCRECOVER_PLACEMENT）：本线程分发数据并写出结果，属于写入阶段；
+        // 开启NUMA配对时CRC线程和读取缓冲区都放在本线程所在的节点上，扇区数据不跨节点
+        const ThreadPlacement& placement = ThreadPlacement::fromEnvironment();
+        const CpuTopology& topology = CpuTopology::instance();
+        CpuTopology::pinCurrentThread(placement.writer);
+        const NumaNode& localNode = topology.nodes()[topology.currentNodeIndex()];
+        bool numaLocal = placement.numaAware && topology.nodeCount() > 1;
+        if (numaLocal && placement.writer.empty()) {
+            CpuTopology::pinCurrentThread(localNode.cpus);
+        }
+        CpuSet hasherCpus = placement.stageCpus(placement.hashers, localNode);
+        
+        // 启动CRC计算线程；线程数按可用CPU数上限启动，实际参与计算的数量由自适应控制器决定
+        unsigned int numThreads = hasherCpus.empty() ? std::thread::hardware_concurrency()
+                                                     : static_cast<unsigned int>(hasherCpus.count());
         if (numThreads == 0) numThreads = 4; // 默认4个线程
-        std::cout << "[INFO] Using " << numThreads << " CRC calculation threads" << std::endl;
+        if (numaLocal) {
+            std::cout << "[INFO] NUMA node " << localNode.id << ", CRC threads on CPUs " << hasherCpus.toString() << std::endl;
+        }
         
+        // 从中间位置开始，按吞吐反馈调整在途读取数、extent大小和计算线程数，
+        // 小型虚拟机上不会过度订阅，多核主机上也不会闲置
+        ConcurrencySettings initialSettings;
+        initialSettings.readsInFlight = 2;
+        initialSettings.extentSectors = EXTENT_SECTORS / 2;
+        initialSettings.hasherCount = std::max(1, static_cast<int>(numThreads) / 2);
+        ConcurrencySettings minimumSettings;
+        minimumSettings.readsInFlight = 1;
+        minimumSettings.extentSectors = MIN_EXTENT_SECTORS;
+        minimumSettings.hasherCount = 1;
+        ConcurrencySettings maximumSettings;
+        maximumSettings.readsInFlight = static_cast<int>(MAX_READS_IN_FLIGHT);
+        maximumSettings.extentSectors = EXTENT_SECTORS;
+        maximumSettings.hasherCount = static_cast<int>(numThreads);
+        
+        AdaptiveConcurrencyController controller(initialSettings, minimumSettings, maximumSettings);
+        ConcurrencySettings settings = controller.settings();
+        
+        std::cout << "[INFO] Up to " << numThreads << " CRC calculation threads, starting with "
+                  << settings.toString() << std::endl;
+        
+        activeHashers_ = settings.hasherCount;
+        hasherBusyNanos_ = 0;
         std::vector<std::thread> crcThreads;
         for (unsigned int i = 0; i < numThreads; ++i) {
-            crcThreads.emplace_back(&FinalUltimateOptimizedCRC::crcWorkerThread, this);
+            crcThreads.emplace_back(&FinalUltimateOptimizedCRC::crcWorkerThread, this, static_cast<int>(i), hasherCpus);
         }
         
         // 启动键盘监听线程
         std::thread keyboardThread(&FinalUltimateOptimizedCRC::keyboardListenerThread, this);
         
+        // 坏块表：之前运行发现的不可读区域不再发起大块读取，本次新发现的区域运行结束后写回
+        std::string badBlockMapPath = outputFile + ".badblocks";
+        BadBlockMap knownBad;
+        BadBlockMap foundBad;
+        if (!knownBad.load(badBlockMapPath)) {
+            std::cout << "[WARNING] " << knownBad.getLastError() << ", ignoring it" << std::endl;
+        }
+        
         auto totalStart = std::chrono::high_resolution_clock::now();
         uint64_t processed = 0;
+        uint64_t dispatchedSectors = 0; // 已分发给CRC线程的扇区数，不含坏扇区
         uint64_t sectorsWritten = 0;
         
-        // 连续读取，不等待批次
-        const uint64_t READ_BUFFER_SECTORS = 8192; // 32MB读取缓冲区
-        std::vector<uint8_t> readBuffer(READ_BUFFER_SECTORS * SECTOR_SIZE);
-        
-        LARGE_INTEGER sectorOffset;
-        sectorOffset.QuadPart = startSector * SECTOR_SIZE;
+        // 多缓冲重叠读取：settings.readsInFlight个读取始终在途，一个缓冲区读完后立即补发读取，
+        // 再去切分和分发刚读完的数据，设备不会因为CRC分发或写出结果而空闲。
+        // 槽位按环形使用：head是最早发起的读取，其后inFlight个槽位依次在途。
+        // 读取缓冲区来自固定大小的对齐缓冲池，其所有extent处理完后自动归还，稳态下不再分配内存
+        BufferPool bufferPool(READ_BUFFER_POOL_SIZE, READ_BUFFER_SECTORS * SECTOR_SIZE, BUFFER_POOL_ALIGNMENT,
+                              numaLocal ? static_cast<int>(localNode.id) : -1);
         
-        if (!SetFilePointerEx(hDisk_, sectorOffset, NULL, FILE_BEGIN)) {
-            std::cout << "[ERROR] Cannot set file pointer" << std::endl;
-            return false;
+        PendingRead reads[MAX_READS_IN_FLIGHT];
+        for (auto& read : reads) {
+            read.event = CreateEventA(NULL, TRUE, FALSE, NULL);
         }
         
-        std::cout << "[INFO] Starting continuous read and parallel CRC calculation..." << std::endl;
+        uint64_t issued = 0; // 已发起读取的扇区数
         
-        while (processed < sectorCount && !isUserCancelled()) {
-            uint64_t sectorsToRead = std::min(READ_BUFFER_SECTORS, sectorCount - processed);
-            DWORD bytesRead;
+        size_t head = 0;
+        size_t inFlight = 0;
+        
+        // 在槽位上发起下一段读取；没有空闲缓冲区时先取走已完成的结果，再阻塞等待CRC线程归还
+        auto issueNextRead = [&](PendingRead& read) {
+            if (read.event == NULL) {
+                return false;
+            }
+            
+            BufferLease buffer = bufferPool.tryAcquire();
+            if (!buffer) {
+                drainResults(outFile, sectorsWritten);
+                buffer = bufferPool.acquire();
+            }
+            
+            uint64_t sectorsToRead = std::min(READ_BUFFER_SECTORS, sectorCount - issued);
+            uint64_t badStart, badCount;
+            read.rescue = knownBad.findNext(startSector + issued, badStart, badCount) &&
+                          badStart < startSector + issued + sectorsToRead;
+            if (read.rescue) {
+                read.buffer = std::move(buffer);
+                read.firstSector = issued;
+                read.sectorCount = sectorsToRead;
+            } else if (!issueRead(read, std::move(buffer), startSector, issued, sectorsToRead)) {
+                // 同步失败与异步失败一样处理：轮到这个槽位时同步抢救可读的扇区
+                std::cout << "[WARNING] Read failed at sector " << startSector + issued
+                          << ", rescuing readable sectors" << std::endl;
+                read.rescue = true;
+            }
+            issued += sectorsToRead;
+            return true;
+        };
+        
+        // 补足到当前设定的在途读取数；设定调低后已在途的读取照常完成，只是不再补发
+        auto fillReads = [&]() {
+            while (inFlight < static_cast<size_t>(settings.readsInFlight) && issued < sectorCount &&
+                   !isUserCancelled()) {
+                if (!issueNextRead(reads[(head + inFlight) % MAX_READS_IN_FLIGHT])) {
+                    std::cout << "[ERROR] Cannot start read at sector " << startSector + issued << std::endl;
+                    return false;
+                }
+                ++inFlight;
+            }
+            return true;
+        };
+        
+        std::cout << "[INFO] Starting overlapped read and parallel CRC calculation..." << std::endl;
+        
+        bool readFailed = !fillReads();
+        auto lastCompletion = std::chrono::high_resolution_clock::now();
+        
+        while (!readFailed && inFlight > 0 && !isUserCancelled()) {
+            PendingRead& read = reads[head];
+            DWORD bytesRead = 0;
+            bool rescue = read.rescue;
+            bool readOk = !rescue && completeRead(read, bytesRead) && bytesRead == read.sectorCount * SECTOR_SIZE;
+            head = (head + 1) % MAX_READS_IN_FLIGHT;
+            --inFlight;
             
-            auto readStart = std::chrono::high_resolution_clock::now();
+            BufferLease readBuffer = std::move(read.buffer);
+            uint64_t firstSector = read.firstSector;
+            uint64_t sectorsRead = read.sectorCount;
             
-            BOOL result = ReadFile(hDisk_, readBuffer.data(), sectorsToRead * SECTOR_SIZE, &bytesRead, NULL);
-            if (!result || bytesRead != sectorsToRead * SECTOR_SIZE) {
-                std::cout << "[ERROR] Read failed at sector " << processed << std::endl;
+            // 先补发读取，再处理刚读完的缓冲区
+            if (!fillReads()) {
+                readFailed = true;
                 break;
             }
             
+            // 读取失败不再中止整个操作：同步抢救这段缓冲区，只分发可读的扇区段
+            std::vector<std::pair<uint64_t, uint64_t>> runs;
+            if (readOk) {
+                runs.emplace_back(0, sectorsRead);
+            } else {
+                if (!rescue) {
+                    std::cout << "[WARNING] Read failed at sector " << startSector + firstSector
+                              << ", rescuing readable sectors" << std::endl;
+                }
+                uint64_t badBefore = foundBad.sectorCount();
+                runs = rescueRange(startSector + firstSector, sectorsRead, readBuffer.data(), knownBad, foundBad);
+                if (isUserCancelled()) {
+                    break;
+                }
+                if (foundBad.sectorCount() > badBefore) {
+                    std::cout << "[WARNING] " << foundBad.sectorCount() - badBefore << " unreadable sector(s) from sector "
+                              << startSector + firstSector << " skipped" << std::endl;
+                }
+            }
+            
+            // 读取在途重叠，按相邻两次完成的间隔计算设备吞吐
             auto readEnd = std::chrono::high_resolution_clock::now();
-            auto readDuration = std::chrono::duration_cast<std::chrono::milliseconds>(readEnd - readStart);
-            double readSpeed = ((sectorsToRead * SECTOR_SIZE) / (1024.0 * 1024.0)) / (readDuration.count() / 1000.0);
-            
-            // 将读取的数据分发给CRC计算线程
-            for (uint64_t i = 0; i < sectorsToRead; i++) {
-                std::vector<uint8_t> sectorData(readBuffer.begin() + i * SECTOR_SIZE, 
-                                               readBuffer.begin() + (i + 1) * SECTOR_SIZE);
-                
-                {
-                    std::lock_guard<std::mutex> lock(dataMutex_);
-                    dataQueue_.push({startSector + processed + i, std::move(sectorData)});
+            auto readDuration = std::chrono::duration_cast<std::chrono::milliseconds>(readEnd - lastCompletion);
+            lastCompletion = readEnd;
+            double readSpeed = ((sectorsRead * SECTOR_SIZE) / (1024.0 * 1024.0)) / (std::max<long long>(1, readDuration.count()) / 1000.0);
+            
+            // 分发前的队列占用反映CRC线程是否跟得上读取
+            double occupancy = static_cast<double>(dataRing_.sizeApprox()) / dataRing_.capacity();
+            
+            // 把缓冲区的可读扇区段切成extent分发给CRC计算线程，扇区数据本身不再复制
+            bool dispatched = true;
+            for (const auto& run : runs) {
+                uint64_t runEnd = run.first + run.second;
+                for (uint64_t first = run.first; first < runEnd && dispatched; first += settings.extentSectors) {
+                    SectorExtent extent;
+                    extent.buffer = readBuffer;
+                    extent.offset = first * SECTOR_SIZE;
+                    extent.startSector = startSector + firstSector + first;
+                    extent.sectorCount = static_cast<uint32_t>(std::min<uint64_t>(settings.extentSectors, runEnd - first));
+                    extent.sectorSize = SECTOR_SIZE;
+                    dispatchedSectors += extent.sectorCount;
+                    
+                    if (!dataRing_.tryPush(std::move(extent))) {
+                        // 数据队列已满：先取走已完成的结果，再阻塞等待空位
+                        drainResults(outFile, sectorsWritten);
+                        dispatched = dataRing_.push(std::move(extent));
+                    }
                 }
-                dataCV_.notify_one();
+            }
+            readBuffer.reset();
+            
+            if (!dispatched) {
+                break; // 用户取消
             }
             
-            processed += sectorsToRead;
+            processed += sectorsRead;
+            
+            // 反馈调整：新设置从下一次补发读取和下一个缓冲区开始生效
+            if (controller.sample(processed * SECTOR_SIZE, hasherBusyNanos_.load(), occupancy)) {
+                settings = controller.settings();
+                activeHashers_ = settings.hasherCount;
+                hasherGate_.notifyAll();
+                std::cout << "[TUNE] " << settings.toString() << std::endl;
+            }
             
             // 实时显示进度 - 每1000个扇区显示一次，更频繁的更新
             if (processed % 1000 == 0 || processed == sectorCount) {
@@ -289,66 +632,41 @@ public:
             
             // 实时显示当前处理的扇区范围
             if (processed % 100 == 0) {
-                std::cout << "[SECTOR] Processing sectors " << startSector + processed - sectorsToRead + 1 
+                std::cout << "[SECTOR] Processing sectors " << startSector + processed - sectorsRead + 1 
                          << " to " << startSector + processed << std::endl;
             }
             
             // 写入结果到文件
-            while (sectorsWritten < processed && !isUserCancelled()) {
-                std::pair<uint64_t, uint32_t> result;
-                bool hasResult = false;
-                
-                {
-                    std::lock_guard<std::mutex> lock(resultMutex_);
-                    if (!resultQueue_.empty()) {
-                        result = resultQueue_.front();
-                        resultQueue_.pop();
-                        hasResult = true;
-                    }
-                }
-                
-                if (hasResult) {
-                    outFile.write(reinterpret_cast<const char*>(&result.first), sizeof(uint64_t));
-                    outFile.write(reinterpret_cast<const char*>(&result.second), sizeof(uint32_t));
-                    sectorsWritten++;
-                } else {
-                    break;
-                }
-            }
+            drainResults(outFile, sectorsWritten);
         }
         
-        // 等待所有CRC计算完成
-        while (sectorsWritten < processed && !isUserCancelled()) {
-            std::pair<uint64_t, uint32_t> result;
-            bool hasResult = false;
-            
-            {
-                std::lock_guard<std::mutex> lock(resultMutex_);
-                if (!resultQueue_.empty()) {
-                    result = resultQueue_.front();
-                    resultQueue_.pop();
-                    hasResult = true;
-                }
-            }
-            
-            if (hasResult) {
-                outFile.write(reinterpret_cast<const char*>(&result.first), sizeof(uint64_t));
-                outFile.write(reinterpret_cast<const char*>(&result.second), sizeof(uint32_t));
-                sectorsWritten++;
-            } else {
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        // 取消或出错时仍有读取在途
+        cancelPendingReads(reads, MAX_READS_IN_FLIGHT);
+        for (auto& read : reads) {
+            if (read.event != NULL) {
+                CloseHandle(read.event);
             }
         }
         
-        // 停止工作线程
+        // 等待所有CRC计算完成；用户取消时结果队列被关闭，pop返回false
+        dataRing_.close();
+        ExtentChecksums done;
+        while (sectorsWritten < dispatchedSectors && !isUserCancelled() && resultRing_.pop(done)) {
+            writeExtentChecksums(outFile, done);
+            sectorsWritten += done.count;
+        }
+        
+        // 停止工作线程，挂起的线程看到队列关闭后退出
         stopProcessing_ = true;
-        dataCV_.notify_all();
+        dataRing_.close();
+        hasherGate_.notifyAll();
         
         for (auto& thread : crcThreads) {
             if (thread.joinable()) {
                 thread.join();
             }
         }
+        tunedSettings_ = settings;
         
         if (keyboardThread.joinable()) {
             keyboardThread.join();
@@ -356,10 +674,27 @@ public:
         
         outFile.close();
         
+        // 写回坏块表：实际扫描过的范围（按顺序处理完的前processed个扇区）以本次结果为准，
+        // 取消或中止时其后的已知坏块保持不变
+        BadBlockMap badBlocks = knownBad;
+        badBlocks.remove(startSector, processed);
+        badBlocks.merge(foundBad);
+        if ((!badBlocks.empty() || !knownBad.empty()) && !badBlocks.save(badBlockMapPath)) {
+            std::cout << "[WARNING] " << badBlocks.getLastError() << std::endl;
+        }
+        if (!foundBad.empty()) {
+            std::cout << "[INFO] " << foundBad.sectorCount() << " unreadable sector(s) recorded in " << badBlockMapPath << std::endl;
+        }
+        
         if (isUserCancelled()) {
             std::cout << "[INFO] Operation cancelled by user" << std::endl;
             return false;
         }
+        if (readFailed) {
+            std::cout << "[ERROR] Generation aborted after " << processed << " of " << sectorCount
+                      << " sectors; the checksum file is incomplete" << std::endl;
+            return false;
+        }
         
         auto totalEnd = std::chrono::high_resolution_clock::now();
         auto totalDuration = std::chrono::duration_cast<std::chrono::milliseconds>(totalEnd - totalStart);
@@ -374,6 +709,8 @@ public:
         std::cout << "[INFO] Total time: " << (totalDuration.count() / 1000.0) << " seconds" << std::endl;
         std::cout << "[INFO] Average speed: " << totalSpeed << " MB/s" << std::endl;
         std::cout << "[INFO] CRC calculation threads: " << numThreads << std::endl;
+        std::cout << "[INFO] Tuned settings: " << tunedSettings_.toString()
+                  << (controller.isSettled() ? "" : " (still tuning)") << std::endl;
         
         return true;
     }
@@ -413,11 +750,13 @@ public:
         
         auto totalStart = std::chrono::high_resolution_clock::now();
         
+        // 所有扇区复用同一个缓冲区
+        std::vector<uint8_t> sectorData(SECTOR_SIZE);
+        
         while (inFile.read(reinterpret_cast<char*>(&sectorNum), sizeof(uint64_t)) && 
                inFile.read(reinterpret_cast<char*>(&expectedCRC), sizeof(uint32_t)) && 
                !isUserCancelled()) {
             
-            std::vector<uint8_t> sectorData(SECTOR_SIZE);
             DWORD bytesRead;
             
             LARGE_INTEGER sectorOffset;
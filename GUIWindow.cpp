@@ -1,5 +1,6 @@
 #include "GUIWindow.h"
 #include "HighPerformanceCRC.h"
+#include "EnhancedDiskSectorCRC.h"
 #include <iostream>
 #include <windows.h>
 #include <fileapi.h>
@@ -109,7 +110,7 @@ bool GUIWindow::verifyIntegrity(const std::string& diskPath, const std::string&
         statusCallback_("Initializing disk access...");
     }
     
-    diskCRC_ = new DiskSectorCRC(diskPath);
+    diskCRC_ = new EnhancedDiskSectorCRC(diskPath);
     
     if (!diskCRC_->checkFilePermissions()) {
         if (statusCallback_) {
@@ -143,7 +144,7 @@ bool GUIWindow::repairData(const std::string& diskPath, const std::string& check
         statusCallback_("Initializing disk access...");
     }
     
-    diskCRC_ = new DiskSectorCRC(diskPath);
+    diskCRC_ = new EnhancedDiskSectorCRC(diskPath);
     
     if (!diskCRC_->checkFilePermissions()) {
         if (statusCallback_) {
@@ -156,7 +157,9 @@ bool GUIWindow::repairData(const std::string& diskPath, const std::string& check
         statusCallback_("Starting data repair...");
     }
     
-    bool result = diskCRC_->repairSectorData(checksumFile, backupDiskPath);
+    // The enhanced engine journals every change so an interrupted repair can be recovered
+    EnhancedDiskSectorCRC repairDisk(diskPath);
+    bool result = repairDisk.repairSectorData(checksumFile, backupDiskPath);
     
     if (result) {
         if (statusCallback_) {
@@ -164,7 +167,7 @@ bool GUIWindow::repairData(const std::string& diskPath, const std::string& check
         }
     } else {
         if (statusCallback_) {
-            statusCallback_("Problem occurred during data repair: " + diskCRC_->getLastError());
+            statusCallback_("Problem occurred during data repair: " + repairDisk.getLastError());
         }
     }
     
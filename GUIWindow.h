@@ -1,7 +1,7 @@
 #ifndef GUI_WINDOW_H
 #define GUI_WINDOW_H
 
-#include "DiskSectorCRC.h"
+#include "EnhancedDiskSectorCRC.h"
 #include "DiskUtils.h"
 #include <string>
 #include <vector>
@@ -40,7 +40,7 @@ public:
 private:
     std::function<void(const std::string&)> statusCallback_;
     std::function<void(int, int)> progressCallback_;
-    DiskSectorCRC* diskCRC_;
+    EnhancedDiskSectorCRC* diskCRC_;
     
     // 光碟特定操作
     bool readCDSector(const std::string& cdPath, uint64_t sectorNumber, std::vector<uint8_t>& buffer);
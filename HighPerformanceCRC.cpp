@@ -1,46 +1,13 @@
 #include "HighPerformanceCRC.h"
+#include "ChecksumManifest.h"
+#include "WorkStealingPool.h"
+#include "FastCRC32.h"
 #include <iostream>
 #include <chrono>
 #include <algorithm>
 
-// CRC32查找表
-static const uint32_t crc32_table[] = {
-    0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
-    0x0EDB8832, 0x79DCB8A4, 0xE0D5E4E8, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
-    0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
-    0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
-    0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172, 0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
-    0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
-    0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
-    0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
-    0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
-    0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
-    0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
-    0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
-    0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
-    0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0, 0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
-    0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
-    0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
-    0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
-    0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
-    0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
-    0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
-    0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
-    0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
-    0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236, 0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
-    0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
-    0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
-    0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
-    0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
-    0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
-    0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
-    0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
-    0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
-    0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
-};
-
 HighPerformanceCRC::HighPerformanceCRC(const std::string& diskPath)
-    : diskPath_(diskPath), operationCancelled_(false) {
+    : diskPath_(diskPath), operationCancelled_(false), placement_(ThreadPlacement::fromEnvironment()) {
 }
 
 HighPerformanceCRC::~HighPerformanceCRC() {
@@ -61,33 +28,76 @@ bool HighPerformanceCRC::generateChecksumsHighPerformance(uint64_t startSector,
     std::cout << "高性能模式: " << readerThreads << " 个读取线程, " 
               << processorThreads << " 个处理线程" << std::endl;
     
-    // 创建输出文件并写入头部
-    std::ofstream outFile(outputFile, std::ios::binary);
-    if (!outFile.is_open()) {
+    // 创建输出文件（v2格式，带块校验），所有处理线程共享同一个写入器
+    uint64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    
+    // 之前运行中发现的坏块区域不再读取
+    std::string badBlockMapPath = badBlockMapPath_.empty() ? outputFile + ".badblocks" : badBlockMapPath_;
+    if (!knownBadBlocks_.load(badBlockMapPath)) {
+        lastError_ = knownBadBlocks_.getLastError();
+        return false;
+    }
+    foundBadBlocks_.clear();
+    foundSlowBlocks_.clear();
+    
+    ChecksumManifestWriter writer;
+    if (!writer.open(outputFile, startSector, sectorCount, timestamp)) {
         lastError_ = "无法创建输出文件: " + outputFile;
         return false;
     }
     
-    uint32_t magic = 0x43524344; // "CRCD"
-    uint64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
+    // 读取线程是专用的I/O线程；CRC计算以每个extent一个任务的形式交给共享的工作窃取线程池，
+    // 计算宽度由线程池决定，processorThreads只决定同时在途的缓冲区数量
+    const int readerBatchSize = 256;
+    TaskGroup tasks;
     
-    outFile.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
-    outFile.write(reinterpret_cast<const char*>(&startSector), sizeof(startSector));
-    outFile.write(reinterpret_cast<const char*>(&sectorCount), sizeof(sectorCount));
-    outFile.write(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
-    outFile.close();
+    HashJob job;
+    job.tasks = &tasks;
+    job.writer = &writer;
+    job.totalCount = sectorCount;
+    job.progressCallback = progressCallback;
     
-    // 生产者-消费者设置
-    std::queue<SectorData> dataQueue;
-    std::mutex queueMutex;
-    std::condition_variable queueCV;
-    std::atomic<bool> readingComplete(false);
-    std::atomic<uint64_t> processedCount(0);
+    // 按NUMA节点划分读取通道，读取线程轮流分到各通道；只有一个节点或关闭NUMA配对时只有一个通道
+    const CpuTopology& topology = CpuTopology::instance();
+    std::vector<std::unique_ptr<ReaderLane>> lanes;
+    if (placement_.numaAware && topology.nodeCount() > 1) {
+        for (size_t node = 0; node < topology.nodeCount() && lanes.size() < static_cast<size_t>(readerThreads); ++node) {
+            const NumaNode& numaNode = topology.nodes()[node];
+            if (!placement_.readers.empty() && placement_.readers.intersect(numaNode.cpus).empty()) {
+                continue; // 指定的读取CPU不在该节点上
+            }
+            std::unique_ptr<ReaderLane> lane(new ReaderLane());
+            lane->nodeIndex = static_cast<int>(node);
+            lane->readerCpus = placement_.stageCpus(placement_.readers, numaNode);
+            lanes.push_back(std::move(lane));
+        }
+    }
+    if (lanes.empty()) {
+        std::unique_ptr<ReaderLane> lane(new ReaderLane());
+        lane->readerCpus = placement_.readers;
+        lanes.push_back(std::move(lane));
+    }
+    
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        ReaderLane& lane = *lanes[i];
+        size_t laneReaders = readerThreads / lanes.size() + (i < readerThreads % lanes.size() ? 1 : 0);
+        size_t laneBuffers = std::max<size_t>(2, 2 * processorThreads / lanes.size() + laneReaders);
+        int memoryNode = lane.nodeIndex >= 0 ? static_cast<int>(topology.nodes()[lane.nodeIndex].id) : -1;
+        
+        // 缓冲池分配在本节点；每个缓冲区只承载一次读取（一个extent），
+        // 队列容量保证读取线程不会因队列满而等待
+        lane.bufferPool.reset(new BufferPool(laneBuffers,
+                                             static_cast<size_t>(readerBatchSize) * OptimizedDiskReader::sectorSize(),
+                                             BUFFER_POOL_ALIGNMENT, memoryNode));
+        lane.dataRing.reset(new BlockingRing<SectorExtent>(laneBuffers));
+        lane.job = &job;
+    }
+    if (lanes.size() > 1) {
+        std::cout << "NUMA: " << lanes.size() << " 个读取通道，缓冲区和CRC计算留在读取线程所在节点" << std::endl;
+    }
     
     std::vector<std::thread> readerThreadsList;
-    std::vector<std::thread> processorThreadsList;
-    std::mutex fileMutex;
     
     // 计算每个读取线程处理的扇区数
     uint64_t sectorsPerReader = sectorCount / readerThreads;
@@ -105,163 +115,153 @@ bool HighPerformanceCRC::generateChecksumsHighPerformance(uint64_t startSector,
         uint64_t threadEnd = currentStart + threadSectorCount;
         
         readerThreadsList.emplace_back(&HighPerformanceCRC::optimizedReaderWorker, this,
-                                     currentStart, threadEnd, std::ref(dataQueue),
-                                     std::ref(queueMutex), std::ref(queueCV),
-                                     std::ref(readingComplete), 256); // 更大的批量大小
+                                     currentStart, threadEnd, std::ref(*lanes[i % lanes.size()]),
+                                     readerBatchSize); // 更大的批量大小
         
         currentStart = threadEnd;
     }
     
-    // 启动处理线程（消费者）
-    for (int i = 0; i < processorThreads; ++i) {
-        processorThreadsList.emplace_back(&HighPerformanceCRC::optimizedProcessorWorker, this,
-                                        std::ref(dataQueue), std::ref(queueMutex),
-                                        std::ref(queueCV), std::ref(readingComplete),
-                                        outputFile, std::ref(fileMutex),
-                                        std::ref(processedCount), sectorCount, progressCallback);
-    }
-    
     // 等待所有读取线程完成
     for (auto& thread : readerThreadsList) {
         thread.join();
     }
     
-    // 发出读取完成信号
-    readingComplete = true;
-    queueCV.notify_all();
+    // 等待剩余的计算任务完成（当前线程也参与执行）
+    tasks.wait();
     
-    // 等待所有处理线程完成
-    for (auto& thread : processorThreadsList) {
-        thread.join();
+    if (job.writeFailed || job.readFailed) {
+        lastError_ = job.readFailed ? job.readError : writer.getLastError();
+        writer.suspend();
+        return false;
+    }
+    
+    // 取消时校验文件没有覆盖整个范围，保持未完成状态；否则写入块索引并完成文件头
+    bool cancelled = isOperationCancelled();
+    if (cancelled) {
+        writer.suspend();
+    } else if (!writer.close()) {
+        lastError_ = writer.getLastError();
+        return false;
+    }
+    
+    // 保存坏块表：完整扫描过的范围以本次结果为准，取消时只追加新发现的区域
+    BadBlockMap badBlocks = knownBadBlocks_;
+    if (!cancelled) {
+        badBlocks.remove(startSector, sectorCount);
+    }
+    badBlocks.merge(foundBadBlocks_);
+    if (!foundBadBlocks_.empty()) {
+        std::cout << "跳过 " << foundBadBlocks_.sectorCount() << " 个不可读扇区，已记入 " << badBlockMapPath << std::endl;
+    }
+    if (!foundSlowBlocks_.empty()) {
+        std::cout << foundSlowBlocks_.sectorCount() << " 个扇区所在的读取超过 " << rescuePolicy_.readTimeoutMs
+                  << " ms 超时" << std::endl;
+    }
+    if ((!badBlocks.empty() || !knownBadBlocks_.empty()) && !badBlocks.save(badBlockMapPath)) {
+        lastError_ = badBlocks.getLastError();
+        return false;
     }
     
-    return !isOperationCancelled();
+    return !cancelled;
 }
 
-uint32_t HighPerformanceCRC::calculateCRC32(const std::vector<uint8_t>& data) {
-    uint32_t crc = 0xFFFFFFFF;
-    for (uint8_t byte : data) {
-        crc = (crc >> 8) ^ crc32_table[(crc ^ byte) & 0xFF];
-    }
-    return crc ^ 0xFFFFFFFF;
+uint32_t HighPerformanceCRC::calculateCRC32(const uint8_t* data, size_t length) {
+    // 与其它生成器和校验路径使用同一个 CRC-32
+    return FastCRC32::compute(data, length);
 }
 
-void HighPerformanceCRC::optimizedReaderWorker(uint64_t startSector, uint64_t endSector,
-                                              std::queue<SectorData>& dataQueue, std::mutex& queueMutex,
-                                              std::condition_variable& queueCV, std::atomic<bool>& readingComplete,
+void HighPerformanceCRC::optimizedReaderWorker(uint64_t startSector, uint64_t endSector, ReaderLane& lane,
                                               int batchSize) {
-    const int MAX_QUEUE_SIZE = batchSize * 2; // 防止队列过大
+    // 绑定到通道所在节点（或指定的读取CPU）
+    CpuTopology::pinCurrentThread(lane.readerCpus);
     
+    BufferPool& bufferPool = *lane.bufferPool;
+    HashJob& job = *lane.job;
     OptimizedDiskReader diskReader(diskPath_);
-    diskReader.setBatchSize(batchSize);
-    
     if (!diskReader.openDisk()) {
-        std::cerr << "无法打开磁盘: " << diskReader.getLastError() << std::endl;
+        // 这个读取线程的范围没有读到，校验文件不能完成
+        std::lock_guard<std::mutex> lock(badBlocksMutex_);
+        job.readError = "Cannot open disk: " + diskReader.getLastError();
+        job.readFailed = true;
         return;
     }
+    // 每次读取都有截止时间，取消时正在进行的读取也会被中止
+    diskReader.setReadTimeout(rescuePolicy_.readTimeoutMs);
+    diskReader.setCancelCheck([this]() { return isOperationCancelled(); });
     
-    uint64_t currentSector = startSector;
+    // 先大块读取，出错区域在其余部分读完后再用更小的读取重访
+    RescuePolicy policy = rescuePolicy_;
+    policy.maxReadSectors = static_cast<uint32_t>(std::min(batchSize, static_cast<int>(EXTENT_MAX_SECTORS)));
+    RescueScheduler rescue(startSector, endSector, policy, &knownBadBlocks_);
     
-    while (currentSector < endSector && !isOperationCancelled()) {
-        // 批量读取扇区
-        uint64_t remainingSectors = endSector - currentSector;
-        uint64_t actualBatchSize = std::min(static_cast<uint64_t>(batchSize), remainingSectors);
-        
-        std::vector<std::vector<uint8_t>> batchData;
-        if (diskReader.readSectorsBatch(currentSector, actualBatchSize, batchData)) {
-            // 准备扇区数据加入队列
-            uint64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-                std::chrono::system_clock::now().time_since_epoch()).count();
-            
-            std::vector<SectorData> sectorBatch;
-            for (size_t i = 0; i < batchData.size(); ++i) {
-                if (!batchData[i].empty()) {
-                    SectorData data;
-                    data.sectorNumber = currentSector + i;
-                    data.data = std::move(batchData[i]);
-                    data.timestamp = timestamp;
-                    sectorBatch.push_back(std::move(data));
-                }
-            }
-            
-            // 添加到队列，使用适当的同步
-            if (!sectorBatch.empty()) {
-                std::unique_lock<std::mutex> lock(queueMutex);
-                
-                // 如果队列过大，等待以防止内存耗尽
-                while (dataQueue.size() >= MAX_QUEUE_SIZE && !isOperationCancelled()) {
-                    queueCV.wait_for(lock, std::chrono::milliseconds(5));
-                }
-                
-                if (isOperationCancelled()) {
-                    break;
-                }
-                
-                // 将批次中的所有扇区添加到队列
-                for (auto& data : sectorBatch) {
-                    dataQueue.push(std::move(data));
-                }
-                
-                lock.unlock();
-                queueCV.notify_all(); // 通知处理线程
-            }
+    const uint32_t sectorSize = OptimizedDiskReader::sectorSize();
+    uint64_t firstSector;
+    uint32_t sectorCount;
+    while (!isOperationCancelled() && rescue.next(firstSector, sectorCount)) {
+        BufferLease buffer = bufferPool.acquire();
+        if (!buffer) {
+            break;
+        }
+        bool readOk = diskReader.readSectorsInto(firstSector, sectorCount, buffer.data());
+        rescue.complete(readOk, diskReader.lastReadTimedOut());
+        if (!readOk) {
+            continue;
         }
         
-        currentSector += actualBatchSize;
+        // 每次成功的读取成为一个extent
+        SectorExtent extent;
+        extent.buffer = buffer;
+        extent.sectorSize = sectorSize;
+        extent.startSector = firstSector;
+        extent.sectorCount = sectorCount;
+        if (isOperationCancelled() || !lane.dataRing->push(std::move(extent))) {
+            break;
+        }
+        job.tasks->run([this, &lane]() { hashNextExtent(lane); }, lane.nodeIndex);
     }
     
     diskReader.closeDisk();
+    
+    std::lock_guard<std::mutex> lock(badBlocksMutex_);
+    foundBadBlocks_.merge(rescue.badBlocks());
+    foundSlowBlocks_.merge(rescue.slowBlocks());
 }
 
-void HighPerformanceCRC::optimizedProcessorWorker(std::queue<SectorData>& dataQueue, std::mutex& queueMutex,
-                                                 std::condition_variable& queueCV, std::atomic<bool>& readingComplete,
-                                                 const std::string& outputFile, std::mutex& fileMutex,
-                                                 std::atomic<uint64_t>& processedCount, uint64_t totalCount,
-                                                 std::function<void(int, int)> progressCallback) {
-    std::ofstream outFile(outputFile, std::ios::binary | std::ios::app);
-    if (!outFile.is_open()) {
+void HighPerformanceCRC::hashNextExtent(ReaderLane& lane) {
+    // 每个任务对应读取线程放入通道的一个extent；pop最多等待同通道另一个读取线程完成正在进行的放入
+    HashJob& job = *lane.job;
+    SectorExtent extent;
+    if (!lane.dataRing->pop(extent)) {
         return;
     }
     
-    while (!isOperationCancelled()) {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        
-        // 等待数据或完成信号
-        while (dataQueue.empty() && !(readingComplete && isOperationCancelled())) {
-            queueCV.wait_for(lock, std::chrono::milliseconds(50));
-        }
-        
-        if (dataQueue.empty() && readingComplete) {
-            break; // 没有更多数据且读取完成
-        }
-        
-        if (dataQueue.empty()) {
-            continue; // 还没有数据可用
-        }
-        
-        // 一次处理一个扇区以更好地负载均衡
-        SectorData data = std::move(dataQueue.front());
-        dataQueue.pop();
-        lock.unlock();
-        
-        // 计算CRC
-        data.crc = calculateCRC32(data.data);
-        
-        // 将结果写入文件
-        SectorChecksum checksum{data.sectorNumber, data.crc, data.timestamp};
-        {
-            std::lock_guard<std::mutex> fileLock(fileMutex);
-            outFile.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
-        }
-        
-        // 更新进度
-        uint64_t processed = ++processedCount;
-        if (progressCallback && processed % 100 == 0) {
-            progressCallback(processed, totalCount);
-        }
+    // 取消或写入失败后只丢弃数据，缓冲区随extent释放回缓冲池
+    if (isOperationCancelled() || job.writeFailed) {
+        return;
+    }
+    
+    // 每个extent计算出一段连续的CRC数组
+    uint32_t crcs[EXTENT_MAX_SECTORS];
+    for (uint32_t i = 0; i < extent.sectorCount; ++i) {
+        crcs[i] = calculateCRC32(extent.sector(i), extent.sectorSize);
+    }
+    extent.buffer.reset();
+    
+    // 整段交给共享的写入器
+    if (!job.writer->appendRun(extent.startSector, crcs, extent.sectorCount)) {
+        job.writeFailed = true;
+        return;
     }
     
-    outFile.close();
+    // 大约每100个扇区更新一次进度
+    uint64_t processed = job.processedCount += extent.sectorCount;
+    if (job.progressCallback && processed / 100 != (processed - extent.sectorCount) / 100) {
+        job.progressCallback(processed, job.totalCount);
+    }
+}
+
+void HighPerformanceCRC::setThreadPlacement(const ThreadPlacement& placement) {
+    placement_ = placement;
 }
 
 std::string HighPerformanceCRC::getLastError() const {
@@ -2,14 +2,21 @@
 #define HIGH_PERFORMANCE_CRC_H
 
 #include "OptimizedDiskReader.h"
+#include "ConcurrentRing.h"
+#include "SectorExtent.h"
+#include "CpuTopology.h"
+#include "BadBlockMap.h"
 #include <atomic>
 #include <thread>
 #include <vector>
-#include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
 #include <fstream>
+#include <memory>
+
+class ChecksumManifestWriter;
+class TaskGroup;
 
 class HighPerformanceCRC {
 public:
@@ -22,6 +29,15 @@ public:
                                          int readerThreads = 1, int processorThreads = 0,
                                          std::function<void(int, int)> progressCallback = nullptr);
     
+    // 读取线程和计算任务的CPU/NUMA放置，默认取自CRCRECOVER_PLACEMENT环境变量
+    void setThreadPlacement(const ThreadPlacement& placement);
+    
+    // 坏块表文件，空表示<输出文件>.badblocks；表中的区域不再读取，新发现的不可读扇区记入表中
+    void setBadBlockMapPath(const std::string& path) { badBlockMapPath_ = path; }
+    
+    // 读取策略：先大块读取并在出错后指数跳过，再二分重读失败区域，最后逐扇区重试
+    void setRescuePolicy(const RescuePolicy& policy) { rescuePolicy_ = policy; }
+    
     // 获取最后错误信息
     std::string getLastError() const;
     
@@ -34,36 +50,46 @@ private:
     std::string diskPath_;
     std::string lastError_;
     std::atomic<bool> operationCancelled_;
+    ThreadPlacement placement_;
+    std::string badBlockMapPath_;
+    RescuePolicy rescuePolicy_;
+    BadBlockMap knownBadBlocks_;    // 操作开始时载入，运行期间只读
+    BadBlockMap foundBadBlocks_;    // 本次发现的不可读扇区，由badBlocksMutex_保护
+    BadBlockMap foundSlowBlocks_;   // 读取超时覆盖的扇区，同样由badBlocksMutex_保护
+    std::mutex badBlocksMutex_;
+    
+    // 优化的CRC计算
+    uint32_t calculateCRC32(const uint8_t* data, size_t length);
     
-    // 数据结构
-    struct SectorData {
-        uint64_t sectorNumber;
-        std::vector<uint8_t> data;
-        uint32_t crc;
-        uint64_t timestamp;
+    // 一次生成操作的共享状态：读取线程把extent放入所在通道的环形队列，
+    // 并为每个extent向共享线程池提交一个CRC计算任务
+    struct HashJob {
+        TaskGroup* tasks = nullptr;
+        ChecksumManifestWriter* writer = nullptr;
+        std::atomic<uint64_t> processedCount{0};
+        uint64_t totalCount = 0;
+        std::function<void(int, int)> progressCallback;
+        std::atomic<bool> writeFailed{false};
+        std::atomic<bool> readFailed{false};    // 有读取线程打不开磁盘，范围没有覆盖
+        std::string readError;                  // badBlocksMutex_保护
     };
     
-    // 优化的CRC计算
-    uint32_t calculateCRC32(const std::vector<uint8_t>& data);
+    // 一个NUMA节点上的读取通道：读取线程把数据读入节点本地的缓冲池，
+    // 计算任务也提交给同一节点上的线程池工作线程，扇区数据不跨节点传输
+    struct ReaderLane {
+        int nodeIndex = -1;         // CpuTopology::nodes()中的下标，-1表示不区分节点
+        CpuSet readerCpus;          // 读取线程绑定的CPU，空表示不绑定
+        std::unique_ptr<BufferPool> bufferPool;
+        std::unique_ptr<BlockingRing<SectorExtent>> dataRing;
+        HashJob* job = nullptr;
+    };
     
-    // 优化的工作者函数
-    void optimizedReaderWorker(uint64_t startSector, uint64_t endSector,
-                              std::queue<SectorData>& dataQueue, std::mutex& queueMutex,
-                              std::condition_variable& queueCV, std::atomic<bool>& readingComplete,
+    // 优化的读取线程，按RescueScheduler的计划读取，以连续扇区段（extent）为单位交给计算任务
+    void optimizedReaderWorker(uint64_t startSector, uint64_t endSector, ReaderLane& lane,
                               int batchSize = 128);
     
-    void optimizedProcessorWorker(std::queue<SectorData>& dataQueue, std::mutex& queueMutex,
-                                 std::condition_variable& queueCV, std::atomic<bool>& readingComplete,
-                                 const std::string& outputFile, std::mutex& fileMutex,
-                                 std::atomic<uint64_t>& processedCount, uint64_t totalCount,
-                                 std::function<void(int, int)> progressCallback);
-    
-    // 校验和数据结构
-    struct SectorChecksum {
-        uint64_t sectorNumber;
-        uint32_t crc32;
-        uint64_t timestamp;
-    };
+    // 线程池任务：从通道队列取出一个extent，计算CRC并写入
+    void hashNextExtent(ReaderLane& lane);
 };
 
 #endif // HIGH_PERFORMANCE_CRC_H
@@ -0,0 +1,43 @@
+#include "IoPlanner.h"
+#include <algorithm>
+
+IoPlanner::IoPlanner(uint32_t maxGapSectors, uint32_t maxReadSectors)
+    : maxGapSectors_(maxGapSectors), maxReadSectors_(std::max<uint32_t>(1, maxReadSectors)), plannedSectors_(0) {
+}
+
+void IoPlanner::build() {
+    reads_.clear();
+    plannedSectors_ = 0;
+
+    // Manifests written in order are already sorted; only pay for the sort when they are not
+    auto bySector = [](const Entry& a, const Entry& b) { return a.sector < b.sector; };
+    if (!std::is_sorted(entries_.begin(), entries_.end(), bySector)) {
+        std::stable_sort(entries_.begin(), entries_.end(), bySector);
+    }
+
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        uint64_t sector = entries_[i].sector;
+        if (!reads_.empty()) {
+            PlannedRead& read = reads_.back();
+            uint64_t readEnd = read.startSector + read.sectorCount;
+            if (sector < readEnd) {
+                read.entryCount++; // Duplicate of a sector already covered
+                continue;
+            }
+            if (sector - readEnd <= maxGapSectors_ && sector - read.startSector < maxReadSectors_) {
+                plannedSectors_ += sector + 1 - readEnd;
+                read.sectorCount = static_cast<uint32_t>(sector + 1 - read.startSector);
+                read.entryCount++;
+                continue;
+            }
+        }
+
+        PlannedRead read;
+        read.startSector = sector;
+        read.sectorCount = 1;
+        read.firstEntry = i;
+        read.entryCount = 1;
+        reads_.push_back(read);
+        plannedSectors_++;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef IO_PLANNER_H
+#define IO_PLANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One read of a plan: sectors [startSector, startSector + sectorCount), serving the plan entries
+// [firstEntry, firstEntry + entryCount)
+struct PlannedRead {
+    uint64_t startSector = 0;
+    uint32_t sectorCount = 0;
+    size_t firstEntry = 0;
+    size_t entryCount = 0;
+};
+
+// Turns a list of target sectors in any order into few large reads in LBA order. Targets are
+// sorted by sector; neighbours closer than the gap threshold share one read, and the sectors in
+// between are read and discarded, which on rotating media is far cheaper than a seek. Reads never
+// exceed maxReadSectors. Duplicate targets share the read of their sector.
+class IoPlanner {
+public:
+    static constexpr uint32_t DEFAULT_MAX_GAP_SECTORS = 16;
+    static constexpr uint32_t DEFAULT_MAX_READ_SECTORS = 1024;
+
+    explicit IoPlanner(uint32_t maxGapSectors = DEFAULT_MAX_GAP_SECTORS,
+                       uint32_t maxReadSectors = DEFAULT_MAX_READ_SECTORS);
+
+    // Plan reads for items[first, last); sectorOf(item) returns the sector an item targets
+    template <typename Item, typename SectorOf>
+    void plan(const std::vector<Item>& items, size_t first, size_t last, SectorOf sectorOf) {
+        entries_.clear();
+        entries_.reserve(last - first);
+        for (size_t i = first; i < last; ++i) {
+            entries_.push_back(Entry{sectorOf(items[i]), i});
+        }
+        build();
+    }
+
+    const std::vector<PlannedRead>& reads() const { return reads_; }
+
+    // Index into the planned items of entry `entry`; entries are in sector order
+    size_t itemIndex(size_t entry) const { return entries_[entry].item; }
+
+    uint32_t maxGapSectors() const { return maxGapSectors_; }
+    uint32_t maxReadSectors() const { return maxReadSectors_; }
+
+    // Sectors the plan reads, gaps included
+    uint64_t plannedSectors() const { return plannedSectors_; }
+
+private:
+    struct Entry {
+        uint64_t sector;
+        size_t item;
+    };
+
+    uint32_t maxGapSectors_;
+    uint32_t maxReadSectors_;
+    std::vector<Entry> entries_;
+    std::vector<PlannedRead> reads_;
+    uint64_t plannedSectors_;
+
+    void build();
+};
+
+#endif // IO_PLANNER_H
@@ -0,0 +1,230 @@
+#include "IoThrottle.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Longest single sleep, so cancellation is noticed quickly
+static constexpr uint32_t THROTTLE_POLL_MS = 100;
+
+// Sleep for `milliseconds` in slices; false if `cancelled` turned true
+static bool sleepCancellable(uint64_t milliseconds, const std::function<bool()>& cancelled) {
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+    while (std::chrono::steady_clock::now() < until) {
+        if (cancelled && cancelled()) {
+            return false;
+        }
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(until - std::chrono::steady_clock::now());
+        std::this_thread::sleep_for(std::min(left, std::chrono::milliseconds(THROTTLE_POLL_MS)));
+    }
+    return !(cancelled && cancelled());
+}
+
+// TokenBucket
+
+TokenBucket::TokenBucket(uint64_t bytesPerSecond, uint64_t burstBytes)
+    : rate_(bytesPerSecond), burst_(std::max<uint64_t>(1, burstBytes)), tokens_(static_cast<double>(burst_)),
+      refilled_(std::chrono::steady_clock::now()) {
+}
+
+void TokenBucket::refill(std::chrono::steady_clock::time_point now) {
+    double seconds = std::chrono::duration<double>(now - refilled_).count();
+    tokens_ = std::min(static_cast<double>(burst_), tokens_ + seconds * rate_);
+    refilled_ = now;
+}
+
+bool TokenBucket::acquire(uint64_t bytes, const std::function<bool()>& cancelled) {
+    for (;;) {
+        uint64_t waitMs = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (rate_ == 0) {
+                return true;
+            }
+            refill(std::chrono::steady_clock::now());
+
+            // Oversized requests go through on a full bucket and leave it in debt
+            double needed = std::min(static_cast<double>(bytes), static_cast<double>(burst_));
+            if (tokens_ >= needed) {
+                tokens_ -= static_cast<double>(bytes);
+                return true;
+            }
+            waitMs = static_cast<uint64_t>((needed - tokens_) * 1000.0 / rate_) + 1;
+        }
+        if (!sleepCancellable(std::min<uint64_t>(waitMs, THROTTLE_POLL_MS), cancelled)) {
+            return false;
+        }
+    }
+}
+
+void TokenBucket::setRate(uint64_t bytesPerSecond) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    refill(std::chrono::steady_clock::now());
+    rate_ = bytesPerSecond;
+}
+
+uint64_t TokenBucket::rate() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rate_;
+}
+
+// DiskActivityMonitor
+
+DiskActivityMonitor::DiskActivityMonitor(const std::string& diskPath)
+    : diskPath_(diskPath), device_(nullptr), haveLast_(false) {
+}
+
+DiskActivityMonitor::~DiskActivityMonitor() {
+#ifdef _WIN32
+    if (device_ != nullptr) {
+        CloseHandle(static_cast<HANDLE>(device_));
+    }
+#endif
+}
+
+bool DiskActivityMonitor::open() {
+    haveLast_ = false;
+#ifdef _WIN32
+    std::string devicePath = diskPath_;
+    if (devicePath.find("\\\\.\\") == std::string::npos) {
+        devicePath = "\\\\.\\" + devicePath;
+    }
+    // No access rights are needed to query the counters
+    HANDLE device = CreateFileA(devicePath.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                OPEN_EXISTING, 0, NULL);
+    if (device == INVALID_HANDLE_VALUE) {
+        lastError_ = "Cannot open disk for its performance counters: " + devicePath;
+        return false;
+    }
+    device_ = device;
+#endif
+    Counters counters;
+    return readCounters(counters);
+}
+
+bool DiskActivityMonitor::readCounters(Counters& counters) {
+    counters.takenAt = std::chrono::steady_clock::now();
+#ifdef _WIN32
+    DISK_PERFORMANCE performance = {};
+    DWORD returned = 0;
+    if (device_ == nullptr ||
+        !DeviceIoControl(static_cast<HANDLE>(device_), IOCTL_DISK_PERFORMANCE, NULL, 0, &performance,
+                         sizeof(performance), &returned, NULL)) {
+        lastError_ = "Disk performance counters are not available for " + diskPath_ +
+                     " (error code: " + std::to_string(GetLastError()) + ")";
+        return false;
+    }
+    // Times are in 100 ns units; busy time is what the disk did not spend idle
+    uint64_t elapsed = static_cast<uint64_t>(performance.QueryTime.QuadPart);
+    uint64_t idle = static_cast<uint64_t>(performance.IdleTime.QuadPart);
+    counters.busyMs = (elapsed > idle ? elapsed - idle : 0) / 10000;
+    counters.bytes = static_cast<uint64_t>(performance.BytesRead.QuadPart) +
+                     static_cast<uint64_t>(performance.BytesWritten.QuadPart);
+    return true;
+#else
+    // /proc/diskstats: major minor name reads merged sectorsRead msReading writes merged
+    // sectorsWritten msWriting inFlight msDoingIo ...
+    std::string name = diskPath_.substr(diskPath_.find_last_of('/') + 1);
+    std::ifstream stats("/proc/diskstats");
+    std::string line;
+    while (std::getline(stats, line)) {
+        std::istringstream fields(line);
+        uint64_t major, minor, reads, readsMerged, sectorsRead, msReading, writes, writesMerged;
+        uint64_t sectorsWritten, msWriting, inFlight, msDoingIo;
+        std::string device;
+        if (fields >> major >> minor >> device && device == name &&
+            fields >> reads >> readsMerged >> sectorsRead >> msReading >> writes >> writesMerged >>
+                sectorsWritten >> msWriting >> inFlight >> msDoingIo) {
+            counters.busyMs = msDoingIo;
+            counters.bytes = (sectorsRead + sectorsWritten) * 512;   // Always 512-byte units
+            return true;
+        }
+    }
+    lastError_ = "Disk " + name + " not found in /proc/diskstats";
+    return false;
+#endif
+}
+
+bool DiskActivityMonitor::sample(uint64_t ownBytes, double& foregroundUtilisation) {
+    foregroundUtilisation = 0;
+    Counters now;
+    if (!readCounters(now)) {
+        return false;
+    }
+    if (haveLast_) {
+        double elapsedMs = std::chrono::duration<double, std::milli>(now.takenAt - last_.takenAt).count();
+        uint64_t busyMs = now.busyMs - std::min(now.busyMs, last_.busyMs);
+        uint64_t bytes = now.bytes - std::min(now.bytes, last_.bytes);
+        if (elapsedMs > 0) {
+            double busy = std::min(1.0, busyMs / elapsedMs);
+            // Charge the busy time to the others by their share of the bytes; no bytes, no load
+            double foregroundShare = bytes > ownBytes ? static_cast<double>(bytes - ownBytes) / bytes : 0.0;
+            foregroundUtilisation = busy * foregroundShare;
+        }
+    }
+    last_ = now;
+    haveLast_ = true;
+    return true;
+}
+
+// IoThrottle
+
+IoThrottle::IoThrottle(const std::string& diskPath, const ThrottlePolicy& policy)
+    : policy_(policy), bucket_(policy.bytesPerSecond, std::max<uint64_t>(policy.bytesPerSecond / 4, 1 << 20)),
+      monitor_(diskPath), monitoring_(false), ownBytes_(0), utilisation_(0),
+      nextSample_(std::chrono::steady_clock::now()), backoffCount_(0), backoffMs_(0) {
+    if (policy_.busyThreshold > 0) {
+        monitoring_ = monitor_.open() && monitor_.sample(0, utilisation_);
+    }
+}
+
+bool IoThrottle::sampleBusy() {
+    if (!monitoring_ || std::chrono::steady_clock::now() < nextSample_) {
+        return false;
+    }
+    nextSample_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(policy_.sampleIntervalMs);
+    if (!monitor_.sample(ownBytes_, utilisation_)) {
+        monitoring_ = false;    // Counters went away; keep going on the bandwidth cap alone
+        return false;
+    }
+    ownBytes_ = 0;
+    return utilisation_ > policy_.busyThreshold;
+}
+
+bool IoThrottle::acquire(uint64_t bytes, const std::function<bool()>& cancelled) {
+    // Stay off the disk while the foreground keeps it busy, a little longer each time it still is
+    uint64_t pauseMs = policy_.sampleIntervalMs;
+    while (sampleBusy()) {
+        backoffCount_++;
+        if (!sleepCancellable(pauseMs, cancelled)) {
+            return false;
+        }
+        backoffMs_ += pauseMs;
+        pauseMs = std::min<uint64_t>(pauseMs * 2, std::max(policy_.maxBackoffMs, policy_.sampleIntervalMs));
+        nextSample_ = std::chrono::steady_clock::now();
+    }
+
+    if (!bucket_.acquire(bytes, cancelled)) {
+        return false;
+    }
+    ownBytes_ += bytes;
+    return true;
+}
+
+bool IoThrottle::lowerCurrentThreadIoPriority() {
+#ifdef _WIN32
+    return SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN) != FALSE;
+#else
+    // ioprio_set(IOPRIO_WHO_PROCESS, this thread, IOPRIO_CLASS_IDLE)
+    const int whoProcess = 1;
+    const int classIdle = 3;
+    return syscall(SYS_ioprio_set, whoProcess, 0, classIdle << 13) == 0;
+#endif
+}
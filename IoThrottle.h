@@ -0,0 +1,111 @@
+#ifndef IO_THROTTLE_H
+#define IO_THROTTLE_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// Token bucket capping the bytes a reader issues per second. Tokens accrue at `bytesPerSecond` up
+// to `burstBytes`; acquire() takes the tokens of one read and sleeps until they have accrued. A
+// read larger than the burst is let through once the bucket is full and leaves it in debt, so big
+// reads are delayed, never starved.
+class TokenBucket {
+public:
+    TokenBucket(uint64_t bytesPerSecond, uint64_t burstBytes);
+
+    // False if `cancelled` turned true while waiting
+    bool acquire(uint64_t bytes, const std::function<bool()>& cancelled = nullptr);
+
+    // 0 lifts the cap
+    void setRate(uint64_t bytesPerSecond);
+    uint64_t rate() const;
+
+private:
+    mutable std::mutex mutex_;
+    uint64_t rate_;
+    uint64_t burst_;
+    double tokens_;
+    std::chrono::steady_clock::time_point refilled_;
+
+    void refill(std::chrono::steady_clock::time_point now);
+};
+
+// How much of a disk's time goes to I/O other than ours, from the OS disk counters: the disk
+// performance counters (IOCTL_DISK_PERFORMANCE) on Windows, /proc/diskstats elsewhere. Between two
+// samples the busy fraction of the interval is split by the bytes moved, so our own reads do not
+// count as foreground load.
+class DiskActivityMonitor {
+public:
+    explicit DiskActivityMonitor(const std::string& diskPath);
+    ~DiskActivityMonitor();
+
+    DiskActivityMonitor(const DiskActivityMonitor&) = delete;
+    DiskActivityMonitor& operator=(const DiskActivityMonitor&) = delete;
+
+    bool open();
+
+    // Busy fraction (0..1) caused by others since the previous call; ownBytes is what we
+    // transferred meanwhile. The first call only takes the baseline and reports 0.
+    bool sample(uint64_t ownBytes, double& foregroundUtilisation);
+
+    std::string getLastError() const { return lastError_; }
+
+private:
+    struct Counters {
+        uint64_t busyMs = 0;
+        uint64_t bytes = 0;
+        std::chrono::steady_clock::time_point takenAt;
+    };
+
+    std::string diskPath_;
+    void* device_;          // Windows handle used for the counter query
+    Counters last_;
+    bool haveLast_;
+    std::string lastError_;
+
+    bool readCounters(Counters& counters);
+};
+
+// Pacing of a background reader
+struct ThrottlePolicy {
+    uint64_t bytesPerSecond = 50ull << 20;  // Bandwidth cap, 0 for none
+    double busyThreshold = 0.3;             // Pause while others keep the disk busier than this, 0 never
+    uint32_t sampleIntervalMs = 1000;       // How often the disk counters are read
+    uint32_t maxBackoffMs = 60000;          // Pauses double while the disk stays busy, up to this
+};
+
+// Gate in front of every read of a background reader: while foreground I/O keeps the disk busy
+// above the threshold it pauses, backing off exponentially, and then waits for bandwidth tokens.
+// Without usable disk counters only the bandwidth cap applies. Meant for one reader thread.
+class IoThrottle {
+public:
+    IoThrottle(const std::string& diskPath, const ThrottlePolicy& policy = ThrottlePolicy());
+
+    // Call before reading `bytes`; false if `cancelled` turned true while waiting
+    bool acquire(uint64_t bytes, const std::function<bool()>& cancelled = nullptr);
+
+    uint64_t backoffCount() const { return backoffCount_; }
+    uint64_t backoffMs() const { return backoffMs_; }
+    double lastUtilisation() const { return utilisation_; }
+
+    // Lower the I/O priority of the calling thread to the idle class (Windows background mode,
+    // elsewhere IOPRIO_CLASS_IDLE), so its reads only get disk time nobody else wants
+    static bool lowerCurrentThreadIoPriority();
+
+private:
+    ThrottlePolicy policy_;
+    TokenBucket bucket_;
+    DiskActivityMonitor monitor_;
+    bool monitoring_;
+    uint64_t ownBytes_;             // Read since the last sample
+    double utilisation_;
+    std::chrono::steady_clock::time_point nextSample_;
+    uint64_t backoffCount_;
+    uint64_t backoffMs_;
+
+    bool sampleBusy();
+};
+
+#endif // IO_THROTTLE_H
@@ -0,0 +1,162 @@
+#include "JobCheckpoint.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char* const CHECKPOINT_HEADER = "# CRCRECOVER checkpoint";
+
+bool JobCheckpoint::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        lastError_ = "Cannot open checkpoint: " + path;
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(file, line) || line.compare(0, std::string(CHECKPOINT_HEADER).size(), CHECKPOINT_HEADER) != 0) {
+        lastError_ = "Not a checkpoint file: " + path;
+        return false;
+    }
+
+    *this = JobCheckpoint();
+    bool haveKind = false;
+    uint64_t lineNumber = 1;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+
+        bool valid = true;
+        if (key == "job") {
+            std::string kindText;
+            fields >> kindText;
+            haveKind = kindText == "generate" || kindText == "verify";
+            valid = haveKind;
+            kind = kindText == "verify" ? Kind::Verify : Kind::Generate;
+        } else if (key == "disk") {
+            // The path may contain spaces, take the rest of the line
+            std::getline(fields >> std::ws, diskPath);
+        } else if (key == "range") {
+            valid = static_cast<bool>(fields >> startSector >> sectorCount);
+        } else if (key == "timestamp") {
+            valid = static_cast<bool>(fields >> timestamp);
+        } else if (key == "blocks") {
+            valid = static_cast<bool>(fields >> manifestBlocks);
+        } else if (key == "records") {
+            valid = static_cast<bool>(fields >> manifestRecords);
+        } else if (key == "stats") {
+            valid = static_cast<bool>(fields >> processedCount >> corruptedCount >> unreadableCount);
+        } else if (key == "saved") {
+            valid = static_cast<bool>(fields >> savedAt);
+        } else if (key == "done") {
+            uint64_t rangeStart, rangeCount;
+            valid = static_cast<bool>(fields >> rangeStart >> rangeCount);
+            if (valid) {
+                doneRanges[rangeStart] = rangeCount;
+            }
+        }
+        // Unknown keys are skipped so newer checkpoints stay readable
+
+        if (!valid) {
+            lastError_ = "Invalid checkpoint entry at line " + std::to_string(lineNumber) + ": " + path;
+            return false;
+        }
+    }
+
+    if (!haveKind) {
+        lastError_ = "Checkpoint names no job: " + path;
+        return false;
+    }
+    return true;
+}
+
+bool JobCheckpoint::save(const std::string& path) const {
+    std::string temporaryPath = path + ".tmp";
+    std::FILE* file = std::fopen(temporaryPath.c_str(), "w");
+    if (file == nullptr) {
+        lastError_ = "Cannot write checkpoint: " + temporaryPath;
+        return false;
+    }
+
+    uint64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::ostringstream text;
+    text << CHECKPOINT_HEADER << '\n'
+         << "job " << kindName(kind) << '\n'
+         << "disk " << diskPath << '\n'
+         << "range " << startSector << ' ' << sectorCount << '\n'
+         << "timestamp " << timestamp << '\n'
+         << "saved " << now << '\n'
+         << "stats " << processedCount << ' ' << corruptedCount << ' ' << unreadableCount << '\n';
+    if (kind == Kind::Generate) {
+        text << "blocks " << manifestBlocks << '\n'
+             << "# Completed ranges: done <start sector> <sector count>\n";
+        for (const auto& range : doneRanges) {
+            text << "done " << range.first << ' ' << range.second << '\n';
+        }
+    } else {
+        text << "records " << manifestRecords << '\n';
+    }
+
+    std::string content = text.str();
+    bool written = std::fwrite(content.data(), 1, content.size(), file) == content.size() && std::fflush(file) == 0;
+#ifdef _WIN32
+    written = written && _commit(_fileno(file)) == 0;
+#else
+    written = written && fsync(fileno(file)) == 0;
+#endif
+    written = std::fclose(file) == 0 && written;
+    if (!written) {
+        lastError_ = "Cannot write checkpoint: " + temporaryPath;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+
+    // Replace the previous checkpoint in one step
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        lastError_ = "Cannot replace checkpoint " + path + ": " + error.message();
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+uint64_t JobCheckpoint::doneSectors() const {
+    uint64_t total = 0;
+    for (const auto& range : doneRanges) {
+        total += range.second;
+    }
+    return total;
+}
+
+bool JobCheckpoint::exists(const std::string& path) {
+    std::error_code error;
+    return std::filesystem::exists(path, error);
+}
+
+bool JobCheckpoint::remove(const std::string& path) {
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    return !error;
+}
+
+const char* JobCheckpoint::kindName(Kind kind) {
+    return kind == Kind::Verify ? "verify" : "generate";
+}
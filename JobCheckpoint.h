@@ -0,0 +1,50 @@
+#ifndef JOB_CHECKPOINT_H
+#define JOB_CHECKPOINT_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Progress of a long generate or verify run, written next to its manifest at intervals so an
+// interrupted run (ESC, crash, reboot) can continue where it stopped instead of at sector 0.
+// Persisted as a small text file of "key value" lines; it is written to a temporary file, synced
+// and renamed over the previous one, so a crash leaves either the old or the new checkpoint.
+class JobCheckpoint {
+public:
+    enum class Kind { Generate, Verify };
+
+    Kind kind = Kind::Generate;
+    std::string diskPath;
+    uint64_t startSector = 0;       // Range of the job (generate) or of the manifest (verify)
+    uint64_t sectorCount = 0;
+    uint64_t timestamp = 0;         // Manifest timestamp, identifies the manifest being written or read
+
+    // Generate: whole manifest blocks written and the sector ranges their records cover
+    uint64_t manifestBlocks = 0;
+    std::map<uint64_t, uint64_t> doneRanges;    // start -> count
+
+    // Verify: merged manifest records checked, in manifest order
+    uint64_t manifestRecords = 0;
+
+    // Statistics up to this point
+    uint64_t processedCount = 0;
+    uint64_t corruptedCount = 0;
+    uint64_t unreadableCount = 0;
+    uint64_t savedAt = 0;           // Seconds since the epoch
+
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    uint64_t doneSectors() const;
+
+    static bool exists(const std::string& path);
+    static bool remove(const std::string& path);
+    static const char* kindName(Kind kind);
+
+    std::string getLastError() const { return lastError_; }
+
+private:
+    mutable std::string lastError_;
+};
+
+#endif // JOB_CHECKPOINT_H
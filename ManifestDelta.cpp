@@ -0,0 +1,667 @@
+#include "ManifestDelta.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+
+// Sort one delta layer by sector; a sector recorded twice keeps its last CRC
+static void sortLayer(std::vector<uint64_t>& sectors, std::vector<uint32_t>& crcs) {
+    std::vector<size_t> order(sectors.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return sectors[a] < sectors[b];
+    });
+
+    std::vector<uint64_t> sortedSectors;
+    std::vector<uint32_t> sortedCrcs;
+    sortedSectors.reserve(order.size());
+    sortedCrcs.reserve(order.size());
+    for (size_t index : order) {
+        if (!sortedSectors.empty() && sortedSectors.back() == sectors[index]) {
+            sortedCrcs.back() = crcs[index];
+        } else {
+            sortedSectors.push_back(sectors[index]);
+            sortedCrcs.push_back(crcs[index]);
+        }
+    }
+
+    sectors.swap(sortedSectors);
+    crcs.swap(sortedCrcs);
+}
+
+ManifestChainView::ManifestChainView()
+    : rootCursor_(0), overlayCursor_(0), rootIndexed_(false), sortedCursor_(0), sortedOverlayCursor_(0),
+      sortedPosition_(0) {
+}
+
+ManifestChainView::~ManifestChainView() {
+    close();
+}
+
+bool ManifestChainView::open(const std::string& manifestPath) {
+    close();
+
+    ChecksumManifestReader reader;
+    if (!reader.open(manifestPath)) {
+        lastError_ = reader.getLastError();
+        return false;
+    }
+
+    topInfo_ = reader.info();
+    chainPaths_.push_back(manifestPath);
+
+    // Walk down to the full manifest, loading each delta layer (newest first)
+    std::vector<std::vector<uint64_t>> layerSectors;
+    std::vector<std::vector<uint32_t>> layerCrcs;
+    std::string currentPath = manifestPath;
+
+    while (reader.info().format == ManifestFormat::Delta) {
+        if (chainPaths_.size() > MANIFEST_MAX_CHAIN_DEPTH) {
+            lastError_ = "Delta chain is deeper than " + std::to_string(MANIFEST_MAX_CHAIN_DEPTH) +
+                         " manifests: " + manifestPath;
+            close();
+            return false;
+        }
+
+        const ManifestInfo delta = reader.info();
+        layerSectors.emplace_back();
+        layerCrcs.emplace_back();
+        if (!reader.readColumns(0, delta.recordCount, layerSectors.back(), layerCrcs.back())) {
+            lastError_ = reader.getLastError() + ": " + currentPath;
+            close();
+            return false;
+        }
+        sortLayer(layerSectors.back(), layerCrcs.back());
+
+        std::string basePath = resolveBasePath(currentPath, delta.baseManifest);
+        if (!reader.open(basePath)) {
+            lastError_ = "Cannot open base manifest " + basePath + " of " + currentPath + ": " + reader.getLastError();
+            close();
+            return false;
+        }
+        // Every layer must use the same CRC, the merged records are checked with one of them
+        if (reader.info().legacyCrc != topInfo_.legacyCrc) {
+            lastError_ = "Delta chain mixes manifests of the old and the current CRC-32 table: " + currentPath;
+            close();
+            return false;
+        }
+
+        if (reader.info().timestamp != delta.baseTimestamp || reader.info().recordCount != delta.baseRecordCount) {
+            lastError_ = "Base manifest " + basePath + " has changed since " + currentPath + " was written";
+            close();
+            return false;
+        }
+
+        currentPath = basePath;
+        chainPaths_.push_back(currentPath);
+    }
+    reader.close();
+
+    if (!root_.open(currentPath)) {
+        lastError_ = root_.getLastError();
+        close();
+        return false;
+    }
+
+    // Collapse the layers oldest to newest so newer CRCs replace older ones
+    for (size_t layer = layerSectors.size(); layer-- > 0;) {
+        const std::vector<uint64_t>& sectors = layerSectors[layer];
+        const std::vector<uint32_t>& crcs = layerCrcs[layer];
+
+        std::vector<uint64_t> mergedSectors;
+        std::vector<uint32_t> mergedCrcs;
+        mergedSectors.reserve(overlaySectors_.size() + sectors.size());
+        mergedCrcs.reserve(overlaySectors_.size() + sectors.size());
+
+        size_t i = 0, j = 0;
+        while (i < overlaySectors_.size() || j < sectors.size()) {
+            if (j >= sectors.size() || (i < overlaySectors_.size() && overlaySectors_[i] < sectors[j])) {
+                mergedSectors.push_back(overlaySectors_[i]);
+                mergedCrcs.push_back(overlayCrcs_[i]);
+                ++i;
+            } else {
+                if (i < overlaySectors_.size() && overlaySectors_[i] == sectors[j]) {
+                    ++i;
+                }
+                mergedSectors.push_back(sectors[j]);
+                mergedCrcs.push_back(crcs[j]);
+                ++j;
+            }
+        }
+
+        overlaySectors_.swap(mergedSectors);
+        overlayCrcs_.swap(mergedCrcs);
+    }
+
+    // Only the newest layer's sector range is part of the view
+    if (chainPaths_.size() > 1) {
+        size_t out = 0;
+        for (size_t i = 0; i < overlaySectors_.size(); ++i) {
+            if (inTopRange(overlaySectors_[i])) {
+                overlaySectors_[out] = overlaySectors_[i];
+                overlayCrcs_[out] = overlayCrcs_[i];
+                ++out;
+            }
+        }
+        overlaySectors_.resize(out);
+        overlayCrcs_.resize(out);
+    }
+
+    rewind();
+    return true;
+}
+
+void ManifestChainView::close() {
+    root_.close();
+    topInfo_ = ManifestInfo();
+    chainPaths_.clear();
+    overlaySectors_.clear();
+    overlayCrcs_.clear();
+    overlayMatched_.clear();
+    rootCursor_ = 0;
+    overlayCursor_ = 0;
+    rootChunks_.clear();
+    rootIndexed_ = false;
+    sortedRoot_.close();
+    if (!sortedRootPath_.empty()) {
+        std::remove(sortedRootPath_.c_str());
+        sortedRootPath_.clear();
+    }
+}
+
+void ManifestChainView::rewind() {
+    rootCursor_ = 0;
+    overlayCursor_ = 0;
+    overlayMatched_.assign(overlaySectors_.size(), 0);
+    sortedCursor_ = 0;
+    sortedOverlayCursor_ = 0;
+    sortedPosition_ = 0;
+    sortedSectors_.clear();
+    sortedCrcs_.clear();
+}
+
+bool ManifestChainView::inTopRange(uint64_t sector) const {
+    if (chainPaths_.size() <= 1) {
+        return true;
+    }
+    return sector >= topInfo_.startSector && sector - topInfo_.startSector < topInfo_.sectorCount;
+}
+
+bool ManifestChainView::readNext(uint64_t maxRecords, std::vector<uint64_t>& sectors, std::vector<uint32_t>& crcs) {
+    sectors.clear();
+    crcs.clear();
+
+    if (!root_.isOpen()) {
+        lastError_ = "Checksum file is not open";
+        return false;
+    }
+
+    while (sectors.size() < maxRecords) {
+        // Stream the full manifest, patching sectors that a delta has replaced
+        if (rootCursor_ < root_.info().recordCount) {
+            if (!root_.readColumns(rootCursor_, maxRecords - sectors.size(), rootSectors_, rootCrcs_)) {
+                lastError_ = root_.getLastError();
+                return false;
+            }
+            rootCursor_ += rootSectors_.size();
+
+            for (size_t i = 0; i < rootSectors_.size(); ++i) {
+                uint64_t sector = rootSectors_[i];
+                if (!inTopRange(sector)) {
+                    continue;
+                }
+
+                uint32_t crc = rootCrcs_[i];
+                if (!overlaySectors_.empty()) {
+                    auto it = std::lower_bound(overlaySectors_.begin(), overlaySectors_.end(), sector);
+                    if (it != overlaySectors_.end() && *it == sector) {
+                        size_t index = it - overlaySectors_.begin();
+                        crc = overlayCrcs_[index];
+                        overlayMatched_[index] = 1;
+                    }
+                }
+
+                sectors.push_back(sector);
+                crcs.push_back(crc);
+            }
+            continue;
+        }
+
+        // Then emit sectors that only exist in the deltas
+        while (overlayCursor_ < overlaySectors_.size() && sectors.size() < maxRecords) {
+            if (!overlayMatched_[overlayCursor_]) {
+                sectors.push_back(overlaySectors_[overlayCursor_]);
+                crcs.push_back(overlayCrcs_[overlayCursor_]);
+            }
+            ++overlayCursor_;
+        }
+        break;
+    }
+
+    return true;
+}
+
+bool ManifestChainView::readSorted(uint64_t maxRecords, std::vector<uint64_t>& sectors, std::vector<uint32_t>& crcs) {
+    sectors.clear();
+    crcs.clear();
+
+    if (!root_.isOpen()) {
+        lastError_ = "Checksum file is not open";
+        return false;
+    }
+    if (!rootIndexed_ && !indexRoot()) {
+        return false;
+    }
+
+    // Two-cursor merge of the ordered root and the overlay; an overlay record replaces the root's
+    ChecksumManifestReader& root = orderedRoot();
+    const uint64_t rootRecords = root.info().recordCount;
+    while (sectors.size() < maxRecords) {
+        if (sortedPosition_ >= sortedSectors_.size() && sortedCursor_ < rootRecords) {
+            if (!root.readColumns(sortedCursor_, maxRecords, sortedSectors_, sortedCrcs_)) {
+                lastError_ = root.getLastError();
+                return false;
+            }
+            sortedCursor_ = sortedSectors_.empty() ? rootRecords : sortedCursor_ + sortedSectors_.size();
+            sortedPosition_ = 0;
+        }
+
+        bool rootLeft = sortedPosition_ < sortedSectors_.size();
+        bool overlayLeft = sortedOverlayCursor_ < overlaySectors_.size();
+        if (!rootLeft && !overlayLeft) {
+            break;
+        }
+        if (rootLeft && !inTopRange(sortedSectors_[sortedPosition_])) {
+            ++sortedPosition_;
+            continue;
+        }
+
+        if (overlayLeft && (!rootLeft || overlaySectors_[sortedOverlayCursor_] <= sortedSectors_[sortedPosition_])) {
+            if (rootLeft && overlaySectors_[sortedOverlayCursor_] == sortedSectors_[sortedPosition_]) {
+                ++sortedPosition_;
+            }
+            sectors.push_back(overlaySectors_[sortedOverlayCursor_]);
+            crcs.push_back(overlayCrcs_[sortedOverlayCursor_]);
+            ++sortedOverlayCursor_;
+        } else {
+            sectors.push_back(sortedSectors_[sortedPosition_]);
+            crcs.push_back(sortedCrcs_[sortedPosition_]);
+            ++sortedPosition_;
+        }
+    }
+
+    return true;
+}
+
+bool ManifestChainView::readAll(std::vector<SectorChecksum>& checksums) {
+    const uint64_t CHUNK_RECORDS = 1 << 20;
+    std::vector<uint64_t> sectors;
+    std::vector<uint32_t> crcs;
+
+    checksums.clear();
+    checksums.reserve(root_.info().recordCount + overlaySectors_.size());
+
+    rewind();
+    while (true) {
+        if (!readNext(CHUNK_RECORDS, sectors, crcs)) {
+            return false;
+        }
+        if (sectors.empty()) {
+            break;
+        }
+        for (size_t i = 0; i < sectors.size(); ++i) {
+            checksums.push_back(SectorChecksum{sectors[i], crcs[i], topInfo_.timestamp});
+        }
+    }
+    rewind();
+
+    return true;
+}
+
+bool ManifestChainView::indexChunks(ChecksumManifestReader& reader, bool& ordered) {
+    const uint64_t CHUNK_RECORDS = 1 << 16;
+    std::vector<uint64_t> sectors;
+    std::vector<uint32_t> crcs;
+
+    rootChunks_.clear();
+    ordered = true;
+    for (uint64_t first = 0; first < reader.info().recordCount; first += CHUNK_RECORDS) {
+        if (!reader.readColumns(first, CHUNK_RECORDS, sectors, crcs)) {
+            lastError_ = reader.getLastError();
+            return false;
+        }
+        if (sectors.empty()) {
+            break;
+        }
+        if (std::adjacent_find(sectors.begin(), sectors.end(), std::greater_equal<uint64_t>()) != sectors.end() ||
+            (!rootChunks_.empty() && sectors.front() <= rootChunks_.back().maxSector)) {
+            ordered = false;
+            return true;
+        }
+        rootChunks_.push_back(RootChunk{first, sectors.size(), sectors.front(), sectors.back()});
+    }
+    return true;
+}
+
+bool ManifestChainView::indexRoot() {
+    bool ordered = false;
+    if (!indexChunks(root_, ordered)) {
+        return false;
+    }
+
+    // Overlapping chunks would make every window rescan the whole root, so sort it once instead
+    if (!ordered) {
+        static std::atomic<uint64_t> sortSequence(0);
+        std::error_code ec;
+        std::filesystem::path directory = std::filesystem::temp_directory_path(ec);
+        if (ec) {
+            directory = std::filesystem::path(chainPaths_.back()).parent_path();
+        }
+        uint64_t stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+        sortedRootPath_ = (directory / ("crcrecover-" + std::to_string(stamp) + "-" +
+                                        std::to_string(sortSequence++) + ".sorted.crc")).string();
+
+        ManifestSorter sorter;
+        if (!sorter.sort(root_, sortedRootPath_)) {
+            lastError_ = "Cannot sort manifest " + chainPaths_.back() + ": " + sorter.getLastError();
+            sortedRootPath_.clear();
+            return false;
+        }
+        if (!sortedRoot_.open(sortedRootPath_) || !indexChunks(sortedRoot_, ordered)) {
+            if (!sortedRoot_.isOpen()) {
+                lastError_ = sortedRoot_.getLastError();
+            }
+            return false;
+        }
+    }
+
+    rootIndexed_ = true;
+    return true;
+}
+
+bool ManifestChainView::readWindow(uint64_t firstSector, uint64_t sectorCount,
+                                   std::vector<uint32_t>& crcs, std::vector<uint8_t>& present) {
+    crcs.assign(sectorCount, 0);
+    present.assign(sectorCount, 0);
+
+    if (!root_.isOpen()) {
+        lastError_ = "Checksum file is not open";
+        return false;
+    }
+    if (!rootIndexed_ && !indexRoot()) {
+        return false;
+    }
+    if (sectorCount == 0) {
+        return true;
+    }
+    const uint64_t lastSector = firstSector + sectorCount - 1;
+
+    // Chunks are in ascending, disjoint sector order: start at the first one that reaches the window
+    ChecksumManifestReader& root = orderedRoot();
+    std::vector<uint64_t> sectors;
+    std::vector<uint32_t> chunkCrcs;
+    auto chunk = std::lower_bound(rootChunks_.begin(), rootChunks_.end(), firstSector,
+                                  [](const RootChunk& c, uint64_t sector) { return c.maxSector < sector; });
+    for (; chunk != rootChunks_.end() && chunk->minSector <= lastSector; ++chunk) {
+        if (!root.readColumns(chunk->firstRecord, chunk->recordCount, sectors, chunkCrcs)) {
+            lastError_ = root.getLastError();
+            return false;
+        }
+        for (size_t i = 0; i < sectors.size(); ++i) {
+            if (sectors[i] >= firstSector && sectors[i] <= lastSector && inTopRange(sectors[i])) {
+                crcs[sectors[i] - firstSector] = chunkCrcs[i];
+                present[sectors[i] - firstSector] = 1;
+            }
+        }
+    }
+
+    // The collapsed delta layers replace whatever the root holds
+    auto it = std::lower_bound(overlaySectors_.begin(), overlaySectors_.end(), firstSector);
+    for (; it != overlaySectors_.end() && *it <= lastSector; ++it) {
+        size_t index = it - overlaySectors_.begin();
+        crcs[*it - firstSector] = overlayCrcs_[index];
+        present[*it - firstSector] = 1;
+    }
+
+    return true;
+}
+
+std::string ManifestChainView::resolveBasePath(const std::string& deltaPath, const std::string& baseName) {
+    std::filesystem::path base(baseName);
+    if (base.is_relative()) {
+        std::error_code ec;
+        std::filesystem::path candidate = std::filesystem::path(deltaPath).parent_path() / base;
+        if (std::filesystem::exists(candidate, ec)) {
+            return candidate.string();
+        }
+    }
+    return baseName;
+}
+
+ChecksumDeltaWriter::ChecksumDeltaWriter() : recordCount_(0), lastSector_(0) {
+}
+
+ChecksumDeltaWriter::~ChecksumDeltaWriter() {
+    // A delta that was never closed is incomplete; finalizing it would claim unchanged sectors
+    abandon();
+}
+
+bool ChecksumDeltaWriter::open(const std::string& outputFile, const std::string& baseManifest,
+                               uint64_t startSector, uint64_t sectorCount, uint64_t timestamp) {
+    outputFile_ = outputFile;
+    recordCount_ = 0;
+    lastSector_ = 0;
+    buffer_.clear();
+
+    ChecksumManifestReader base;
+    if (!base.open(baseManifest)) {
+        lastError_ = "Cannot open base manifest: " + base.getLastError();
+        return false;
+    }
+    const ManifestInfo baseInfo = base.info();
+    base.close();
+
+    // Current CRCs differ from old-table ones almost everywhere, so such a delta would hold every sector
+    if (baseInfo.legacyCrc) {
+        lastError_ = "Base manifest was written with the old CRC-32 table; write a full manifest instead: " + baseManifest;
+        return false;
+    }
+
+    uint32_t chainDepth = (baseInfo.format == ManifestFormat::Delta) ? baseInfo.chainDepth + 1 : 1;
+    if (chainDepth > MANIFEST_MAX_CHAIN_DEPTH) {
+        lastError_ = "Delta chain would exceed " + std::to_string(MANIFEST_MAX_CHAIN_DEPTH) +
+                     " manifests; write a full manifest instead";
+        return false;
+    }
+
+    // Store the base relative to the delta so snapshot directories can be moved as a whole
+    std::error_code ec;
+    std::filesystem::path outputDir = std::filesystem::absolute(outputFile, ec).parent_path();
+    std::filesystem::path baseAbsolute = std::filesystem::absolute(baseManifest, ec);
+    std::filesystem::path relative = baseAbsolute.lexically_relative(outputDir);
+    std::string baseName = relative.empty() ? baseAbsolute.string() : relative.generic_string();
+
+    file_.open(outputFile, std::ios::binary);
+    if (!file_.is_open()) {
+        lastError_ = "Cannot create output file: " + outputFile;
+        return false;
+    }
+
+    uint32_t magic = MANIFEST_MAGIC_DELTA;
+    uint32_t version = MANIFEST_DELTA_UNFINISHED_VERSION;   // close() writes the real version
+    uint64_t recordCount = 0;
+    uint32_t baseNameLength = static_cast<uint32_t>(baseName.size());
+
+    file_.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+    file_.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    file_.write(reinterpret_cast<const char*>(&startSector), sizeof(startSector));
+    file_.write(reinterpret_cast<const char*>(&sectorCount), sizeof(sectorCount));
+    file_.write(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
+    file_.write(reinterpret_cast<const char*>(&recordCount), sizeof(recordCount));
+    file_.write(reinterpret_cast<const char*>(&baseInfo.timestamp), sizeof(baseInfo.timestamp));
+    file_.write(reinterpret_cast<const char*>(&baseInfo.recordCount), sizeof(baseInfo.recordCount));
+    file_.write(reinterpret_cast<const char*>(&chainDepth), sizeof(chainDepth));
+    file_.write(reinterpret_cast<const char*>(&baseNameLength), sizeof(baseNameLength));
+    file_.write(baseName.data(), baseNameLength);
+
+    return file_.good();
+}
+
+bool ChecksumDeltaWriter::append(uint64_t sectorNumber, uint32_t crc32) {
+    if (recordCount_ > 0 && sectorNumber <= lastSector_) {
+        lastError_ = "Delta records must be in ascending sector order";
+        return false;
+    }
+
+    size_t offset = buffer_.size();
+    buffer_.resize(offset + MANIFEST_COMPACT_RECORD_SIZE);
+    std::copy_n(reinterpret_cast<const uint8_t*>(&sectorNumber), sizeof(sectorNumber), buffer_.data() + offset);
+    std::copy_n(reinterpret_cast<const uint8_t*>(&crc32), sizeof(crc32), buffer_.data() + offset + sizeof(sectorNumber));
+
+    lastSector_ = sectorNumber;
+    recordCount_++;
+
+    if (buffer_.size() >= 1024 * 1024) {
+        return flushBuffer();
+    }
+    return true;
+}
+
+bool ChecksumDeltaWriter::flushBuffer() {
+    if (!buffer_.empty()) {
+        file_.write(reinterpret_cast<const char*>(buffer_.data()), buffer_.size());
+        buffer_.clear();
+    }
+    if (!file_.good()) {
+        lastError_ = "Failed to write delta manifest: " + outputFile_;
+        return false;
+    }
+    return true;
+}
+
+bool ChecksumDeltaWriter::close() {
+    if (!file_.is_open()) {
+        return true;
+    }
+
+    bool ok = flushBuffer();
+    if (ok) {
+        uint32_t version = MANIFEST_DELTA_VERSION;
+        file_.seekp(static_cast<std::streamoff>(MANIFEST_DELTA_RECORD_COUNT_OFFSET), std::ios::beg);
+        file_.write(reinterpret_cast<const char*>(&recordCount_), sizeof(recordCount_));
+        file_.flush();
+        file_.seekp(static_cast<std::streamoff>(sizeof(uint32_t)), std::ios::beg);
+        file_.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        file_.flush();
+        ok = file_.good();
+        if (!ok) {
+            lastError_ = "Failed to finalize delta manifest: " + outputFile_;
+        }
+    }
+
+    file_.close();
+    if (!ok) {
+        std::remove(outputFile_.c_str());
+    }
+    return ok;
+}
+
+void ChecksumDeltaWriter::abandon() {
+    if (file_.is_open()) {
+        file_.close();
+        std::remove(outputFile_.c_str());
+    }
+}
+
+bool ManifestDelta::create(const std::string& baseManifest, const std::string& currentManifest,
+                           const std::string& deltaFile) {
+    const uint64_t CHUNK_RECORDS = 1 << 20;
+    changedSectors_ = 0;
+
+    ManifestChainView current;
+    if (!current.open(currentManifest)) {
+        lastError_ = current.getLastError();
+        return false;
+    }
+
+    std::vector<uint64_t> sectors;
+    std::vector<uint32_t> crcs;
+    uint64_t startSector = current.info().startSector;
+    uint64_t sectorCount = current.info().sectorCount;
+
+    // Compact manifests carry no header, so derive their range from the records
+    if (current.info().format == ManifestFormat::Compact) {
+        uint64_t minSector = UINT64_MAX, maxSector = 0;
+        while (current.readNext(CHUNK_RECORDS, sectors, crcs) && !sectors.empty()) {
+            auto bounds = std::minmax_element(sectors.begin(), sectors.end());
+            minSector = std::min(minSector, *bounds.first);
+            maxSector = std::max(maxSector, *bounds.second);
+        }
+        current.rewind();
+        startSector = (minSector == UINT64_MAX) ? 0 : minSector;
+        sectorCount = (minSector == UINT64_MAX) ? 0 : maxSector - minSector + 1;
+    }
+
+    ManifestChainView base;
+    if (!base.open(baseManifest)) {
+        lastError_ = base.getLastError();
+        return false;
+    }
+    if (current.info().legacyCrc) {
+        lastError_ = "Manifest was written with the old CRC-32 table and cannot be stored as a delta: " + currentManifest;
+        return false;
+    }
+
+    uint64_t timestamp = current.info().timestamp;
+    if (timestamp == 0) {
+        timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    ChecksumDeltaWriter writer;
+    if (!writer.open(deltaFile, baseManifest, startSector, sectorCount, timestamp)) {
+        lastError_ = writer.getLastError();
+        return false;
+    }
+
+    // Both sides are compared window by window, which also puts the records in sector order
+    std::vector<uint32_t> currentCrcs, baseCrcs;
+    std::vector<uint8_t> currentPresent, basePresent;
+    for (uint64_t windowStart = startSector; windowStart - startSector < sectorCount;
+         windowStart += ManifestChainView::WINDOW_SECTORS) {
+        uint64_t windowCount = std::min(ManifestChainView::WINDOW_SECTORS, sectorCount - (windowStart - startSector));
+        if (!current.readWindow(windowStart, windowCount, currentCrcs, currentPresent)) {
+            lastError_ = current.getLastError();
+            return false;
+        }
+        if (!base.readWindow(windowStart, windowCount, baseCrcs, basePresent)) {
+            lastError_ = base.getLastError();
+            return false;
+        }
+        for (uint64_t i = 0; i < windowCount; ++i) {
+            // Records can only add or replace CRCs; a sector the base knows would silently keep its
+            // old CRC if the newer snapshot dropped it, so such a snapshot needs a full manifest
+            if (basePresent[i] && !currentPresent[i]) {
+                lastError_ = "Sector " + std::to_string(windowStart + i) + " is missing from " + currentManifest +
+                             " but present in " + baseManifest + "; a delta cannot drop sectors, write a full manifest";
+                return false;
+            }
+            if (currentPresent[i] && (!basePresent[i] || baseCrcs[i] != currentCrcs[i]) &&
+                !writer.append(windowStart + i, currentCrcs[i])) {
+                lastError_ = writer.getLastError();
+                return false;
+            }
+        }
+    }
+
+    if (!writer.close()) {
+        lastError_ = writer.getLastError();
+        return false;
+    }
+
+    changedSectors_ = writer.recordCount();
+    return true;
+}
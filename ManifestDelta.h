@@ -0,0 +1,158 @@
+#ifndef MANIFEST_DELTA_H
+#define MANIFEST_DELTA_H
+
+#include "ChecksumManifest.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+
+// Maximum number of deltas stacked on top of a full manifest
+static constexpr uint32_t MANIFEST_MAX_CHAIN_DEPTH = 64;
+
+// Read-only merged view over a manifest and, for delta manifests, its whole base chain.
+// The full manifest at the root of the chain is streamed in chunks and patched on the fly
+// with the (small) delta records, so opening a chain never loads the base into memory.
+class ManifestChainView {
+public:
+    // Largest window readWindow() callers are expected to ask for
+    static constexpr uint64_t WINDOW_SECTORS = 1 << 20;
+
+    ManifestChainView();
+    ~ManifestChainView();
+
+    bool open(const std::string& manifestPath);
+    void close();
+
+    // Header of the manifest that was opened (the newest layer)
+    const ManifestInfo& info() const { return topInfo_; }
+
+    // Number of files in the chain, 1 for a full manifest
+    size_t chainLength() const { return chainPaths_.size(); }
+    const std::vector<std::string>& chainPaths() const { return chainPaths_; }
+
+    // Restart streaming from the first record
+    void rewind();
+
+    // Stream up to maxRecords merged records; an empty result marks the end of the view
+    bool readNext(uint64_t maxRecords, std::vector<uint64_t>& sectors, std::vector<uint32_t>& crcs);
+
+    // Stream up to maxRecords merged records in ascending sector order, one per sector; an empty
+    // result marks the end. Uses the ordered root readWindow() builds, with its own cursor (rewind()
+    // restarts it too).
+    bool readSorted(uint64_t maxRecords, std::vector<uint64_t>& sectors, std::vector<uint32_t>& crcs);
+
+    // Upper bound of the records the view streams
+    uint64_t recordBound() const { return root_.info().recordCount + overlaySectors_.size(); }
+
+    // Materialise the whole merged view (timestamps are taken from the newest header)
+    bool readAll(std::vector<SectorChecksum>& checksums);
+
+    // CRCs of the window [firstSector, firstSector + sectorCount), indexed by sector - firstSector;
+    // present[i] marks known sectors. The first call indexes the root in chunks with their sector
+    // bounds; a root whose records are not in strictly ascending order (v1, compact or parallel
+    // v2 output) is first sorted once into a temporary v2 manifest. Every window then reads only
+    // the chunks that hold its sectors, so walking a range window by window reads the root once.
+    bool readWindow(uint64_t firstSector, uint64_t sectorCount,
+                    std::vector<uint32_t>& crcs, std::vector<uint8_t>& present);
+
+    std::string getLastError() const { return lastError_; }
+
+    // Locate the base of a delta manifest: relative names are tried next to the delta first
+    static std::string resolveBasePath(const std::string& deltaPath, const std::string& baseName);
+
+private:
+    ManifestInfo topInfo_;
+    std::vector<std::string> chainPaths_;
+    ChecksumManifestReader root_;
+    std::string lastError_;
+
+    // Collapsed delta records, sorted by sector, newest layer wins
+    std::vector<uint64_t> overlaySectors_;
+    std::vector<uint32_t> overlayCrcs_;
+    std::vector<uint8_t> overlayMatched_;
+
+    uint64_t rootCursor_;
+    uint64_t overlayCursor_;
+    std::vector<uint64_t> rootSectors_;
+    std::vector<uint32_t> rootCrcs_;
+
+    // Sector bounds of consecutive chunks of the ordered root, built by the first readWindow()
+    struct RootChunk {
+        uint64_t firstRecord;
+        uint64_t recordCount;
+        uint64_t minSector;
+        uint64_t maxSector;
+    };
+    std::vector<RootChunk> rootChunks_;
+    bool rootIndexed_;
+
+    // Sorted copy of an unordered root, removed by close()
+    ChecksumManifestReader sortedRoot_;
+    std::string sortedRootPath_;
+
+    // readSorted() position in the ordered root and the overlay
+    uint64_t sortedCursor_;
+    uint64_t sortedOverlayCursor_;
+    size_t sortedPosition_;
+    std::vector<uint64_t> sortedSectors_;
+    std::vector<uint32_t> sortedCrcs_;
+
+    bool inTopRange(uint64_t sector) const;
+    bool indexRoot();
+    bool indexChunks(ChecksumManifestReader& reader, bool& ordered);
+    ChecksumManifestReader& orderedRoot() { return sortedRoot_.isOpen() ? sortedRoot_ : root_; }
+};
+
+// Writer for delta manifests: records only sectors whose CRC differs from the base view
+class ChecksumDeltaWriter {
+public:
+    ChecksumDeltaWriter();
+    ~ChecksumDeltaWriter();
+
+    // The base may itself be a delta; its identity is recorded so stale chains are detected
+    bool open(const std::string& outputFile, const std::string& baseManifest,
+              uint64_t startSector, uint64_t sectorCount, uint64_t timestamp);
+
+    // Records must be appended in ascending sector order
+    bool append(uint64_t sectorNumber, uint32_t crc32);
+
+    // Flush buffered records and patch the record count and version into the header. Until then
+    // the version reads 0, so readers reject an interrupted delta instead of taking the missing
+    // records for unchanged sectors.
+    bool close();
+
+    // Drop an unfinished delta (error or cancellation); also what the destructor does
+    void abandon();
+
+    uint64_t recordCount() const { return recordCount_; }
+    std::string getLastError() const { return lastError_; }
+
+private:
+    std::ofstream file_;
+    std::string outputFile_;
+    std::string lastError_;
+    std::vector<uint8_t> buffer_;
+    uint64_t recordCount_;
+    uint64_t lastSector_;
+
+    bool flushBuffer();
+};
+
+// Builds delta manifests from existing snapshots
+class ManifestDelta {
+public:
+    // Store only the sectors of currentManifest whose CRC differs from baseManifest. Fails if
+    // currentManifest lacks a sector of its range that the base has: deltas cannot drop sectors.
+    bool create(const std::string& baseManifest, const std::string& currentManifest,
+                const std::string& deltaFile);
+
+    uint64_t changedSectors() const { return changedSectors_; }
+    std::string getLastError() const { return lastError_; }
+
+private:
+    uint64_t changedSectors_ = 0;
+    std::string lastError_;
+};
+
+#endif // MANIFEST_DELTA_H
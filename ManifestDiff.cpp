@@ -0,0 +1,350 @@
+#include "ManifestDiff.h"
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MANIFEST_DIFF_SSE2
+#endif
+
+// Append the indices where the two CRC columns differ
+static void collectMismatches(const uint32_t* a, const uint32_t* b, size_t count,
+                              std::vector<size_t>& mismatches) {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    for (; i + 8 <= count; i += 8) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        int equalMask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(va, vb)));
+        if (equalMask != 0xFF) {
+            for (int lane = 0; lane < 8; ++lane) {
+                if (!(equalMask & (1 << lane))) {
+                    mismatches.push_back(i + lane);
+                }
+            }
+        }
+    }
+#elif defined(MANIFEST_DIFF_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        int equalMask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(va, vb)));
+        if (equalMask != 0xF) {
+            for (int lane = 0; lane < 4; ++lane) {
+                if (!(equalMask & (1 << lane))) {
+                    mismatches.push_back(i + lane);
+                }
+            }
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        if (a[i] != b[i]) {
+            mismatches.push_back(i);
+        }
+    }
+}
+
+// Extend the last range if the sector is contiguous, otherwise start a new one
+static void appendSector(std::vector<SectorRange>& ranges, uint64_t sector) {
+    if (!ranges.empty() && ranges.back().firstSector + ranges.back().sectorCount == sector) {
+        ranges.back().sectorCount++;
+    } else {
+        ranges.push_back(SectorRange{sector, 1});
+    }
+}
+
+ManifestDiff::ManifestDiff() : chunkRecords_(1 << 20) {
+}
+
+bool ManifestDiff::compare(const std::string& oldManifest, const std::string& newManifest,
+                           ManifestDiffResult& result, int threadCount,
+                           std::function<void(int, int)> progressCallback) {
+    oldPath_ = oldManifest;
+    newPath_ = newManifest;
+    result = ManifestDiffResult{{}, 0, 0, 0, 0, false, {}};
+
+    ChecksumManifestReader oldReader;
+    ChecksumManifestReader newReader;
+    if (!oldReader.open(oldManifest)) {
+        lastError_ = oldReader.getLastError();
+        return false;
+    }
+    if (!newReader.open(newManifest)) {
+        lastError_ = newReader.getLastError();
+        return false;
+    }
+
+    if (threadCount <= 0) threadCount = std::thread::hardware_concurrency();
+    if (threadCount <= 0) threadCount = 4;
+
+    const ManifestInfo oldInfo = oldReader.info();
+    const ManifestInfo newInfo = newReader.info();
+    oldReader.close();
+    newReader.close();
+
+    // Two legacy-CRC manifests still compare fine with each other, just not with a current one
+    if (oldInfo.legacyCrc != newInfo.legacyCrc) {
+        lastError_ = "Cannot compare a manifest written with the old CRC-32 table against a current one; "
+                     "regenerate " + (oldInfo.legacyCrc ? oldManifest : newManifest);
+        return false;
+    }
+
+    // Same record count: try the positional column compare first
+    bool fullManifests = oldInfo.format != ManifestFormat::Delta && newInfo.format != ManifestFormat::Delta;
+    if (fullManifests && oldInfo.recordCount == newInfo.recordCount) {
+        bool misaligned = false;
+        if (compareAligned(oldInfo, threadCount, result, misaligned, progressCallback)) {
+            return true;
+        }
+        if (!misaligned) {
+            return false;
+        }
+        result = ManifestDiffResult{{}, 0, 0, 0, 0, false, {}};
+    }
+
+    return compareSorted(result, progressCallback);
+}
+
+bool ManifestDiff::compareAligned(const ManifestInfo& oldInfo, int threadCount, ManifestDiffResult& result,
+                                  bool& misaligned, std::function<void(int, int)> progressCallback) {
+    const uint64_t recordCount = oldInfo.recordCount;
+    const uint64_t chunkCount = (recordCount + chunkRecords_ - 1) / chunkRecords_;
+
+    std::vector<std::vector<SectorRange>> chunkRanges(chunkCount);
+    std::atomic<uint64_t> nextChunk(0);
+    uint64_t completedChunks = 0;
+    std::atomic<uint64_t> modifiedCount(0);
+    std::atomic<bool> diverged(false);
+    std::atomic<bool> failed(false);
+    std::mutex errorMutex;
+    std::mutex progressMutex;
+
+    auto worker = [&]() {
+        ChecksumManifestReader oldReader;
+        ChecksumManifestReader newReader;
+        if (!oldReader.open(oldPath_) || !newReader.open(newPath_)) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            lastError_ = !oldReader.isOpen() ? oldReader.getLastError() : newReader.getLastError();
+            failed = true;
+            return;
+        }
+
+        std::vector<uint64_t> oldSectors, newSectors;
+        std::vector<uint32_t> oldCrcs, newCrcs;
+        std::vector<size_t> mismatches;
+
+        // Chunks are handed out dynamically so uneven I/O latency balances itself
+        while (!diverged && !failed) {
+            uint64_t chunk = nextChunk.fetch_add(1);
+            if (chunk >= chunkCount) {
+                break;
+            }
+
+            uint64_t first = chunk * chunkRecords_;
+            if (!oldReader.readColumns(first, chunkRecords_, oldSectors, oldCrcs) ||
+                !newReader.readColumns(first, chunkRecords_, newSectors, newCrcs)) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                lastError_ = oldReader.getLastError().empty() ? newReader.getLastError() : oldReader.getLastError();
+                failed = true;
+                return;
+            }
+
+            if (oldSectors.size() != newSectors.size() ||
+                std::memcmp(oldSectors.data(), newSectors.data(), oldSectors.size() * sizeof(uint64_t)) != 0) {
+                diverged = true;
+                return;
+            }
+
+            mismatches.clear();
+            collectMismatches(oldCrcs.data(), newCrcs.data(), oldCrcs.size(), mismatches);
+
+            std::vector<SectorRange>& ranges = chunkRanges[chunk];
+            for (size_t index : mismatches) {
+                appendSector(ranges, oldSectors[index]);
+            }
+            modifiedCount += mismatches.size();
+
+            // Serialized so callers see one call at a time, in increasing order
+            if (progressCallback) {
+                std::lock_guard<std::mutex> lock(progressMutex);
+                progressCallback(static_cast<int>(++completedChunks), static_cast<int>(chunkCount));
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    int workers = static_cast<int>(std::min<uint64_t>(threadCount, std::max<uint64_t>(chunkCount, 1)));
+    for (int i = 0; i < workers; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (failed) {
+        return false;
+    }
+    if (diverged) {
+        misaligned = true;
+        return false;
+    }
+
+    for (auto& ranges : chunkRanges) {
+        result.changedRanges.insert(result.changedRanges.end(), ranges.begin(), ranges.end());
+    }
+    coalesceRanges(result.changedRanges);
+
+    result.comparedSectors = recordCount;
+    result.modifiedSectors = modifiedCount;
+    result.positionalCompare = true;
+    return true;
+}
+
+bool ManifestDiff::compareSorted(ManifestDiffResult& result, std::function<void(int, int)> progressCallback) {
+    ManifestChainView oldView;
+    ManifestChainView newView;
+    if (!oldView.open(oldPath_)) {
+        lastError_ = oldView.getLastError();
+        return false;
+    }
+    if (!newView.open(newPath_)) {
+        lastError_ = newView.getLastError();
+        return false;
+    }
+
+    std::vector<uint64_t> oldSectors, newSectors;
+    std::vector<uint32_t> oldCrcs, newCrcs;
+
+    // The first window may have to sort an unordered manifest, so fill both sides concurrently
+    bool oldRead = false;
+    std::thread oldLoader([&]() { oldRead = oldView.readSorted(chunkRecords_, oldSectors, oldCrcs); });
+    bool newRead = newView.readSorted(chunkRecords_, newSectors, newCrcs);
+    oldLoader.join();
+    if (!oldRead || !newRead) {
+        lastError_ = !oldRead ? oldView.getLastError() : newView.getLastError();
+        return false;
+    }
+
+    const uint64_t totalChunks = std::max<uint64_t>(
+        (oldView.recordBound() + newView.recordBound() + chunkRecords_ - 1) / chunkRecords_, 1);
+    uint64_t consumedRecords = 0;
+    auto reportProgress = [&]() {
+        if (progressCallback) {
+            progressCallback(static_cast<int>(std::min(consumedRecords / chunkRecords_, totalChunks)),
+                             static_cast<int>(totalChunks));
+        }
+    };
+
+    // Two-cursor merge; each view yields every sector once, in ascending order
+    size_t i = 0, j = 0;
+    while (true) {
+        if (i >= oldSectors.size() && !oldSectors.empty()) {
+            consumedRecords += oldSectors.size();
+            if (!oldView.readSorted(chunkRecords_, oldSectors, oldCrcs)) {
+                lastError_ = oldView.getLastError();
+                return false;
+            }
+            i = 0;
+            reportProgress();
+        }
+        if (j >= newSectors.size() && !newSectors.empty()) {
+            consumedRecords += newSectors.size();
+            if (!newView.readSorted(chunkRecords_, newSectors, newCrcs)) {
+                lastError_ = newView.getLastError();
+                return false;
+            }
+            j = 0;
+            reportProgress();
+        }
+
+        bool oldLeft = i < oldSectors.size();
+        bool newLeft = j < newSectors.size();
+        if (!oldLeft && !newLeft) {
+            break;
+        }
+
+        if (!newLeft || (oldLeft && oldSectors[i] < newSectors[j])) {
+            appendSector(result.changedRanges, oldSectors[i]);
+            appendSector(result.removedRanges, oldSectors[i]);
+            result.removedSectors++;
+            ++i;
+        } else if (!oldLeft || newSectors[j] < oldSectors[i]) {
+            appendSector(result.changedRanges, newSectors[j]);
+            result.addedSectors++;
+            ++j;
+        } else {
+            result.comparedSectors++;
+            if (oldCrcs[i] != newCrcs[j]) {
+                appendSector(result.changedRanges, oldSectors[i]);
+                result.modifiedSectors++;
+            }
+            ++i;
+            ++j;
+        }
+    }
+
+    coalesceRanges(result.changedRanges);
+    coalesceRanges(result.removedRanges);
+    result.positionalCompare = false;
+
+    if (progressCallback) {
+        progressCallback(static_cast<int>(totalChunks), static_cast<int>(totalChunks));
+    }
+    return true;
+}
+
+bool ManifestDiff::writeRanges(const std::string& outputFile, const ManifestDiffResult& result) {
+    std::ofstream outFile(outputFile);
+    if (!outFile.is_open()) {
+        lastError_ = "Cannot create output file: " + outputFile;
+        return false;
+    }
+
+    uint64_t changedSectors = result.modifiedSectors + result.addedSectors + result.removedSectors;
+    outFile << "# CRCRECOVER manifest diff" << std::endl;
+    outFile << "# old: " << oldPath_ << std::endl;
+    outFile << "# new: " << newPath_ << std::endl;
+    outFile << "# changed sectors: " << changedSectors << " in "
+            << result.changedRanges.size() << " ranges" << std::endl;
+    outFile << "# <first_sector> <sector_count>" << std::endl;
+
+    for (const auto& range : result.changedRanges) {
+        outFile << range.firstSector << " " << range.sectorCount << "\n";
+    }
+
+    outFile.close();
+    return true;
+}
+
+void ManifestDiff::coalesceRanges(std::vector<SectorRange>& ranges) {
+    if (ranges.empty()) {
+        return;
+    }
+
+    std::sort(ranges.begin(), ranges.end(), [](const SectorRange& a, const SectorRange& b) {
+        return a.firstSector < b.firstSector;
+    });
+
+    size_t out = 0;
+    for (size_t i = 1; i < ranges.size(); ++i) {
+        SectorRange& last = ranges[out];
+        uint64_t lastEnd = last.firstSector + last.sectorCount;
+        if (ranges[i].firstSector <= lastEnd) {
+            uint64_t end = std::max(lastEnd, ranges[i].firstSector + ranges[i].sectorCount);
+            last.sectorCount = end - last.firstSector;
+        } else {
+            ranges[++out] = ranges[i];
+        }
+    }
+    ranges.resize(out + 1);
+}
@@ -0,0 +1,59 @@
+#ifndef MANIFEST_DIFF_H
+#define MANIFEST_DIFF_H
+
+#include "ManifestDelta.h"
+#include "SectorExtent.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+// Result of comparing two manifests
+struct ManifestDiffResult {
+    std::vector<SectorRange> changedRanges;   // Sorted, coalesced ranges of every differing sector
+    uint64_t comparedSectors;                 // Sectors present in both manifests
+    uint64_t modifiedSectors;                 // Present in both with different CRCs
+    uint64_t addedSectors;                    // Only present in the new manifest
+    uint64_t removedSectors;                  // Only present in the old manifest
+    bool positionalCompare;                   // True when the aligned fast path was used
+    std::vector<SectorRange> removedRanges;   // Subset of changedRanges only present in the old manifest
+};
+
+// Snapshot-to-snapshot change detection between two checksum manifests.
+// Full manifests with identical record layout are compared column-wise in parallel chunks;
+// anything else (different ranges, unordered parallel output, delta chains) falls back to a
+// streaming two-cursor merge over the chain views in sector order, which sorts an unordered
+// manifest once on disk instead of loading either side into memory.
+class ManifestDiff {
+public:
+    ManifestDiff();
+
+    bool compare(const std::string& oldManifest, const std::string& newManifest,
+                 ManifestDiffResult& result, int threadCount = 0,
+                 std::function<void(int, int)> progressCallback = nullptr);
+
+    // Write the changed ranges as "<first_sector> <sector_count>" lines
+    bool writeRanges(const std::string& outputFile, const ManifestDiffResult& result);
+
+    // Records per parallel work chunk
+    void setChunkRecords(uint64_t chunkRecords) { chunkRecords_ = chunkRecords ? chunkRecords : 1; }
+
+    // Sort and merge overlapping or adjacent ranges in place
+    static void coalesceRanges(std::vector<SectorRange>& ranges);
+
+    std::string getLastError() const { return lastError_; }
+
+private:
+    uint64_t chunkRecords_;
+    std::string lastError_;
+    std::string oldPath_;
+    std::string newPath_;
+
+    // Positional path: returns false with `misaligned` set if the sector columns diverge
+    bool compareAligned(const ManifestInfo& oldInfo, int threadCount, ManifestDiffResult& result,
+                        bool& misaligned, std::function<void(int, int)> progressCallback);
+
+    bool compareSorted(ManifestDiffResult& result, std::function<void(int, int)> progressCallback);
+};
+
+#endif // MANIFEST_DIFF_H
@@ -0,0 +1,73 @@
+#include "ManifestDiff.h"
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+void printUsage() {
+    std::cout << "Manifest Diff Tool - snapshot-to-snapshot change detection" << std::endl;
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  ManifestDiffTool <old_manifest> <new_manifest> [ranges_file] [--threads N]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Accepts CRCD v1/v2, compact and delta manifests (formats may be mixed)." << std::endl;
+    std::cout << "Changed sectors are written as coalesced \"<first_sector> <sector_count>\" ranges." << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage();
+        return 1;
+    }
+
+    std::string oldManifest = argv[1];
+    std::string newManifest = argv[2];
+    std::string rangesFile;
+    int threadCount = 0;
+
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threadCount = std::atoi(argv[++i]);
+        } else if (rangesFile.empty()) {
+            rangesFile = arg;
+        } else {
+            std::cout << "Error: Unexpected argument '" << arg << "'" << std::endl;
+            printUsage();
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    ManifestDiff diff;
+    ManifestDiffResult result;
+    if (!diff.compare(oldManifest, newManifest, result, threadCount)) {
+        std::cout << "Error: " << diff.getLastError() << std::endl;
+        return 1;
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+    std::cout << "Compare mode: " << (result.positionalCompare ? "aligned columns" : "sort-merge") << std::endl;
+    std::cout << "Compared sectors: " << result.comparedSectors << std::endl;
+    std::cout << "Modified sectors: " << result.modifiedSectors << std::endl;
+    std::cout << "Added sectors: " << result.addedSectors << std::endl;
+    std::cout << "Removed sectors: " << result.removedSectors << std::endl;
+    std::cout << "Changed ranges: " << result.changedRanges.size() << std::endl;
+    std::cout << "Time: " << (duration.count() / 1000.0) << " seconds" << std::endl;
+
+    if (!rangesFile.empty()) {
+        if (!diff.writeRanges(rangesFile, result)) {
+            std::cout << "Error: " << diff.getLastError() << std::endl;
+            return 1;
+        }
+        std::cout << "Ranges saved to: " << rangesFile << std::endl;
+    } else {
+        for (const auto& range : result.changedRanges) {
+            std::cout << range.firstSector << " " << range.sectorCount << std::endl;
+        }
+    }
+
+    return 0;
+}
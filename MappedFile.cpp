@@ -0,0 +1,124 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : data_(nullptr), size_(0), opened_(false)
+#ifdef _WIN32
+    , fileHandle_(INVALID_HANDLE_VALUE), mappingHandle_(nullptr)
+#else
+    , fd_(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& filePath) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        lastError_ = "Cannot open file: " + filePath + ", error code: " + std::to_string(GetLastError());
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        lastError_ = "Cannot get file size: " + filePath;
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle_ = file;
+    size_ = static_cast<uint64_t>(fileSize.QuadPart);
+    opened_ = true;
+
+    // 空文件无法映射，按长度为0的视图处理
+    if (size_ == 0) {
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        lastError_ = "Cannot create file mapping: " + filePath + ", error code: " + std::to_string(GetLastError());
+        close();
+        return false;
+    }
+    mappingHandle_ = mapping;
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        lastError_ = "Cannot map view of file: " + filePath + ", error code: " + std::to_string(GetLastError());
+        close();
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(view);
+#else
+    fd_ = ::open(filePath.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        lastError_ = "Cannot open file: " + filePath;
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd_, &fileStat) != 0) {
+        lastError_ = "Cannot get file size: " + filePath;
+        close();
+        return false;
+    }
+    size_ = static_cast<uint64_t>(fileStat.st_size);
+    opened_ = true;
+
+    if (size_ == 0) {
+        return true;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(size_), PROT_READ, MAP_SHARED, fd_, 0);
+    if (view == MAP_FAILED) {
+        lastError_ = "Cannot map file: " + filePath;
+        close();
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(view);
+#endif
+
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+    }
+    if (mappingHandle_ != nullptr) {
+        CloseHandle(static_cast<HANDLE>(mappingHandle_));
+        mappingHandle_ = nullptr;
+    }
+    if (fileHandle_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(static_cast<HANDLE>(fileHandle_));
+        fileHandle_ = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (data_ != nullptr) {
+        munmap(const_cast<uint8_t*>(data_), static_cast<size_t>(size_));
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    opened_ = false;
+}
@@ -0,0 +1,40 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstdint>
+
+// 只读内存映射文件
+// Windows 下使用 CreateFileMapping/MapViewOfFile，其他平台使用 mmap
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filePath);
+    void close();
+    bool isOpen() const { return opened_; }
+
+    const uint8_t* data() const { return data_; }
+    uint64_t size() const { return size_; }
+
+    std::string getLastError() const { return lastError_; }
+
+private:
+    const uint8_t* data_;
+    uint64_t size_;
+    bool opened_;
+    std::string lastError_;
+
+#ifdef _WIN32
+    void* fileHandle_;      // HANDLE，避免在头文件中引入 windows.h
+    void* mappingHandle_;
+#else
+    int fd_;
+#endif
+};
+
+#endif // MAPPED_FILE_H
@@ -1,38 +1,67 @@
 #include "OptimizedDiskReader.h"
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <cstring>
 
 // 扇区大小常量
 static constexpr uint32_t SECTOR_SIZE = 512;
 
+// 等待I/O时检查取消的间隔（毫秒）
+static constexpr DWORD CANCEL_POLL_MS = 100;
+
+// 撤销后等待I/O结束的上限（毫秒），超过就放弃这次I/O
+static constexpr DWORD CANCEL_GRACE_MS = 2000;
+
+struct OptimizedDiskReader::IoSlot {
+    OVERLAPPED overlapped;
+    HANDLE event;
+    uint8_t* data;          // VirtualAlloc分配，按页对齐
+    size_t capacity;
+};
+
 OptimizedDiskReader::OptimizedDiskReader(const std::string& diskPath)
-    : diskPath_(diskPath), hDisk_(INVALID_HANDLE_VALUE), batchSize_(64), nextBufferIndex_(0) {
+    : diskPath_(diskPath), hDisk_(INVALID_HANDLE_VALUE), writable_(false), unbuffered_(false),
+      io_(nullptr), readTimeoutMs_(DEFAULT_READ_TIMEOUT_MS), lastReadTimedOut_(false) {
     
     // 在Windows上，磁盘路径需要以"\\\\.\\"开头
     if (diskPath_.find("\\\\.\\") == std::string::npos) {
         diskPath_ = "\\\\.\\" + diskPath_;
     }
-    
-    // 预分配一些缓冲区
-    preallocateBuffers(batchSize_);
 }
 
 OptimizedDiskReader::~OptimizedDiskReader() {
     closeDisk();
-    releaseAllBuffers();
+    if (io_ != nullptr) {
+        if (io_->event != NULL) {
+            CloseHandle(io_->event);
+        }
+        if (io_->data != nullptr) {
+            VirtualFree(io_->data, 0, MEM_RELEASE);
+        }
+        delete io_;
+    }
 }
 
-bool OptimizedDiskReader::openDisk() {
+bool OptimizedDiskReader::openDisk(bool writable) {
     if (isOpen()) {
-        return true; // 已经打开
+        if (writable_ || !writable) {
+            return true; // 已经以所需方式打开
+        }
+        closeDisk();
     }
     
+    // 以重叠方式打开，每次I/O都可以限时等待并单独撤销
+    DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED;
+    if (unbuffered_) {
+        flags |= FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH;
+    }
     hDisk_ = CreateFileA(diskPath_.c_str(), 
-                        GENERIC_READ,
+                        writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
                         FILE_SHARE_READ | FILE_SHARE_WRITE,
                         NULL,
                         OPEN_EXISTING,
-                        FILE_ATTRIBUTE_NORMAL,
+                        flags,
                         NULL);
     
     if (hDisk_ == INVALID_HANDLE_VALUE) {
@@ -61,6 +90,7 @@ bool OptimizedDiskReader::openDisk() {
         return false;
     }
     
+    writable_ = writable;
     return true;
 }
 
@@ -71,30 +101,18 @@ void OptimizedDiskReader::closeDisk() {
     }
 }
 
-bool OptimizedDiskReader::readSectorsBatch(uint64_t startSector, uint64_t count, 
-                                          std::vector<std::vector<uint8_t>>& batchData) {
+bool OptimizedDiskReader::readSectorsInto(uint64_t startSector, uint64_t count, uint8_t* buffer) {
     if (!ensureDiskOpen()) {
         return false;
     }
     
-    // 限制批量大小
-    count = std::min(count, static_cast<uint64_t>(batchSize_));
-    batchData.clear();
-    batchData.reserve(count);
-    
-    // 使用预分配的缓冲区
-    for (uint64_t i = 0; i < count; ++i) {
-        auto& buffer = acquireBuffer();
-        if (!readSector(startSector + i, buffer)) {
-            // 如果读取失败，清除缓冲区并继续
-            buffer.clear();
-        }
-        batchData.push_back(std::move(buffer));
+    // 整段只发起一次读取
+    if (!transfer(startSector, count, buffer, false)) {
+        lastError_ = "Failed to read sectors: " + std::to_string(startSector) + "-" +
+                     std::to_string(startSector + count - 1) +
+                     (lastReadTimedOut_ ? " (timed out after " + std::to_string(readTimeoutMs_) + " ms)" : "");
+        return false;
     }
-    
-    // 重置缓冲区索引以便下次使用
-    nextBufferIndex_ = 0;
-    
     return true;
 }
 
@@ -103,66 +121,170 @@ bool OptimizedDiskReader::readSector(uint64_t sectorNumber, std::vector<uint8_t>
         return false;
     }
     
-    // 设置文件指针到指定扇区
-    LARGE_INTEGER liDistance;
-    liDistance.QuadPart = sectorNumber * SECTOR_SIZE;
-    
-    if (SetFilePointerEx(hDisk_, liDistance, NULL, FILE_BEGIN) == 0) {
-        lastError_ = "Cannot set file pointer to sector: " + std::to_string(sectorNumber);
-        return false;
-    }
-    
     // 确保缓冲区大小正确
     if (buffer.size() != SECTOR_SIZE) {
         buffer.resize(SECTOR_SIZE);
     }
     
     // 读取扇区数据
-    DWORD bytesRead;
-    if (!ReadFile(hDisk_, buffer.data(), SECTOR_SIZE, &bytesRead, NULL)) {
-        lastError_ = "Failed to read sector: " + std::to_string(sectorNumber);
+    if (!transfer(sectorNumber, 1, buffer.data(), false)) {
+        lastError_ = "Failed to read sector: " + std::to_string(sectorNumber) +
+                     (lastReadTimedOut_ ? " (timed out after " + std::to_string(readTimeoutMs_) + " ms)" : "");
         return false;
     }
+    return true;
+}
+
+bool OptimizedDiskReader::writeSectorsFrom(uint64_t startSector, uint64_t count, const uint8_t* buffer) {
+    if (!isOpen() || !writable_) {
+        lastError_ = "Disk is not open for writing: " + diskPath_;
+        return false;
+    }
+    
+    // 整段只发起一次写入
+    if (!transfer(startSector, count, const_cast<uint8_t*>(buffer), true)) {
+        lastError_ = "Failed to write sectors: " + std::to_string(startSector) + "-" +
+                     std::to_string(startSector + count - 1);
+        return false;
+    }
+    return true;
+}
+
+bool OptimizedDiskReader::flush() {
+    if (!isOpen()) {
+        return true;
+    }
     
-    return bytesRead == SECTOR_SIZE;
+    if (!FlushFileBuffers(hDisk_)) {
+        lastError_ = "Failed to flush disk: " + diskPath_;
+        return false;
+    }
+    return true;
 }
 
 std::string OptimizedDiskReader::getLastError() const {
     return lastError_;
 }
 
-void OptimizedDiskReader::preallocateBuffers(size_t count) {
-    bufferPool_.reserve(count);
-    for (size_t i = 0; i < count; ++i) {
-        bufferPool_.emplace_back(SECTOR_SIZE);
-    }
-    nextBufferIndex_ = 0;
+uint32_t OptimizedDiskReader::sectorSize() {
+    return SECTOR_SIZE;
 }
 
-bool OptimizedDiskReader::ensureDiskOpen() {
-    if (!isOpen()) {
-        return openDisk();
+bool OptimizedDiskReader::prepareIoSlot(size_t bytes) {
+    if (io_ == nullptr) {
+        io_ = new IoSlot();
+        io_->event = CreateEventA(NULL, TRUE, FALSE, NULL);
+        io_->data = nullptr;
+        io_->capacity = 0;
+    }
+    if (io_->event == NULL) {
+        lastError_ = "Cannot create I/O event";
+        return false;
+    }
+    if (io_->capacity < bytes) {
+        if (io_->data != nullptr) {
+            VirtualFree(io_->data, 0, MEM_RELEASE);
+        }
+        io_->data = static_cast<uint8_t*>(VirtualAlloc(NULL, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+        io_->capacity = io_->data != nullptr ? bytes : 0;
+        if (io_->data == nullptr) {
+            lastError_ = "Cannot allocate I/O buffer of " + std::to_string(bytes) + " bytes";
+            return false;
+        }
     }
     return true;
 }
 
-std::vector<uint8_t>& OptimizedDiskReader::acquireBuffer() {
-    if (nextBufferIndex_ < bufferPool_.size()) {
-        // 使用预分配的缓冲区
-        auto& buffer = bufferPool_[nextBufferIndex_++];
-        // 确保缓冲区大小正确
-        if (buffer.size() != SECTOR_SIZE) {
-            buffer.resize(SECTOR_SIZE);
+void OptimizedDiskReader::abandonIo() {
+    // 句柄关闭后I/O仍可能迟到完成，io_（OVERLAPPED、事件、中转缓冲区）故意不释放
+    io_ = nullptr;
+    CloseHandle(hDisk_);
+    hDisk_ = INVALID_HANDLE_VALUE;
+}
+
+bool OptimizedDiskReader::transfer(uint64_t startSector, uint64_t count, uint8_t* buffer, bool write) {
+    if (!write) {
+        lastReadTimedOut_ = false;
+    }
+    
+    uint64_t byteOffset = startSector * SECTOR_SIZE;
+    DWORD bytes = static_cast<DWORD>(count * SECTOR_SIZE);
+    if (!prepareIoSlot(bytes)) {
+        return false;
+    }
+    IoSlot& io = *io_;
+    if (write) {
+        std::memcpy(io.data, buffer, bytes);
+    }
+    io.overlapped = OVERLAPPED();
+    io.overlapped.Offset = static_cast<DWORD>(byteOffset);
+    io.overlapped.OffsetHigh = static_cast<DWORD>(byteOffset >> 32);
+    io.overlapped.hEvent = io.event;
+    ResetEvent(io.event);
+    
+    BOOL started = write ? WriteFile(hDisk_, io.data, bytes, NULL, &io.overlapped)
+                         : ReadFile(hDisk_, io.data, bytes, NULL, &io.overlapped);
+    if (!started && GetLastError() != ERROR_IO_PENDING) {
+        return false;
+    }
+    
+    // 分段等待：到截止时间或取消检查返回true时撤销这次I/O，一个卡住的扇区不会让线程无限等待
+    bool timed = !write && readTimeoutMs_ > 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(readTimeoutMs_);
+    bool timedOut = false;
+    bool cancelled = false;
+    for (;;) {
+        DWORD slice = CANCEL_POLL_MS;
+        if (timed) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            slice = static_cast<DWORD>(std::max<long long>(0, std::min<long long>(slice, remaining)));
+        }
+        
+        DWORD wait = WaitForSingleObject(io.event, slice);
+        if (wait != WAIT_TIMEOUT) {
+            break;
+        }
+        if (cancelCheck_ && cancelCheck_()) {
+            cancelled = true;
+            CancelIoEx(hDisk_, &io.overlapped);
+            break;
+        }
+        if (timed && std::chrono::steady_clock::now() >= deadline) {
+            timedOut = true;
+            cancelled = true;
+            CancelIoEx(hDisk_, &io.overlapped);
+            break;
         }
-        return buffer;
-    } else {
-        // 动态分配新的缓冲区
-        bufferPool_.emplace_back(SECTOR_SIZE);
-        return bufferPool_.back();
     }
+    
+    // 撤销只等有限时间：不响应撤销的驱动让这次I/O连同句柄一起被放弃，线程不会卡在这里
+    if (cancelled && WaitForSingleObject(io.event, CANCEL_GRACE_MS) == WAIT_TIMEOUT) {
+        abandonIo();
+        if (!write) {
+            lastReadTimedOut_ = timedOut;
+        }
+        return false;
+    }
+    
+    // 事件已触发，I/O已经结束
+    DWORD transferred = 0;
+    BOOL completed = GetOverlappedResult(hDisk_, &io.overlapped, &transferred, FALSE);
+    if (completed && transferred == bytes) {
+        if (!write) {
+            std::memcpy(buffer, io.data, bytes);
+        }
+        return true; // 撤销前刚好完成
+    }
+    if (!write) {
+        lastReadTimedOut_ = timedOut;
+    }
+    return false;
 }
 
-void OptimizedDiskReader::releaseAllBuffers() {
-    bufferPool_.clear();
-    nextBufferIndex_ = 0;
+bool OptimizedDiskReader::ensureDiskOpen() {
+    if (!isOpen()) {
+        return openDisk();
+    }
+    return true;
 }
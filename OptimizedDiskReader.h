@@ -4,49 +4,82 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <functional>
 #include <windows.h>
 
 class OptimizedDiskReader {
 public:
+    // 默认每次读取的截止时间（毫秒）
+    static constexpr uint32_t DEFAULT_READ_TIMEOUT_MS = 30000;
+    
     OptimizedDiskReader(const std::string& diskPath);
     ~OptimizedDiskReader();
     
-    // 保持磁盘句柄打开状态
-    bool openDisk();
+    // 保持磁盘句柄打开状态；writable为true时以读写方式打开（已只读打开时会重新打开）
+    bool openDisk(bool writable = false);
     void closeDisk();
     
-    // 批量读取扇区 - 核心优化
-    bool readSectorsBatch(uint64_t startSector, uint64_t count, std::vector<std::vector<uint8_t>>& batchData);
+    // 连续扇区一次读入调用方提供的缓冲区（count * 扇区大小字节）
+    bool readSectorsInto(uint64_t startSector, uint64_t count, uint8_t* buffer);
     
     // 单个扇区读取（使用已打开的句柄）
     bool readSector(uint64_t sectorNumber, std::vector<uint8_t>& buffer);
     
+    // 连续扇区一次写入（需要以读写方式打开），数据为count * 扇区大小字节
+    bool writeSectorsFrom(uint64_t startSector, uint64_t count, const uint8_t* buffer);
+    
+    // 把已写入的数据刷到设备
+    bool flush();
+    
     // 获取最后错误信息
     std::string getLastError() const;
     
+    // 扇区大小
+    static uint32_t sectorSize();
+    
     // 检查磁盘是否已打开
     bool isOpen() const { return hDisk_ != INVALID_HANDLE_VALUE; }
     
-    // 设置批量读取大小
-    void setBatchSize(size_t batchSize) { batchSize_ = batchSize; }
+    // 每次读取的截止时间，超时后撤销该读取并返回失败；0表示不限时。写入不设截止时间
+    void setReadTimeout(uint32_t milliseconds) { readTimeoutMs_ = milliseconds; }
+    
+    // 绕过系统缓存（FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH）：写入直达设备，读取不会命中
+    // 刚写入的页缓存。在openDisk之前设置；I/O经过按页对齐的中转缓冲区，调用方缓冲区不需要对齐
+    void setUnbuffered(bool unbuffered) { unbuffered_ = unbuffered; }
     
-    // 预分配缓冲区以减少内存分配
-    void preallocateBuffers(size_t count);
+    // 等待读写完成期间定期调用，返回true时撤销正在进行的I/O（异步取消）
+    void setCancelCheck(std::function<bool()> cancelled) { cancelCheck_ = cancelled; }
+    
+    // 最近一次失败的读取是否因超时被撤销
+    bool lastReadTimedOut() const { return lastReadTimedOut_; }
 
 private:
     std::string diskPath_;
     HANDLE hDisk_;
     std::string lastError_;
-    size_t batchSize_;
+    bool writable_;
+    bool unbuffered_;
     
-    // 预分配的缓冲区池
-    std::vector<std::vector<uint8_t>> bufferPool_;
-    size_t nextBufferIndex_;
+    // 重叠I/O的OVERLAPPED、完成事件和中转缓冲区，每个实例同一时间只有一个I/O。撤销后迟迟不结束
+    // 的I/O连同句柄一起被放弃，这块状态不再释放，驱动迟到的完成不会写进调用方已收回的内存
+    struct IoSlot;
+    IoSlot* io_;
+    uint32_t readTimeoutMs_;
+    std::function<bool()> cancelCheck_;
+    bool lastReadTimedOut_;
     
     // 内部辅助方法
     bool ensureDiskOpen();
-    std::vector<uint8_t>& acquireBuffer();
-    void releaseAllBuffers();
+    
+    // 以重叠方式发起一次读写并等待完成；读取受截止时间限制，两者都响应取消检查。撤销后最多再等
+    // CANCEL_GRACE_MS，仍未结束就放弃句柄（读取下次自动重新打开，写入需要重新openDisk）
+    bool transfer(uint64_t startSector, uint64_t count, uint8_t* buffer, bool write);
+    
+    // 准备至少bytes字节的中转缓冲区
+    bool prepareIoSlot(size_t bytes);
+    
+    // 撤销未能结束：关闭句柄，放弃当前I/O状态
+    void abandonIo();
 };
 
 #endif // OPTIMIZED_DISK_READER_H
@@ -0,0 +1,291 @@
+#include "ParitySidecar.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARITY_SIDECAR_SSE2
+#endif
+
+// File layout (little endian):
+//   header: magic, version, sectorSize, groupSize, interleave, reserved, startSector, sectorCount
+//   stripe s at PARITY_HEADER_SIZE + s * stripeRecordSize: invalidMask, interleave parity sectors
+static constexpr uint32_t PARITY_MAGIC = 0x43524350;   // "CRCP"
+static constexpr uint32_t PARITY_VERSION = 1;
+static constexpr uint64_t PARITY_HEADER_SIZE = 6 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+static uint64_t stripeRecordSize(const ParityLayout& layout) {
+    return sizeof(uint64_t) + static_cast<uint64_t>(layout.interleave) * layout.sectorSize;
+}
+
+uint64_t ParityLayout::sectorsInStripe(uint64_t stripe) const {
+    uint64_t first = stripe * stripeSectors();
+    return first >= sectorCount ? 0 : std::min(stripeSectors(), sectorCount - first);
+}
+
+uint32_t ParityLayout::groupMembers(uint64_t stripeLength, uint32_t group) const {
+    return group >= stripeLength ? 0 : static_cast<uint32_t>((stripeLength - 1 - group) / interleave + 1);
+}
+
+uint32_t ParityLayout::groupSizeForOverhead(double percent) {
+    if (!(percent > 0.0)) {
+        return 0;
+    }
+    return std::max<uint32_t>(2, static_cast<uint32_t>(std::lround(100.0 / percent)));
+}
+
+void xorInto(uint8_t* dst, const uint8_t* src, size_t length) {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    for (; i + 32 <= length; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(a, b));
+    }
+#elif defined(PARITY_SIDECAR_SSE2)
+    for (; i + 16 <= length; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(a, b));
+    }
+#endif
+
+    for (; i < length; ++i) {
+        dst[i] ^= src[i];
+    }
+}
+
+ParitySidecarWriter::ParitySidecarWriter() : failed_(false) {
+}
+
+ParitySidecarWriter::~ParitySidecarWriter() {
+    abandon();
+}
+
+bool ParitySidecarWriter::open(const std::string& path, const ParityLayout& layout) {
+    if (layout.groupSize < 2 || layout.interleave == 0 || layout.interleave > ParityLayout::MAX_INTERLEAVE ||
+        layout.sectorSize == 0) {
+        setError("Invalid parity layout");
+        return false;
+    }
+
+    layout_ = layout;
+    path_ = path;
+    failed_ = false;
+    stripes_.clear();
+    written_.assign(layout_.stripeCount(), false);
+    file_.open(path, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+    if (!file_.is_open()) {
+        setError("Cannot create parity file: " + path);
+        return false;
+    }
+
+    uint32_t reserved = 0;
+    file_.write(reinterpret_cast<const char*>(&PARITY_MAGIC), sizeof(PARITY_MAGIC));
+    file_.write(reinterpret_cast<const char*>(&PARITY_VERSION), sizeof(PARITY_VERSION));
+    file_.write(reinterpret_cast<const char*>(&layout_.sectorSize), sizeof(layout_.sectorSize));
+    file_.write(reinterpret_cast<const char*>(&layout_.groupSize), sizeof(layout_.groupSize));
+    file_.write(reinterpret_cast<const char*>(&layout_.interleave), sizeof(layout_.interleave));
+    file_.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+    file_.write(reinterpret_cast<const char*>(&layout_.startSector), sizeof(layout_.startSector));
+    file_.write(reinterpret_cast<const char*>(&layout_.sectorCount), sizeof(layout_.sectorCount));
+    if (!file_) {
+        setError("Failed to write parity header: " + path);
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<ParitySidecarWriter::Stripe> ParitySidecarWriter::stripe(uint64_t index) {
+    std::lock_guard<std::mutex> lock(stripesMutex_);
+    std::shared_ptr<Stripe>& entry = stripes_[index];
+    if (!entry) {
+        entry = std::make_shared<Stripe>();
+        entry->parity.assign(static_cast<size_t>(layout_.interleave) * layout_.sectorSize, 0);
+        entry->pending = layout_.sectorsInStripe(index);
+        entry->missing.resize(layout_.interleave);
+        for (uint32_t group = 0; group < layout_.interleave; ++group) {
+            entry->missing[group] = layout_.groupMembers(entry->pending, group);
+        }
+    }
+    return entry;
+}
+
+bool ParitySidecarWriter::accumulate(uint64_t firstSector, const uint8_t* data, uint32_t count) {
+    return account(firstSector, data, count);
+}
+
+bool ParitySidecarWriter::skip(uint64_t sector) {
+    return account(sector, nullptr, 1);
+}
+
+bool ParitySidecarWriter::account(uint64_t firstSector, const uint8_t* data, uint32_t count) {
+    if (failed_) {
+        return false;
+    }
+
+    uint64_t offset = firstSector - layout_.startSector;
+    uint64_t end = std::min(offset + count, layout_.sectorCount);
+    while (offset < end) {
+        // One stripe at a time: its lock covers the XOR and the bookkeeping
+        uint64_t index = offset / layout_.stripeSectors();
+        uint64_t stripeEnd = std::min(end, (index + 1) * layout_.stripeSectors());
+        std::shared_ptr<Stripe> current = stripe(index);
+
+        bool complete;
+        {
+            std::lock_guard<std::mutex> lock(current->mutex);
+            for (uint64_t sector = offset; sector < stripeEnd; ++sector) {
+                uint32_t group = static_cast<uint32_t>((sector - index * layout_.stripeSectors()) % layout_.interleave);
+                if (data != nullptr) {
+                    xorInto(current->parity.data() + static_cast<size_t>(group) * layout_.sectorSize,
+                            data + (sector - (firstSector - layout_.startSector)) * layout_.sectorSize,
+                            layout_.sectorSize);
+                } else {
+                    current->invalidMask |= uint64_t(1) << group;
+                }
+                current->missing[group]--;
+            }
+            current->pending -= stripeEnd - offset;
+            complete = current->pending == 0;
+        }
+
+        if (complete) {
+            {
+                std::lock_guard<std::mutex> lock(stripesMutex_);
+                stripes_.erase(index);
+            }
+            if (!finishStripe(index, *current)) {
+                return false;
+            }
+        }
+        offset = stripeEnd;
+    }
+    return true;
+}
+
+bool ParitySidecarWriter::finishStripe(uint64_t index, Stripe& stripe) {
+    // Groups that never saw all their members cannot rebuild anything
+    for (uint32_t group = 0; group < layout_.interleave; ++group) {
+        if (stripe.missing[group] != 0) {
+            stripe.invalidMask |= uint64_t(1) << group;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(fileMutex_);
+    file_.seekp(static_cast<std::streamoff>(PARITY_HEADER_SIZE + index * stripeRecordSize(layout_)));
+    file_.write(reinterpret_cast<const char*>(&stripe.invalidMask), sizeof(stripe.invalidMask));
+    file_.write(reinterpret_cast<const char*>(stripe.parity.data()), stripe.parity.size());
+    written_[index] = true;
+    if (!file_) {
+        setError("Failed to write parity stripe " + std::to_string(index));
+        return false;
+    }
+    return true;
+}
+
+void ParitySidecarWriter::abandon() {
+    if (file_.is_open()) {
+        file_.close();
+        std::remove(path_.c_str());
+    }
+}
+
+bool ParitySidecarWriter::close() {
+    if (!file_.is_open()) {
+        return !failed_;
+    }
+
+    // Stripes still open lost sectors (or were never reached, e.g. after cancellation)
+    std::map<uint64_t, std::shared_ptr<Stripe>> remaining;
+    {
+        std::lock_guard<std::mutex> lock(stripesMutex_);
+        remaining.swap(stripes_);
+    }
+    bool ok = !failed_;
+    for (auto& entry : remaining) {
+        ok = finishStripe(entry.first, *entry.second) && ok;
+    }
+
+    // Stripes never reached at all are written as fully invalid, so no hole reads as parity
+    if (ok) {
+        std::vector<uint8_t> record(static_cast<size_t>(stripeRecordSize(layout_)), 0);
+        uint64_t invalid = ~uint64_t(0);
+        std::memcpy(record.data(), &invalid, sizeof(invalid));
+        for (uint64_t index = 0; index < written_.size(); ++index) {
+            if (!written_[index]) {
+                file_.seekp(static_cast<std::streamoff>(PARITY_HEADER_SIZE + index * stripeRecordSize(layout_)));
+                file_.write(reinterpret_cast<const char*>(record.data()), record.size());
+            }
+        }
+    }
+
+    file_.close();
+    if (!file_ && ok) {
+        setError("Failed to close parity file");
+        ok = false;
+    }
+    return ok;
+}
+
+std::string ParitySidecarWriter::getLastError() const {
+    std::lock_guard<std::mutex> lock(errorMutex_);
+    return lastError_;
+}
+
+void ParitySidecarWriter::setError(const std::string& error) {
+    std::lock_guard<std::mutex> lock(errorMutex_);
+    lastError_ = error;
+    failed_ = true;
+}
+
+bool ParitySidecarReader::open(const std::string& path) {
+    close();
+    file_.open(path, std::ios::binary);
+    if (!file_.is_open()) {
+        lastError_ = "Cannot open parity file: " + path;
+        return false;
+    }
+
+    uint32_t magic = 0, version = 0, reserved = 0;
+    file_.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file_.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file_.read(reinterpret_cast<char*>(&layout_.sectorSize), sizeof(layout_.sectorSize));
+    file_.read(reinterpret_cast<char*>(&layout_.groupSize), sizeof(layout_.groupSize));
+    file_.read(reinterpret_cast<char*>(&layout_.interleave), sizeof(layout_.interleave));
+    file_.read(reinterpret_cast<char*>(&reserved), sizeof(reserved));
+    file_.read(reinterpret_cast<char*>(&layout_.startSector), sizeof(layout_.startSector));
+    file_.read(reinterpret_cast<char*>(&layout_.sectorCount), sizeof(layout_.sectorCount));
+    if (!file_ || magic != PARITY_MAGIC || version != PARITY_VERSION || layout_.groupSize < 2 ||
+        layout_.interleave == 0 || layout_.interleave > ParityLayout::MAX_INTERLEAVE || layout_.sectorSize == 0) {
+        lastError_ = "Not a supported parity file: " + path;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ParitySidecarReader::close() {
+    if (file_.is_open()) {
+        file_.close();
+    }
+    file_.clear();
+}
+
+bool ParitySidecarReader::readStripe(uint64_t stripe, uint64_t& invalidMask, std::vector<uint8_t>& parity) {
+    parity.resize(static_cast<size_t>(layout_.interleave) * layout_.sectorSize);
+    file_.seekg(static_cast<std::streamoff>(PARITY_HEADER_SIZE + stripe * stripeRecordSize(layout_)));
+    file_.read(reinterpret_cast<char*>(&invalidMask), sizeof(invalidMask));
+    file_.read(reinterpret_cast<char*>(parity.data()), parity.size());
+    if (!file_) {
+        file_.clear();
+        lastError_ = "Cannot read parity stripe " + std::to_string(stripe);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,113 @@
+#ifndef PARITY_SIDECAR_H
+#define PARITY_SIDECAR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Interleaved XOR parity over the sectors of a checksummed range. The range is cut into stripes
+// of groupSize * interleave sectors; sector w of a stripe belongs to group w % interleave, and
+// each group has one parity sector. A consecutive burst of up to `interleave` bad sectors thus
+// lands in different groups. The manifest says which sectors are bad, so a group can rebuild one
+// bad member from the parity and its other members. Overhead is 1 / groupSize of the range.
+struct ParityLayout {
+    static constexpr uint32_t MAX_INTERLEAVE = 64;  // Groups per stripe, one validity bit each
+
+    uint64_t startSector = 0;
+    uint64_t sectorCount = 0;
+    uint32_t sectorSize = 0;
+    uint32_t groupSize = 32;        // Data sectors per parity sector (32 = ~3% overhead)
+    uint32_t interleave = 64;       // Parity sectors per stripe
+
+    uint64_t stripeSectors() const { return static_cast<uint64_t>(groupSize) * interleave; }
+    uint64_t stripeCount() const { return (sectorCount + stripeSectors() - 1) / stripeSectors(); }
+
+    // Sectors of the range inside stripe `stripe` (the last one may be short)
+    uint64_t sectorsInStripe(uint64_t stripe) const;
+
+    // Members of group `group` inside a stripe holding `stripeLength` sectors
+    uint32_t groupMembers(uint64_t stripeLength, uint32_t group) const;
+
+    // Group size giving roughly `percent` overhead
+    static uint32_t groupSizeForOverhead(double percent);
+};
+
+// dst ^= src over `length` bytes, vectorised where the target allows
+void xorInto(uint8_t* dst, const uint8_t* src, size_t length);
+
+// Accumulates parity while a generator streams sectors in any order from any number of threads.
+// A stripe is written as soon as all its sectors have been seen; sectors that could not be read
+// are reported with skip() and invalidate their group. close() writes what is left; a run that
+// was cancelled or failed calls abandon() instead (so does the destructor of an unclosed writer).
+class ParitySidecarWriter {
+public:
+    ParitySidecarWriter();
+    ~ParitySidecarWriter();
+
+    bool open(const std::string& path, const ParityLayout& layout);
+
+    // XOR `count` consecutive sectors starting at firstSector into their groups
+    bool accumulate(uint64_t firstSector, const uint8_t* data, uint32_t count);
+
+    // A sector of the range that will never be accumulated
+    bool skip(uint64_t sector);
+
+    bool close();
+
+    // Delete the sidecar of a run that did not cover its range
+    void abandon();
+
+    const ParityLayout& layout() const { return layout_; }
+    std::string getLastError() const;
+
+private:
+    struct Stripe {
+        std::mutex mutex;
+        std::vector<uint8_t> parity;
+        uint64_t invalidMask = 0;
+        uint64_t pending = 0;       // Sectors not yet accumulated or skipped
+        std::vector<uint32_t> missing;  // Per group
+    };
+
+    ParityLayout layout_;
+    std::string path_;
+    std::fstream file_;
+    std::mutex stripesMutex_;
+    std::map<uint64_t, std::shared_ptr<Stripe>> stripes_;
+    std::mutex fileMutex_;
+    std::vector<bool> written_;     // Per stripe, guarded by fileMutex_
+    mutable std::mutex errorMutex_;
+    std::string lastError_;
+    std::atomic<bool> failed_;
+
+    std::shared_ptr<Stripe> stripe(uint64_t index);
+    bool account(uint64_t firstSector, const uint8_t* data, uint32_t count);
+    bool finishStripe(uint64_t index, Stripe& stripe);
+    void setError(const std::string& error);
+};
+
+class ParitySidecarReader {
+public:
+    bool open(const std::string& path);
+    void close();
+
+    const ParityLayout& layout() const { return layout_; }
+
+    // Parity sectors of a stripe (interleave * sectorSize bytes) and its invalid-group mask
+    bool readStripe(uint64_t stripe, uint64_t& invalidMask, std::vector<uint8_t>& parity);
+
+    std::string getLastError() const { return lastError_; }
+
+private:
+    ParityLayout layout_;
+    std::ifstream file_;
+    std::string lastError_;
+};
+
+#endif // PARITY_SIDECAR_H
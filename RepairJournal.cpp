@@ -0,0 +1,224 @@
+#include "RepairJournal.h"
+#include "FastCRC32.h"
+#include "OptimizedDiskReader.h"
+#include <chrono>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// File layout (little endian):
+//   header: magic, version, sectorSize, timestamp, diskPathLength, diskPath
+//   record: magic, sectorCount, startSector, crc, original image, replacement image
+// The record CRC covers sectorCount, startSector and both images.
+static constexpr uint32_t JOURNAL_MAGIC = 0x4352434A;         // "CRCJ"
+static constexpr uint32_t JOURNAL_VERSION = 1;
+static constexpr uint32_t JOURNAL_RECORD_MAGIC = 0x52474E52;  // "RNGR"
+static constexpr uint32_t JOURNAL_MAX_RECORD_SECTORS = 1 << 16;
+
+static uint32_t recordCrc(uint32_t sectorCount, uint64_t startSector, const uint8_t* images, size_t imageBytes) {
+    uint32_t crc = FastCRC32::update(0, &sectorCount, sizeof(sectorCount));
+    crc = FastCRC32::update(crc, &startSector, sizeof(startSector));
+    return FastCRC32::update(crc, images, imageBytes);
+}
+
+RepairJournal::RepairJournal()
+    : file_(nullptr), sectorSize_(0), rangeCount_(0), sectorCount_(0) {
+}
+
+RepairJournal::~RepairJournal() {
+    close();
+}
+
+bool RepairJournal::exists(const std::string& journalPath) {
+    std::ifstream file(journalPath, std::ios::binary);
+    return file.is_open();
+}
+
+bool RepairJournal::create(const std::string& journalPath, const std::string& diskPath, uint32_t sectorSize) {
+    close();
+    rangeCount_ = 0;
+    sectorCount_ = 0;
+
+    if (exists(journalPath)) {
+        lastError_ = "Interrupted repair journal found: " + journalPath + " (replay or roll it back first)";
+        return false;
+    }
+
+    file_ = std::fopen(journalPath.c_str(), "wb");
+    if (file_ == nullptr) {
+        lastError_ = "Cannot create repair journal: " + journalPath;
+        return false;
+    }
+    journalPath_ = journalPath;
+    sectorSize_ = sectorSize;
+
+    uint64_t timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    uint32_t pathLength = static_cast<uint32_t>(diskPath.size());
+    if (!writeBytes(&JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) ||
+        !writeBytes(&JOURNAL_VERSION, sizeof(JOURNAL_VERSION)) ||
+        !writeBytes(&sectorSize_, sizeof(sectorSize_)) ||
+        !writeBytes(&timestamp, sizeof(timestamp)) ||
+        !writeBytes(&pathLength, sizeof(pathLength)) ||
+        !writeBytes(diskPath.data(), diskPath.size())) {
+        return false;
+    }
+
+    // The header must be durable before any record can matter
+    return sync();
+}
+
+bool RepairJournal::appendRange(uint64_t startSector, uint32_t sectorCount, const uint8_t* original,
+                                const uint8_t* replacement) {
+    if (file_ == nullptr) {
+        lastError_ = "Repair journal is not open";
+        return false;
+    }
+
+    size_t imageBytes = static_cast<size_t>(sectorCount) * sectorSize_;
+    uint32_t crc = FastCRC32::update(0, &sectorCount, sizeof(sectorCount));
+    crc = FastCRC32::update(crc, &startSector, sizeof(startSector));
+    crc = FastCRC32::update(crc, original, imageBytes);
+    crc = FastCRC32::update(crc, replacement, imageBytes);
+
+    if (!writeBytes(&JOURNAL_RECORD_MAGIC, sizeof(JOURNAL_RECORD_MAGIC)) ||
+        !writeBytes(&sectorCount, sizeof(sectorCount)) ||
+        !writeBytes(&startSector, sizeof(startSector)) ||
+        !writeBytes(&crc, sizeof(crc)) ||
+        !writeBytes(original, imageBytes) ||
+        !writeBytes(replacement, imageBytes)) {
+        return false;
+    }
+
+    rangeCount_++;
+    sectorCount_ += sectorCount;
+    return true;
+}
+
+bool RepairJournal::sync() {
+    if (file_ == nullptr) {
+        lastError_ = "Repair journal is not open";
+        return false;
+    }
+
+    bool synced = std::fflush(file_) == 0;
+#ifdef _WIN32
+    synced = synced && _commit(_fileno(file_)) == 0;
+#else
+    synced = synced && fsync(fileno(file_)) == 0;
+#endif
+    if (!synced) {
+        lastError_ = "Cannot flush repair journal: " + journalPath_;
+    }
+    return synced;
+}
+
+bool RepairJournal::complete() {
+    close();
+    if (!journalPath_.empty() && std::remove(journalPath_.c_str()) != 0) {
+        lastError_ = "Cannot remove repair journal: " + journalPath_;
+        return false;
+    }
+    return true;
+}
+
+bool RepairJournal::recover(const std::string& journalPath, RecoveryMode mode, const std::string& diskPath) {
+    close();
+    journalPath_ = journalPath;
+    rangeCount_ = 0;
+    sectorCount_ = 0;
+
+    std::ifstream file(journalPath, std::ios::binary);
+    if (!file.is_open()) {
+        lastError_ = "Cannot open repair journal: " + journalPath;
+        return false;
+    }
+
+    uint32_t magic = 0, version = 0, pathLength = 0;
+    uint64_t timestamp = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&sectorSize_), sizeof(sectorSize_));
+    file.read(reinterpret_cast<char*>(&timestamp), sizeof(timestamp));
+    file.read(reinterpret_cast<char*>(&pathLength), sizeof(pathLength));
+    if (!file || magic != JOURNAL_MAGIC || version != JOURNAL_VERSION || pathLength > 4096 ||
+        sectorSize_ != OptimizedDiskReader::sectorSize()) {
+        lastError_ = "Not a supported repair journal: " + journalPath;
+        return false;
+    }
+    std::string recordedDisk(pathLength, '\0');
+    file.read(&recordedDisk[0], pathLength);
+    if (!file) {
+        lastError_ = "Truncated repair journal header: " + journalPath;
+        return false;
+    }
+
+    OptimizedDiskReader disk(diskPath.empty() ? recordedDisk : diskPath);
+    if (!disk.openDisk(true)) {
+        lastError_ = disk.getLastError();
+        return false;
+    }
+
+    // One sequential pass; records never overlap, so order does not matter for rollback either
+    std::vector<uint8_t> images;
+    while (true) {
+        uint32_t recordMagic = 0, sectorCount = 0, crc = 0;
+        uint64_t startSector = 0;
+        file.read(reinterpret_cast<char*>(&recordMagic), sizeof(recordMagic));
+        file.read(reinterpret_cast<char*>(&sectorCount), sizeof(sectorCount));
+        file.read(reinterpret_cast<char*>(&startSector), sizeof(startSector));
+        file.read(reinterpret_cast<char*>(&crc), sizeof(crc));
+        if (!file || recordMagic != JOURNAL_RECORD_MAGIC || sectorCount == 0 ||
+            sectorCount > JOURNAL_MAX_RECORD_SECTORS) {
+            break; // End of the journal or a torn header
+        }
+
+        size_t imageBytes = static_cast<size_t>(sectorCount) * sectorSize_;
+        images.resize(2 * imageBytes);
+        file.read(reinterpret_cast<char*>(images.data()), images.size());
+        if (!file || recordCrc(sectorCount, startSector, images.data(), images.size()) != crc) {
+            break; // Torn record: it was never synced, so its device write never happened
+        }
+
+        const uint8_t* image = images.data() + (mode == RecoveryMode::Replay ? imageBytes : 0);
+        if (!disk.writeSectorsFrom(startSector, sectorCount, image)) {
+            lastError_ = disk.getLastError();
+            return false;
+        }
+        rangeCount_++;
+        sectorCount_ += sectorCount;
+    }
+
+    if (!disk.flush()) {
+        lastError_ = disk.getLastError();
+        return false;
+    }
+    disk.closeDisk();
+    file.close();
+
+    if (std::remove(journalPath.c_str()) != 0) {
+        lastError_ = "Cannot remove repair journal: " + journalPath;
+        return false;
+    }
+    return true;
+}
+
+void RepairJournal::close() {
+    if (file_ != nullptr) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+bool RepairJournal::writeBytes(const void* data, size_t size) {
+    if (size > 0 && std::fwrite(data, 1, size, file_) != size) {
+        lastError_ = "Failed to write repair journal: " + journalPath_;
+        return false;
+    }
+    return true;
+}
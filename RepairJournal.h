@@ -0,0 +1,64 @@
+#ifndef REPAIR_JOURNAL_H
+#define REPAIR_JOURNAL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Write-ahead log of a sector repair. Before a range of sectors is overwritten, its original
+// and replacement contents are appended as one record; records are made durable in groups and
+// only then are the device writes issued. Once every write has reached the device the journal is
+// removed, so a journal left on disk always means an interrupted repair.
+//
+// Recovery reads the journal in one sequential pass and writes either the replacement images
+// (replay: finish the repair) or the original images (rollback: undo it). Both are idempotent, so
+// an interrupted recovery can simply be run again. A torn record at the end was never synced,
+// hence never written to the device, and is ignored.
+class RepairJournal {
+public:
+    enum class RecoveryMode { Replay, Rollback };
+
+    RepairJournal();
+    ~RepairJournal();
+
+    RepairJournal(const RepairJournal&) = delete;
+    RepairJournal& operator=(const RepairJournal&) = delete;
+
+    // Start a new journal for repairs of diskPath; fails if one already exists at journalPath
+    bool create(const std::string& journalPath, const std::string& diskPath, uint32_t sectorSize);
+
+    // Record one range; original and replacement each hold sectorCount sectors
+    bool appendRange(uint64_t startSector, uint32_t sectorCount, const uint8_t* original,
+                     const uint8_t* replacement);
+
+    // Make every range appended so far durable; call before writing those ranges to the device
+    bool sync();
+
+    // All device writes are flushed: delete the journal
+    bool complete();
+
+    // Replay or roll back an interrupted repair. An empty diskPath uses the disk recorded in the
+    // journal. The journal is removed once recovery has been flushed to the device.
+    bool recover(const std::string& journalPath, RecoveryMode mode, const std::string& diskPath = "");
+
+    uint64_t rangeCount() const { return rangeCount_; }
+    uint64_t sectorCount() const { return sectorCount_; }
+    const std::string& journalPath() const { return journalPath_; }
+
+    static bool exists(const std::string& journalPath);
+
+    std::string getLastError() const { return lastError_; }
+
+private:
+    std::FILE* file_;
+    std::string journalPath_;
+    std::string lastError_;
+    uint32_t sectorSize_;
+    uint64_t rangeCount_;
+    uint64_t sectorCount_;
+
+    void close();
+    bool writeBytes(const void* data, size_t size);
+};
+
+#endif // REPAIR_JOURNAL_H
@@ -0,0 +1,106 @@
+#include "ScrubDaemon.h"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+ScrubDaemon::ScrubDaemon(const ScrubPolicy& policy) : policy_(policy) {
+}
+
+bool ScrubDaemon::loadTargets(const std::string& registryPath) {
+    std::ifstream file(registryPath);
+    if (!file.is_open()) {
+        lastError_ = "Cannot open scrub registry: " + registryPath;
+        return false;
+    }
+
+    std::string line;
+    uint64_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#' || line.find_first_not_of(" \t") == std::string::npos) {
+            continue;
+        }
+        // The manifest is the rest of the line, so its path may contain spaces
+        std::istringstream fields(line);
+        ScrubTarget target;
+        fields >> target.diskPath;
+        std::getline(fields >> std::ws, target.manifest);
+        if (target.manifest.empty()) {
+            lastError_ = "Invalid scrub registry entry at line " + std::to_string(lineNumber) + ": " + registryPath;
+            return false;
+        }
+        targets_.push_back(target);
+    }
+    return true;
+}
+
+bool ScrubDaemon::run(std::function<void(const ScrubReport&)> reportCallback) {
+    if (targets_.empty()) {
+        lastError_ = "No devices registered for scrubbing";
+        return false;
+    }
+
+    // Devices are independent; each one is paced by its own throttle
+    std::vector<std::thread> threads;
+    for (const ScrubTarget& target : targets_) {
+        threads.emplace_back(&ScrubDaemon::scrubDevice, this, std::cref(target), std::cref(reportCallback));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return true;
+}
+
+void ScrubDaemon::scrubDevice(const ScrubTarget& target,
+                              const std::function<void(const ScrubReport&)>& reportCallback) {
+    for (uint64_t pass = 1; policy_.passes == 0 || pass <= policy_.passes; ++pass) {
+        if (stopToken_.stopRequested()) {
+            return;
+        }
+
+        // A fresh throttle per pass, so the backoff counts are the pass's own
+        IoThrottle throttle(target.diskPath, policy_.throttle);
+        EnhancedDiskSectorCRC disk(target.diskPath);
+        disk.setStopToken(stopToken_);
+        disk.setReadThrottle(&throttle);
+        disk.setLowIoPriority(policy_.lowIoPriority);
+        disk.setResumeFromCheckpoint(true);
+
+        ScrubReport report;
+        report.target = target;
+        report.pass = pass;
+        auto started = std::chrono::steady_clock::now();
+        bool verified = disk.verifyIntegrityHighPerformance(target.manifest, 1, 2);
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        report.stats = disk.verifyStats();
+        report.backoffCount = throttle.backoffCount();
+        report.backoffMs = throttle.backoffMs();
+
+        // Failed sectors end a pass normally; anything else means it did not get through
+        bool stopped = stopToken_.stopRequested();
+        report.completed = !stopped && (verified || report.stats.corruptedSectors > 0);
+        if (!verified && !stopped && report.stats.corruptedSectors == 0) {
+            report.error = disk.getLastError();
+        }
+
+        if (reportCallback) {
+            std::lock_guard<std::mutex> lock(reportMutex_);
+            reportCallback(report);
+        }
+        if (!rest(report.completed ? policy_.passIntervalSeconds : policy_.retrySeconds)) {
+            return;
+        }
+    }
+}
+
+bool ScrubDaemon::rest(uint32_t seconds) const {
+    auto until = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    while (!stopToken_.stopRequested() && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return !stopToken_.stopRequested();
+}
@@ -0,0 +1,74 @@
+#ifndef SCRUB_DAEMON_H
+#define SCRUB_DAEMON_H
+
+#include "EnhancedDiskSectorCRC.h"
+#include "IoThrottle.h"
+#include "StopToken.h"
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Device registered for scrubbing and the manifest it is checked against
+struct ScrubTarget {
+    std::string diskPath;
+    std::string manifest;
+};
+
+struct ScrubPolicy {
+    ThrottlePolicy throttle;            // Per device
+    uint32_t passIntervalSeconds = 0;   // Rest between two passes over a device
+    uint32_t retrySeconds = 300;        // Wait after a pass that could not run (device or manifest missing)
+    uint32_t passes = 0;                // Passes per device, 0 until stopped
+    bool lowIoPriority = true;          // Read in the idle I/O class
+};
+
+// Outcome of one pass over one device
+struct ScrubReport {
+    ScrubTarget target;
+    uint64_t pass = 0;
+    bool completed = false;     // Whole manifest checked (a stopped pass resumes next time)
+    VerifyStats stats;
+    double seconds = 0;
+    uint64_t backoffCount = 0;  // Pauses for foreground I/O during the pass
+    uint64_t backoffMs = 0;
+    std::string error;          // Set when the pass could not run or stopped on an error
+};
+
+// Long-running background verification of registered devices. Every device gets its own thread
+// that verifies it against its manifest pass after pass with the high-performance verifier, so
+// each pass is checkpointed: a stopped or restarted scrub continues every device where it left
+// off. Reads go through an IoThrottle per device (bandwidth cap, pause while foreground I/O keeps
+// the disk busy) at idle I/O priority, so production disks keep their latency.
+class ScrubDaemon {
+public:
+    explicit ScrubDaemon(const ScrubPolicy& policy = ScrubPolicy());
+
+    // Registry file: one "<disk path> <manifest>" per line; '#' starts a comment line
+    bool loadTargets(const std::string& registryPath);
+    void addTarget(const ScrubTarget& target) { targets_.push_back(target); }
+    const std::vector<ScrubTarget>& targets() const { return targets_; }
+
+    // Scrub until stopped or every device had its passes. reportCallback runs after every pass,
+    // one call at a time.
+    bool run(std::function<void(const ScrubReport&)> reportCallback = nullptr);
+
+    void setStopToken(const StopToken& stopToken) { stopToken_ = stopToken; }
+
+    std::string getLastError() const { return lastError_; }
+
+private:
+    ScrubPolicy policy_;
+    std::vector<ScrubTarget> targets_;
+    StopToken stopToken_;
+    std::mutex reportMutex_;
+    std::string lastError_;
+
+    void scrubDevice(const ScrubTarget& target, const std::function<void(const ScrubReport&)>& reportCallback);
+
+    // Sleep up to `seconds`; false once a stop was requested
+    bool rest(uint32_t seconds) const;
+};
+
+#endif // SCRUB_DAEMON_H
@@ -0,0 +1,41 @@
+#ifndef SECTOR_EXTENT_H
+#define SECTOR_EXTENT_H
+
+#include "BufferPool.h"
+#include <cstddef>
+#include <cstdint>
+
+// Largest extent the pipelines produce; bounds the inline CRC array of ExtentChecksums
+static constexpr uint32_t EXTENT_MAX_SECTORS = 256;
+
+// Contiguous run of sectors
+struct SectorRange {
+    uint64_t firstSector;
+    uint64_t sectorCount;
+};
+
+// Unit of work handed from disk readers to CRC workers: a run of consecutive, successfully read
+// sectors inside a leased pool buffer. Many extents can share one large buffer; it returns to its
+// pool when the last extent referencing it is dropped, so the pipeline moves descriptors, not
+// sector copies, and allocates nothing per extent.
+struct SectorExtent {
+    BufferLease buffer;
+    size_t offset = 0;              // Byte offset of the first sector inside buffer
+    uint64_t startSector = 0;
+    uint32_t sectorCount = 0;
+    uint32_t sectorSize = 0;
+
+    const uint8_t* sector(uint32_t index) const {
+        return buffer.data() + offset + static_cast<size_t>(index) * sectorSize;
+    }
+};
+
+// CRCs of one extent, crcs[i] belonging to sector startSector + i. Stored inline so results can
+// travel through a ring without a heap allocation each.
+struct ExtentChecksums {
+    uint64_t startSector = 0;
+    uint32_t count = 0;
+    uint32_t crcs[EXTENT_MAX_SECTORS];
+};
+
+#endif // SECTOR_EXTENT_H
@@ -0,0 +1,38 @@
+#ifndef STOP_TOKEN_H
+#define STOP_TOKEN_H
+
+#include <atomic>
+#include <memory>
+
+// Cooperative cancellation shaped like C++20 std::stop_source / std::stop_token, which the
+// C++17 build cannot use. Every token of a source shares its state, so one job can be stopped
+// without touching any other. A default-constructed token can never be stopped.
+class StopToken {
+public:
+    StopToken() = default;
+
+    bool stopRequested() const { return state_ && state_->load(std::memory_order_relaxed); }
+    bool stopPossible() const { return state_ != nullptr; }
+
+private:
+    friend class StopSource;
+    explicit StopToken(std::shared_ptr<std::atomic<bool>> state) : state_(std::move(state)) {}
+
+    std::shared_ptr<std::atomic<bool>> state_;
+};
+
+class StopSource {
+public:
+    StopSource() : state_(std::make_shared<std::atomic<bool>>(false)) {}
+
+    // True if this call made the request, false if a stop was already requested
+    bool requestStop() { return !state_->exchange(true); }
+    bool stopRequested() const { return state_->load(std::memory_order_relaxed); }
+
+    StopToken token() const { return StopToken(state_); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> state_;
+};
+
+#endif // STOP_TOKEN_H
@@ -0,0 +1,256 @@
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <chrono>
+
+// Identity of the pool worker running on this thread, if any
+static thread_local WorkStealingPool* currentPool = nullptr;
+static thread_local int currentWorker = -1;
+
+WorkStealingPool& WorkStealingPool::instance() {
+    static WorkStealingPool pool(0, ThreadPlacement::fromEnvironment());
+    return pool;
+}
+
+WorkStealingPool::WorkStealingPool(unsigned int workerCount, const ThreadPlacement& placement)
+    : stopping_(false), nextQueue_(0) {
+    // One lane of workers per NUMA node, pinned to the node's hasher CPUs
+    size_t cpuCount = 0;
+    if (placement.numaAware) {
+        for (const NumaNode& node : CpuTopology::instance().nodes()) {
+            nodeCpus_.push_back(placement.hashers.empty() ? node.cpus : placement.hashers.intersect(node.cpus));
+            cpuCount += nodeCpus_.back().count();
+        }
+    }
+    if (cpuCount == 0) {
+        // No NUMA pairing: a single lane over the hasher CPUs, unpinned if none are given
+        nodeCpus_.assign(1, placement.hashers);
+        cpuCount = placement.hashers.count();
+    }
+    nodeWorkers_.resize(nodeCpus_.size());
+
+    if (workerCount == 0) {
+        workerCount = cpuCount ? static_cast<unsigned int>(cpuCount) : std::thread::hardware_concurrency();
+    }
+    if (workerCount == 0) {
+        workerCount = 4;
+    }
+
+    // Spread workers over the lanes in proportion to their CPUs
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        size_t lane = 0;
+        if (cpuCount > 0) {
+            double bestLoad = 0.0;
+            bool found = false;
+            for (size_t candidate = 0; candidate < nodeCpus_.size(); ++candidate) {
+                size_t cpus = nodeCpus_[candidate].count();
+                if (cpus == 0) {
+                    continue;
+                }
+                double load = static_cast<double>(nodeWorkers_[candidate].size() + 1) / cpus;
+                if (!found || load < bestLoad) {
+                    lane = candidate;
+                    bestLoad = load;
+                    found = true;
+                }
+            }
+        }
+        nodeWorkers_[lane].push_back(i);
+        workerNode_.push_back(static_cast<int>(lane));
+        queues_.emplace_back(new WorkerQueue());
+    }
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        workers_.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    // Workers finish whatever is still queued before they exit
+    stopping_.store(true, std::memory_order_seq_cst);
+    workAvailable_.notifyAll();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void WorkStealingPool::submit(Task task, int node) {
+    size_t index;
+    if (currentPool == this && (node < 0 || workerNode_[currentWorker] == node)) {
+        index = static_cast<size_t>(currentWorker);
+    } else if (node >= 0 && static_cast<size_t>(node) < nodeWorkers_.size() && !nodeWorkers_[node].empty()) {
+        const std::vector<size_t>& workers = nodeWorkers_[node];
+        index = workers[nextQueue_.fetch_add(1, std::memory_order_relaxed) % workers.size()];
+    } else {
+        index = static_cast<size_t>(nextQueue_.fetch_add(1, std::memory_order_relaxed) % queues_.size());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    workAvailable_.notifyOne();
+}
+
+bool WorkStealingPool::runPendingTask() {
+    Task task;
+    if (!takeTask(currentPool == this ? currentWorker : -1, task)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+bool WorkStealingPool::takeTask(int ownIndex, Task& task) {
+    // Own deque first, newest task first
+    if (ownIndex >= 0) {
+        WorkerQueue& own = *queues_[ownIndex];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Steal the oldest task of another deque on our node, then anywhere, starting next to our
+    // own deque to spread thieves out
+    if (ownIndex >= 0) {
+        const std::vector<size_t>& neighbours = nodeWorkers_[workerNode_[ownIndex]];
+        size_t offset = std::find(neighbours.begin(), neighbours.end(), static_cast<size_t>(ownIndex)) - neighbours.begin();
+        for (size_t i = 1; i < neighbours.size(); ++i) {
+            if (stealFrom(neighbours[(offset + i) % neighbours.size()], task)) {
+                return true;
+            }
+        }
+    }
+
+    size_t queueCount = queues_.size();
+    size_t start = ownIndex >= 0 ? static_cast<size_t>(ownIndex) + 1
+                                 : static_cast<size_t>(nextQueue_.load(std::memory_order_relaxed));
+    for (size_t i = 0; i < queueCount; ++i) {
+        size_t index = (start + i) % queueCount;
+        if (static_cast<int>(index) == ownIndex) {
+            continue;
+        }
+        if (stealFrom(index, task)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkStealingPool::stealFrom(size_t index, Task& task) {
+    WorkerQueue& victim = *queues_[index];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (victim.tasks.empty()) {
+        return false;
+    }
+    task = std::move(victim.tasks.front());
+    victim.tasks.pop_front();
+    return true;
+}
+
+void WorkStealingPool::workerLoop(unsigned int index) {
+    currentPool = this;
+    currentWorker = static_cast<int>(index);
+    CpuTopology::pinCurrentThread(nodeCpus_[workerNode_[index]]);
+
+    for (;;) {
+        Task task;
+        if (takeTask(currentWorker, task)) {
+            task();
+            continue;
+        }
+
+        // Park until a submit; re-check after registering so a concurrent submit is not missed
+        uint64_t key = workAvailable_.prepareWait();
+        if (takeTask(currentWorker, task)) {
+            workAvailable_.cancelWait();
+            task();
+            continue;
+        }
+        if (stopping_.load(std::memory_order_seq_cst)) {
+            workAvailable_.cancelWait();
+            break;
+        }
+        workAvailable_.wait(key);
+    }
+
+    currentPool = nullptr;
+    currentWorker = -1;
+}
+
+void WorkStealingPool::parallelFor(uint64_t begin, uint64_t end, uint64_t grain, int parallelism,
+                                   const std::function<void(uint64_t, uint64_t)>& body) {
+    if (end <= begin) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+
+    uint64_t chunkCount = (end - begin + grain - 1) / grain;
+    uint64_t runnerCount = parallelism > 0 ? static_cast<uint64_t>(parallelism) : workerCount();
+    runnerCount = std::max<uint64_t>(1, std::min(runnerCount, chunkCount));
+
+    // Every runner keeps claiming the next unclaimed chunk until none are left
+    std::atomic<uint64_t> nextChunk(0);
+    auto runner = [&]() {
+        for (;;) {
+            uint64_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= chunkCount) {
+                return;
+            }
+            uint64_t first = begin + chunk * grain;
+            body(first, std::min(end, first + grain));
+        }
+    };
+
+    TaskGroup group(*this);
+    for (uint64_t i = 1; i < runnerCount; ++i) {
+        group.run(runner);
+    }
+    runner();
+    group.wait();
+}
+
+TaskGroup::TaskGroup(WorkStealingPool& pool) : pool_(pool), pending_(0) {
+}
+
+TaskGroup::~TaskGroup() {
+    wait();
+}
+
+void TaskGroup::run(WorkStealingPool::Task task, int node) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    pool_.submit([this, task = std::move(task)]() {
+        task();
+        // Decrement under the lock so wait() cannot return, and the group be destroyed,
+        // between the decrement and the notification
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            done_.notify_all();
+        }
+    }, node);
+}
+
+void TaskGroup::wait() {
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pending_.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+        }
+
+        // Help instead of idling; this also keeps nested waits on pool workers deadlock-free
+        if (pool_.runPendingTask()) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait_for(lock, std::chrono::milliseconds(5),
+                       [this]() { return pending_.load(std::memory_order_acquire) == 0; });
+    }
+}
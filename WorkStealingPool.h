@@ -0,0 +1,102 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include "ConcurrentRing.h"
+#include "CpuTopology.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Process-wide scheduler for CPU work. Every worker owns a deque: it pushes and pops its own
+// tasks at the back (LIFO, cache-warm) and, when that runs dry, steals from the front of the
+// other deques. Threads are started once and reused by every operation, so back-to-back jobs
+// do not pay thread start-up costs.
+//
+// Workers are spread evenly over the NUMA nodes and pinned to their node (narrowed to the hasher
+// CPUs of the placement). A task submitted for a node goes to a worker there, and thieves try
+// their own node before crossing to another, so work stays next to its data.
+//
+// Tasks must not block waiting on other tasks except through TaskGroup::wait or parallelFor,
+// both of which run pending tasks while they wait. Blocking I/O pipelines (ring readers) keep
+// their own dedicated threads and only hand CPU work to the pool.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    // Shared instance with one worker per usable processor, placed per CRCRECOVER_PLACEMENT
+    static WorkStealingPool& instance();
+
+    explicit WorkStealingPool(unsigned int workerCount = 0,
+                              const ThreadPlacement& placement = ThreadPlacement());
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Called from a worker the task goes to that worker's deque, otherwise deques are
+    // picked round-robin. `node` (an index into CpuTopology::nodes()) prefers workers of that
+    // node; -1, or a node without workers, means any.
+    void submit(Task task, int node = -1);
+
+    // Run one queued task on the calling thread; false if every deque was empty
+    bool runPendingTask();
+
+    unsigned int workerCount() const { return static_cast<unsigned int>(workers_.size()); }
+    size_t nodeCount() const { return nodeWorkers_.size(); }
+
+    // Run body(first, last) over [begin, end) split into chunks of `grain` items. At most
+    // `parallelism` chunks run at once (0 = one per worker); chunks are claimed dynamically, so
+    // uneven chunks balance themselves. The calling thread takes part and returns when all
+    // chunks are done.
+    void parallelFor(uint64_t begin, uint64_t end, uint64_t grain, int parallelism,
+                     const std::function<void(uint64_t, uint64_t)>& body);
+
+private:
+    struct alignas(RING_CACHE_LINE) WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::vector<int> workerNode_;                   // Lane (node) index of each worker
+    std::vector<std::vector<size_t>> nodeWorkers_;  // Workers of each node
+    std::vector<CpuSet> nodeCpus_;                  // CPUs each node's workers are pinned to
+    std::atomic<bool> stopping_;
+    std::atomic<uint64_t> nextQueue_;
+    RingEventCount workAvailable_;
+
+    void workerLoop(unsigned int index);
+    bool takeTask(int ownIndex, Task& task);
+    bool stealFrom(size_t index, Task& task);
+};
+
+// Set of tasks submitted to a pool that can be waited on together
+class TaskGroup {
+public:
+    explicit TaskGroup(WorkStealingPool& pool = WorkStealingPool::instance());
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    // `node` as for WorkStealingPool::submit
+    void run(WorkStealingPool::Task task, int node = -1);
+
+    // Block until every task of the group has finished, running pool tasks meanwhile
+    void wait();
+
+private:
+    WorkStealingPool& pool_;
+    std::atomic<uint64_t> pending_;
+    std::mutex mutex_;
+    std::condition_variable done_;
+};
+
+#endif // WORK_STEALING_POOL_H
@@ -1,4 +1,12 @@
 #include "DiskSectorCRC.h"
+#include "DiskSync.h"
+#include "EnhancedDiskSectorCRC.h"
+#include "ManifestDiff.h"
+#include "ParitySidecar.h"
+#include "RepairJournal.h"
+#include "ScrubDaemon.h"
+#include <csignal>
+#include <ctime>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -9,20 +17,63 @@ void printUsage() {
     std::cout << "  CRCRECOVER <command> [parameters]" << std::endl;
     std::cout << std::endl;
     std::cout << "Commands:" << std::endl;
-    std::cout << "  generate <disk_path> <start_sector> <sector_count> <output_file> - Generate checksum data" << std::endl;
-    std::cout << "  verify <disk_path> <checksum_file> - Verify data integrity" << std::endl;
-    std::cout << "  repair <disk_path> <checksum_file> [backup_disk_path] - Repair corrupted data" << std::endl;
+    std::cout << "  generate <disk_path> <start_sector> <sector_count> <output_file> [--parity[=percent]] [--resume] - Generate checksum data" << std::endl;
+    std::cout << "  verify <disk_path> <checksum_file> [--resume] - Verify data integrity" << std::endl;
+    std::cout << "  verify-sample <disk_path> <checksum_file> [--budget=MB] [--time=seconds] [--confidence=percent] - Estimate corruption from a random sample" << std::endl;
+    std::cout << "  repair <disk_path> <checksum_file> [backup_disk_path ...] - Repair corrupted data" << std::endl;
+    std::cout << "  generate-delta <disk_path> <start_sector> <sector_count> <base_checksum_file> <output_file> - Generate checksums changed since a base snapshot" << std::endl;
+    std::cout << "  delta <base_checksum_file> <checksum_file> <output_file> - Convert a full snapshot into a delta against a base" << std::endl;
+    std::cout << "  diff <old_checksum_file> <new_checksum_file> [ranges_file] - List sector ranges changed between snapshots" << std::endl;
+    std::cout << "  validate <checksum_file> [--quick] - Check a checksum file (and its delta chain) for damage" << std::endl;
+    std::cout << "  recover-repair <journal_file> <replay|rollback> [disk_path] - Finish or undo an interrupted repair" << std::endl;
+    std::cout << "  sync <source_disk> <target_disk> <source_checksum_file> <target_checksum_file> [start_sector sector_count] - Copy only sectors that differ" << std::endl;
+    std::cout << "  scrub <registry_file> [--rate=MB/s] [--busy=percent] [--interval=seconds] [--passes=N] - Verify registered disks in the background" << std::endl;
     std::cout << "  help - Show this help message" << std::endl;
     std::cout << std::endl;
     std::cout << "Examples:" << std::endl;
     std::cout << "  CRCRECOVER generate C: 0 1000 checksums.dat" << std::endl;
     std::cout << "  CRCRECOVER verify C: checksums.dat" << std::endl;
+    std::cout << "  CRCRECOVER verify \\\\.\\PhysicalDrive1 checksums.dat --resume" << std::endl;
+    std::cout << "  CRCRECOVER verify-sample C: checksums.dat --budget=512 --time=60" << std::endl;
     std::cout << "  CRCRECOVER repair C: checksums.dat D:" << std::endl;
+    std::cout << "  CRCRECOVER repair C: checksums.dat D: E:" << std::endl;
+    std::cout << "  CRCRECOVER generate C: 0 1000 checksums.dat --parity=5" << std::endl;
+    std::cout << "  CRCRECOVER repair C: checksums.dat" << std::endl;
+    std::cout << "  CRCRECOVER generate-delta C: 0 1000 monday.dat tuesday.dlt" << std::endl;
+    std::cout << "  CRCRECOVER diff monday.dat tuesday.dat changes.txt" << std::endl;
+    std::cout << "  CRCRECOVER validate checksums.dat" << std::endl;
+    std::cout << "  CRCRECOVER recover-repair checksums.dat.journal rollback" << std::endl;
+    std::cout << "  CRCRECOVER sync D: E: source.dat mirror.dat 0 1000" << std::endl;
+    std::cout << "  CRCRECOVER scrub scrub.txt --rate=20 --busy=20 --interval=86400" << std::endl;
     std::cout << std::endl;
     std::cout << "Notes:" << std::endl;
     std::cout << "  - Disk path can be physical disk (e.g., \\\\.\\PhysicalDrive0) or logical partition (e.g., C:)" << std::endl;
     std::cout << "  - Administrator privileges required to access physical disks" << std::endl;
-    std::cout << "  - Repair function requires valid backup disk" << std::endl;
+    std::cout << "  - Repair function requires valid backup disk, or a parity file written by generate --parity" << std::endl;
+    std::cout << "  - --parity writes <output_file>.parity (default 3% of the range); repair without a backup" << std::endl;
+    std::cout << "    uses it to rebuild isolated bad sectors and bursts of up to 64 consecutive sectors" << std::endl;
+    std::cout << "  - repair first fixes sectors differing by a single flipped bit from their CRC alone" << std::endl;
+    std::cout << "  - with two or more backup disks, repair verifies all copies in parallel and rewrites every" << std::endl;
+    std::cout << "    stale copy, backups included, from the one matching the checksum file (majority elsewhere)" << std::endl;
+    std::cout << "  - verify, repair and diff accept delta files; their base chain is resolved automatically" << std::endl;
+    std::cout << "  - verify-sample reads 1 MB extents spread evenly over the disk until the budget (default 1024 MB)" << std::endl;
+    std::cout << "    or time limit is used up; it exits with 1 if any sampled sector is corrupted" << std::endl;
+    std::cout << "  - repair journals every change to <checksum_file>.journal; a journal left behind by a crash" << std::endl;
+    std::cout << "    must be replayed or rolled back with recover-repair before the next repair" << std::endl;
+    std::cout << "  - sync compares the two manifests and copies only differing ranges, reading every write back;" << std::endl;
+    std::cout << "    with a sector range both manifests are generated first, concurrently. The target must not be in use" << std::endl;
+    std::cout << "  - with --resume, generate and verify save their progress to <checksum_file>.checkpoint every minute" << std::endl;
+    std::cout << "    and an interrupted run given --resume again continues from there instead of from the start" << std::endl;
+    std::cout << "  - scrub reads \"<disk_path> <checksum_file>\" lines and verifies every disk over and over at idle I/O" << std::endl;
+    std::cout << "    priority, capped at --rate (default 50 MB/s) and pausing while other I/O keeps the disk busier than" << std::endl;
+    std::cout << "    --busy (default 30%); Ctrl+C saves each disk's progress and the next scrub continues from there" << std::endl;
+}
+
+// Ctrl+C asks the running scrub to stop at its next clean boundary
+static StopSource scrubStop;
+
+static void requestScrubStop(int) {
+    scrubStop.requestStop();
 }
 
 bool parseUint64(const std::string& str, uint64_t& value) {
@@ -34,6 +85,16 @@ bool parseUint64(const std::string& str, uint64_t& value) {
     }
 }
 
+bool parseDouble(const std::string& str, double& value) {
+    try {
+        size_t used = 0;
+        value = std::stod(str, &used);
+        return used == str.size();
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         printUsage();
@@ -47,12 +108,34 @@ int main(int argc, char* argv[]) {
         return 0;
     }
     else if (command == "generate") {
-        if (argc != 6) {
-            std::cout << "Error: generate command requires 4 parameters" << std::endl;
+        if (argc < 6 || argc > 8) {
+            std::cout << "Error: generate command requires 4 parameters and optional --parity and --resume flags" << std::endl;
             printUsage();
             return 1;
         }
 
+        uint32_t parityGroupSize = 0;
+        bool resume = false;
+        for (int i = 6; i < argc; ++i) {
+            std::string option = argv[i];
+            if (option == "--resume") {
+                resume = true;
+                continue;
+            }
+            double percent = 3.0;
+            if (option.compare(0, 8, "--parity") != 0 ||
+                (option.size() > 8 && (option[8] != '=' || !parseDouble(option.substr(9), percent))) ||
+                percent < 0.1 || percent > 50.0) {
+                std::cout << "Error: expected --parity or --parity=<percent> between 0.1 and 50" << std::endl;
+                return 1;
+            }
+            parityGroupSize = ParityLayout::groupSizeForOverhead(percent);
+        }
+        if (resume && parityGroupSize > 0) {
+            std::cout << "Error: --resume cannot be combined with --parity" << std::endl;
+            return 1;
+        }
+
         std::string diskPath = argv[2];
         std::string startSectorStr = argv[3];
         std::string sectorCountStr = argv[4];
@@ -65,7 +148,7 @@ int main(int argc, char* argv[]) {
         }
 
         std::cout << "Initializing disk access..." << std::endl;
-        DiskSectorCRC disk(diskPath);
+        EnhancedDiskSectorCRC disk(diskPath);
 
         // Check basic permissions first
         if (!disk.checkFilePermissions()) {
@@ -74,7 +157,15 @@ int main(int argc, char* argv[]) {
         }
 
         std::cout << "Starting checksum generation..." << std::endl;
-        if (disk.generateSectorChecksums(startSector, sectorCount, outputFile)) {
+        // Parity is accumulated by the pipelined generator while it hashes
+        if (parityGroupSize > 0) {
+            disk.setParitySidecar(parityGroupSize);
+        }
+        if (resume) {
+            disk.setResumeFromCheckpoint(true);
+        }
+        bool generated = disk.generateChecksumsHighPerformance(startSector, sectorCount, outputFile);
+        if (generated) {
             std::cout << "Checksum data generated successfully!" << std::endl;
             return 0;
         } else {
@@ -83,8 +174,8 @@ int main(int argc, char* argv[]) {
         }
     }
     else if (command == "verify") {
-        if (argc != 4) {
-            std::cout << "Error: verify command requires 2 parameters" << std::endl;
+        if (argc != 4 && !(argc == 5 && std::string(argv[4]) == "--resume")) {
+            std::cout << "Error: verify command requires 2 parameters and an optional --resume flag" << std::endl;
             printUsage();
             return 1;
         }
@@ -93,7 +184,7 @@ int main(int argc, char* argv[]) {
         std::string checksumFile = argv[3];
 
         std::cout << "Initializing disk access..." << std::endl;
-        DiskSectorCRC disk(diskPath);
+        EnhancedDiskSectorCRC disk(diskPath);
 
         if (!disk.checkFilePermissions()) {
             std::cout << "Error: " << disk.getLastError() << std::endl;
@@ -101,33 +192,117 @@ int main(int argc, char* argv[]) {
         }
 
         std::cout << "Starting data integrity verification..." << std::endl;
-        if (disk.verifySectorIntegrity(checksumFile)) {
+        if (argc == 5) {
+            disk.setResumeFromCheckpoint(true);
+        }
+        if (disk.verifyIntegrityHighPerformance(checksumFile)) {
             std::cout << "Data integrity verification passed!" << std::endl;
             return 0;
         } else {
+            std::cout << "Error: " << disk.getLastError() << std::endl;
             std::cout << "Data integrity verification failed!" << std::endl;
             return 1;
         }
     }
+    else if (command == "verify-sample") {
+        if (argc < 4 || argc > 7) {
+            std::cout << "Error: verify-sample command requires 2 parameters and optional limits" << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        SamplingPolicy policy;
+        for (int i = 4; i < argc; ++i) {
+            std::string option = argv[i];
+            size_t equals = option.find('=');
+            std::string name = option.substr(0, equals);
+            std::string value = (equals == std::string::npos) ? "" : option.substr(equals + 1);
+            uint64_t number = 0;
+            double percent = 0;
+            if (name == "--budget" && parseUint64(value, number)) {
+                policy.maxBytes = number * 1024 * 1024;
+            } else if (name == "--time" && parseUint64(value, number)) {
+                policy.maxSeconds = static_cast<uint32_t>(number);
+            } else if (name == "--confidence" && parseDouble(value, percent) && percent >= 50 && percent < 100) {
+                policy.confidence = percent / 100;
+            } else {
+                std::cout << "Error: unknown or invalid option '" << option << "'" << std::endl;
+                return 1;
+            }
+        }
+
+        std::string diskPath = argv[2];
+        std::string checksumFile = argv[3];
+
+        std::cout << "Initializing disk access..." << std::endl;
+        EnhancedDiskSectorCRC disk(diskPath);
+
+        if (!disk.checkFilePermissions()) {
+            std::cout << "Error: " << disk.getLastError() << std::endl;
+            return 1;
+        }
+
+        std::cout << "Starting sampled verification..." << std::endl;
+        SamplingResult result;
+        if (!disk.verifySampled(checksumFile, policy, result)) {
+            std::cout << "Error: " << disk.getLastError() << std::endl;
+            return 1;
+        }
+
+        std::cout << "Sampled " << result.sampledExtents << " of " << result.manifestExtents << " extents ("
+                  << result.sampledSectors << " of " << result.manifestSectors << " sectors, "
+                  << result.bytesRead / (1024 * 1024) << " MB in " << result.seconds << " s)"
+                  << (result.timeLimitReached ? ", time limit reached" : "") << std::endl;
+        std::cout << "Corrupted sectors: " << result.corruptedSectors << " (" << result.unreadableSectors
+                  << " unreadable) in " << result.corruptedExtents << " extent(s)" << std::endl;
+        std::cout << "Estimated corrupted extents: " << result.extentRate * 100 << "% ("
+                  << policy.confidence * 100 << "% interval " << result.extentRateLow * 100 << "% - "
+                  << result.extentRateHigh * 100 << "%)" << std::endl;
+        std::cout << "Estimated corrupted sectors: " << result.sectorRate * 100 << "% (interval "
+                  << result.sectorRateLow * 100 << "% - " << result.sectorRateHigh * 100 << "%, about "
+                  << static_cast<uint64_t>(result.sectorRateHigh * result.manifestSectors) << " sectors at most)" << std::endl;
+        return result.corruptedSectors == 0 ? 0 : 1;
+    }
     else if (command == "repair") {
-        if (argc < 4 || argc > 5) {
-            std::cout << "Error: repair command requires 2-3 parameters" << std::endl;
+        if (argc < 4) {
+            std::cout << "Error: repair command requires at least 2 parameters" << std::endl;
             printUsage();
             return 1;
         }
 
         std::string diskPath = argv[2];
         std::string checksumFile = argv[3];
-        std::string backupDiskPath = (argc == 5) ? argv[4] : "";
+        std::vector<std::string> backupDiskPaths(argv + 4, argv + argc);
 
         std::cout << "Initializing disk access..." << std::endl;
-        DiskSectorCRC disk(diskPath);
+        EnhancedDiskSectorCRC disk(diskPath);
 
         if (!disk.checkFilePermissions()) {
             std::cout << "Error: " << disk.getLastError() << std::endl;
             return 1;
         }
 
+        if (backupDiskPaths.size() > 1) {
+            std::cout << "Verifying " << backupDiskPaths.size() + 1 << " copies..." << std::endl;
+            ReplicaRepairStats stats;
+            bool repaired = disk.repairWithReplicas(checksumFile, backupDiskPaths, stats);
+            std::cout << "Sectors bad on at least one copy: " << stats.suspectSectors << std::endl;
+            for (size_t copy = 0; copy < stats.repairedSectors.size(); ++copy) {
+                std::cout << "  " << (copy == 0 ? diskPath : backupDiskPaths[copy - 1]) << ": "
+                          << stats.repairedSectors[copy] << " sector(s) rewritten" << std::endl;
+            }
+            if (stats.votedSectors > 0) {
+                std::cout << "Sectors settled by majority vote: " << stats.votedSectors << std::endl;
+            }
+            if (!repaired) {
+                std::cout << "Problem occurred during data repair: " << disk.getLastError() << std::endl;
+                return 1;
+            }
+            std::cout << "Data repair completed!" << std::endl;
+            return 0;
+        }
+
+        std::string backupDiskPath = backupDiskPaths.empty() ? "" : backupDiskPaths[0];
         std::cout << "Starting data repair..." << std::endl;
         if (disk.repairSectorData(checksumFile, backupDiskPath)) {
             std::cout << "Data repair completed!" << std::endl;
@@ -137,6 +312,263 @@ int main(int argc, char* argv[]) {
             return 1;
         }
     }
+    else if (command == "generate-delta") {
+        if (argc != 7) {
+            std::cout << "Error: generate-delta command requires 5 parameters" << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        std::string diskPath = argv[2];
+        std::string baseChecksumFile = argv[5];
+        std::string outputFile = argv[6];
+
+        uint64_t startSector, sectorCount;
+        if (!parseUint64(argv[3], startSector) || !parseUint64(argv[4], sectorCount)) {
+            std::cout << "Error: start sector and sector count must be valid numbers" << std::endl;
+            return 1;
+        }
+
+        std::cout << "Initializing disk access..." << std::endl;
+        EnhancedDiskSectorCRC disk(diskPath);
+
+        if (!disk.checkFilePermissions()) {
+            std::cout << "Error: " << disk.getLastError() << std::endl;
+            return 1;
+        }
+
+        std::cout << "Starting delta checksum generation against " << baseChecksumFile << "..." << std::endl;
+        if (disk.generateDeltaChecksums(startSector, sectorCount, baseChecksumFile, outputFile)) {
+            std::cout << "Delta checksum data generated successfully!" << std::endl;
+            return 0;
+        } else {
+            std::cout << "Error: " << disk.getLastError() << std::endl;
+            return 1;
+        }
+    }
+    else if (command == "delta") {
+        if (argc != 5) {
+            std::cout << "Error: delta command requires 3 parameters" << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        ManifestDelta delta;
+        if (!delta.create(argv[2], argv[3], argv[4])) {
+            std::cout << "Error: " << delta.getLastError() << std::endl;
+            return 1;
+        }
+
+        std::cout << "Delta saved to " << argv[4] << " (" << delta.changedSectors() << " changed sectors)" << std::endl;
+        return 0;
+    }
+    else if (command == "diff") {
+        if (argc < 4 || argc > 5) {
+            std::cout << "Error: diff command requires 2-3 parameters" << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        std::string oldChecksumFile = argv[2];
+        std::string newChecksumFile = argv[3];
+        std::string rangesFile = (argc == 5) ? argv[4] : "";
+
+        ManifestDiff diff;
+        ManifestDiffResult result;
+
+        std::cout << "Comparing checksum snapshots..." << std::endl;
+        if (!diff.compare(oldChecksumFile, newChecksumFile, result)) {
+            std::cout << "Error: " << diff.getLastError() << std::endl;
+            return 1;
+        }
+
+        std::cout << "Modified sectors: " << result.modifiedSectors << std::endl;
+        std::cout << "Added sectors: " << result.addedSectors << std::endl;
+        std::cout << "Removed sectors: " << result.removedSectors << std::endl;
+        std::cout << "Changed ranges: " << result.changedRanges.size() << std::endl;
+
+        if (rangesFile.empty()) {
+            for (const auto& range : result.changedRanges) {
+                std::cout << range.firstSector << " " << range.sectorCount << std::endl;
+            }
+        } else if (!diff.writeRanges(rangesFile, result)) {
+            std::cout << "Error: " << diff.getLastError() << std::endl;
+            return 1;
+        } else {
+            std::cout << "Changed ranges saved to: " << rangesFile << std::endl;
+        }
+        return 0;
+    }
+    else if (command == "validate") {
+        if (argc < 3 || argc > 4 || (argc == 4 && std::string(argv[3]) != "--quick")) {
+            std::cout << "Error: validate command requires 1 parameter and an optional --quick flag" << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        bool quickCheck = (argc == 4);
+        ManifestChainView view;
+        if (!view.open(argv[2])) {
+            std::cout << "Error: " << view.getLastError() << std::endl;
+            return 1;
+        }
+        std::vector<std::string> chainPaths = view.chainPaths();
+        view.close();
+
+        bool allValid = true;
+        for (const auto& path : chainPaths) {
+            ManifestValidator validator;
+            bool valid = validator.validate(path, quickCheck);
+            std::cout << path << " (" << ChecksumManifestReader::formatName(validator.info().format) << "): ";
+            if (valid) {
+                if (!validator.hasChecksums()) {
+                    std::cout << "structure OK (format carries no checksums)" << std::endl;
+                } else if (quickCheck) {
+                    std::cout << "header and block index OK" << std::endl;
+                } else {
+                    std::cout << validator.blocksChecked() << " blocks OK" << std::endl;
+                }
+                if (validator.info().legacyCrc) {
+                    std::cout << "  Written with the old CRC-32 table; verify and repair check it with that table" << std::endl;
+                }
+                continue;
+            }
+
+            allValid = false;
+            std::cout << "DAMAGED" << std::endl;
+            std::cout << "  " << validator.getLastError() << std::endl;
+            for (const auto& damage : validator.damagedBlocks()) {
+                std::cout << "  Block " << damage.blockIndex << ": records " << damage.firstRecord
+                          << "-" << (damage.firstRecord + damage.recordCount - 1)
+                          << ", sectors " << damage.minSector << "-" << damage.maxSector << std::endl;
+            }
+        }
+        return allValid ? 0 : 1;
+    }
+    else if (command == "recover-repair") {
+        std::string mode = (argc >= 4) ? argv[3] : "";
+        if (argc < 4 || argc > 5 || (mode != "replay" && mode != "rollback")) {
+            std::cout << "Error: recover-repair command requires a journal file, replay or rollback, and an optional disk path" << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        RepairJournal journal;
+        RepairJournal::RecoveryMode recoveryMode = (mode == "replay") ? RepairJournal::RecoveryMode::Replay
+                                                                      : RepairJournal::RecoveryMode::Rollback;
+        std::string diskPath = (argc == 5) ? argv[4] : "";
+        if (!journal.recover(argv[2], recoveryMode, diskPath)) {
+            std::cout << "Error: " << journal.getLastError() << std::endl;
+            return 1;
+        }
+        std::cout << (mode == "replay" ? "Replayed " : "Rolled back ") << journal.rangeCount() << " range(s), "
+                  << journal.sectorCount() << " sector(s)" << std::endl;
+        return 0;
+    }
+    else if (command == "sync") {
+        if (argc != 6 && argc != 8) {
+            std::cout << "Error: sync command requires 4 parameters and an optional sector range" << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        std::string sourceDisk = argv[2];
+        std::string targetDisk = argv[3];
+        std::string sourceChecksumFile = argv[4];
+        std::string targetChecksumFile = argv[5];
+
+        DiskSync diskSync(sourceDisk, targetDisk);
+        DiskSyncResult result;
+        bool synced = false;
+        if (argc == 8) {
+            uint64_t startSector, sectorCount;
+            if (!parseUint64(argv[6], startSector) || !parseUint64(argv[7], sectorCount)) {
+                std::cout << "Error: start sector and sector count must be valid numbers" << std::endl;
+                return 1;
+            }
+            std::cout << "Scanning both disks..." << std::endl;
+            synced = diskSync.scanAndSync(startSector, sectorCount, sourceChecksumFile, targetChecksumFile, result);
+        } else {
+            std::cout << "Comparing checksum files..." << std::endl;
+            synced = diskSync.sync(sourceChecksumFile, targetChecksumFile, result);
+        }
+        if (!synced) {
+            std::cout << "Error: " << diskSync.getLastError() << std::endl;
+            return 1;
+        }
+
+        std::cout << "Changed sectors: " << result.changedSectors << " in " << result.changedRanges << " range(s)" << std::endl;
+        std::cout << "Copied sectors: " << result.copiedSectors << " in " << result.transferCount << " transfer(s)" << std::endl;
+        if (result.copiedSectors > 0) {
+            std::cout << "Target synchronized; " << sourceChecksumFile << " now describes it" << std::endl;
+        } else {
+            std::cout << "Target already in sync" << std::endl;
+        }
+        return 0;
+    }
+    else if (command == "scrub") {
+        if (argc < 3 || argc > 7) {
+            std::cout << "Error: scrub command requires a registry file and optional limits" << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        ScrubPolicy policy;
+        for (int i = 3; i < argc; ++i) {
+            std::string option = argv[i];
+            size_t equals = option.find('=');
+            std::string name = option.substr(0, equals);
+            std::string value = (equals == std::string::npos) ? "" : option.substr(equals + 1);
+            uint64_t number = 0;
+            double percent = 0;
+            if (name == "--rate" && parseUint64(value, number)) {
+                policy.throttle.bytesPerSecond = number * 1024 * 1024;
+            } else if (name == "--busy" && parseDouble(value, percent) && percent >= 0 && percent <= 100) {
+                policy.throttle.busyThreshold = percent / 100;
+            } else if (name == "--interval" && parseUint64(value, number)) {
+                policy.passIntervalSeconds = static_cast<uint32_t>(number);
+            } else if (name == "--passes" && parseUint64(value, number)) {
+                policy.passes = static_cast<uint32_t>(number);
+            } else {
+                std::cout << "Error: unknown or invalid option '" << option << "'" << std::endl;
+                return 1;
+            }
+        }
+
+        ScrubDaemon daemon(policy);
+        if (!daemon.loadTargets(argv[2])) {
+            std::cout << "Error: " << daemon.getLastError() << std::endl;
+            return 1;
+        }
+        daemon.setStopToken(scrubStop.token());
+        std::signal(SIGINT, requestScrubStop);
+        std::signal(SIGTERM, requestScrubStop);
+
+        std::cout << "Scrubbing " << daemon.targets().size() << " disk(s); press Ctrl+C to stop" << std::endl;
+        bool problemsFound = false;
+        bool ran = daemon.run([&problemsFound](const ScrubReport& report) {
+            char when[32];
+            std::time_t now = std::time(nullptr);
+            std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+            std::cout << "[" << when << "] " << report.target.diskPath << " pass " << report.pass << ": ";
+            if (!report.error.empty()) {
+                std::cout << "error: " << report.error << std::endl;
+                problemsFound = true;
+                return;
+            }
+            std::cout << (report.completed ? "completed" : "stopped, progress saved")
+                      << (report.stats.resumed ? " (resumed)" : "") << ", " << report.stats.verifiedSectors
+                      << " sectors checked, " << report.stats.corruptedSectors << " corrupted ("
+                      << report.stats.unreadableSectors << " unreadable) in " << report.seconds << " s, "
+                      << report.backoffCount << " pause(s) for foreground I/O" << std::endl;
+            problemsFound = problemsFound || report.stats.corruptedSectors > 0;
+        });
+        if (!ran) {
+            std::cout << "Error: " << daemon.getLastError() << std::endl;
+            return 1;
+        }
+        return problemsFound ? 1 : 0;
+    }
     else {
         std::cout << "Error: Unknown command '" << command << "'" << std::endl;
         printUsage();